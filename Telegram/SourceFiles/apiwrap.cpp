@@ -32,6 +32,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_item_components.h"
 #include "history/feed/history_feed_section.h"
 #include "storage/localstorage.h"
+#include "storage/file_upload.h"
 #include "auth_session.h"
 #include "boxes/confirm_box.h"
 #include "window/notifications_manager.h"
@@ -49,6 +50,7 @@ namespace {
 
 constexpr auto kReloadChannelMembersTimeout = 1000; // 1 second wait before reload members in channel after adding
 constexpr auto kSaveCloudDraftTimeout = 1000; // save draft to the cloud with 1 sec extra delay
+constexpr auto kSaveCloudDraftAnywayTimeout = 5000; // ..but no more than 5 sec after the first dirty draft
 constexpr auto kSaveDraftBeforeQuitTimeout = 1500; // give the app 1.5 secs to save drafts to cloud when quitting
 constexpr auto kSmallDelayMs = 5;
 constexpr auto kUnreadMentionsPreloadIfLess = 5;
@@ -57,6 +59,7 @@ constexpr auto kUnreadMentionsNextRequestLimit = 100;
 constexpr auto kSharedMediaLimit = 100;
 constexpr auto kFeedMessagesLimit = 50;
 constexpr auto kReadFeaturedSetsTimeout = TimeMs(1000);
+constexpr auto kMaxPendingWebPages = 1000;
 constexpr auto kFileLoaderQueueStopTimeout = TimeMs(5000);
 constexpr auto kFeedReadTimeout = TimeMs(1000);
 constexpr auto kStickersByEmojiInvalidateTimeout = TimeMs(60 * 60 * 1000);
@@ -135,6 +138,7 @@ FileLoadTo FileLoadTaskOptions(const ApiWrap::SendOptions &options) {
 ApiWrap::ApiWrap(not_null<AuthSession*> session)
 : _session(session)
 , _messageDataResolveDelayed([this] { resolveMessageDatas(); })
+, _fullPeerResolveDelayed([this] { resolveFullPeers(); })
 , _webPagesTimer([this] { resolveWebPages(); })
 , _draftsSaveTimer([this] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([this] { readFeaturedSets(); })
@@ -561,8 +565,30 @@ void ApiWrap::applyFeedDialogs(
 }
 
 void ApiWrap::requestFullPeer(PeerData *peer) {
-	if (!peer || _fullPeerRequests.contains(peer)) return;
+	if (!peer
+		|| _fullPeerRequests.contains(peer)
+		|| _fullPeerQueue.contains(peer)) {
+		return;
+	}
+
+	// There is no bulk full peer request in the protocol, but opening
+	// a busy members list asks for many of them at once, so collect
+	// the peers for one event-loop turn and send them as one batch.
+	_fullPeerQueue.insert(peer);
+	_fullPeerResolveDelayed.call();
+}
+
+void ApiWrap::resolveFullPeers() {
+	// Inside one batch the requests ride in a single container with
+	// one encryption pass and one TCP write.
+	const auto batch = batchRequests();
+	const auto queue = base::take(_fullPeerQueue);
+	for_const (const auto peer, queue) {
+		sendFullPeerRequest(peer);
+	}
+}
 
+void ApiWrap::sendFullPeerRequest(PeerData *peer) {
 	auto sendRequest = [this, peer] {
 		auto failHandler = [this, peer](const RPCError &error) {
 			_fullPeerRequests.remove(peer);
@@ -781,7 +807,12 @@ void ApiWrap::gotUserFull(UserData *user, const MTPUserFull &result, mtpRequestI
 }
 
 void ApiWrap::requestPeer(PeerData *peer) {
-	if (!peer || _fullPeerRequests.contains(peer) || _peerRequests.contains(peer)) return;
+	if (!peer
+		|| _fullPeerRequests.contains(peer)
+		|| _fullPeerQueue.contains(peer)
+		|| _peerRequests.contains(peer)) {
+		return;
+	}
 
 	auto sendRequest = [this, peer] {
 		auto failHandler = [this, peer](const RPCError &error) {
@@ -899,7 +930,12 @@ void ApiWrap::requestPeers(const QList<PeerData*> &peers) {
 	channels.reserve(peers.size());
 	users.reserve(peers.size());
 	for (QList<PeerData*>::const_iterator i = peers.cbegin(), e = peers.cend(); i != e; ++i) {
-		if (!*i || _fullPeerRequests.contains(*i) || _peerRequests.contains(*i)) continue;
+		if (!*i
+			|| _fullPeerRequests.contains(*i)
+			|| _fullPeerQueue.contains(*i)
+			|| _peerRequests.contains(*i)) {
+			continue;
+		}
 		if ((*i)->isUser()) {
 			users.push_back((*i)->asUser()->inputUser);
 		} else if ((*i)->isChat()) {
@@ -913,6 +949,7 @@ void ApiWrap::requestPeers(const QList<PeerData*> &peers) {
 			App::feedChats(*chats);
 		}
 	};
+	const auto batch = batchRequests();
 	if (!chats.isEmpty()) {
 		request(MTPmessages_GetChats(MTP_vector<MTPint>(chats))).done(handleChats).send();
 	}
@@ -1635,8 +1672,19 @@ void ApiWrap::requestNotifySetting(PeerData *peer) {
 
 void ApiWrap::saveDraftToCloudDelayed(History *history) {
 	_draftsSaveRequestIds.insert(history, 0);
-	if (!_draftsSaveTimer.isActive()) {
+
+	// Debounce, so flipping through a list of chats collects the dirty
+	// drafts into one burst instead of a save request per chat switch.
+	// Sending is forced after kSaveCloudDraftAnywayTimeout so that the
+	// flipping can't postpone the saves forever.
+	const auto ms = getms(true);
+	if (!_draftsSaveStart) {
+		_draftsSaveStart = ms;
+	}
+	if (ms - _draftsSaveStart < kSaveCloudDraftAnywayTimeout) {
 		_draftsSaveTimer.callOnce(kSaveCloudDraftTimeout);
+	} else if (!_draftsSaveTimer.isActive()) {
+		_draftsSaveTimer.callOnce(0);
 	}
 }
 
@@ -1824,6 +1872,10 @@ void ApiWrap::applyAffectedMessages(
 }
 
 void ApiWrap::saveDraftsToCloud() {
+	_draftsSaveStart = 0;
+
+	// Pack the whole burst into one message container / network write.
+	const auto batch = batchRequests();
 	for (auto i = _draftsSaveRequestIds.begin(), e = _draftsSaveRequestIds.end(); i != e; ++i) {
 		if (i.value()) continue; // sent already
 
@@ -1939,6 +1991,27 @@ void ApiWrap::gotStickerSet(uint64 setId, const MTPmessages_StickerSet &result)
 
 void ApiWrap::requestWebPageDelayed(WebPageData *page) {
 	if (page->pendingTill <= 0) return;
+	if (!_webPagesPending.contains(page)
+		&& _webPagesPending.size() >= kMaxPendingWebPages) {
+		// Link-heavy channels can accumulate thousands of pending
+		// previews. Expire the entry with the nearest deadline - it
+		// is the oldest request - instead of growing without bound,
+		// the page just renders as a plain link.
+		auto oldest = _webPagesPending.end();
+		for (auto i = _webPagesPending.begin(); i != _webPagesPending.end(); ++i) {
+			if (i.value() > 0) continue;
+			if (oldest == _webPagesPending.end()
+				|| i.key()->pendingTill < oldest.key()->pendingTill) {
+				oldest = i;
+			}
+		}
+		if (oldest != _webPagesPending.end()) {
+			const auto evicted = oldest.key();
+			_webPagesPending.erase(oldest);
+			evicted->pendingTill = -1; // failed, like webPageEmpty
+			_session->data().notifyWebPageUpdateDelayed(evicted);
+		}
+	}
 	_webPagesPending.insert(page, 0);
 	auto left = (page->pendingTill - unixtime()) * 1000;
 	if (!_webPagesTimer.isActive() || left <= _webPagesTimer.remainingTime()) {
@@ -3748,6 +3821,7 @@ void ApiWrap::uploadAlbumMedia(
 		item->history()->peer->input,
 		media
 	)).done([=](const MTPMessageMedia &result) {
+		_session->uploader().reuseDone(localId);
 		const auto item = App::histItemById(localId);
 		if (!item) {
 			failed();
@@ -3799,7 +3873,9 @@ void ApiWrap::uploadAlbumMedia(
 		} break;
 		}
 	}).fail([=](const RPCError &error) {
-		failed();
+		if (!_session->uploader().reuseFailed(localId, error.type())) {
+			failed();
+		}
 	}).send();
 }
 
@@ -3838,6 +3914,7 @@ void ApiWrap::sendMediaWithRandomId(
 			? MTPmessages_SendMedia::Flag::f_entities
 			: MTPmessages_SendMedia::Flag(0));
 
+	const auto itemId = item->fullId();
 	history->sendRequestId = request(MTPmessages_SendMedia(
 		MTP_flags(flags),
 		history->peer->input,
@@ -3847,8 +3924,13 @@ void ApiWrap::sendMediaWithRandomId(
 		MTP_long(randomId),
 		MTPnullMarkup,
 		sentEntities
-	)).done([=](const MTPUpdates &result) { applyUpdates(result);
-	}).fail([=](const RPCError &error) { sendMessageFail(error);
+	)).done([=](const MTPUpdates &result) {
+		_session->uploader().reuseDone(itemId);
+		applyUpdates(result);
+	}).fail([=](const RPCError &error) {
+		if (!_session->uploader().reuseFailed(itemId, error.type())) {
+			sendMessageFail(error);
+		}
 	}).afterRequest(history->sendRequestId
 	).send();
 }
@@ -307,6 +307,8 @@ private:
 		not_null<Data::Feed*> feed,
 		const MTPmessages_Dialogs &dialogs);
 
+	void resolveFullPeers();
+	void sendFullPeerRequest(PeerData *peer);
 	void gotChatFull(PeerData *peer, const MTPmessages_ChatFull &result, mtpRequestId req);
 	void gotUserFull(UserData *user, const MTPUserFull &result, mtpRequestId req);
 	void applyLastParticipantsList(
@@ -445,6 +447,8 @@ private:
 
 	using PeerRequests = QMap<PeerData*, mtpRequestId>;
 	PeerRequests _fullPeerRequests;
+	OrderedSet<PeerData*> _fullPeerQueue;
+	SingleQueuedInvokation _fullPeerResolveDelayed;
 	PeerRequests _peerRequests;
 
 	PeerRequests _participantsRequests;
@@ -484,6 +488,7 @@ private:
 
 	QMap<History*, mtpRequestId> _draftsSaveRequestIds;
 	base::Timer _draftsSaveTimer;
+	TimeMs _draftsSaveStart = 0;
 
 	base::flat_set<mtpRequestId> _stickerSetDisenableRequests;
 	Stickers::Order _stickersOrder;
@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 #include "styles/style_boxes.h"
 #include "lang/lang_keys.h"
+#include "base/hash_map.h"
 #include "data/data_abstract_structure.h"
 #include "data/data_media_types.h"
 #include "data/data_session.h"
@@ -50,7 +51,9 @@ namespace {
 
 	UserData *self = nullptr;
 
-	using PeersData = QHash<PeerId, PeerData*>;
+	// Every update that mentions a peer looks the id up here, an open
+	// addressing table keeps those lookups out of per-node allocations.
+	using PeersData = base::hash_map<PeerId, PeerData*>;
 	PeersData peersData;
 
 	using MutedPeers = QMap<not_null<PeerData*>, bool>;
@@ -85,6 +88,19 @@ namespace {
 	QPixmap *emoji = nullptr, *emojiLarge = nullptr;
 	style::font monofont;
 
+	QPixmap *loadEmojiSheet(int index) {
+		// Decode straight into the premultiplied format, so that the
+		// paint engine can blit the sprites without converting the
+		// whole sheet on the first draw.
+		auto image = QImage(Ui::Emoji::Filename(index));
+		if (image.format() != QImage::Format_ARGB32_Premultiplied) {
+			image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+		}
+		auto result = new QPixmap(App::pixmapFromImageInPlace(std::move(image)));
+		if (cRetina()) result->setDevicePixelRatio(cRetinaFactor());
+		return result;
+	}
+
 	struct CornersPixmaps {
 		QPixmap p[4];
 	};
@@ -1120,11 +1136,17 @@ namespace {
 		}
 	}
 
+	void reservePeers(int count) {
+		if (count > 0) {
+			peersData.reserve(count);
+		}
+	}
+
 	PeerData *peer(const PeerId &id, PeerData::LoadedStatus restriction) {
 		if (!id) return nullptr;
 
-		auto i = peersData.constFind(id);
-		if (i == peersData.cend()) {
+		auto i = peersData.find(id);
+		if (i == peersData.end()) {
 			PeerData *newData = nullptr;
 			if (peerIsUser(id)) {
 				newData = new UserData(id);
@@ -1136,38 +1158,44 @@ namespace {
 			Assert(newData != nullptr);
 
 			newData->input = MTPinputPeer(MTP_inputPeerEmpty());
-			i = peersData.insert(id, newData);
+			i = peersData.emplace(id, newData).first;
 		}
 		switch (restriction) {
 		case PeerData::MinimalLoaded: {
-			if (i.value()->loadedStatus == PeerData::NotLoaded) {
+			if (i->second->loadedStatus == PeerData::NotLoaded) {
 				return nullptr;
 			}
 		} break;
 		case PeerData::FullLoaded: {
-			if (i.value()->loadedStatus != PeerData::FullLoaded) {
+			if (i->second->loadedStatus != PeerData::FullLoaded) {
 				return nullptr;
 			}
 		} break;
 		}
-		return i.value();
+		return i->second;
 	}
 
 	void enumerateUsers(base::lambda<void(UserData*)> action) {
-		for_const (auto peer, peersData) {
+		for (const auto &[peerId, peer] : peersData) {
 			if (auto user = peer->asUser()) {
 				action(user);
 			}
 		}
 	}
 
+	void enumeratePeers(base::lambda<void(PeerData*)> action) {
+		for (const auto &[peerId, peer] : peersData) {
+			action(peer);
+		}
+	}
+
 	UserData *self() {
 		return ::self;
 	}
 
 	PeerData *peerByName(const QString &username) {
 		QString uname(username.trimmed());
-		for_const (PeerData *peer, peersData) {
+		for (const auto &[peerId, peer] : peersData) {
 			if (!peer->userName().compare(uname, Qt::CaseInsensitive)) {
 				return peer;
 			}
@@ -1314,7 +1342,7 @@ namespace {
 		cSetSavedPeersByTime(SavedPeersByTime());
 		cSetRecentInlineBots(RecentInlineBots());
 
-		for_const (auto peer, ::peersData) {
+		for (const auto &[peerId, peer] : ::peersData) {
 			delete peer;
 		}
 		::peersData.clear();
@@ -1471,24 +1499,15 @@ namespace {
 	}
 
 	void initMedia() {
-		if (!::monofont) {
-			QString family;
-			tryFontFamily(family, qsl("Consolas"));
-			tryFontFamily(family, qsl("Liberation Mono"));
-			tryFontFamily(family, qsl("Menlo"));
-			tryFontFamily(family, qsl("Courier"));
-			if (family.isEmpty()) family = QFontDatabase::systemFont(QFontDatabase::FixedFont).family();
-			::monofont = style::font(st::normalFont->f.pixelSize(), 0, family);
-		}
+		// The monospace font is resolved lazily in App::monofont() -
+		// probing font families goes through the system font database
+		// and may read font files from disk, while the font itself is
+		// only needed once a code block is laid out.
 		Ui::Emoji::Init();
-		if (!::emoji) {
-			::emoji = new QPixmap(Ui::Emoji::Filename(Ui::Emoji::Index()));
-            if (cRetina()) ::emoji->setDevicePixelRatio(cRetinaFactor());
-		}
-		if (!::emojiLarge) {
-			::emojiLarge = new QPixmap(Ui::Emoji::Filename(Ui::Emoji::Index() + 1));
-			if (cRetina()) ::emojiLarge->setDevicePixelRatio(cRetinaFactor());
-		}
+
+		// The emoji spritesheets are decoded lazily in App::emoji()
+		// and App::emojiLarge() - decoding megabytes of pixels that a
+		// session may never paint doesn't belong on the startup path.
 
 		createCorners();
 
@@ -1595,14 +1614,29 @@ namespace {
 	}
 
 	const style::font &monofont() {
+		if (!::monofont) {
+			QString family;
+			tryFontFamily(family, qsl("Consolas"));
+			tryFontFamily(family, qsl("Liberation Mono"));
+			tryFontFamily(family, qsl("Menlo"));
+			tryFontFamily(family, qsl("Courier"));
+			if (family.isEmpty()) family = QFontDatabase::systemFont(QFontDatabase::FixedFont).family();
+			::monofont = style::font(st::normalFont->f.pixelSize(), 0, family);
+		}
 		return ::monofont;
 	}
 
 	const QPixmap &emoji() {
+		if (!::emoji) {
+			::emoji = ::loadEmojiSheet(Ui::Emoji::Index());
+		}
 		return *::emoji;
 	}
 
 	const QPixmap &emojiLarge() {
+		if (!::emojiLarge) {
+			::emojiLarge = ::loadEmojiSheet(Ui::Emoji::Index() + 1);
+		}
 		return *::emojiLarge;
 	}
 
@@ -95,6 +95,7 @@ namespace App {
 
 	ImagePtr image(const MTPPhotoSize &size);
 
+	void reservePeers(int count);
 	PeerData *peer(const PeerId &id, PeerData::LoadedStatus restriction = PeerData::NotLoaded);
 	inline UserData *user(const PeerId &id, PeerData::LoadedStatus restriction = PeerData::NotLoaded) {
 		return asUser(peer(id, restriction));
@@ -136,6 +137,7 @@ namespace App {
 		return channel(channelId, PeerData::FullLoaded);
 	}
 	void enumerateUsers(base::lambda<void(UserData*)> action);
+	void enumeratePeers(base::lambda<void(PeerData*)> action);
 
 	UserData *self();
 	PeerData *peerByName(const QString &username);
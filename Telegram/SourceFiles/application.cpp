@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 #include "messenger.h"
 #include "base/timer.h"
+#include "ui/paint_profiler.h"
 #include "core/update_checker.h"
 #include "core/crash_report_window.h"
 
@@ -58,6 +59,72 @@ QString _escapeFrom7bit(const QString &str) {
 	return result;
 }
 
+constexpr auto kSharedCommandsSize = 4096;
+constexpr auto kSharedCommandsProbeTimeout = 1000;
+
+// Layout of the shared commands segment, followed by the commands
+// bytes. All fields are written under QSharedMemory::lock().
+struct SharedCommandsHeader {
+	quint64 primaryPid;
+	quint32 quitRequested;
+	quint32 commandsLength;
+};
+
+// Blocks on the semaphore in the primary instance and forwards the
+// commands written by second launches to the main thread.
+class SharedCommandsThread : public QThread {
+public:
+	SharedCommandsThread(
+		Application *application,
+		not_null<QSharedMemory*> memory,
+		not_null<QSystemSemaphore*> semaphore)
+	: _application(application)
+	, _memory(memory)
+	, _semaphore(semaphore) {
+	}
+
+	void run() override {
+		while (true) {
+			_semaphore->acquire();
+
+			auto commands = QByteArray();
+			_memory->lock();
+			const auto header = static_cast<SharedCommandsHeader*>(
+				_memory->data());
+			const auto quit = (header->quitRequested != 0);
+
+			// Never trust the length written by another process, a
+			// corrupt or version-mismatched writer must not make us
+			// read past the segment.
+			constexpr auto kCapacity = quint32(kSharedCommandsSize
+				- sizeof(SharedCommandsHeader));
+			const auto length = qMin(header->commandsLength, kCapacity);
+			if (!quit && length > 0) {
+				commands = QByteArray(
+					reinterpret_cast<const char*>(header + 1),
+					length);
+			}
+			header->commandsLength = 0;
+			_memory->unlock();
+
+			if (quit) {
+				return;
+			} else if (!commands.isEmpty()) {
+				const auto application = _application;
+				crl::on_main(application, [=] {
+					application->processSharedCommands(commands);
+				});
+			}
+		}
+	}
+
+private:
+	Application *_application = nullptr;
+	not_null<QSharedMemory*> _memory;
+	not_null<QSystemSemaphore*> _semaphore;
+
+};
+
 } // namespace
 
 Application::Application(
@@ -93,6 +160,8 @@ Application::Application(
 	if (cManyInstance()) {
 		LOG(("Many instance allowed, starting..."));
 		singleInstanceChecked();
+	} else if (trySharedMemoryHandshake()) {
+		LOG(("Shared memory handshake done, activating the running instance and quitting..."));
 	} else {
         LOG(("Connecting local socket to %1...").arg(_localServerName));
 		_localSocket.connectToServer(_localServerName);
@@ -108,10 +177,23 @@ bool Application::event(QEvent *e) {
 	return QApplication::event(e);
 }
 
-void Application::socketConnected() {
-	LOG(("Socket connected, this is not the first application instance, sending show command..."));
-	_secondInstance = true;
+bool Application::notify(QObject *receiver, QEvent *e) {
+	if (e->type() == QEvent::Paint
+		&& Ui::PaintProfiler::Enabled()
+		&& receiver->isWidgetType()) {
+		// The class name is taken before the paint - the widget could
+		// be destroyed while handling its paint event.
+		auto className = QByteArray(receiver->metaObject()->className());
+		auto timer = QElapsedTimer();
+		timer.start();
+		const auto result = QApplication::notify(receiver, e);
+		Ui::PaintProfiler::RegisterPaint(receiver, className, timer.nsecsElapsed());
+		return result;
+	}
+	return QApplication::notify(receiver, e);
+}
 
+QString Application::instanceCommands() const {
 	QString commands;
 	const QStringList &lst(cSendPaths());
 	for (QStringList::const_iterator i = lst.cbegin(), e = lst.cend(); i != e; ++i) {
@@ -121,7 +203,142 @@ void Application::socketConnected() {
 		commands += qsl("OPEN:") + _escapeTo7bit(cStartUrl()) + ';';
 	}
 	commands += qsl("CMD:show;");
+	return commands;
+}
+
+bool Application::trySharedMemoryHandshake() {
+	QSharedMemory memory(_localServerName + qsl("-shm"));
+	if (!memory.attach()) {
+		return false;
+	}
+
+	// On Linux and macOS the segment outlives a crashed primary
+	// instance, so the pid written in the header may be dead already.
+	// Confirm someone actually listens on the local socket before
+	// trusting the segment - the socket path below knows how to
+	// reclaim the server name on the first launch after a crash.
+	{
+		QLocalSocket probe;
+		probe.connectToServer(_localServerName);
+		if (!probe.waitForConnected(kSharedCommandsProbeTimeout)) {
+			LOG(("Shared commands segment found, but no one listens on the local socket, falling back..."));
+			memory.detach();
+			return false;
+		}
+		probe.disconnectFromServer();
+	}
+
+	const auto commands = instanceCommands().toLatin1();
+
+	auto pid = quint64(0);
+	auto written = false;
+	memory.lock();
+	const auto header = static_cast<SharedCommandsHeader*>(memory.data());
+	if (!header->quitRequested
+		&& (sizeof(SharedCommandsHeader)
+			+ header->commandsLength
+			+ commands.size() <= kSharedCommandsSize)) {
+		memcpy(
+			reinterpret_cast<char*>(header + 1) + header->commandsLength,
+			commands.constData(),
+			commands.size());
+		header->commandsLength += commands.size();
+		pid = header->primaryPid;
+		written = true;
+	}
+	memory.unlock();
+	memory.detach();
+	if (!written) {
+		// The segment is full or the primary instance is quitting,
+		// take the slow local socket path instead.
+		return false;
+	}
+	QSystemSemaphore(_localServerName + qsl("-sem"), 0).release();
+	psActivateProcess(pid);
+	App::quit();
+	return true;
+}
+
+void Application::startSharedCommandsWatcher() {
+	_sharedCommands = std::make_unique<QSharedMemory>(
+		_localServerName + qsl("-shm"));
+	if (!_sharedCommands->create(kSharedCommandsSize)) {
+		if (_sharedCommands->error() == QSharedMemory::AlreadyExists) {
+			// A segment left by a crashed instance, reclaim it.
+			_sharedCommands->attach();
+			_sharedCommands->detach();
+		}
+		if (!_sharedCommands->create(kSharedCommandsSize)) {
+			LOG(("Application Warning: could not create shared commands segment, error: %1").arg(_sharedCommands->errorString()));
+			_sharedCommands = nullptr;
+			return;
+		}
+	}
+	_sharedCommands->lock();
+	memset(_sharedCommands->data(), 0, kSharedCommandsSize);
+	const auto header = static_cast<SharedCommandsHeader*>(
+		_sharedCommands->data());
+	header->primaryPid = quint64(QCoreApplication::applicationPid());
+	_sharedCommands->unlock();
+
+	_sharedCommandsSemaphore = std::make_unique<QSystemSemaphore>(
+		_localServerName + qsl("-sem"),
+		0,
+		QSystemSemaphore::Create);
+	_sharedCommandsThread = std::make_unique<SharedCommandsThread>(
+		this,
+		_sharedCommands.get(),
+		_sharedCommandsSemaphore.get());
+	_sharedCommandsThread->start();
+}
 
+void Application::processSharedCommands(const QByteArray &commands) {
+	// Mirrors readClients(), only there is no client to respond to -
+	// the second instance has already activated us and quit.
+	QString startUrl;
+	QStringList toSend;
+	QString cmds(QString::fromLatin1(commands));
+	int32 from = 0, l = cmds.length();
+	for (int32 to = cmds.indexOf(QChar(';'), from); to >= from; to = (from < l) ? cmds.indexOf(QChar(';'), from) : -1) {
+		QStringRef cmd(&cmds, from, to - from);
+		if (cmd.startsWith(qsl("CMD:"))) {
+			Sandbox::execExternal(cmds.mid(from + 4, to - from - 4));
+		} else if (cmd.startsWith(qsl("SEND:"))) {
+			if (cSendPaths().isEmpty()) {
+				toSend.append(_escapeFrom7bit(cmds.mid(from + 5, to - from - 5)));
+			}
+		} else if (cmd.startsWith(qsl("OPEN:"))) {
+			if (cStartUrl().isEmpty()) {
+				startUrl = _escapeFrom7bit(cmds.mid(from + 5, to - from - 5)).mid(0, 8192);
+			}
+		} else {
+			LOG(("Application Error: unknown command %1 passed in shared memory").arg(QString(cmd.constData(), cmd.length())));
+		}
+		from = to + 1;
+	}
+	if (!toSend.isEmpty()) {
+		QStringList paths(cSendPaths());
+		paths.append(toSend);
+		cSetSendPaths(paths);
+	}
+	if (!cSendPaths().isEmpty()) {
+		if (App::wnd()) {
+			App::wnd()->sendPaths();
+		}
+	}
+	if (!startUrl.isEmpty()) {
+		cSetStartUrl(startUrl);
+	}
+	if (auto messenger = Messenger::InstancePointer()) {
+		messenger->checkStartUrl();
+	}
+}
+
+void Application::socketConnected() {
+	LOG(("Socket connected, this is not the first application instance, sending show command..."));
+	_secondInstance = true;
+
+	const auto commands = instanceCommands();
 	DEBUG_LOG(("Application Info: writing commands %1").arg(commands));
 	_localSocket.write(commands.toLatin1());
 }
@@ -184,6 +401,8 @@ void Application::socketError(QLocalSocket::LocalSocketError e) {
 	}
 #endif // !TDESKTOP_DISABLE_AUTOUPDATE
 
+	startSharedCommandsWatcher();
+
 	singleInstanceChecked();
 }
 
@@ -336,6 +555,18 @@ void Application::closeApplication() {
 
 	Sandbox::finish();
 
+	if (_sharedCommandsThread) {
+		_sharedCommands->lock();
+		static_cast<SharedCommandsHeader*>(
+			_sharedCommands->data())->quitRequested = 1;
+		_sharedCommands->unlock();
+		_sharedCommandsSemaphore->release();
+		_sharedCommandsThread->wait();
+		_sharedCommandsThread = nullptr;
+	}
+	_sharedCommandsSemaphore = nullptr;
+	_sharedCommands = nullptr;
+
 	_localServer.close();
 	for (LocalClients::iterator i = _localClients.begin(), e = _localClients.end(); i != e; ++i) {
 		disconnect(i->first, SIGNAL(disconnected()), this, SLOT(removeClients()));
@@ -19,6 +19,7 @@ public:
 	Application(not_null<Core::Launcher*> launcher, int &argc, char **argv);
 
 	bool event(QEvent *e) override;
+	bool notify(QObject *receiver, QEvent *e) override;
 
 	void createMessenger();
 	void refreshGlobalProxy();
@@ -43,6 +44,11 @@ public slots:
 	void startApplication(); // will be done in exec()
 	void closeApplication(); // will be done in aboutToQuit()
 
+public:
+	// Called from the shared commands watcher thread through
+	// crl::on_main, handles commands forwarded by a second instance.
+	void processSharedCommands(const QByteArray &commands);
+
 private:
 	typedef QPair<QLocalSocket*, QByteArray> LocalClient;
 	typedef QList<LocalClient> LocalClients;
@@ -58,6 +64,18 @@ private:
 
 	void singleInstanceChecked();
 
+	// Fast second-launch path: the primary instance exposes a shared
+	// memory segment, a second launch writes its command line there
+	// and releases a semaphore instead of round-tripping the local
+	// socket. The socket stays as server and fallback.
+	QString instanceCommands() const;
+	bool trySharedMemoryHandshake();
+	void startSharedCommandsWatcher();
+
+	std::unique_ptr<QSharedMemory> _sharedCommands;
+	std::unique_ptr<QSystemSemaphore> _sharedCommandsSemaphore;
+	std::unique_ptr<QThread> _sharedCommandsThread;
+
 private:
 #ifndef TDESKTOP_DISABLE_AUTOUPDATE
 	std::unique_ptr<Core::UpdateChecker> _updateChecker;
@@ -0,0 +1,45 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace base {
+namespace benchmark {
+
+// Body of one benchmark case: run the measured operation exactly
+// `iterations` times, the harness times the whole call.
+using Body = void (*)(int iterations);
+
+int Register(const char *name, Body body);
+
+// Runs every registered case and writes one tab-separated line per
+// case to stdout: name, iterations, total ns, ns per iteration.
+// The output is machine-readable on purpose, so the numbers can be
+// collected and compared across releases.
+int RunAll();
+
+// Keeps the optimizer from discarding a computed value.
+template <typename Type>
+inline void DoNotOptimizeAway(const Type &value) {
+	static volatile const void *Sink/* = nullptr*/;
+	Sink = &value;
+}
+
+} // namespace benchmark
+} // namespace base
+
+#define BENCHMARK_CASE_NAMED(Function, Registered, Name) \
+static void Function(int iterations); \
+static const auto Registered = base::benchmark::Register(Name, &Function); \
+static void Function(int iterations)
+
+#define BENCHMARK_CASE_EXPAND(Name, Counter) \
+BENCHMARK_CASE_NAMED(BenchmarkBody##Counter, BenchmarkCase##Counter, Name)
+
+#define BENCHMARK_CASE_PASTE(Name, Counter) BENCHMARK_CASE_EXPAND(Name, Counter)
+
+#define BENCHMARK_CASE(Name) BENCHMARK_CASE_PASTE(Name, __COUNTER__)
@@ -0,0 +1,87 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace base {
+namespace assertion {
+
+// For Assert() / Expects() / Ensures() / Unexpected() to work.
+void log(const char *message, const char *file, int line) {
+	std::cout << message << " (" << file << ":" << line << ")" << std::endl;
+}
+
+} // namespace assertion
+
+namespace benchmark {
+namespace {
+
+struct Case {
+	const char *name;
+	Body body;
+};
+
+std::vector<Case> &Cases() {
+	static auto result = std::vector<Case>();
+	return result;
+}
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t MeasureNs(Body body, int iterations) {
+	const auto from = Clock::now();
+	body(iterations);
+	const auto till = Clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		till - from).count();
+}
+
+} // namespace
+
+int Register(const char *name, Body body) {
+	Cases().push_back({ name, body });
+	return int(Cases().size());
+}
+
+int RunAll() {
+	// Keep doubling the iterations until a case runs long enough for
+	// the ns-per-iteration to be stable against timer granularity.
+	constexpr auto kMinRunNs = std::int64_t(100000000);
+	constexpr auto kMaxIterations = (1 << 24);
+
+	for (const auto &entry : Cases()) {
+		MeasureNs(entry.body, 1); // warmup
+
+		auto iterations = 1;
+		auto elapsed = std::int64_t(0);
+		while (true) {
+			elapsed = MeasureNs(entry.body, iterations);
+			if (elapsed >= kMinRunNs || iterations >= kMaxIterations) {
+				break;
+			}
+			iterations *= 2;
+		}
+		std::cout
+			<< entry.name << '\t'
+			<< iterations << '\t'
+			<< elapsed << '\t'
+			<< (elapsed / iterations) << std::endl;
+	}
+	return 0;
+}
+
+} // namespace benchmark
+} // namespace base
+
+int main(int argc, char *argv[]) {
+	return base::benchmark::RunAll();
+}
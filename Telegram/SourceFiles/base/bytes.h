@@ -81,6 +81,50 @@ inline int compare(const_span a, const_span b) {
 		: memcmp(a.data(), b.data(), aSize);
 }
 
+// Equality check that always reads both spans in full, so the timing
+// doesn't leak the position of the first mismatch. The word-sized loop
+// lets the compiler vectorize it, memcmp-like early exits don't.
+inline bool compare_constant_time(const_span a, const_span b) {
+	Expects(a.size() == b.size());
+
+	const auto size = std::size_t(a.size());
+	const auto ai = reinterpret_cast<const unsigned char*>(a.data());
+	const auto bi = reinterpret_cast<const unsigned char*>(b.data());
+	const auto words = size / sizeof(std::size_t);
+	auto result = std::size_t(0);
+	for (auto word = std::size_t(0); word != words; ++word) {
+		auto wa = std::size_t(), wb = std::size_t();
+		memcpy(&wa, ai + word * sizeof(std::size_t), sizeof(std::size_t));
+		memcpy(&wb, bi + word * sizeof(std::size_t), sizeof(std::size_t));
+		result |= (wa ^ wb);
+	}
+	for (auto i = words * sizeof(std::size_t); i != size; ++i) {
+		result |= std::size_t(ai[i] ^ bi[i]);
+	}
+	return (result == 0);
+}
+
+// XORs the first source.size() bytes of destination with source,
+// word at a time so the compiler can vectorize the loop.
+inline void xor_with(span destination, const_span source) {
+	Expects(destination.size() >= source.size());
+
+	const auto size = std::size_t(source.size());
+	const auto to = reinterpret_cast<unsigned char*>(destination.data());
+	const auto from = reinterpret_cast<const unsigned char*>(source.data());
+	const auto words = size / sizeof(std::size_t);
+	for (auto word = std::size_t(0); word != words; ++word) {
+		auto wa = std::size_t(), wb = std::size_t();
+		memcpy(&wa, to + word * sizeof(std::size_t), sizeof(std::size_t));
+		memcpy(&wb, from + word * sizeof(std::size_t), sizeof(std::size_t));
+		wa ^= wb;
+		memcpy(to + word * sizeof(std::size_t), &wa, sizeof(std::size_t));
+	}
+	for (auto i = words * sizeof(std::size_t); i != size; ++i) {
+		to[i] ^= from[i];
+	}
+}
+
 namespace details {
 
 template <typename Arg>
@@ -7,7 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
-#include <deque>
+#include <vector>
 #include <algorithm>
 #include "base/optional.h"
 
@@ -225,7 +225,11 @@ public:
 
 private:
 	using pair_type = flat_multi_map_pair_type<Key, Type>;
-	using impl_t = std::deque<pair_type>;
+
+	// A vector allocates one contiguous block sized to the content,
+	// while a deque allocates its chunks and the chunk map even for a
+	// single element - and the maps here are almost always tiny.
+	using impl_t = std::vector<pair_type>;
 
 	using iterator_base = flat_multi_map_iterator_base_impl<
 		iterator,
@@ -313,6 +317,12 @@ public:
 	void clear() {
 		impl().clear();
 	}
+	void reserve(size_type count) {
+		impl().reserve(count);
+	}
+	void shrink_to_fit() {
+		impl().shrink_to_fit();
+	}
 
 	iterator begin() {
 		return impl().begin();
@@ -366,7 +376,7 @@ public:
 
 	iterator insert(const value_type &value) {
 		if (empty() || compare()(value.first, front().first)) {
-			impl().push_front(value);
+			impl().insert(impl().begin(), value);
 			return begin();
 		} else if (!compare()(value.first, back().first)) {
 			impl().push_back(value);
@@ -377,7 +387,7 @@ public:
 	}
 	iterator insert(value_type &&value) {
 		if (empty() || compare()(value.first, front().first)) {
-			impl().push_front(std::move(value));
+			impl().insert(impl().begin(), std::move(value));
 			return begin();
 		} else if (!compare()(value.first, back().first)) {
 			impl().push_back(std::move(value));
@@ -414,8 +424,9 @@ public:
 		if (range.first == range.second) {
 			return 0;
 		}
+		auto result = int(range.second - range.first);
 		impl().erase(range.first, range.second);
-		return (range.second - range.first);
+		return result;
 	}
 
 	iterator erase(const_iterator where) {
@@ -602,6 +613,8 @@ public:
 	using parent::size;
 	using parent::empty;
 	using parent::clear;
+	using parent::reserve;
+	using parent::shrink_to_fit;
 	using parent::begin;
 	using parent::end;
 	using parent::cbegin;
@@ -617,7 +630,7 @@ public:
 
 	std::pair<iterator, bool> insert(const value_type &value) {
 		if (this->empty() || this->compare()(value.first, this->front().first)) {
-			this->impl().push_front(value);
+			this->impl().insert(this->impl().begin(), value);
 			return { this->begin(), true };
 		} else if (this->compare()(this->back().first, value.first)) {
 			this->impl().push_back(value);
@@ -631,7 +644,7 @@ public:
 	}
 	std::pair<iterator, bool> insert(value_type &&value) {
 		if (this->empty() || this->compare()(value.first, this->front().first)) {
-			this->impl().push_front(std::move(value));
+			this->impl().insert(this->impl().begin(), std::move(value));
 			return { this->begin(), true };
 		} else if (this->compare()(this->back().first, value.first)) {
 			this->impl().push_back(std::move(value));
@@ -656,7 +669,7 @@ public:
 			const Key &key,
 			Args&&... args) {
 		if (this->empty() || this->compare()(key, this->front().first)) {
-			this->impl().push_front(value_type(
+			this->impl().insert(this->impl().begin(), value_type(
 				key,
 				Type(std::forward<Args>(args)...)));
 			return { this->begin(), true };
@@ -693,7 +706,7 @@ public:
 
 	Type &operator[](const Key &key) {
 		if (this->empty() || this->compare()(key, this->front().first)) {
-			this->impl().push_front({ key, Type() });
+			this->impl().insert(this->impl().begin(), { key, Type() });
 			return this->front().second;
 		} else if (this->compare()(this->back().first, key)) {
 			this->impl().push_back({ key, Type() });
@@ -0,0 +1,72 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include "base/flat_map.h"
+#include <map>
+
+namespace {
+
+// The sizes mirror what the client really stores in these maps:
+// a handful of entries (components, admins), a chat of members, a
+// large dialogs-scale index.
+constexpr int kSmall = 8;
+constexpr int kMedium = 64;
+constexpr int kLarge = 512;
+
+// Insertion order hits the middle of the sorted range as often as the
+// ends, like the object ids the client receives do.
+int shuffledKey(int index, int size) {
+	return (index * 7919) % size;
+}
+
+template <typename Map>
+void buildMap(int iterations, int size) {
+	for (auto i = 0; i != iterations; ++i) {
+		auto map = Map();
+		for (auto j = 0; j != size; ++j) {
+			map.emplace(shuffledKey(j, size), j);
+		}
+		base::benchmark::DoNotOptimizeAway(map);
+	}
+}
+
+template <typename Map>
+void findInMap(int iterations, int size) {
+	auto map = Map();
+	for (auto j = 0; j != size; ++j) {
+		map.emplace(shuffledKey(j, size), j);
+	}
+	auto found = 0;
+	for (auto i = 0; i != iterations; ++i) {
+		const auto it = map.find(shuffledKey(i % size, size));
+		if (it != map.end()) {
+			++found;
+		}
+	}
+	base::benchmark::DoNotOptimizeAway(found);
+}
+
+using FlatMap = base::flat_map<int, int>;
+using StdMap = std::map<int, int>;
+
+} // namespace
+
+BENCHMARK_CASE("flat_map.build.8") { buildMap<FlatMap>(iterations, kSmall); }
+BENCHMARK_CASE("std_map.build.8") { buildMap<StdMap>(iterations, kSmall); }
+BENCHMARK_CASE("flat_map.build.64") { buildMap<FlatMap>(iterations, kMedium); }
+BENCHMARK_CASE("std_map.build.64") { buildMap<StdMap>(iterations, kMedium); }
+BENCHMARK_CASE("flat_map.build.512") { buildMap<FlatMap>(iterations, kLarge); }
+BENCHMARK_CASE("std_map.build.512") { buildMap<StdMap>(iterations, kLarge); }
+
+BENCHMARK_CASE("flat_map.find.8") { findInMap<FlatMap>(iterations, kSmall); }
+BENCHMARK_CASE("std_map.find.8") { findInMap<StdMap>(iterations, kSmall); }
+BENCHMARK_CASE("flat_map.find.64") { findInMap<FlatMap>(iterations, kMedium); }
+BENCHMARK_CASE("std_map.find.64") { findInMap<StdMap>(iterations, kMedium); }
+BENCHMARK_CASE("flat_map.find.512") { findInMap<FlatMap>(iterations, kLarge); }
+BENCHMARK_CASE("std_map.find.512") { findInMap<StdMap>(iterations, kLarge); }
@@ -70,3 +70,44 @@ TEST_CASE("flat_maps custom comparator", "[flat_map]") {
 		checkSorted();
 	}
 }
+
+TEST_CASE("flat_maps reserve and shrink_to_fit", "[flat_map]") {
+	base::flat_map<int, string> v;
+	v.reserve(10);
+	v.emplace(3, "a");
+	v.emplace(1, "b");
+	v.emplace(2, "c");
+
+	REQUIRE(v.size() == 3);
+	REQUIRE(v.find(1)->second == "b");
+	REQUIRE(v.find(2)->second == "c");
+	REQUIRE(v.find(3)->second == "a");
+
+	SECTION("shrinking keeps the content") {
+		v.shrink_to_fit();
+		REQUIRE(v.size() == 3);
+		REQUIRE(v.find(1)->second == "b");
+		REQUIRE(v.find(2)->second == "c");
+		REQUIRE(v.find(3)->second == "a");
+	}
+	SECTION("reserving doesn't add elements") {
+		auto copy = base::flat_map<int, string>();
+		copy.reserve(4);
+		REQUIRE(copy.empty());
+		REQUIRE(copy.begin() == copy.end());
+	}
+}
+
+TEST_CASE("flat_maps removeAll", "[flat_map]") {
+	base::flat_multi_map<int, string> v;
+	v.emplace(1, "a");
+	v.emplace(2, "b");
+	v.emplace(2, "c");
+	v.emplace(3, "d");
+
+	REQUIRE(v.removeAll(2) == 2);
+	REQUIRE(v.size() == 2);
+	REQUIRE(v.findFirst(2) == v.end());
+	REQUIRE(v.findFirst(1) != v.end());
+	REQUIRE(v.findFirst(3) != v.end());
+}
@@ -389,8 +389,17 @@ public:
 		typename Iterator,
 		typename = typename std::iterator_traits<Iterator>::iterator_category>
 	void merge(Iterator first, Iterator last) {
+		// The old content is already sorted, so only sort the added
+		// tail and merge the two parts, instead of a full re-sort.
+		const auto size = impl().size();
 		impl().insert(impl().end(), first, last);
-		std::sort(std::begin(impl()), std::end(impl()), compare());
+		const auto middle = std::begin(impl()) + size;
+		std::sort(middle, std::end(impl()), compare());
+		std::inplace_merge(
+			std::begin(impl()),
+			middle,
+			std::end(impl()),
+			compare());
 	}
 
 	void merge(const flat_multi_set<Type, Compare> &other) {
@@ -56,6 +56,37 @@ TEST_CASE("flat_sets should keep items sorted", "[flat_set]") {
 	}
 }
 
+TEST_CASE("flat_sets merge a range", "[flat_set]") {
+
+	base::flat_set<int> v;
+	v.insert(0);
+	v.insert(2);
+	v.insert(4);
+
+	auto checkSorted = [&] {
+		auto prev = v.begin();
+		REQUIRE(prev != v.end());
+		for (auto i = prev + 1; i != v.end(); prev = i, ++i) {
+			REQUIRE(*prev < *i);
+		}
+	};
+
+	SECTION("an unsorted range with duplicates") {
+		auto other = std::vector<int> { 5, 2, 3, 5, 0 };
+		v.merge(other.begin(), other.end());
+		REQUIRE(v.size() == 5);
+		REQUIRE(v.contains(3));
+		REQUIRE(v.contains(5));
+		checkSorted();
+	}
+	SECTION("an empty range") {
+		auto other = std::vector<int>();
+		v.merge(other.begin(), other.end());
+		REQUIRE(v.size() == 3);
+		checkSorted();
+	}
+}
+
 TEST_CASE("flat_sets with custom comparators", "[flat_set]") {
 	base::flat_set<int_wrap, int_wrap_comparator> v;
 	v.insert({ 0 });
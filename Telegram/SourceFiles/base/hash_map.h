@@ -0,0 +1,449 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace base {
+
+template <
+	typename Key,
+	typename Type,
+	typename Hash = std::hash<Key>>
+class hash_map;
+
+template <typename Key, typename Value>
+struct hash_map_pair_type {
+	using first_type = const Key;
+	using second_type = Value;
+
+	constexpr hash_map_pair_type()
+	: first()
+	, second() {
+	}
+
+	template <typename OtherKey, typename OtherValue>
+	constexpr hash_map_pair_type(OtherKey &&key, OtherValue &&value)
+	: first(std::forward<OtherKey>(key))
+	, second(std::forward<OtherValue>(value)) {
+	}
+
+	hash_map_pair_type(const hash_map_pair_type&) = default;
+	hash_map_pair_type(hash_map_pair_type&&) = default;
+
+	hash_map_pair_type &operator=(const hash_map_pair_type&) = delete;
+	hash_map_pair_type &operator=(hash_map_pair_type &&other) {
+		const_cast<Key&>(first) = other.first;
+		second = std::move(other.second);
+		return *this;
+	}
+
+	void swap(hash_map_pair_type &other) {
+		using std::swap;
+
+		if (this != &other) {
+			std::swap(
+				const_cast<Key&>(first),
+				const_cast<Key&>(other.first));
+			std::swap(second, other.second);
+		}
+	}
+
+	const Key first;
+	Value second;
+};
+
+// An open addressing hash map that keeps all the entries in one flat
+// array of slots with linear probing, so a lookup walks consecutive
+// memory instead of chasing per-node allocations. Each slot remembers
+// how far its entry sits from the home bucket and an insert displaces
+// entries that sit nearer than itself (robin hood hashing), which keeps
+// the probe sequences short even at high load. Removing an entry shifts
+// the rest of its run back, there are no tombstones.
+//
+// Insertion and removal invalidate all the iterators, the entries are
+// enumerated in an unspecified order.
+template <typename Key, typename Type, typename Hash>
+class hash_map {
+	struct Slot;
+
+public:
+	using value_type = hash_map_pair_type<Key, Type>;
+	using size_type = std::size_t;
+
+	class const_iterator;
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = hash_map::value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = value_type*;
+		using reference = value_type&;
+
+		iterator() = default;
+
+		reference operator*() const {
+			return *_slot->entry();
+		}
+		pointer operator->() const {
+			return _slot->entry();
+		}
+		iterator &operator++() {
+			++_slot;
+			skipEmpty();
+			return *this;
+		}
+		iterator operator++(int) {
+			auto result = *this;
+			++*this;
+			return result;
+		}
+		bool operator==(const iterator &other) const {
+			return _slot == other._slot;
+		}
+		bool operator!=(const iterator &other) const {
+			return !(*this == other);
+		}
+
+	private:
+		iterator(Slot *slot, Slot *end) : _slot(slot), _end(end) {
+			skipEmpty();
+		}
+		void skipEmpty() {
+			while (_slot != _end && !_slot->distance) {
+				++_slot;
+			}
+		}
+
+		Slot *_slot = nullptr;
+		Slot *_end = nullptr;
+
+		friend class hash_map;
+		friend class const_iterator;
+
+	};
+	class const_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = hash_map::value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+
+		const_iterator() = default;
+		const_iterator(iterator other)
+		: _slot(other._slot)
+		, _end(other._end) {
+		}
+
+		reference operator*() const {
+			return *_slot->entry();
+		}
+		pointer operator->() const {
+			return _slot->entry();
+		}
+		const_iterator &operator++() {
+			++_slot;
+			skipEmpty();
+			return *this;
+		}
+		const_iterator operator++(int) {
+			auto result = *this;
+			++*this;
+			return result;
+		}
+		bool operator==(const const_iterator &other) const {
+			return _slot == other._slot;
+		}
+		bool operator!=(const const_iterator &other) const {
+			return !(*this == other);
+		}
+
+	private:
+		const_iterator(const Slot *slot, const Slot *end)
+		: _slot(slot)
+		, _end(end) {
+			skipEmpty();
+		}
+		void skipEmpty() {
+			while (_slot != _end && !_slot->distance) {
+				++_slot;
+			}
+		}
+
+		const Slot *_slot = nullptr;
+		const Slot *_end = nullptr;
+
+		friend class hash_map;
+
+	};
+
+	hash_map() = default;
+	hash_map(const hash_map &other) {
+		if (!other._count) {
+			return;
+		}
+		rehash(other._buckets);
+		for (const auto &value : other) {
+			placeValue(value_type(value.first, value.second));
+		}
+		_count = other._count;
+	}
+	hash_map(hash_map &&other)
+	: _slots(std::move(other._slots))
+	, _buckets(std::exchange(other._buckets, 0))
+	, _count(std::exchange(other._count, 0)) {
+	}
+	hash_map &operator=(const hash_map &other) {
+		if (this != &other) {
+			auto copy = other;
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	hash_map &operator=(hash_map &&other) {
+		if (this != &other) {
+			clear();
+			_slots = std::move(other._slots);
+			_buckets = std::exchange(other._buckets, 0);
+			_count = std::exchange(other._count, 0);
+		}
+		return *this;
+	}
+	~hash_map() {
+		clear();
+	}
+
+	size_type size() const {
+		return _count;
+	}
+	bool empty() const {
+		return !_count;
+	}
+	void clear() {
+		if (!_count) {
+			return;
+		}
+		for (auto i = size_type(0); i != _buckets; ++i) {
+			auto &slot = _slots[i];
+			if (slot.distance) {
+				slot.entry()->~value_type();
+				slot.distance = 0;
+			}
+		}
+		_count = 0;
+	}
+	void reserve(size_type count) {
+		if (count * 4 > _buckets * 3) {
+			rehash(bucketsFor(count));
+		}
+	}
+
+	iterator begin() {
+		return { _slots.get(), endSlot() };
+	}
+	iterator end() {
+		return { endSlot(), endSlot() };
+	}
+	const_iterator begin() const {
+		return { _slots.get(), endSlot() };
+	}
+	const_iterator end() const {
+		return { endSlot(), endSlot() };
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator cend() const {
+		return end();
+	}
+
+	iterator find(const Key &key) {
+		return { findSlot(key), endSlot() };
+	}
+	const_iterator find(const Key &key) const {
+		return { findSlot(key), endSlot() };
+	}
+	bool contains(const Key &key) const {
+		return findSlot(key) != endSlot();
+	}
+
+	std::pair<iterator, bool> insert(value_type &&value) {
+		if (const auto already = find(value.first); already != end()) {
+			return { already, false };
+		}
+		reserve(_count + 1);
+		const auto key = value.first;
+		placeValue(std::move(value));
+		++_count;
+		return { find(key), true };
+	}
+	template <typename ...Args>
+	std::pair<iterator, bool> emplace(const Key &key, Args &&...args) {
+		if (const auto already = find(key); already != end()) {
+			return { already, false };
+		}
+		reserve(_count + 1);
+		placeValue(value_type(key, Type(std::forward<Args>(args)...)));
+		++_count;
+		return { find(key), true };
+	}
+
+	Type &operator[](const Key &key) {
+		return emplace(key).first->second;
+	}
+
+	bool remove(const Key &key) {
+		const auto slot = findSlot(key);
+		if (slot == endSlot()) {
+			return false;
+		}
+		eraseSlot(slot);
+		return true;
+	}
+	void erase(const_iterator where) {
+		eraseSlot(_slots.get() + (where._slot - _slots.get()));
+	}
+
+private:
+	struct Slot {
+		value_type *entry() {
+			return reinterpret_cast<value_type*>(&storage);
+		}
+		const value_type *entry() const {
+			return reinterpret_cast<const value_type*>(&storage);
+		}
+
+		// Zero for an empty slot, one for an entry in its home bucket.
+		unsigned char distance = 0;
+		std::aligned_storage_t<
+			sizeof(value_type),
+			alignof(value_type)> storage;
+	};
+
+	static constexpr auto kMinimalBuckets = size_type(8);
+	static constexpr auto kMaxDistance = size_type(0xFF);
+
+	size_type bucketFor(const Key &key) const {
+		// Fibonacci hashing mixes the identity std::hash of the
+		// builtin id types well enough for power of two bucket counts.
+		constexpr auto kGoldenRatio = std::uint64_t(0x9E3779B97F4A7C15ULL);
+		const auto mixed = std::uint64_t(Hash()(key)) * kGoldenRatio;
+		return size_type(mixed >> 32) & (_buckets - 1);
+	}
+	static size_type bucketsFor(size_type count) {
+		auto result = kMinimalBuckets;
+		while (result * 3 < count * 4) {
+			result *= 2;
+		}
+		return result;
+	}
+
+	Slot *endSlot() const {
+		return _slots.get() + _buckets;
+	}
+	Slot *findSlot(const Key &key) const {
+		if (!_count) {
+			return endSlot();
+		}
+		auto index = bucketFor(key);
+		auto distance = size_type(1);
+		while (true) {
+			const auto &slot = _slots[index];
+			if (slot.distance < distance) {
+				// A robin hood entry for this key would have stolen
+				// the nearer slot, so the key is not in the table.
+				return endSlot();
+			} else if (slot.distance == distance
+				&& slot.entry()->first == key) {
+				return _slots.get() + index;
+			}
+			++distance;
+			index = (index + 1) & (_buckets - 1);
+		}
+	}
+
+	// The caller accounts for _count and ensured both enough capacity
+	// and the absence of the key, this only finds a slot for the value.
+	void placeValue(value_type &&value) {
+		auto index = bucketFor(value.first);
+		auto distance = size_type(1);
+		while (true) {
+			if (distance == kMaxDistance) {
+				// The distance no longer fits in the slot,
+				// grow and retry with the shorter probe sequences.
+				grow();
+				index = bucketFor(value.first);
+				distance = 1;
+				continue;
+			}
+			auto &slot = _slots[index];
+			if (!slot.distance) {
+				new (&slot.storage) value_type(std::move(value));
+				slot.distance = static_cast<unsigned char>(distance);
+				return;
+			} else if (slot.distance < distance) {
+				// This entry sits nearer to its home bucket than we
+				// are to ours, steal its slot and find a place for it
+				// instead, this is what bounds the probe lengths.
+				slot.entry()->swap(value);
+				const auto displaced = size_type(slot.distance);
+				slot.distance = static_cast<unsigned char>(distance);
+				distance = displaced;
+			}
+			++distance;
+			index = (index + 1) & (_buckets - 1);
+		}
+	}
+	void eraseSlot(Slot *slot) {
+		slot->entry()->~value_type();
+		auto index = size_type(slot - _slots.get());
+		while (true) {
+			// Shift the rest of the probe run one slot back so that
+			// lookups never need a tombstone to keep probing through.
+			const auto next = (index + 1) & (_buckets - 1);
+			auto &shifted = _slots[next];
+			if (shifted.distance < 2) {
+				break;
+			}
+			new (&_slots[index].storage) value_type(
+				std::move(*shifted.entry()));
+			_slots[index].distance = shifted.distance - 1;
+			shifted.entry()->~value_type();
+			index = next;
+		}
+		_slots[index].distance = 0;
+		--_count;
+	}
+	void grow() {
+		rehash(_buckets ? (_buckets * 2) : kMinimalBuckets);
+	}
+	void rehash(size_type buckets) {
+		auto old = std::move(_slots);
+		const auto oldBuckets = std::exchange(_buckets, buckets);
+		_slots = std::make_unique<Slot[]>(buckets);
+		for (auto i = size_type(0); i != oldBuckets; ++i) {
+			auto &slot = old[i];
+			if (slot.distance) {
+				placeValue(std::move(*slot.entry()));
+				slot.entry()->~value_type();
+			}
+		}
+	}
+
+	std::unique_ptr<Slot[]> _slots;
+	size_type _buckets = 0;
+	size_type _count = 0;
+
+};
+
+} // namespace base
@@ -0,0 +1,105 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/hash_map.h"
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace std;
+
+TEST_CASE("hash_map insert and find", "[hash_map]") {
+	base::hash_map<int, string> v;
+	REQUIRE(v.empty());
+	REQUIRE(v.find(1) == v.end());
+
+	v.emplace(1, "a");
+	v.emplace(2, "b");
+	v.emplace(3, "c");
+	REQUIRE(v.size() == 3);
+	REQUIRE(v.find(1)->second == "a");
+	REQUIRE(v.find(2)->second == "b");
+	REQUIRE(v.find(3)->second == "c");
+	REQUIRE(v.find(4) == v.end());
+	REQUIRE(v.contains(2));
+	REQUIRE(!v.contains(4));
+
+	SECTION("emplacing an existing key keeps the old value") {
+		auto result = v.emplace(2, "x");
+		REQUIRE(!result.second);
+		REQUIRE(result.first->second == "b");
+		REQUIRE(v.size() == 3);
+	}
+	SECTION("operator[] inserts a default value once") {
+		v[4] = "d";
+		REQUIRE(v.size() == 4);
+		REQUIRE(v[4] == "d");
+		REQUIRE(v.size() == 4);
+	}
+}
+
+TEST_CASE("hash_map remove shifts the probe runs back", "[hash_map]") {
+	base::hash_map<int, int> v;
+	for (auto i = 0; i != 100; ++i) {
+		v.emplace(i, i * 10);
+	}
+	for (auto i = 0; i != 100; i += 2) {
+		REQUIRE(v.remove(i));
+	}
+	REQUIRE(!v.remove(0));
+	REQUIRE(v.size() == 50);
+	for (auto i = 0; i != 100; ++i) {
+		if (i % 2) {
+			REQUIRE(v.find(i)->second == i * 10);
+		} else {
+			REQUIRE(v.find(i) == v.end());
+		}
+	}
+}
+
+TEST_CASE("hash_map grows through rehashes", "[hash_map]") {
+	base::hash_map<int, int> v;
+	for (auto i = 0; i != 10000; ++i) {
+		v.emplace(i, i + 1);
+	}
+	REQUIRE(v.size() == 10000);
+	for (auto i = 0; i != 10000; ++i) {
+		REQUIRE(v.find(i)->second == i + 1);
+	}
+
+	SECTION("iteration visits each entry once") {
+		auto keys = set<int>();
+		for (const auto &[key, value] : v) {
+			REQUIRE(value == key + 1);
+			REQUIRE(keys.emplace(key).second);
+		}
+		REQUIRE(keys.size() == 10000);
+	}
+	SECTION("reserving ahead keeps the content") {
+		v.reserve(100000);
+		REQUIRE(v.size() == 10000);
+		REQUIRE(v.find(9999)->second == 10000);
+	}
+}
+
+TEST_CASE("hash_map owning values", "[hash_map]") {
+	base::hash_map<int, unique_ptr<int>> v;
+	v.emplace(1, make_unique<int>(10));
+	v.emplace(2, make_unique<int>(20));
+
+	auto taken = std::move(v.find(1)->second);
+	v.erase(v.find(1));
+	REQUIRE(v.size() == 1);
+	REQUIRE(*taken == 10);
+
+	v.emplace(3, std::move(taken));
+	REQUIRE(*v.find(3)->second == 10);
+	v.clear();
+	REQUIRE(v.empty());
+}
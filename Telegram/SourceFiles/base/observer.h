@@ -405,6 +405,64 @@ private:
 
 };
 
+// Aggregating observable: producers notify single events, subscribers
+// receive the whole batch queued since the last flush as one vector.
+// During a sync storm that costs each subscriber one call per flush
+// instead of one call per event, and lets it rebuild its state once.
+//
+// Subscribe through batches(), the handler signature is
+// void(const std::vector<EventType>&).
+template <typename EventType>
+class BatchedObservable {
+public:
+	BatchedObservable() = default;
+	BatchedObservable(const BatchedObservable &other) = delete;
+	BatchedObservable &operator=(const BatchedObservable &other) = delete;
+
+	void notify(EventType &&event, bool sync = false) {
+		if (sync) {
+			_pending.push_back(std::move(event));
+			flush();
+			return;
+		}
+		if (!_callHandlers) {
+			_callHandlers = [this] { flush(); };
+		}
+		if (_pending.empty()) {
+			internal::RegisterPendingObservable(&_callHandlers);
+		}
+		_pending.push_back(std::move(event));
+	}
+	void notify(const EventType &event, bool sync = false) {
+		auto copy = event;
+		notify(std::move(copy), sync);
+	}
+
+	Observable<std::vector<EventType>> &batches() const {
+		return _batches;
+	}
+
+	~BatchedObservable() {
+		internal::UnregisterObservable(&_callHandlers);
+	}
+
+private:
+	void flush() {
+		if (_pending.empty()) {
+			return;
+		}
+		// Deliver synchronously - the queueing already happened here,
+		// going through the inner observable queue would add a frame
+		// of latency for every flush.
+		_batches.notify(base::take(_pending), true);
+	}
+
+	std::vector<EventType> _pending;
+	mutable Observable<std::vector<EventType>> _batches;
+	internal::ObservableCallHandlers _callHandlers;
+
+};
+
 class Subscriber {
 protected:
 	template <typename EventType, typename Handler, typename Lambda>
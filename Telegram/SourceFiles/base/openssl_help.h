@@ -207,6 +207,33 @@ inline BigNum operator-(const BigNum &a, const BigNum &b) {
 	return result;
 }
 
+// An incremental SHA256 that can be fed several spans without
+// concatenating them first, reusable through reset().
+class Sha256Digest {
+public:
+	Sha256Digest() {
+		reset();
+	}
+
+	void reset() {
+		SHA256_Init(&_data);
+	}
+	void feed(base::const_byte_span bytes) {
+		SHA256_Update(&_data, bytes.data(), bytes.size());
+	}
+	base::byte_array<SHA256_DIGEST_LENGTH> result() {
+		auto result = base::byte_array<SHA256_DIGEST_LENGTH>();
+		SHA256_Final(
+			reinterpret_cast<unsigned char*>(result.data()),
+			&_data);
+		return result;
+	}
+
+private:
+	SHA256_CTX _data;
+
+};
+
 inline base::byte_array<SHA256_DIGEST_LENGTH> Sha256(base::const_byte_span bytes) {
 	auto result = base::byte_array<SHA256_DIGEST_LENGTH>();
 	SHA256(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), reinterpret_cast<unsigned char*>(result.data()));
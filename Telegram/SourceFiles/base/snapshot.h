@@ -0,0 +1,56 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace base {
+
+// RCU-style publication of immutable snapshots for read-mostly data.
+//
+// Writers (serialized between themselves by their own lock) build a new
+// snapshot and publish() it, readers on any thread load() a reference
+// without blocking and keep using the version they got even while a
+// writer swaps in the next one. Reclamation of the old versions is
+// handled by the shared_ptr reference counts.
+//
+// load() returns nullptr until the first publication.
+template <typename Type>
+class snapshot {
+public:
+	using pointer = std::shared_ptr<const Type>;
+
+	snapshot() = default;
+	snapshot(const snapshot &other) = delete;
+	snapshot &operator=(const snapshot &other) = delete;
+
+	pointer load() const {
+		return std::atomic_load_explicit(
+			&_data,
+			std::memory_order_acquire);
+	}
+
+	template <typename ...Args>
+	void publish(Args &&...args) {
+		store(std::make_shared<const Type>(std::forward<Args>(args)...));
+	}
+
+	void store(pointer data) {
+		std::atomic_store_explicit(
+			&_data,
+			std::move(data),
+			std::memory_order_release);
+	}
+
+private:
+	pointer _data;
+
+};
+
+} // namespace base
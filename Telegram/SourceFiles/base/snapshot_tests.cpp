@@ -0,0 +1,38 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/snapshot.h"
+#include <string>
+
+TEST_CASE("snapshot publication", "[snapshot]") {
+	base::snapshot<std::string> v;
+
+	SECTION("empty before the first publication") {
+		REQUIRE(v.load() == nullptr);
+	}
+
+	SECTION("readers keep the version they loaded") {
+		v.publish("first");
+		const auto loaded = v.load();
+		REQUIRE(loaded != nullptr);
+		REQUIRE(*loaded == "first");
+
+		v.publish("second");
+		REQUIRE(*loaded == "first");
+		REQUIRE(*v.load() == "second");
+	}
+
+	SECTION("storing a prepared snapshot") {
+		v.store(std::make_shared<const std::string>("prepared"));
+		REQUIRE(*v.load() == "prepared");
+
+		v.store(nullptr);
+		REQUIRE(v.load() == nullptr);
+	}
+}
@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "base/timer.h"
 
+#include <map>
+
 namespace base {
 namespace {
 
@@ -17,6 +19,114 @@ QObject *TimersAdjuster() {
 
 } // namespace
 
+// One scheduler per thread keeps all the active timers of that thread
+// ordered by their deadline and arms a single Qt timer for the nearest
+// one, so thousands of live base::Timer instances (ripples, typing
+// timeouts, resend timers) cost one timer registration per thread
+// instead of one each.
+class TimerScheduler final : private QObject {
+public:
+	TimerScheduler();
+
+	static not_null<TimerScheduler*> Current();
+
+	void schedule(not_null<Timer*> timer);
+	void unschedule(not_null<Timer*> timer);
+
+protected:
+	void timerEvent(QTimerEvent *e) override;
+
+private:
+	void fireDue();
+	void rearm(TimeMs now);
+
+	std::multimap<TimeMs, not_null<Timer*>> _queue;
+	int _timerId = 0;
+	TimeMs _armedFor = 0;
+	bool _firing = false;
+
+};
+
+TimerScheduler::TimerScheduler() {
+	connect(
+		TimersAdjuster(),
+		&QObject::destroyed,
+		this,
+		[this] { fireDue(); },
+		Qt::QueuedConnection);
+}
+
+not_null<TimerScheduler*> TimerScheduler::Current() {
+	static thread_local TimerScheduler result;
+	return &result;
+}
+
+void TimerScheduler::schedule(not_null<Timer*> timer) {
+	const auto when = timer->_next;
+	_queue.emplace(when, timer);
+	if (!_firing && (!_timerId || when < _armedFor)) {
+		rearm(getms(true));
+	}
+}
+
+void TimerScheduler::unschedule(not_null<Timer*> timer) {
+	const auto range = _queue.equal_range(timer->_next);
+	for (auto i = range.first; i != range.second; ++i) {
+		if (i->second == timer) {
+			_queue.erase(i);
+			break;
+		}
+	}
+	// Don't bother rearming when the nearest entry goes away, the
+	// armed timer will just find nothing due and rearm itself.
+}
+
+void TimerScheduler::timerEvent(QTimerEvent *e) {
+	if (e->timerId() == _timerId) {
+		killTimer(base::take(_timerId));
+		fireDue();
+	}
+}
+
+void TimerScheduler::fireDue() {
+	const auto now = getms(true);
+
+	// Bound the drain by the count of entries that were due when it
+	// started, so a zero timeout timer restarted from its own callback
+	// fires on the next pass instead of looping here forever.
+	auto due = 0;
+	for (auto i = _queue.begin()
+		; i != _queue.end() && i->first <= now
+		; ++i) {
+		++due;
+	}
+	_firing = true;
+	while (due-- > 0
+		&& !_queue.empty()
+		&& _queue.begin()->first <= now) {
+		const auto timer = _queue.begin()->second;
+		_queue.erase(_queue.begin());
+		timer->fired();
+	}
+	_firing = false;
+	rearm(getms(true));
+}
+
+void TimerScheduler::rearm(TimeMs now) {
+	if (_timerId) {
+		killTimer(base::take(_timerId));
+	}
+	if (_queue.empty()) {
+		_armedFor = 0;
+		return;
+	}
+	const auto nearest = _queue.begin();
+	const auto when = nearest->first;
+	const auto left = (when > now) ? (when - now) : TimeMs(0);
+	_timerId = startTimer(static_cast<int>(left), nearest->second->_type);
+	_armedFor = when;
+}
+
 Timer::Timer(
 	not_null<QThread*> thread,
 	base::lambda<void()> callback)
@@ -29,14 +139,8 @@ Timer::Timer(base::lambda<void()> callback)
 : QObject(nullptr)
 , _callback(std::move(callback))
 , _type(Qt::PreciseTimer)
-, _adjusted(false) {
+, _active(false) {
 	setRepeat(Repeat::Interval);
-	connect(
-		TimersAdjuster(),
-		&QObject::destroyed,
-		this,
-		[this] { adjust(); },
-		Qt::QueuedConnection);
 }
 
 void Timer::start(TimeMs timeout, Qt::TimerType type, Repeat repeat) {
@@ -44,19 +148,17 @@ void Timer::start(TimeMs timeout, Qt::TimerType type, Repeat repeat) {
 
 	_type = type;
 	setRepeat(repeat);
-	_adjusted = false;
 	setTimeout(timeout);
-	_timerId = startTimer(_timeout, _type);
-	if (_timerId) {
-		_next = getms(true) + _timeout;
-	} else {
-		_next = 0;
-	}
+	_next = getms(true) + _timeout;
+	_scheduler = TimerScheduler::Current();
+	_active = true;
+	_scheduler->schedule(this);
 }
 
 void Timer::cancel() {
 	if (isActive()) {
-		killTimer(base::take(_timerId));
+		_active = false;
+		_scheduler->unschedule(this);
 	}
 }
 
@@ -77,15 +179,6 @@ void Timer::Adjust() {
 		&QObject::destroyed);
 }
 
-void Timer::adjust() {
-	auto remaining = remainingTime();
-	if (remaining >= 0) {
-		cancel();
-		_timerId = startTimer(remaining, _type);
-		_adjusted = true;
-	}
-}
-
 void Timer::setTimeout(TimeMs timeout) {
 	Expects(timeout >= 0 && timeout <= std::numeric_limits<int>::max());
 
@@ -96,22 +189,25 @@ int Timer::timeout() const {
 	return _timeout;
 }
 
-void Timer::timerEvent(QTimerEvent *e) {
+void Timer::fired() {
 	if (repeat() == Repeat::Interval) {
-		if (_adjusted) {
-			start(_timeout, _type, repeat());
-		} else {
-			_next = getms(true) + _timeout;
-		}
+		_next = getms(true) + _timeout;
+		_scheduler->schedule(this);
 	} else {
-		cancel();
+		_active = false;
 	}
 
+	// Invoking the callback is the last thing done with this instance,
+	// so it may cancel, restart or even destroy the timer.
 	if (_callback) {
 		_callback();
 	}
 }
 
+Timer::~Timer() {
+	cancel();
+}
+
 int DelayedCallTimer::call(
 		TimeMs timeout,
 		lambda_once<void()> callback,
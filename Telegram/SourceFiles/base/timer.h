@@ -12,6 +12,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace base {
 
+class TimerScheduler;
+
 class Timer final : private QObject {
 public:
 	explicit Timer(
@@ -45,7 +47,7 @@ public:
 	}
 
 	bool isActive() const {
-		return (_timerId != 0);
+		return _active;
 	}
 
 	void cancel();
@@ -53,8 +55,7 @@ public:
 
 	static void Adjust();
 
-protected:
-	void timerEvent(QTimerEvent *e) override;
+	~Timer();
 
 private:
 	enum class Repeat : unsigned {
@@ -62,7 +63,7 @@ private:
 		SingleShot = 1,
 	};
 	void start(TimeMs timeout, Qt::TimerType type, Repeat repeat);
-	void adjust();
+	void fired();
 
 	void setTimeout(TimeMs timeout);
 	int timeout() const;
@@ -74,13 +75,18 @@ private:
 		return static_cast<Repeat>(_repeat);
 	}
 
+	friend class TimerScheduler;
+
 	base::lambda<void()> _callback;
+
+	// The scheduler of the thread this timer was started on, it
+	// multiplexes all the timers of its thread onto a single Qt timer.
+	TimerScheduler *_scheduler = nullptr;
 	TimeMs _next = 0;
 	int _timeout = 0;
-	int _timerId = 0;
 
 	Qt::TimerType _type : 2;
-	bool _adjusted : 1;
+	bool _active : 1;
 	unsigned _repeat : 1;
 
 };
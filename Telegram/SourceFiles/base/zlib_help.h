@@ -374,4 +374,134 @@ private:
 
 };
 
+// A reusable decompression context: the zlib state is allocated once
+// and only reset between unpackings, and the output goes to a caller
+// provided buffer, so repeated unpacking in hot paths (gzip-packed
+// RPC responses, langpack diffs, theme files) is allocation-free.
+// Not thread-safe, each user keeps its own context.
+class StreamingInflate {
+public:
+	// Default window handles gzip wrapped streams as inflateInit2.
+	explicit StreamingInflate(int windowBits = 16 + MAX_WBITS) {
+		_stream.zalloc = nullptr;
+		_stream.zfree = nullptr;
+		_stream.opaque = nullptr;
+		_stream.avail_in = 0;
+		_stream.next_in = nullptr;
+		_error = inflateInit2(&_stream, windowBits);
+		_initialized = (_error == Z_OK);
+	}
+	StreamingInflate(const StreamingInflate &other) = delete;
+	StreamingInflate &operator=(const StreamingInflate &other) = delete;
+
+	bool begin(const char *data, int size) {
+		if (!_initialized || (_error = inflateReset(&_stream)) != Z_OK) {
+			return false;
+		}
+		_stream.avail_in = uInt(size);
+		_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+		_finished = false;
+		return true;
+	}
+
+	// Unpacks the next part of the stream into the provided buffer.
+	// Returns the produced byte count or -1 on a broken stream,
+	// check finished() to know if the whole stream was consumed.
+	int unpackSome(char *to, int toSize) {
+		if (!_initialized || _finished) {
+			return -1;
+		}
+		_stream.avail_out = uInt(toSize);
+		_stream.next_out = reinterpret_cast<Bytef*>(to);
+		_error = inflate(&_stream, Z_NO_FLUSH);
+		if (_error == Z_STREAM_END) {
+			_finished = true;
+		} else if (_error != Z_OK) {
+			return -1;
+		}
+		return toSize - int(_stream.avail_out);
+	}
+
+	bool finished() const {
+		return _finished;
+	}
+	int error() const {
+		return _error;
+	}
+
+	~StreamingInflate() {
+		if (_initialized) {
+			inflateEnd(&_stream);
+		}
+	}
+
+private:
+	z_stream _stream;
+	int _error = Z_OK;
+	bool _initialized = false;
+	bool _finished = false;
+
+};
+
+// The compress-side equivalent, a deflate state reused between
+// packings with the output going to a caller provided buffer.
+class StreamingDeflate {
+public:
+	explicit StreamingDeflate(
+			int level = Z_DEFAULT_COMPRESSION,
+			int windowBits = MAX_WBITS) {
+		_stream.zalloc = nullptr;
+		_stream.zfree = nullptr;
+		_stream.opaque = nullptr;
+		_error = deflateInit2(
+			&_stream,
+			level,
+			Z_DEFLATED,
+			windowBits,
+			8,
+			Z_DEFAULT_STRATEGY);
+		_initialized = (_error == Z_OK);
+	}
+	StreamingDeflate(const StreamingDeflate &other) = delete;
+	StreamingDeflate &operator=(const StreamingDeflate &other) = delete;
+
+	// An upper bound for pack() output, valid for the next call only.
+	int packBound(int size) {
+		return _initialized ? int(deflateBound(&_stream, uLong(size))) : -1;
+	}
+
+	// Packs the whole input in one go, returns the packed size or -1
+	// if the state is broken or the output buffer is too small.
+	int pack(const char *data, int size, char *to, int toSize) {
+		if (!_initialized || (_error = deflateReset(&_stream)) != Z_OK) {
+			return -1;
+		}
+		_stream.avail_in = uInt(size);
+		_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+		_stream.avail_out = uInt(toSize);
+		_stream.next_out = reinterpret_cast<Bytef*>(to);
+		_error = deflate(&_stream, Z_FINISH);
+		if (_error != Z_STREAM_END) {
+			return -1;
+		}
+		return toSize - int(_stream.avail_out);
+	}
+
+	int error() const {
+		return _error;
+	}
+
+	~StreamingDeflate() {
+		if (_initialized) {
+			deflateEnd(&_stream);
+		}
+	}
+
+private:
+	z_stream _stream;
+	int _error = Z_OK;
+	bool _initialized = false;
+
+};
+
 } // namespace zlib
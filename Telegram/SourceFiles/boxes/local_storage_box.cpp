@@ -43,6 +43,7 @@ void LocalStorageBox::updateControls() {
 	} else {
 		rowsHeight = st::linkFont->height + st::localStorageBoxSkip;
 	}
+	rowsHeight += st::linkFont->height + st::localStorageBoxSkip;
 	_clear->setVisible(_imagesCount > 0 || _audiosCount > 0);
 	setDimensions(st::boxWidth, st::localStorageBoxSkip + rowsHeight + _clear->height());
 	_clear->moveToLeft(st::boxPadding.left(), st::localStorageBoxSkip + rowsHeight);
@@ -84,6 +85,18 @@ void LocalStorageBox::paintEvent(QPaintEvent *e) {
 		p.drawTextLeft(st::boxPadding.left(), top, width(), lang(lng_settings_no_data_cached));
 		top += st::boxTextFont->height + st::localStorageBoxSkip;
 	}
+	const auto stats = Local::cacheStats();
+	const auto requests = stats.hits + stats.misses;
+	auto statsText = qsl("Cache hits: %1 of %2 (%3%), read %4, written %5, decrypt %6 ms"
+	).arg(stats.hits
+	).arg(requests
+	).arg(requests ? (stats.hits * 100 / requests) : 0
+	).arg(formatSizeText(stats.bytesRead)
+	).arg(formatSizeText(stats.bytesWritten)
+	).arg(stats.decryptMs);
+	p.drawTextLeft(st::boxPadding.left(), top, width(), statsText);
+	top += st::boxTextFont->height + st::localStorageBoxSkip;
+
 	auto text = ([this]() -> QString {
 		switch (_state) {
 		case State::Clearing: return lang(lng_local_storage_clearing);
@@ -369,6 +369,10 @@ public:
 	virtual bool searchInLocal() {
 		return true;
 	}
+	// Called before a local filtering pass, so that controllers which
+	// build their rows incrementally can materialize the rest first.
+	virtual void prepareLocalSearch() {
+	}
 	bool hasComplexSearch() const;
 	void search(const QString &query);
 
@@ -22,6 +22,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
+constexpr auto kContactsPerPage = 100;
+
 base::flat_set<not_null<UserData*>> GetAlreadyInFromPeer(PeerData *peer) {
 	if (!peer) {
 		return {};
@@ -327,6 +329,7 @@ void ContactsBoxController::prepare() {
 
 	prepareViewHook();
 
+	_limit = kContactsPerPage;
 	rebuildRows();
 
 	auto &sessionData = Auth().data();
@@ -336,24 +339,43 @@ void ContactsBoxController::prepare() {
 }
 
 void ContactsBoxController::rebuildRows() {
-	auto appendList = [this](auto chats) {
-		auto count = 0;
-		for (const auto row : chats->all()) {
-			if (const auto history = row->history()) {
-				if (const auto user = history->peer->asUser()) {
-					if (appendRow(user)) {
-						++count;
-					}
-				}
+	// Rows are built incrementally: creating one for each of many
+	// thousands of contacts up front makes the box open slowly. The
+	// next page is appended when the list is scrolled near the bottom
+	// (loadMoreRows) and all of them before a local search pass
+	// (prepareLocalSearch).
+	auto count = 0;
+	for (const auto row : App::main()->contactsList()->all()) {
+		if (count >= _limit) {
+			break;
+		}
+		if (const auto history = row->history()) {
+			if (const auto user = history->peer->asUser()) {
+				appendRow(user);
+				++count;
 			}
 		}
-		return count;
-	};
-	appendList(App::main()->contactsList());
+	}
 	checkForEmptyRows();
 	delegate()->peerListRefreshRows();
 }
 
+void ContactsBoxController::loadMoreRows() {
+	if (_limit >= App::main()->contactsList()->size()) {
+		return;
+	}
+	_limit += kContactsPerPage;
+	rebuildRows();
+}
+
+void ContactsBoxController::prepareLocalSearch() {
+	auto count = App::main()->contactsList()->size();
+	if (_limit < count) {
+		_limit = count;
+		rebuildRows();
+	}
+}
+
 void ContactsBoxController::checkForEmptyRows() {
 	if (delegate()->peerListFullRowsCount()) {
 		setDescriptionText(QString());
@@ -121,6 +121,8 @@ public:
 	void prepare() override final;
 	std::unique_ptr<PeerListRow> createSearchRow(not_null<PeerData*> peer) override final;
 	void rowClicked(not_null<PeerListRow*> row) override;
+	void loadMoreRows() override;
+	void prepareLocalSearch() override;
 
 protected:
 	virtual std::unique_ptr<PeerListRow> createRow(not_null<UserData*> user);
@@ -134,6 +136,10 @@ private:
 	void checkForEmptyRows();
 	bool appendRow(not_null<UserData*> user);
 
+	// How many contacts from the name-ordered list have rows built.
+	// Grows page by page while scrolling, see loadMoreRows().
+	int _limit = 0;
+
 };
 
 class EditChatAdminsBoxController : public PeerListController, private base::Subscriber {
@@ -38,8 +38,22 @@ void PhotoCropBox::prepare() {
 	addButton(langFactory(lng_cancel), [this] { closeBox(); });
 
 	int32 s = st::boxWideWidth - st::boxPhotoPadding.left() - st::boxPhotoPadding.right();
-	_thumb = App::pixmapFromImageInPlace(_img.scaled(s * cIntRetinaFactor(), s * cIntRetinaFactor(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+
+	// Smooth-scaling a multi-megapixel camera photo takes long enough
+	// to freeze the box, so show a fast-scaled preview right away and
+	// bake the smooth one on a worker. Both scale to the same size, so
+	// the crop geometry stays valid when the pixmap is swapped in.
+	const auto side = s * cIntRetinaFactor();
+	_thumb = App::pixmapFromImageInPlace(_img.scaled(side, side, Qt::KeepAspectRatio, Qt::FastTransformation));
 	_thumb.setDevicePixelRatio(cRetinaFactor());
+	crl::async([=, img = _img] {
+		auto scaled = img.scaled(side, side, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		crl::on_main(this, [=]() mutable {
+			_thumb = App::pixmapFromImageInPlace(std::move(scaled));
+			_thumb.setDevicePixelRatio(cRetinaFactor());
+			update();
+		});
+	});
 	_mask = QImage(_thumb.size(), QImage::Format_ARGB32_Premultiplied);
 	_mask.setDevicePixelRatio(cRetinaFactor());
 	_fade = QImage(_thumb.size(), QImage::Format_ARGB32_Premultiplied);
@@ -241,41 +255,53 @@ void PhotoCropBox::paintEvent(QPaintEvent *e) {
 }
 
 void PhotoCropBox::sendPhoto() {
+	if (_sending) {
+		return;
+	}
+	_sending = true;
+
 	auto from = _img;
 	if (_img.width() < _thumb.width()) {
 		from = _thumb.toImage();
 	}
 	float64 x = float64(_cropx) / _thumbw, y = float64(_cropy) / _thumbh, w = float64(_cropw) / _thumbw;
-	int32 ix = int32(x * from.width()), iy = int32(y * from.height()), iw = int32(w * from.width());
-	if (ix < 0) {
-		ix = 0;
-	}
-	if (ix + iw > from.width()) {
-		iw = from.width() - ix;
-	}
-	if (iy < 0) {
-		iy = 0;
-	}
-	if (iy + iw > from.height()) {
-		iw = from.height() - iy;
-	}
-	int32 offset = ix * from.depth() / 8 + iy * from.bytesPerLine();
-	QImage cropped(from.constBits() + offset, iw, iw, from.bytesPerLine(), from.format()), tosend;
-	if (from.format() == QImage::Format_Indexed8) {
-		cropped.setColorCount(from.colorCount());
-		cropped.setColorTable(from.colorTable());
-	}
-	if (cropped.width() > 1280) {
-		tosend = cropped.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-	} else if (cropped.width() < 320) {
-		tosend = cropped.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-	} else {
-		tosend = cropped.copy();
-	}
 
-	auto weak = make_weak(this);
-	_readyImages.fire(std::move(tosend));
-	if (weak) {
-		closeBox();
-	}
+	// Cropping and smooth-scaling the full-resolution image can take
+	// seconds for a camera photo, so bake the result on a worker and
+	// close the box only when it is ready.
+	crl::async([=] {
+		int32 ix = int32(x * from.width()), iy = int32(y * from.height()), iw = int32(w * from.width());
+		if (ix < 0) {
+			ix = 0;
+		}
+		if (ix + iw > from.width()) {
+			iw = from.width() - ix;
+		}
+		if (iy < 0) {
+			iy = 0;
+		}
+		if (iy + iw > from.height()) {
+			iw = from.height() - iy;
+		}
+		int32 offset = ix * from.depth() / 8 + iy * from.bytesPerLine();
+		QImage cropped(from.constBits() + offset, iw, iw, from.bytesPerLine(), from.format()), tosend;
+		if (from.format() == QImage::Format_Indexed8) {
+			cropped.setColorCount(from.colorCount());
+			cropped.setColorTable(from.colorTable());
+		}
+		if (cropped.width() > 1280) {
+			tosend = cropped.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		} else if (cropped.width() < 320) {
+			tosend = cropped.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		} else {
+			tosend = cropped.copy();
+		}
+		crl::on_main(this, [=]() mutable {
+			auto weak = make_weak(this);
+			_readyImages.fire(std::move(tosend));
+			if (weak) {
+				closeBox();
+			}
+		});
+	});
 }
@@ -32,6 +32,7 @@ private:
 	void sendPhoto();
 
 	QString _title;
+	bool _sending = false;
 	int32 _downState = 0;
 	int32 _thumbx, _thumby, _thumbw, _thumbh;
 	int32 _cropx, _cropy, _cropw;
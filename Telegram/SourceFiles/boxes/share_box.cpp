@@ -723,6 +723,9 @@ void ShareBox::Inner::updateFilter(QString filter) {
 	auto words = TextUtilities::PrepareSearchWords(_lastQuery);
 	filter = words.isEmpty() ? QString() : words.join(' ');
 	if (_filter != filter) {
+		const auto refine = !_filter.isEmpty()
+			&& !filter.isEmpty()
+			&& filter.startsWith(_filter);
 		_filter = filter;
 
 		_byUsernameFiltered.clear();
@@ -736,39 +739,54 @@ void ShareBox::Inner::updateFilter(QString filter) {
 		} else {
 			QStringList::const_iterator fb = words.cbegin(), fe = words.cend(), fi;
 
-			_filtered.clear();
-			if (!words.isEmpty()) {
-				const Dialogs::List *toFilter = nullptr;
-				if (!_chatsIndexed->isEmpty()) {
-					for (fi = fb; fi != fe; ++fi) {
-						auto found = _chatsIndexed->filtered(fi->at(0));
-						if (found->isEmpty()) {
-							toFilter = nullptr;
+			auto matches = [&](Dialogs::Row *row) {
+				auto &nameWords = row->entry()->chatsListNameWords();
+				auto nb = nameWords.cbegin(), ne = nameWords.cend(), ni = nb;
+				for (fi = fb; fi != fe; ++fi) {
+					for (ni = nb; ni != ne; ++ni) {
+						if (ni->startsWith(*fi)) {
 							break;
 						}
-						if (!toFilter || toFilter->size() > found->size()) {
-							toFilter = found;
-						}
+					}
+					if (ni == ne) {
+						return false;
+					}
+				}
+				return true;
+			};
+			if (refine) {
+				// Typing on can only narrow the result set down, so the
+				// previous matches are refiltered in place instead of
+				// walking the whole first-letter bucket again.
+				auto all = base::take(_filtered);
+				_filtered.reserve(all.size());
+				for (const auto row : all) {
+					if (matches(row)) {
+						_filtered.push_back(row);
 					}
 				}
-				if (toFilter) {
-					_filtered.reserve(toFilter->size());
-					for (const auto row : *toFilter) {
-						auto &nameWords = row->entry()->chatsListNameWords();
-						auto nb = nameWords.cbegin(), ne = nameWords.cend(), ni = nb;
+			} else {
+				_filtered.clear();
+				if (!words.isEmpty()) {
+					const Dialogs::List *toFilter = nullptr;
+					if (!_chatsIndexed->isEmpty()) {
 						for (fi = fb; fi != fe; ++fi) {
-							auto filterName = *fi;
-							for (ni = nb; ni != ne; ++ni) {
-								if (ni->startsWith(*fi)) {
-									break;
-								}
-							}
-							if (ni == ne) {
+							auto found = _chatsIndexed->filtered(fi->at(0));
+							if (found->isEmpty()) {
+								toFilter = nullptr;
 								break;
 							}
+							if (!toFilter || toFilter->size() > found->size()) {
+								toFilter = found;
+							}
 						}
-						if (fi == fe) {
-							_filtered.push_back(row);
+					}
+					if (toFilter) {
+						_filtered.reserve(toFilter->size());
+						for (const auto row : *toFilter) {
+							if (matches(row)) {
+								_filtered.push_back(row);
+							}
 						}
 					}
 				}
@@ -399,10 +399,19 @@ void StickerSetBox::Inner::paintEvent(QPaintEvent *e) {
 			if (w < 1) w = 1;
 			if (h < 1) h = 1;
 			QPoint ppos = pos + QPoint((st::stickersSize.width() - w) / 2, (st::stickersSize.height() - h) / 2);
+			// If only the compressed bytes of the sticker are in
+			// memory they are decoded on a worker and the cell stays
+			// a placeholder for a frame or two, so a large set shows
+			// its rows progressively instead of stalling the UI.
+			const auto repaint = [this] { update(); };
 			if (goodThumb) {
-				p.drawPixmapLeft(ppos, width(), doc->thumb->pix(w, h));
+				if (_previewDecoder.ready(doc->thumb, repaint)) {
+					p.drawPixmapLeft(ppos, width(), doc->thumb->pix(w, h));
+				}
 			} else if (!doc->sticker()->img->isNull()) {
-				p.drawPixmapLeft(ppos, width(), doc->sticker()->img->pix(w, h));
+				if (_previewDecoder.ready(doc->sticker()->img, repaint)) {
+					p.drawPixmapLeft(ppos, width(), doc->sticker()->img->pix(w, h));
+				}
 			}
 		}
 	}
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "boxes/abstract_box.h"
 #include "chat_helpers/stickers.h"
+#include "ui/images.h"
 
 class ConfirmBox;
 
@@ -91,6 +92,11 @@ private:
 		return (_setFlags & MTPDstickerSet::Flag::f_masks);
 	}
 
+	// Decodes sticker previews on a worker thread so that previewing
+	// a large set paints rows progressively instead of stalling while
+	// every sticker decodes, see paintEvent().
+	Images::AsyncDecoder _previewDecoder;
+
 	std::vector<Animation> _packOvers;
 	Stickers::Pack _pack;
 	Stickers::ByEmojiMap _emoji;
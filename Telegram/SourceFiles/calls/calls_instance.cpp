@@ -15,6 +15,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "boxes/confirm_box.h"
 #include "calls/calls_call.h"
 #include "calls/calls_panel.h"
+#include "storage/file_download.h"
+#include "storage/localimageloader.h"
 #include "media/media_audio_track.h"
 
 #include "boxes/rate_call_box.h"
@@ -91,6 +93,8 @@ void Instance::destroyCall(not_null<Call*> call) {
 		destroyCurrentPanel();
 		_currentCall.reset();
 		_currentCallChanged.notify(nullptr, true);
+		Auth().downloader().clampBackgroundBandwidth(false);
+		TaskQueue::SetAllWorkersPriority(QThread::NormalPriority);
 
 		if (App::quitting()) {
 			LOG(("Calls::Instance doesn't prevent quit any more."));
@@ -118,6 +122,11 @@ void Instance::createCall(not_null<UserData*> user, Call::Type type) {
 		_currentCall = std::move(call);
 	}
 	_currentCallChanged.notify(_currentCall.get(), true);
+	Auth().downloader().clampBackgroundBandwidth(true);
+
+	// The voip library elevates its audio threads by itself, our part
+	// is to keep the heavy worker threads from competing with them.
+	TaskQueue::SetAllWorkersPriority(QThread::LowPriority);
 	refreshServerConfig();
 	refreshDhConfig();
 }
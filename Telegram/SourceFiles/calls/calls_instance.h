@@ -31,6 +31,9 @@ public:
 	base::Observable<Call*> &currentCallChanged() {
 		return _currentCallChanged;
 	}
+	Call *currentCall() const {
+		return _currentCall.get();
+	}
 
 	base::Observable<FullMsgId> &newServiceMessage() {
 		return _newServiceMessage;
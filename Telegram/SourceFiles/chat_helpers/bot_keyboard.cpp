@@ -202,9 +202,15 @@ bool BotKeyboard::updateMarkup(HistoryItem *to, bool force) {
 	_impl = nullptr;
 	if (auto markup = to->Get<HistoryMessageReplyMarkup>()) {
 		if (!markup->rows.empty()) {
-			_impl = std::make_unique<ReplyKeyboard>(
-				to,
-				std::make_unique<Style>(this, *_st));
+			if (!markup->replyKeyboard) {
+				// The measured keyboard is cached on the markup
+				// component, so showing this chat again reuses it.
+				markup->replyKeyboard = std::make_unique<ReplyKeyboard>(
+					to,
+					std::make_unique<Style>(this, *_st));
+			}
+			_impl = markup->replyKeyboard.get();
+			_impl->clearSelection();
 		}
 	}
 
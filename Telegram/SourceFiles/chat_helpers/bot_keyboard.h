@@ -77,7 +77,10 @@ private:
 	bool _forceReply = false;
 
 	QPoint _lastMousePos;
-	std::unique_ptr<ReplyKeyboard> _impl;
+
+	// Owned by the HistoryMessageReplyMarkup component of the item,
+	// dropped together with it, see HistoryWidget::itemRemoved().
+	ReplyKeyboard *_impl = nullptr;
 
 	const style::BotKeyboardButton *_st = nullptr;
 
@@ -130,6 +130,102 @@ inline int indexOfInFirstN(const T &v, const U &elem, int last) {
 }
 }
 
+bool FieldAutocomplete::mentionIndexStale() const {
+	const auto peer = _chat
+		? static_cast<PeerData*>(_chat)
+		: static_cast<PeerData*>(_channel);
+	if (_mentionIndexPeer != peer
+		|| _mentionIndexInlineBots != _addInlineBots) {
+		return true;
+	}
+	auto size = _addInlineBots ? cRecentInlineBots().size() : 0;
+	if (_chat) {
+		size += int(_chat->participants.size()) + _chat->lastAuthors.size();
+	} else if (_channel && _channel->isMegagroup()) {
+		if (_channel->mgInfo->lastParticipants.empty()
+			|| _channel->lastParticipantsCountOutdated()) {
+			return true;
+		}
+		size += int(_channel->mgInfo->lastParticipants.size());
+	}
+	return (size != _mentionIndexSourceSize);
+}
+
+void FieldAutocomplete::rebuildMentionIndex(TimeId now) {
+	_mentionInlineBotCandidates.clear();
+	_mentionCandidates.clear();
+	_mentionIndex.clear();
+	_mentionIndexPeer = _chat
+		? static_cast<PeerData*>(_chat)
+		: static_cast<PeerData*>(_channel);
+	_mentionIndexInlineBots = _addInlineBots;
+	_mentionIndexSourceSize = _addInlineBots ? cRecentInlineBots().size() : 0;
+
+	if (_addInlineBots) {
+		for_const (auto user, cRecentInlineBots()) {
+			if (user->isInaccessible()) continue;
+			_mentionInlineBotCandidates.push_back(user);
+		}
+	}
+	if (_chat) {
+		auto ordered = QMultiMap<TimeId, not_null<UserData*>>();
+		const auto byOnline = [&](not_null<UserData*> user) {
+			return Data::SortByOnlineValue(user, now);
+		};
+		_mentionIndexSourceSize += int(_chat->participants.size())
+			+ _chat->lastAuthors.size();
+		_mentionCandidates.reserve(_chat->participants.empty()
+			? _chat->lastAuthors.size()
+			: int(_chat->participants.size()));
+		if (_chat->noParticipantInfo()) {
+			Auth().api().requestFullPeer(_chat);
+		} else if (!_chat->participants.empty()) {
+			for (const auto [user, v] : _chat->participants) {
+				if (user->isInaccessible()) continue;
+				ordered.insertMulti(byOnline(user), user);
+			}
+		}
+		for (const auto user : _chat->lastAuthors) {
+			if (user->isInaccessible()) continue;
+			_mentionCandidates.push_back(user);
+			if (!ordered.isEmpty()) {
+				ordered.remove(byOnline(user), user);
+			}
+		}
+		if (!ordered.isEmpty()) {
+			for (auto i = ordered.cend(), b = ordered.cbegin(); i != b;) {
+				--i;
+				_mentionCandidates.push_back(i.value());
+			}
+		}
+	} else if (_channel && _channel->isMegagroup()) {
+		if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
+			Auth().api().requestLastParticipants(_channel);
+		} else {
+			_mentionIndexSourceSize += int(_channel->mgInfo->lastParticipants.size());
+			_mentionCandidates.reserve(int(_channel->mgInfo->lastParticipants.size()));
+			for (const auto user : _channel->mgInfo->lastParticipants) {
+				if (user->isInaccessible()) continue;
+				_mentionCandidates.push_back(user);
+			}
+		}
+	}
+	for_const (auto user, _mentionCandidates) {
+		auto chars = QSet<QChar>();
+		if (!user->username.isEmpty()) {
+			chars.insert(user->username.at(0).toLower());
+		}
+		for (const auto &word : user->nameWords()) {
+			if (!word.isEmpty()) {
+				chars.insert(word.at(0).toLower());
+			}
+		}
+		for_const (auto ch, chars) {
+			_mentionIndex[ch].push_back(user);
+		}
+	}
+}
+
 void FieldAutocomplete::updateFiltered(bool resetScroll) {
 	int32 now = unixtime(), recentInlineBots = 0;
 	internal::MentionRows mrows;
@@ -139,19 +235,6 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 	if (_emoji) {
 		srows = Stickers::GetListByEmoji(_emoji, _stickersSeed);
 	} else if (_type == Type::Mentions) {
-		int maxListSize = _addInlineBots ? cRecentInlineBots().size() : 0;
-		if (_chat) {
-			maxListSize += (_chat->participants.empty() ? _chat->lastAuthors.size() : _chat->participants.size());
-		} else if (_channel && _channel->isMegagroup()) {
-			if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
-			} else {
-				maxListSize += _channel->mgInfo->lastParticipants.size();
-			}
-		}
-		if (maxListSize) {
-			mrows.reserve(maxListSize);
-		}
-
 		auto filterNotPassedByUsername = [this](UserData *user) -> bool {
 			if (user->username.startsWith(_filter, Qt::CaseInsensitive)) {
 				bool exactUsername = (user->username.size() == _filter.size());
@@ -169,58 +252,33 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 			return filterNotPassedByUsername(user);
 		};
 
+		if (mentionIndexStale()) {
+			rebuildMentionIndex(now);
+		}
 		bool listAllSuggestions = _filter.isEmpty();
-		if (_addInlineBots) {
-			for_const (auto user, cRecentInlineBots()) {
-				if (user->isInaccessible()) continue;
-				if (!listAllSuggestions && filterNotPassedByUsername(user)) continue;
-				mrows.push_back(user);
-				++recentInlineBots;
-			}
+		for_const (auto user, _mentionInlineBotCandidates) {
+			if (user->isInaccessible()) continue;
+			if (!listAllSuggestions && filterNotPassedByUsername(user)) continue;
+			mrows.push_back(user);
+			++recentInlineBots;
 		}
-		if (_chat) {
-			auto ordered = QMultiMap<TimeId, not_null<UserData*>>();
-			const auto byOnline = [&](not_null<UserData*> user) {
-				return Data::SortByOnlineValue(user, now);
-			};
-			mrows.reserve(mrows.size() + (_chat->participants.empty() ? _chat->lastAuthors.size() : _chat->participants.size()));
-			if (_chat->noParticipantInfo()) {
-				Auth().api().requestFullPeer(_chat);
-			} else if (!_chat->participants.empty()) {
-				for (const auto [user, v] : _chat->participants) {
-					if (user->isInaccessible()) continue;
-					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
-					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
-					ordered.insertMulti(byOnline(user), user);
-				}
-			}
-			for (const auto user : _chat->lastAuthors) {
+		const auto scanMembers = [&](const internal::MentionRows &members) {
+			mrows.reserve(mrows.size() + members.size());
+			for_const (auto user, members) {
 				if (user->isInaccessible()) continue;
 				if (!listAllSuggestions && filterNotPassedByName(user)) continue;
 				if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
 				mrows.push_back(user);
-				if (!ordered.isEmpty()) {
-					ordered.remove(byOnline(user), user);
-				}
 			}
-			if (!ordered.isEmpty()) {
-				for (auto i = ordered.cend(), b = ordered.cbegin(); i != b;) {
-					--i;
-					mrows.push_back(i.value());
-				}
-			}
-		} else if (_channel && _channel->isMegagroup()) {
-			QMultiMap<int32, UserData*> ordered;
-			if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
-				Auth().api().requestLastParticipants(_channel);
-			} else {
-				mrows.reserve(mrows.size() + _channel->mgInfo->lastParticipants.size());
-				for (const auto user : _channel->mgInfo->lastParticipants) {
-					if (user->isInaccessible()) continue;
-					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
-					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
-					mrows.push_back(user);
-				}
+		};
+		if (listAllSuggestions) {
+			scanMembers(_mentionCandidates);
+		} else {
+			// Any user matching the filter by username or by a name
+			// word sits in the bucket of the filter's first letter.
+			const auto i = _mentionIndex.constFind(_filter.at(0).toLower());
+			if (i != _mentionIndex.cend()) {
+				scanMembers(i.value());
 			}
 		}
 	} else if (_type == Type::Hashtags) {
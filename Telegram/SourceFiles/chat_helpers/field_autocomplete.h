@@ -88,6 +88,8 @@ private:
 
 	void updateFiltered(bool resetScroll = false);
 	void recount(bool resetScroll = false);
+	bool mentionIndexStale() const;
+	void rebuildMentionIndex(TimeId now);
 
 	QPixmap _cache;
 	internal::MentionRows _mrows;
@@ -116,6 +118,17 @@ private:
 	QRect _boundings;
 	bool _addInlineBots;
 
+	// Mention candidates in their final order, bucketed by the
+	// lowercased first letter of the username and of every name word,
+	// so a keystroke scans one bucket instead of all participants.
+	// Rebuilt when the peer or the source list sizes change.
+	internal::MentionRows _mentionInlineBotCandidates;
+	internal::MentionRows _mentionCandidates;
+	QMap<QChar, internal::MentionRows> _mentionIndex;
+	PeerData *_mentionIndexPeer = nullptr;
+	int _mentionIndexSourceSize = -1;
+	bool _mentionIndexInlineBots = false;
+
 	int32 _width, _height;
 	bool _hiding = false;
 
@@ -31,6 +31,11 @@ constexpr auto kSearchRequestDelay = 400;
 constexpr auto kInlineItemsMaxPerRow = 5;
 constexpr auto kSearchBotUsername = str_const("gif");
 
+// How many recent search queries keep their results cached, so that
+// flipping between them shows instantly and sends no duplicate
+// requests. The least recently used query is evicted first.
+constexpr auto kInlineCacheQueriesLimit = 8;
+
 } // namespace
 
 class GifsListWidget::Footer : public TabbedSelector::InnerFooter {
@@ -199,10 +204,33 @@ void GifsListWidget::cancelGifsSearch() {
 	}
 	_inlineRequestTimer.stop();
 	_inlineQuery = _inlineNextQuery = _inlineNextOffset = QString();
-	_inlineCache.clear();
+	// The results of the recent queries are kept, so that typing one
+	// of them again after clearing the field doesn't re-request them.
 	refreshInlineRows(nullptr, true);
 }
 
+void GifsListWidget::touchInlineCache(const QString &query) {
+	_inlineCacheOrder.removeOne(query);
+	_inlineCacheOrder.push_back(query);
+	while (_inlineCacheOrder.size() > kInlineCacheQueriesLimit) {
+		const auto evicted = _inlineCacheOrder.front();
+		if (evicted == _inlineQuery || evicted == _inlineNextQuery) {
+			// The current query is always touched last, so this
+			// shouldn't happen, but never evict it from under the
+			// visible rows.
+			break;
+		}
+		_inlineCacheOrder.pop_front();
+		const auto i = _inlineCache.find(evicted);
+		if (i != _inlineCache.cend()) {
+			for (const auto &result : i->second->results) {
+				_inlineLayouts.erase(result.get());
+			}
+			_inlineCache.erase(i);
+		}
+	}
+}
+
 void GifsListWidget::inlineResultsDone(const MTPmessages_BotResults &result) {
 	_footer->setLoading(false);
 	_inlineRequestId = 0;
@@ -242,6 +270,11 @@ void GifsListWidget::inlineResultsDone(const MTPmessages_BotResults &result) {
 	if (!showInlineRows(!adding)) {
 		it->second->nextOffset = QString();
 	}
+	if (_inlineCache.find(_inlineQuery) != _inlineCache.cend()) {
+		// Touch the cache only after the rows were rebuilt, so an
+		// evicted query can't still be referenced by the rows.
+		touchInlineCache(_inlineQuery);
+	}
 	checkLoadMore();
 }
 
@@ -813,6 +846,7 @@ void GifsListWidget::searchForGifs(const QString &query) {
 			_inlineRequestTimer.stop();
 			_inlineQuery = _inlineNextQuery = query;
 			showInlineRows(true);
+			touchInlineCache(query);
 		} else {
 			_inlineNextQuery = query;
 			_inlineRequestTimer.start(kSearchRequestDelay);
@@ -105,6 +105,7 @@ private:
 	};
 
 	void cancelGifsSearch();
+	void touchInlineCache(const QString &query);
 	void switchToSavedGifs();
 	void refreshSavedGifs();
 	int refreshInlineRows(const InlineCacheEntry *results, bool resultsDeleted);
@@ -157,6 +158,10 @@ private:
 	bool _previewShown = false;
 
 	std::map<QString, std::unique_ptr<InlineCacheEntry>> _inlineCache;
+
+	// Queries of _inlineCache, least recently used first,
+	// see touchInlineCache().
+	QStringList _inlineCacheOrder;
 	QTimer _inlineRequestTimer;
 
 	UserData *_searchBot = nullptr;
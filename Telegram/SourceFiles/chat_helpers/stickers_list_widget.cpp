@@ -810,7 +810,13 @@ int StickersListWidget::countDesiredHeight(int newWidth) {
 		- columnCount * singleWidth
 		- rowsRight
 		- st::buttonRadius;
-	_singleSize = QSize(singleWidth, singleWidth);
+	const auto singleSize = QSize(singleWidth, singleWidth);
+	if (_singleSize != singleSize) {
+		// The previews were pre-rendered for the old cell size.
+		_cellPreviews.clear();
+		_cellPreviewMisses.clear();
+	}
+	_singleSize = singleSize;
 	setColumnCount(columnCount);
 
 	auto visibleHeight = minimalHeight();
@@ -1318,18 +1324,27 @@ void StickersListWidget::paintSticker(Painter &p, Set &set, int y, int index, bo
 	auto w = qMax(qRound(coef * sticker->dimensions.width()), 1);
 	auto h = qMax(qRound(coef * sticker->dimensions.height()), 1);
 	auto ppos = pos + QPoint((_singleSize.width() - w) / 2, (_singleSize.height() - h) / 2);
-	auto paintImage = [&](ImagePtr image) {
-		if (image->loaded()) {
-			p.drawPixmapLeft(
-				ppos,
-				width(),
-				image->pixSingle(w, h, w, h, ImageRoundRadius::None));
+	const auto cached = cellPreview(sticker, w, h);
+	if (!cached.isNull()) {
+		p.drawPixmapLeft(ppos, width(), cached);
+	} else {
+		auto paintImage = [&](ImagePtr image) {
+			if (image->loaded() && previewReady(image)) {
+				auto pix = image->pixSingle(w, h, w, h, ImageRoundRadius::None);
+				if (_cellPreviewMisses.remove(sticker)) {
+					// Remember the scaled preview for the next
+					// session and paint from _cellPreviews since.
+					Local::writeStickerPreview(sticker, pix.toImage());
+					_cellPreviews.insert(sticker, pix);
+				}
+				p.drawPixmapLeft(ppos, width(), pix);
+			}
+		};
+		if (goodThumb) {
+			paintImage(sticker->thumb);
+		} else if (!sticker->sticker()->img->isNull()) {
+			paintImage(sticker->sticker()->img);
 		}
-	};
-	if (goodThumb) {
-		paintImage(sticker->thumb);
-	} else if (!sticker->sticker()->img->isNull()) {
-		paintImage(sticker->sticker()->img);
 	}
 
 	if (selected && stickerHasDeleteButton(set, index)) {
@@ -1342,6 +1357,36 @@ void StickersListWidget::paintSticker(Painter &p, Set &set, int y, int index, bo
 	}
 }
 
+bool StickersListWidget::previewReady(const ImagePtr &image) {
+	// Only the compressed bytes of this preview may be in memory -
+	// then they are decoded on a worker and the cell is repainted when
+	// the pixmap arrives, so that a fast scroll through many sets
+	// doesn't stall the UI thread.
+	return _previewDecoder.ready(image, [this] { update(); });
+}
+
+QPixmap StickersListWidget::cellPreview(DocumentData *document, int w, int h) {
+	const auto i = _cellPreviews.constFind(document);
+	if (i != _cellPreviews.cend()) {
+		return i.value();
+	} else if (_cellPreviewMisses.contains(document)) {
+		return QPixmap();
+	}
+	auto image = Local::readStickerPreview(
+		document,
+		QSize(w, h) * cIntRetinaFactor());
+	if (image.isNull()) {
+		// Remember the miss so that Local isn't asked on every
+		// paint, the preview is written at the first full paint.
+		_cellPreviewMisses.insert(document);
+		return QPixmap();
+	}
+	auto pix = App::pixmapFromImageInPlace(std::move(image));
+	pix.setDevicePixelRatio(cRetinaFactor());
+	_cellPreviews.insert(document, pix);
+	return pix;
+}
+
 int StickersListWidget::stickersRight() const {
 	return stickersLeft() + (_columnCount * _singleSize.width());
 }
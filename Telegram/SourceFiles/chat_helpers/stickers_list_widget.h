@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "chat_helpers/tabbed_selector.h"
 #include "chat_helpers/stickers.h"
+#include "ui/images.h"
 #include "base/variant.h"
 #include "base/timer.h"
 
@@ -209,6 +210,8 @@ private:
 	void paintMegagroupEmptySet(Painter &p, int y, bool buttonSelected, TimeMs ms);
 	void paintSticker(Painter &p, Set &set, int y, int index, bool selected, bool deleteSelected);
 	void paintEmptySearchResults(Painter &p);
+	bool previewReady(const ImagePtr &image);
+	QPixmap cellPreview(DocumentData *document, int w, int h);
 
 	int stickersRight() const;
 	bool featuredHasAddButton(int index) const;
@@ -284,6 +287,16 @@ private:
 	QTimer _previewTimer;
 	bool _previewShown = false;
 
+	// Decodes sticker previews on a worker thread so that the first
+	// paint of a row doesn't block the UI, see previewReady().
+	Images::AsyncDecoder _previewDecoder;
+
+	// Previews pre-rendered at the cell size in a past session, read
+	// back from Local storage so the panel paints without touching
+	// the sticker images at all, see cellPreview().
+	QMap<const DocumentData*, QPixmap> _cellPreviews;
+	QSet<const DocumentData*> _cellPreviewMisses;
+
 	std::map<QString, std::vector<Stickers::Set*>> _searchCache;
 	std::vector<std::pair<uint64, QStringList>> _searchIndex;
 	base::Timer _searchRequestTimer;
@@ -246,11 +246,14 @@ void TabbedSelector::SlideAnimation::paintFrame(QPainter &p, float64 dt, float64
 	p.drawImage(outerLeft / cIntRetinaFactor(), outerTop / cIntRetinaFactor(), _frame, outerLeft, outerTop, outerRight - outerLeft, outerBottom - outerTop);
 }
 
-TabbedSelector::Tab::Tab(SelectorTab type, object_ptr<Inner> widget)
-: _type(type)
-, _widget(std::move(widget))
-, _weak(_widget)
-, _footer(_widget->createFooter()) {
+TabbedSelector::Tab::Tab(SelectorTab type) : _type(type) {
+}
+
+void TabbedSelector::Tab::createWidget(object_ptr<Inner> widget) {
+	Expects(!created());
+	_widget = std::move(widget);
+	_weak = _widget;
+	_footer = _widget->createFooter();
 	_footer->setParent(_widget->parentWidget());
 }
 
@@ -268,53 +271,31 @@ void TabbedSelector::Tab::saveScrollTop() {
 }
 
 TabbedSelector::TabbedSelector(QWidget *parent, not_null<Window::Controller*> controller) : RpWidget(parent)
+, _controller(controller)
 , _tabsSlider(this, st::emojiTabs)
 , _topShadow(this)
 , _bottomShadow(this)
 , _scroll(this, st::emojiScroll)
 , _tabs { {
-	Tab { SelectorTab::Emoji, object_ptr<EmojiListWidget>(this, controller) },
-	Tab { SelectorTab::Stickers, object_ptr<StickersListWidget>(this, controller) },
-	Tab { SelectorTab::Gifs, object_ptr<GifsListWidget>(this, controller) },
+	Tab { SelectorTab::Emoji },
+	Tab { SelectorTab::Stickers },
+	Tab { SelectorTab::Gifs },
 } }
 , _currentTabType(Auth().settings().selectorTab()) {
 	resize(st::emojiPanWidth, st::emojiPanMaxHeight);
 
-	for (auto &tab : _tabs) {
-		tab.footer()->hide();
-		tab.widget()->hide();
-	}
+	// Only the tab shown first is constructed here, the others are
+	// created at the first switch to them - building all three
+	// widgets with their initial data is the slowest part of the
+	// first panel open.
+	ensureTabCreated(_currentTabType);
 
 	createTabsSlider();
 	setWidgetToScrollArea();
 
 	_bottomShadow->setGeometry(_tabsSlider->x(), _scroll->y() + _scroll->height() - st::lineWidth, _tabsSlider->width(), st::lineWidth);
 
-	for (auto &tab : _tabs) {
-		auto widget = tab.widget();
-		connect(widget, &Inner::scrollToY, this, [this, tab = &tab](int y) {
-			if (tab == currentTab()) {
-				scrollToY(y);
-			} else {
-				tab->saveScrollTop(y);
-			}
-		});
-		connect(widget, &Inner::disableScroll, this, [this, tab = &tab](bool disabled) {
-			if (tab == currentTab()) {
-				_scroll->disableScroll(disabled);
-			}
-		});
-	}
-
-	connect(stickers(), SIGNAL(scrollUpdated()), this, SLOT(onScroll()));
 	connect(_scroll, SIGNAL(scrolled()), this, SLOT(onScroll()));
-	connect(emoji(), SIGNAL(selected(EmojiPtr)), this, SIGNAL(emojiSelected(EmojiPtr)));
-	connect(stickers(), SIGNAL(selected(DocumentData*)), this, SIGNAL(stickerSelected(DocumentData*)));
-	connect(stickers(), SIGNAL(checkForHide()), this, SIGNAL(checkForHide()));
-	connect(gifs(), SIGNAL(selected(DocumentData*)), this, SIGNAL(stickerSelected(DocumentData*)));
-	connect(gifs(), SIGNAL(selected(PhotoData*)), this, SIGNAL(photoSelected(PhotoData*)));
-	connect(gifs(), SIGNAL(selected(InlineBots::Result*, UserData*)), this, SIGNAL(inlineResultSelected(InlineBots::Result*, UserData*)));
-	connect(gifs(), SIGNAL(cancelled()), this, SIGNAL(cancelled()));
 
 	_topShadow->raise();
 	_bottomShadow->raise();
@@ -328,6 +309,7 @@ TabbedSelector::TabbedSelector(QWidget *parent, not_null<Window::Controller*> co
 
 	Auth().api().stickerSetInstalled(
 	) | rpl::start_with_next([this](uint64 setId) {
+		ensureTabCreated(SelectorTab::Stickers);
 		_tabsSlider->setActiveSection(
 			static_cast<int>(SelectorTab::Stickers));
 		stickers()->showStickerSet(setId);
@@ -339,6 +321,62 @@ TabbedSelector::TabbedSelector(QWidget *parent, not_null<Window::Controller*> co
 	showAll();
 }
 
+void TabbedSelector::ensureTabCreated(SelectorTab type) {
+	auto tab = getTab(type);
+	if (tab->created()) {
+		return;
+	}
+	auto widget = [&]() -> object_ptr<Inner> {
+		switch (type) {
+		case SelectorTab::Emoji:
+			return object_ptr<EmojiListWidget>(this, _controller);
+		case SelectorTab::Stickers:
+			return object_ptr<StickersListWidget>(this, _controller);
+		case SelectorTab::Gifs:
+			return object_ptr<GifsListWidget>(this, _controller);
+		}
+		Unexpected("Type in TabbedSelector::ensureTabCreated.");
+	}();
+	tab->createWidget(std::move(widget));
+	tab->footer()->hide();
+	tab->footer()->resizeToWidth(width());
+	tab->footer()->moveToLeft(0, _footerTop);
+	tab->widget()->hide();
+
+	connect(tab->widget(), &Inner::scrollToY, this, [this, tab](int y) {
+		if (tab == currentTab()) {
+			scrollToY(y);
+		} else {
+			tab->saveScrollTop(y);
+		}
+	});
+	connect(tab->widget(), &Inner::disableScroll, this, [this, tab](bool disabled) {
+		if (tab == currentTab()) {
+			_scroll->disableScroll(disabled);
+		}
+	});
+	switch (type) {
+	case SelectorTab::Emoji:
+		connect(emoji(), SIGNAL(selected(EmojiPtr)), this, SIGNAL(emojiSelected(EmojiPtr)));
+		break;
+	case SelectorTab::Stickers:
+		connect(stickers(), SIGNAL(scrollUpdated()), this, SLOT(onScroll()));
+		connect(stickers(), SIGNAL(selected(DocumentData*)), this, SIGNAL(stickerSelected(DocumentData*)));
+		connect(stickers(), SIGNAL(checkForHide()), this, SIGNAL(checkForHide()));
+		if (_megagroupSetRequested) {
+			stickers()->showMegagroupSet(base::take(_megagroupSetRequested));
+		}
+		break;
+	case SelectorTab::Gifs:
+		connect(gifs(), SIGNAL(selected(DocumentData*)), this, SIGNAL(stickerSelected(DocumentData*)));
+		connect(gifs(), SIGNAL(selected(PhotoData*)), this, SIGNAL(photoSelected(PhotoData*)));
+		connect(gifs(), SIGNAL(selected(InlineBots::Result*, UserData*)), this, SIGNAL(inlineResultSelected(InlineBots::Result*, UserData*)));
+		connect(gifs(), SIGNAL(cancelled()), this, SIGNAL(cancelled()));
+		gifs()->setInlineQueryPeer(_currentPeer);
+		break;
+	}
+}
+
 void TabbedSelector::resizeEvent(QResizeEvent *e) {
 	_tabsSlider->resizeToWidth(width());
 	_tabsSlider->moveToLeft(0, 0);
@@ -377,6 +415,9 @@ void TabbedSelector::resizeEvent(QResizeEvent *e) {
 
 	_footerTop = height() - st::emojiFooterHeight;
 	for (auto &tab : _tabs) {
+		if (!tab.created()) {
+			continue;
+		}
 		tab.footer()->resizeToWidth(width());
 		tab.footer()->moveToLeft(0, _footerTop);
 	}
@@ -459,6 +500,10 @@ int TabbedSelector::marginBottom() const {
 }
 
 void TabbedSelector::refreshStickers() {
+	if (!getTab(SelectorTab::Stickers)->created()) {
+		// The widget reads the fresh sets when it is created.
+		return;
+	}
 	stickers()->refreshStickers();
 	if (isHidden() || _currentTabType != SelectorTab::Stickers) {
 		stickers()->preloadImages();
@@ -466,7 +511,9 @@ void TabbedSelector::refreshStickers() {
 }
 
 bool TabbedSelector::preventAutoHide() const {
-	return stickers()->preventAutoHide();
+	return getTab(SelectorTab::Stickers)->created()
+		? stickers()->preventAutoHide()
+		: false;
 }
 
 QImage TabbedSelector::grabForAnimation() {
@@ -501,7 +548,9 @@ TabbedSelector::~TabbedSelector() = default;
 
 void TabbedSelector::hideFinished() {
 	for (auto &tab : _tabs) {
-		tab.widget()->panelHideFinished();
+		if (tab.created()) {
+			tab.widget()->panelHideFinished();
+		}
 	}
 	_a_slide.finish();
 	_slideAnimation.reset();
@@ -536,11 +585,17 @@ void TabbedSelector::afterShown() {
 }
 
 void TabbedSelector::showMegagroupSet(ChannelData *megagroup) {
-	stickers()->showMegagroupSet(megagroup);
+	if (getTab(SelectorTab::Stickers)->created()) {
+		stickers()->showMegagroupSet(megagroup);
+	} else {
+		_megagroupSetRequested = megagroup;
+	}
 }
 
 void TabbedSelector::setCurrentPeer(PeerData *peer) {
-	gifs()->setInlineQueryPeer(peer);
+	if (getTab(SelectorTab::Gifs)->created()) {
+		gifs()->setInlineQueryPeer(peer);
+	}
 	_currentPeer = peer;
 	checkRestrictedPeer();
 }
@@ -658,6 +713,7 @@ void TabbedSelector::switchTab() {
 	currentTab()->returnWidget(std::move(widget));
 
 	_currentTabType = newTabType;
+	ensureTabCreated(_currentTabType);
 	_restrictedLabel.destroy();
 	checkRestrictedPeer();
 
@@ -690,15 +746,18 @@ void TabbedSelector::switchTab() {
 }
 
 not_null<EmojiListWidget*> TabbedSelector::emoji() const {
-	return static_cast<EmojiListWidget*>(getTab(SelectorTab::Emoji)->widget().get());
+	Expects(getTab(SelectorTab::Emoji)->created());
+	return static_cast<EmojiListWidget*>(getTab(SelectorTab::Emoji)->widget());
 }
 
 not_null<StickersListWidget*> TabbedSelector::stickers() const {
-	return static_cast<StickersListWidget*>(getTab(SelectorTab::Stickers)->widget().get());
+	Expects(getTab(SelectorTab::Stickers)->created());
+	return static_cast<StickersListWidget*>(getTab(SelectorTab::Stickers)->widget());
 }
 
 not_null<GifsListWidget*> TabbedSelector::gifs() const {
-	return static_cast<GifsListWidget*>(getTab(SelectorTab::Gifs)->widget().get());
+	Expects(getTab(SelectorTab::Gifs)->created());
+	return static_cast<GifsListWidget*>(getTab(SelectorTab::Gifs)->widget());
 }
 
 void TabbedSelector::setWidgetToScrollArea() {
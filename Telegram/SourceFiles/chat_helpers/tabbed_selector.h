@@ -105,7 +105,14 @@ private:
 	public:
 		static constexpr auto kCount = 3;
 
-		Tab(SelectorTab type, object_ptr<Inner> widget);
+		explicit Tab(SelectorTab type);
+
+		// The tabs are constructed lazily - only the active one gets
+		// its widget up front, the others at the first switch to them.
+		bool created() const {
+			return (_weak != nullptr);
+		}
+		void createWidget(object_ptr<Inner> widget);
 
 		object_ptr<Inner> takeWidget();
 		void returnWidget(object_ptr<Inner> widget);
@@ -113,10 +120,10 @@ private:
 		SelectorTab type() const {
 			return _type;
 		}
-		not_null<Inner*> widget() const {
+		Inner *widget() const {
 			return _weak;
 		}
-		not_null<InnerFooter*> footer() const {
+		InnerFooter *footer() const {
 			return _footer;
 		}
 
@@ -132,7 +139,7 @@ private:
 		SelectorTab _type = SelectorTab::Emoji;
 		object_ptr<Inner> _widget = { nullptr };
 		QPointer<Inner> _weak;
-		object_ptr<InnerFooter> _footer;
+		object_ptr<InnerFooter> _footer = { nullptr };
 		int _scrollTop = 0;
 
 	};
@@ -155,6 +162,7 @@ private:
 	void setWidgetToScrollArea();
 	void createTabsSlider();
 	void switchTab();
+	void ensureTabCreated(SelectorTab type);
 	not_null<Tab*> getTab(SelectorTab type) {
 		return &_tabs[static_cast<int>(type)];
 	}
@@ -171,10 +179,15 @@ private:
 	not_null<StickersListWidget*> stickers() const;
 	not_null<GifsListWidget*> gifs() const;
 
+	not_null<Window::Controller*> _controller;
+
 	int _roundRadius = 0;
 	int _footerTop = 0;
 	PeerData *_currentPeer = nullptr;
 
+	// Remembered for the stickers tab if it isn't created yet.
+	ChannelData *_megagroupSetRequested = nullptr;
+
 	class SlideAnimation;
 	std::unique_ptr<SlideAnimation> _slideAnimation;
 	Animation _a_slide;
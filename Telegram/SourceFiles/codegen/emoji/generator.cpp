@@ -15,6 +15,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QPainter>
 #include <QtCore/QDir>
 
+#include <algorithm>
+#include <vector>
+
 #ifdef SUPPORT_IMAGE_GENERATION
 Q_IMPORT_PLUGIN(QWebpPlugin)
 #ifdef Q_OS_MAC
@@ -317,6 +320,7 @@ std::vector<One> Items;\n\
 	if (!writeSections()) {
 		return false;
 	}
+	writeFindInTable();
 	if (!writeFindReplace()) {
 		return false;
 	}
@@ -324,6 +328,9 @@ std::vector<One> Items;\n\
 		return false;
 	}
 	source_->popNamespace().newline().pushNamespace("internal");
+	if (!writeFirstCharBits()) {
+		return false;
+	}
 	source_->stream() << "\
 \n\
 EmojiPtr ByIndex(int index) {\n\
@@ -375,6 +382,15 @@ EmojiPtr ByIndex(int index);\n\
 \n\
 EmojiPtr Find(const QChar *ch, const QChar *end, int *outLength = nullptr);\n\
 \n\
+// Bitmap of all the utf-16 code units an emoji can start with, so that\n\
+// the parser can reject a position with a single probe instead of\n\
+// entering the dictionary switches in Find().\n\
+extern const uint32 FirstCharBits[0x10000 / 32];\n\
+\n\
+inline bool MayBeEmojiFirstChar(ushort unicode) {\n\
+	return (FirstCharBits[unicode >> 5] & (uint32(1) << (unicode & 0x1F))) != 0;\n\
+}\n\
+\n\
 inline bool IsReplaceEdge(const QChar *ch) {\n\
 	return true;\n\
 \n\
@@ -589,157 +605,168 @@ EmojiPack GetSection(Section section) {\n\
 }
 
 bool Generator::writeFindReplace() {
-	source_->stream() << "\
-\n\
-int FindReplaceIndex(const QChar *start, const QChar *end, int *outLength) {\n\
-	auto ch = start;\n\
-\n";
-
-	if (!writeFindFromDictionary(data_.replaces)) {
+	if (!writeFindTables("Replace", data_.replaces)) {
 		return false;
 	}
-
 	source_->stream() << "\
+\n\
+int FindReplaceIndex(const QChar *start, const QChar *end, int *outLength) {\n\
+	return FindInTable(ReplaceFirst, base::array_size(ReplaceFirst), ReplaceData, false, start, end, outLength);\n\
 }\n";
 
 	return true;
 }
 
 bool Generator::writeFind() {
+	if (!writeFindTables("Emoji", data_.map)) {
+		return false;
+	}
 	source_->stream() << "\
 \n\
 int FindIndex(const QChar *start, const QChar *end, int *outLength) {\n\
-	auto ch = start;\n\
+	return FindInTable(EmojiFirst, base::array_size(EmojiFirst), EmojiData, true, start, end, outLength);\n\
+}\n\
 \n";
 
-	if (!writeFindFromDictionary(data_.map, true)) {
-		return false;
+	return true;
+}
+
+bool Generator::writeFirstCharBits() {
+	constexpr auto kBitsCount = 0x10000 / 32;
+	auto bits = std::vector<uint32>(kBitsCount, 0);
+	for (auto &item : data_.map) {
+		auto ch = item.first[0].unicode();
+		bits[ch >> 5] |= (uint32(1) << (ch & 0x1F));
 	}
 
 	source_->stream() << "\
-}\n\
-\n";
+\n\
+const uint32 FirstCharBits[] = {";
+	startBinary();
+	for (auto value : bits) {
+		writeUintBinary(source_.get(), value);
+	}
+	source_->stream() << " };\n";
 
 	return true;
 }
 
-bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes) {
-	auto tabs = [](int size) {
-		return QString(size, '\t');
-	};
-
-	std::map<int, int> uniqueFirstChars;
-	auto foundMax = 0, foundMin = 65535;
-	for (auto &item : dictionary) {
-		auto ch = item.first[0].unicode();
-		if (foundMax < ch) foundMax = ch;
-		if (foundMin > ch) foundMin = ch;
-		uniqueFirstChars[ch] = 0;
-	}
+void Generator::writeFindInTable() {
+	source_->stream() << "\
+\n\
+// Each first-level entry maps the first utf-16 code unit of a key to\n\
+// a packed run of entries in a data array. A packed entry holds the\n\
+// emoji index + 1, the suffix length and then the suffix code units,\n\
+// so one lookup walks a small contiguous slice of data. Keys sharing\n\
+// the first code unit are stored in descending order, making the\n\
+// first full match in a run the longest one.\n\
+struct FirstCharEntry {\n\
+	ushort unicode;\n\
+	ushort count;\n\
+	int offset;\n\
+};\n\
+\n\
+int FindInTable(const FirstCharEntry *first, int firstCount, const ushort *data, bool skipPostfixes, const QChar *start, const QChar *end, int *outLength) {\n\
+	if (start == end) {\n\
+		return 0;\n\
+	}\n\
+	auto unicode = start->unicode();\n\
+	auto left = first;\n\
+	auto right = first + firstCount;\n\
+	while (left != right) {\n\
+		auto middle = left + (right - left) / 2;\n\
+		if (middle->unicode < unicode) {\n\
+			left = middle + 1;\n\
+		} else {\n\
+			right = middle;\n\
+		}\n\
+	}\n\
+	if (left == first + firstCount || left->unicode != unicode) {\n\
+		return 0;\n\
+	}\n\
+	auto entry = data + left->offset;\n\
+	for (auto i = 0; i != int(left->count); ++i) {\n\
+		auto index = *entry++;\n\
+		auto length = *entry++;\n\
+		auto ch = start + 1;\n\
+		if (skipPostfixes && ch != end && ch->unicode() == kPostfix) ++ch;\n\
+		auto matched = true;\n\
+		for (auto j = 0; j != int(length); ++j) {\n\
+			if (ch == end || ch->unicode() != entry[j]) {\n\
+				matched = false;\n\
+				break;\n\
+			}\n\
+			++ch;\n\
+			if (skipPostfixes && ch != end && ch->unicode() == kPostfix) ++ch;\n\
+		}\n\
+		if (matched) {\n\
+			if (outLength) *outLength = (ch - start);\n\
+			return index;\n\
+		}\n\
+		entry += length;\n\
+	}\n\
+	return 0;\n\
+}\n";
+}
 
-	enum class UsedCheckType {
-		Switch,
-		If,
+bool Generator::writeFindTables(const QString &prefix, const std::map<QString, int, std::greater<QString>> &dictionary) {
+	// The dictionary is ordered descending by full key, so the keys
+	// sharing a first code unit form a contiguous run and any key goes
+	// before the keys it is a prefix of - the order FindInTable needs
+	// for the longest match. The first-level array is re-sorted
+	// ascending for the binary search.
+	struct FirstChar {
+		ushort unicode = 0;
+		ushort count = 0;
+		int offset = 0;
 	};
-	auto checkTypes = QVector<UsedCheckType>();
-	auto chars = QString();
-	auto tabsUsed = 1;
-	auto lengthsCounted = std::map<QString, bool>();
-
-	auto writeSkipPostfix = [this, &tabs, skipPostfixes](int tabsCount) {
-		if (skipPostfixes) {
-			source_->stream() << tabs(tabsCount) << "if (++ch != end && ch->unicode() == kPostfix) ++ch;\n";
-		} else {
-			source_->stream() << tabs(tabsCount) << "++ch;\n";
-		}
-	};
-
-	// Returns true if at least one check was finished.
-	auto finishChecksTillKey = [this, &chars, &checkTypes, &tabsUsed, tabs](const QString &key) {
-		auto result = false;
-		while (!chars.isEmpty() && key.midRef(0, chars.size()) != chars) {
-			result = true;
-
-			auto wasType = checkTypes.back();
-			chars.resize(chars.size() - 1);
-			checkTypes.pop_back();
-			if (wasType == UsedCheckType::Switch || wasType == UsedCheckType::If) {
-				--tabsUsed;
-				if (wasType == UsedCheckType::Switch) {
-					source_->stream() << tabs(tabsUsed) << "break;\n";
-				}
-				if ((!chars.isEmpty() && key.midRef(0, chars.size()) != chars) || key == chars) {
-					source_->stream() << tabs(tabsUsed) << "}\n";
-				}
-			}
+	auto firstChars = std::vector<FirstChar>();
+	auto packed = std::vector<ushort>();
+	for (auto &item : dictionary) {
+		auto &key = item.first;
+		if (item.second + 1 >= 65536) {
+			logDataError() << "Too many emoji entries.";
+			return false;
 		}
-		return result;
-	};
-
-	// Check if we can use "if" for a check on "charIndex" in "it" (otherwise only "switch")
-	auto canUseIfForCheck = [](auto it, auto end, int charIndex) {
-		auto key = it->first;
-		auto i = it;
-		auto keyStart = key.mid(0, charIndex);
-		for (++i; i != end; ++i) {
-			auto nextKey = i->first;
-			if (nextKey.mid(0, charIndex) != keyStart) {
-				return true;
-			} else if (nextKey.size() > charIndex && nextKey[charIndex] != key[charIndex]) {
-				return false;
-			}
+		if (key.isEmpty() || key.size() >= 256) {
+			logDataError() << "Bad key size: " << key.toStdString();
+			return false;
 		}
-		return true;
-	};
-
-	for (auto i = dictionary.cbegin(), e = dictionary.cend(); i != e; ++i) {
-		auto &item = *i;
-		auto key = item.first;
-		auto weContinueOldSwitch = finishChecksTillKey(key);
-		while (chars.size() != key.size()) {
-			auto checking = chars.size();
-			auto partialKey = key.mid(0, checking);
-			if (dictionary.find(partialKey) != dictionary.cend()) {
-				if (lengthsCounted.find(partialKey) == lengthsCounted.cend()) {
-					lengthsCounted.insert(std::make_pair(partialKey, true));
-					source_->stream() << tabs(tabsUsed) << "if (outLength) *outLength = (ch - start);\n";
-				}
-			}
-
-			auto keyChar = key[checking];
-			auto keyCharString = "0x" + QString::number(keyChar.unicode(), 16);
-			auto usedIfForCheck = !weContinueOldSwitch && canUseIfForCheck(i, e, checking);
-			if (weContinueOldSwitch) {
-				weContinueOldSwitch = false;
-			} else if (!usedIfForCheck) {
-				source_->stream() << tabs(tabsUsed) << "if (ch != end) switch (ch->unicode()) {\n";
-			}
-			if (usedIfForCheck) {
-				source_->stream() << tabs(tabsUsed) << "if (ch != end && ch->unicode() == " << keyCharString << ") {\n";
-				checkTypes.push_back(UsedCheckType::If);
-			} else {
-				source_->stream() << tabs(tabsUsed) << "case " << keyCharString << ":\n";
-				checkTypes.push_back(UsedCheckType::Switch);
-			}
-			writeSkipPostfix(++tabsUsed);
-			chars.push_back(keyChar);
+		auto unicode = key[0].unicode();
+		if (firstChars.empty() || firstChars.back().unicode != unicode) {
+			auto entry = FirstChar();
+			entry.unicode = unicode;
+			entry.offset = int(packed.size());
+			firstChars.push_back(entry);
 		}
-		if (lengthsCounted.find(key) == lengthsCounted.cend()) {
-			lengthsCounted.insert(std::make_pair(key, true));
-			source_->stream() << tabs(tabsUsed) << "if (outLength) *outLength = (ch - start);\n";
+		++firstChars.back().count;
+		packed.push_back(ushort(item.second + 1));
+		packed.push_back(ushort(key.size() - 1));
+		for (auto i = 1; i != key.size(); ++i) {
+			packed.push_back(key[i].unicode());
 		}
-
-		// While IsReplaceEdge() currently is always true we just return the value.
-		//source_->stream() << tabs(1 + chars.size()) << "if (ch + " << chars.size() << " == end || IsReplaceEdge(*(ch + " << chars.size() << ")) || (ch + " << chars.size() << ")->unicode() == ' ') {\n";
-		//source_->stream() << tabs(1 + chars.size()) << "\treturn &Items[" << item.second << "];\n";
-		//source_->stream() << tabs(1 + chars.size()) << "}\n";
-		source_->stream() << tabs(tabsUsed) << "return " << (item.second + 1) << ";\n";
 	}
-	finishChecksTillKey(QString());
+	std::sort(firstChars.begin(), firstChars.end(), [](const FirstChar &a, const FirstChar &b) {
+		return a.unicode < b.unicode;
+	});
 
 	source_->stream() << "\
 \n\
-	return 0;\n";
+const ushort " << prefix << "Data[] = {";
+	startBinary();
+	for (auto value : packed) {
+		writeIntBinary(source_.get(), value);
+	}
+	source_->stream() << " };\n\
+\n\
+const FirstCharEntry " << prefix << "First[] = {\n";
+	for (auto &entry : firstChars) {
+		source_->stream() << "\
+	{ 0x" << QString::number(entry.unicode, 16) << ", " << entry.count << ", " << entry.offset << " },\n";
+	}
+	source_->stream() << "\
+};\n";
+
 	return true;
 }
 
@@ -48,7 +48,9 @@ private:
 	bool writeGetSections();
 	bool writeFindReplace();
 	bool writeFind();
-	bool writeFindFromDictionary(const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes = false);
+	bool writeFirstCharBits();
+	void writeFindInTable();
+	bool writeFindTables(const QString &prefix, const std::map<QString, int, std::greater<QString>> &dictionary);
 	bool writeGetReplacements();
 	void startBinary();
 	bool writeStringBinary(common::CppFile *source, const QString &string);
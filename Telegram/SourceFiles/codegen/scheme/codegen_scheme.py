@@ -83,7 +83,7 @@ factories = '';
 flagOperators = '';
 methods = '';
 inlineMethods = '';
-textSerializeInit = '';
+textSerializeEntries = [];
 textSerializeMethods = '';
 forwards = '';
 forwTypedefs = '';
@@ -539,19 +539,20 @@ def addTextSerialize(lst, dct, dataLetter):
   return result;
 
 # text serialization: types and funcs
-def addTextSerializeInit(lst, dct):
-  result = '';
+def addTextSerializeEntries(lst, dct):
+  result = [];
   for restype in lst:
     v = dct[restype];
     for data in v:
       name = data[0];
-      result += '\tresult.insert(mtpc_' + name + ', Serialize_' + name + ');\n';
+      typeid = data[1];
+      result.append((int(typeid, 16) & 0xffffffff, 'mtpc_' + name, 'Serialize_' + name));
   return result;
 
 textSerializeMethods += addTextSerialize(typesList, typesDict, 'D');
-textSerializeInit += addTextSerializeInit(typesList, typesDict) + '\n';
+textSerializeEntries += addTextSerializeEntries(typesList, typesDict);
 textSerializeMethods += addTextSerialize(funcsList, funcsDict, '');
-textSerializeInit += addTextSerializeInit(funcsList, funcsDict) + '\n';
+textSerializeEntries += addTextSerializeEntries(funcsList, funcsDict);
 
 for restype in typesList:
   v = typesDict[restype];
@@ -902,10 +903,16 @@ void _serialize_core_message(MTPStringLogger &to, int32 stage, int32 lev, Types
 }\n\
 \n';
 
-textSerializeInit += '\
-	result.insert(mtpc_rpc_result, _serialize_rpc_result);\n\
-	result.insert(mtpc_msg_container, _serialize_msg_container);\n\
-	result.insert(mtpc_core_message, _serialize_core_message);\n';
+# the ids here must match the mtpc_ constants in mtproto/core_types.h
+textSerializeEntries.append((0xf35c6d01, 'mtpc_rpc_result', '_serialize_rpc_result'));
+textSerializeEntries.append((0x73f1f8dc, 'mtpc_msg_container', '_serialize_msg_container'));
+textSerializeEntries.append((0xffffffff, 'mtpc_core_message', '_serialize_core_message'));
+
+# sorted by numeric type id, the generated table is binary searched
+textSerializeEntries.sort(key=lambda entry: entry[0]);
+textSerializeTable = '';
+for entry in textSerializeEntries:
+  textSerializeTable += '\t{ mtpTypeId(' + entry[1] + '), ' + entry[2] + ' }, // ' + hex(entry[0]) + '\n';
 
 # module itself
 
@@ -995,21 +1002,32 @@ using StagesFlags = QVector<int32>;\n\
 namespace {\n\
 \n\
 using TextSerializer = void (*)(MTPStringLogger &to, int32 stage, int32 lev, Types &types, Types &vtypes, StagesFlags &stages, StagesFlags &flags, const mtpPrime *start, const mtpPrime *end, uint32 iflag);\n\
-using TextSerializers = QMap<mtpTypeId, TextSerializer>;\n\
-\n\
-QMap<mtpTypeId, TextSerializer> createTextSerializers() {\n\
-	auto result = QMap<mtpTypeId, TextSerializer>();\n\
+struct TextSerializerEntry {\n\
+	mtpTypeId type;\n\
+	TextSerializer serializer;\n\
+};\n\
 \n\
-' + textSerializeInit + '\n\
+// Sorted by type id at generation time, looked up by binary search,\n\
+// so the table lives in the read-only data segment and costs neither\n\
+// a construction on first use nor tree node allocations.\n\
+constexpr TextSerializerEntry TextSerializers[] = {\n\
+' + textSerializeTable + '\
+};\n\
 \n\
-	return result;\n\
+TextSerializer findTextSerializer(mtpTypeId type) {\n\
+	const auto from = std::begin(TextSerializers);\n\
+	const auto till = std::end(TextSerializers);\n\
+	const auto it = std::lower_bound(from, till, type, [](\n\
+			const TextSerializerEntry &entry,\n\
+			mtpTypeId type) {\n\
+		return entry.type < type;\n\
+	});\n\
+	return (it != till && it->type == type) ? it->serializer : nullptr;\n\
 }\n\
 \n\
 } // namespace\n\
 \n\
 void mtpTextSerializeType(MTPStringLogger &to, const mtpPrime *&from, const mtpPrime *end, mtpPrime cons, uint32 level, mtpPrime vcons) {\n\
-	static auto serializers = createTextSerializers();\n\
-\n\
 	QVector<mtpTypeId> types, vtypes;\n\
 	QVector<int32> stages, flags;\n\
 	types.reserve(20); vtypes.reserve(20); stages.reserve(20); flags.reserve(20);\n\
@@ -1035,9 +1053,8 @@ void mtpTextSerializeType(MTPStringLogger &to, const mtpPrime *&from, const mtpP
 		}\n\
 \n\
 		int32 lev = level + types.size() - 1;\n\
-		auto it = serializers.constFind(type);\n\
-		if (it != serializers.cend()) {\n\
-			(*it.value())(to, stage, lev, types, vtypes, stages, flags, start, end, flag);\n\
+		if (const auto serializer = findTextSerializer(type)) {\n\
+			(*serializer)(to, stage, lev, types, vtypes, stages, flags, start, end, flag);\n\
 		} else {\n\
 			mtpTextSerializeCore(to, from, end, type, lev, vtype);\n\
 			types.pop_back(); vtypes.pop_back(); stages.pop_back(); flags.pop_back();\n\
@@ -316,6 +316,22 @@ QString Generator::typeToDefaultValue(structure::Type type) const {
 }
 
 // Empty result means an error.
+// True for values that can be written as static initializers of the
+// generated variables, so init_*() doesn't have to assign them at
+// startup. Scale-dependent (pixel based) values are chosen at runtime,
+// fonts need the family registry and icons need a QApplication, those
+// stay in init_*(). Copies of other st:: values are also excluded to
+// avoid static initialization order dependencies between modules.
+bool Generator::isStaticallyInitialized(structure::Value value) const {
+	if (!value.copyOf().isEmpty()) {
+		return false;
+	}
+	const auto tag = value.type().tag;
+	return (tag == Tag::Int)
+		|| (tag == Tag::Double)
+		|| (tag == Tag::Align);
+}
+
 QString Generator::valueAssignmentCode(structure::Value value) const {
 	auto copy = value.copyOf();
 	if (!copy.isEmpty()) {
@@ -1097,6 +1113,10 @@ void init_" << baseName_ << "() {\n\
 	if (isPalette_) {
 		source_->stream() << "\t_palette.finalize();\n";
 	} else if (!module_.enumVariables([&](const Variable &variable) -> bool {
+		if (isStaticallyInitialized(variable.value)) {
+			// Already written as the static initializer.
+			return true;
+		}
 		auto name = variable.name.back();
 		auto value = valueAssignmentCode(variable.value);
 		if (value.isEmpty()) {
@@ -34,6 +34,7 @@ private:
 	QString typeToString(structure::Type type) const;
 	QString typeToDefaultValue(structure::Type type) const;
 	QString valueAssignmentCode(structure::Value value) const;
+	bool isStaticallyInitialized(structure::Value value) const;
 
 	bool writeHeaderStyleNamespace();
 	bool writeStructsForwardDeclarations();
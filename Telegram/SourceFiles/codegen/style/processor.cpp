@@ -7,8 +7,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "codegen/style/processor.h"
 
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSet>
 #include "codegen/common/cpp_file.h"
 #include "codegen/style/parsed_file.h"
 #include "codegen/style/generator.h"
@@ -19,9 +23,9 @@ namespace {
 
 constexpr int kErrorCantWritePath = 821;
 
-QString destFileBaseName(const structure::Module &module) {
-	return "style_" + QFileInfo(module.filepath()).baseName();
-}
+// Bump this when the generated output format changes, so that cached
+// outputs from an older generator are not considered up-to-date.
+const char kGeneratorVersion[] = "codegen_style/1";
 
 } // namespace
 
@@ -31,6 +35,19 @@ Processor::Processor(const Options &options)
 }
 
 int Processor::launch() {
+	// If the input and all its dependencies hash to the same value as
+	// on the previous run we can skip parsing and generation entirely,
+	// so re-running the generator for an unchanged module is cheap.
+	auto hash = inputsHash();
+	if (!hash.isEmpty()
+		&& QFileInfo(destFilePath() + ".h").isFile()
+		&& QFileInfo(destFilePath() + ".cpp").isFile()) {
+		QFile file(hashFilePath());
+		if (file.open(QIODevice::ReadOnly) && file.readAll() == hash) {
+			return 0;
+		}
+	}
+
 	if (!parser_->read()) {
 		return -1;
 	}
@@ -40,6 +57,13 @@ int Processor::launch() {
 		return -1;
 	}
 
+	if (!hash.isEmpty()) {
+		QFile file(hashFilePath());
+		if (file.open(QIODevice::WriteOnly)) {
+			file.write(hash);
+		}
+	}
+
 	return 0;
 }
 
@@ -52,7 +76,7 @@ bool Processor::write(const structure::Module &module) const {
 	}
 
 	QFileInfo srcFile(module.filepath());
-	QString dstFilePath = dir.absolutePath() + '/' + (options_.isPalette ? "palette" : destFileBaseName(module));
+	QString dstFilePath = destFilePath();
 
 	common::ProjectInfo project = {
 		"codegen_style",
@@ -70,6 +94,62 @@ bool Processor::write(const structure::Module &module) const {
 	return true;
 }
 
+QByteArray Processor::inputsHash() const {
+	static const QRegularExpression usingExpression("^\\s*using \"([^\"]+)\"");
+
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	hash.addData(kGeneratorVersion, sizeof(kGeneratorVersion));
+
+	QStringList queue(QFileInfo(options_.inputPath).absoluteFilePath());
+	QSet<QString> visited;
+	while (!queue.isEmpty()) {
+		auto path = queue.takeFirst();
+		if (visited.contains(path)) {
+			continue;
+		}
+		visited.insert(path);
+
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly)) {
+			return QByteArray();
+		}
+		auto content = file.readAll();
+		hash.addData(content);
+
+		for (const auto &line : QString::fromUtf8(content).split('\n')) {
+			auto match = usingExpression.match(line);
+			if (!match.hasMatch()) {
+				continue;
+			}
+			auto found = false;
+			for (const auto &dir : options_.includePaths) {
+				QFileInfo full(dir + '/' + match.captured(1));
+				if (full.isFile()) {
+					queue.push_back(full.absoluteFilePath());
+					found = true;
+					break;
+				}
+			}
+			if (!found) {
+				return QByteArray();
+			}
+		}
+	}
+	return hash.result().toHex();
+}
+
+QString Processor::destFilePath() const {
+	QDir dir(options_.outputPath);
+	auto baseName = options_.isPalette
+		? QString("palette")
+		: ("style_" + QFileInfo(options_.inputPath).baseName());
+	return dir.absolutePath() + '/' + baseName;
+}
+
+QString Processor::hashFilePath() const {
+	return destFilePath() + ".hash";
+}
+
 Processor::~Processor() = default;
 
 } // namespace style
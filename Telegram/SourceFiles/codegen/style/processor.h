@@ -34,6 +34,12 @@ public:
 private:
 	bool write(const structure::Module &module) const;
 
+	// The hash of the input file and all its transitive dependencies,
+	// empty if some of them could not be read.
+	QByteArray inputsHash() const;
+	QString destFilePath() const;
+	QString hashFilePath() const;
+
 	std::unique_ptr<ParsedFile> parser_;
 	const Options &options_;
 
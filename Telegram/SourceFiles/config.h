@@ -294,11 +294,12 @@ inline const QRegularExpression &cRussianLetters() {
 inline const QStringList &cImgExtensions() {
 	static QStringList result;
 	if (result.isEmpty()) {
-		result.reserve(4);
+		result.reserve(5);
 		result.push_back(qsl(".jpg"));
 		result.push_back(qsl(".jpeg"));
 		result.push_back(qsl(".png"));
 		result.push_back(qsl(".gif"));
+		result.push_back(qsl(".webp"));
 	}
 	return result;
 }
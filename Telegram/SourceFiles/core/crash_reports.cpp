@@ -58,6 +58,14 @@ using AnnotationRefs = std::map<std::string, const QString*>;
 Annotations ProcessAnnotations;
 AnnotationRefs ProcessAnnotationRefs;
 
+// Fixed atomic pointer per AnnotationSlot value, read only from the
+// crash handler. Keys must match the order of the enum in the header.
+const char *AnnotationSlotKeys[int(AnnotationSlot::Count)] = {
+	"CrashString",
+	"IndexAsNewItemId",
+};
+std::atomic<const QString*> AnnotationSlots[int(AnnotationSlot::Count)] = {};
+
 #ifndef TDESKTOP_DISABLE_CRASH_REPORTS
 
 QString ReportPath;
@@ -174,6 +182,21 @@ void SignalHandler(int signum) {
 			ProcessAnnotations[i.first] = wrapped;
 		}
 
+		for (auto slot = 0; slot != int(AnnotationSlot::Count); ++slot) {
+			const auto value = AnnotationSlots[slot].load();
+			if (!value) {
+				continue;
+			}
+			QByteArray utf8 = value->toUtf8();
+			std::string wrapped;
+			wrapped.reserve(4 * utf8.size());
+			for (auto ch : utf8) {
+				auto uch = static_cast<uchar>(ch);
+				wrapped.append("\\x", 2).append(1, dec2hex(uch >> 4)).append(1, dec2hex(uch & 0x0F));
+			}
+			ProcessAnnotations[AnnotationSlotKeys[slot]] = wrapped;
+		}
+
 		const Annotations c_ProcessAnnotations(ProcessAnnotations);
 		for (const auto &i : c_ProcessAnnotations) {
 			dump() << i.first.c_str() << ": " << i.second.c_str() << "\n";
@@ -526,6 +549,12 @@ void SetAnnotationRef(const std::string &key, const QString *valuePtr) {
 	}
 }
 
+void SetAnnotationSlot(AnnotationSlot slot, const QString *valuePtr) {
+	Expects(slot < AnnotationSlot::Count);
+
+	AnnotationSlots[int(slot)].store(valuePtr);
+}
+
 #ifndef TDESKTOP_DISABLE_CRASH_REPORTS
 
 dump::~dump() {
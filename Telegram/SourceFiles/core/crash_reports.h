@@ -46,6 +46,22 @@ inline void ClearAnnotationRef(const std::string &key) {
 	SetAnnotationRef(key, nullptr);
 }
 
+// Preallocated annotation slots for hot paths. Setting or clearing a
+// slot is a single atomic pointer store - no lock, no allocation - so
+// these may be used on paths that run for every message or every text
+// block. The pointed-to value must stay alive until the slot is
+// cleared, same as with SetAnnotationRef.
+enum class AnnotationSlot {
+	CrashString,
+	IndexAsNewItemId,
+
+	Count,
+};
+void SetAnnotationSlot(AnnotationSlot slot, const QString *valuePtr);
+inline void ClearAnnotationSlot(AnnotationSlot slot) {
+	SetAnnotationSlot(slot, nullptr);
+}
+
 void StartCatching();
 void FinishCatching();
 
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "platform/platform_specific.h"
 #include "core/crash_reports.h"
 #include "core/main_queue_processor.h"
+#include "core/startup_timeline.h"
 #include "application.h"
 
 namespace Core {
@@ -39,6 +40,8 @@ void Launcher::init() {
 }
 
 int Launcher::exec() {
+	Core::StartupTimeline::Mark(qsl("launch"));
+
 	init();
 
 	if (cLaunchMode() == LaunchModeFixPrevious) {
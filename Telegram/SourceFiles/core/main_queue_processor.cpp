@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "core/main_queue_processor.h"
 
+#include <atomic>
+
 namespace Core {
 namespace {
 
@@ -16,34 +18,66 @@ MainQueueProcessor *ProcessorInstance/* = nullptr*/;
 constexpr auto kProcessorEvent = QEvent::Type(QEvent::User + 1);
 static_assert(kProcessorEvent < QEvent::MaxUser);
 
-class ProcessorEvent : public QEvent {
-public:
-	ProcessorEvent(void (*callable)(void*), void *argument);
+// The callables are pushed to an intrusive lock-free stack from any
+// thread and drained in batches on the main thread, so a flood of
+// cross-thread messages costs one small allocation per message and
+// only the first message of a batch posts a wakeup event.
+struct ProcessorCallable {
+	void (*callable)(void*) = nullptr;
+	void *argument = nullptr;
+	ProcessorCallable *next = nullptr;
+};
 
-	void process();
+std::atomic<ProcessorCallable*> PendingTop/* = nullptr*/;
 
-private:
-	void (*_callable)(void*) = nullptr;
-	void *_argument = nullptr;
+// Processing a drained batch stops after this long and the remaining
+// callables are deferred to a freshly posted event, so that a storm
+// of cross-thread messages can't occupy the whole event loop and
+// starve input events. Main thread only.
+constexpr auto kProcessTimeBudget = TimeMs(8);
 
-};
+ProcessorCallable *DeferredCallables/* = nullptr*/;
 
-ProcessorEvent::ProcessorEvent(void (*callable)(void*), void *argument)
-: QEvent(kProcessorEvent)
-, _callable(callable)
-, _argument(argument) {
+// Returns true if the queue was empty, so a wakeup should be posted.
+bool EnqueueCallable(void (*callable)(void*), void *argument) {
+	const auto entry = new ProcessorCallable{ callable, argument };
+	entry->next = PendingTop.load(std::memory_order_relaxed);
+	while (!PendingTop.compare_exchange_weak(
+		entry->next,
+		entry,
+		std::memory_order_release)) {
+	}
+	return (entry->next == nullptr);
 }
 
-void ProcessorEvent::process() {
-	_callable(_argument);
+// Takes all the pending callables in the order they were pushed.
+ProcessorCallable *TakeCallables() {
+	auto taken = PendingTop.exchange(nullptr, std::memory_order_acquire);
+
+	// The stack is LIFO, reverse it to invoke in push order.
+	auto result = static_cast<ProcessorCallable*>(nullptr);
+	while (taken) {
+		const auto next = taken->next;
+		taken->next = result;
+		result = taken;
+		taken = next;
+	}
+	return result;
 }
 
-void ProcessMainQueue(void (*callable)(void*), void *argument) {
+void PostWakeup() {
 	QMutexLocker lock(&ProcessorMutex);
 
 	if (ProcessorInstance) {
-		const auto event = new ProcessorEvent(callable, argument);
-		QCoreApplication::postEvent(ProcessorInstance, event);
+		QCoreApplication::postEvent(
+			ProcessorInstance,
+			new QEvent(kProcessorEvent));
+	}
+}
+
+void ProcessMainQueue(void (*callable)(void*), void *argument) {
+	if (EnqueueCallable(callable, argument)) {
+		PostWakeup();
 	}
 }
 
@@ -56,7 +90,27 @@ MainQueueProcessor::MainQueueProcessor() {
 
 bool MainQueueProcessor::event(QEvent *event) {
 	if (event->type() == kProcessorEvent) {
-		static_cast<ProcessorEvent*>(event)->process();
+		// A batch deferred on budget overflow runs before freshly
+		// drained callables to keep the invocation order. Callables
+		// pushed while we process post another wakeup for themselves.
+		const auto started = getms();
+		auto entry = std::exchange(DeferredCallables, nullptr);
+		if (!entry) {
+			entry = TakeCallables();
+		}
+		while (entry) {
+			const auto next = entry->next;
+			entry->callable(entry->argument);
+			delete entry;
+			entry = next;
+			if (entry && getms() - started >= kProcessTimeBudget) {
+				DeferredCallables = entry;
+				QCoreApplication::postEvent(
+					this,
+					new QEvent(kProcessorEvent));
+				break;
+			}
+		}
 		return true;
 	}
 	return QObject::event(event);
@@ -65,8 +119,15 @@ bool MainQueueProcessor::event(QEvent *event) {
 void MainQueueProcessor::acquire() {
 	Expects(ProcessorInstance == nullptr);
 
-	QMutexLocker lock(&ProcessorMutex);
-	ProcessorInstance = this;
+	{
+		QMutexLocker lock(&ProcessorMutex);
+		ProcessorInstance = this;
+	}
+
+	// Some callables could be pushed while no processor existed.
+	if (PendingTop.load(std::memory_order_acquire) != nullptr) {
+		QCoreApplication::postEvent(this, new QEvent(kProcessorEvent));
+	}
 }
 
 void MainQueueProcessor::release() {
@@ -78,6 +139,22 @@ void MainQueueProcessor::release() {
 
 MainQueueProcessor::~MainQueueProcessor() {
 	release();
+
+	// The callables enqueued after this point are dropped, just like
+	// the posted events were dropped before, only the list entries
+	// are freed here.
+	auto entry = PendingTop.exchange(nullptr, std::memory_order_acquire);
+	while (entry) {
+		const auto next = entry->next;
+		delete entry;
+		entry = next;
+	}
+	entry = std::exchange(DeferredCallables, nullptr);
+	while (entry) {
+		const auto next = entry->next;
+		delete entry;
+		entry = next;
+	}
 }
 
 } // namespace
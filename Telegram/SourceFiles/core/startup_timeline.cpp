@@ -0,0 +1,61 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/startup_timeline.h"
+
+namespace Core {
+namespace StartupTimeline {
+namespace {
+
+struct Entry {
+	QString phase;
+	TimeMs time = 0;
+};
+
+std::vector<Entry> &Entries() {
+	static auto result = std::vector<Entry>();
+	return result;
+}
+
+bool FirstDialogsPainted = false;
+
+} // namespace
+
+void Mark(const QString &phase) {
+	Entries().push_back({ phase, getms(true) });
+}
+
+void MarkFirstDialogsPaint() {
+	if (FirstDialogsPainted) {
+		return;
+	}
+	FirstDialogsPainted = true;
+	Mark(qsl("first dialogs paint"));
+	LOG(("Startup Timeline:\n%1").arg(Report()));
+}
+
+QString Report() {
+	const auto &list = Entries();
+	if (list.empty()) {
+		return QString();
+	}
+	auto result = QString();
+	result.reserve(list.size() * 48);
+	const auto base = list.front().time;
+	auto previous = base;
+	for (const auto &entry : list) {
+		result += QString("%1 ms (+%2 ms): %3\n"
+		).arg(entry.time - base
+		).arg(entry.time - previous
+		).arg(entry.phase);
+		previous = entry.time;
+	}
+	return result;
+}
+
+} // namespace StartupTimeline
+} // namespace Core
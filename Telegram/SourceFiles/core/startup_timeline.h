@@ -0,0 +1,28 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+namespace StartupTimeline {
+
+// Records a named startup phase with the current time. Call it when
+// a phase finishes, so the delta from the previous mark shows how
+// long that phase took. Main thread only.
+void Mark(const QString &phase);
+
+// Records the first complete dialogs list paint, the moment the app
+// is actually usable, and dumps the whole timeline to the log. Calls
+// after the first one are ignored, so paint code may call it freely.
+void MarkFirstDialogsPaint();
+
+// Multi-line timeline of all recorded phases with absolute offsets
+// from launch and per-phase durations.
+QString Report();
+
+} // namespace StartupTimeline
+} // namespace Core
@@ -0,0 +1,129 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/tracing.h"
+
+namespace Core {
+namespace Tracing {
+namespace {
+
+// ~3 Mb of events. The ring wraps, so a capture left running keeps
+// the most recent window instead of growing without bound.
+constexpr auto kEventsLimit = 0x20000;
+
+struct Event {
+	const char *name = nullptr;
+	qint64 started = 0; // microseconds since capture start
+	qint64 duration = 0; // 0 - instant marker
+	quint64 thread = 0;
+};
+
+std::atomic<bool> Capturing/* = false*/;
+std::atomic<quint32> Counter/* = 0*/;
+QElapsedTimer Started;
+
+std::vector<Event> &Events() {
+	static auto result = std::vector<Event>(kEventsLimit);
+	return result;
+}
+
+// Concurrent writers may race for a slot when the ring wraps under
+// load from several threads at once - a torn event in a diagnostic
+// trace is acceptable, a lock on the probe path is not.
+void Record(const char *name, qint64 started, qint64 duration) {
+	const auto index = Counter.fetch_add(1, std::memory_order_relaxed);
+	auto &event = Events()[index % kEventsLimit];
+	event.name = name;
+	event.started = started;
+	event.duration = duration;
+	event.thread = quint64(reinterpret_cast<quintptr>(
+		QThread::currentThreadId()));
+}
+
+QString Write() {
+	const auto count = Counter.load();
+	const auto total = qMin(count, quint32(kEventsLimit));
+	const auto from = (count > quint32(kEventsLimit))
+		? (count % kEventsLimit)
+		: 0;
+
+	auto path = cWorkingDir()
+		+ qsl("tdata/trace-%1.json"
+		).arg(QDateTime::currentDateTime().toString(qsl("yyyyMMdd-hhmmss")));
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("Tracing Error: could not open '%1' for writing.").arg(path));
+		return QString();
+	}
+
+	auto out = QTextStream(&file);
+	out << "{\"traceEvents\":[";
+	const auto &events = Events();
+	for (auto i = quint32(0); i != total; ++i) {
+		const auto &event = events[(from + i) % kEventsLimit];
+		if (!event.name) {
+			continue;
+		}
+		if (i) {
+			out << ",\n";
+		}
+		// Names are string literals from the probes, no escaping.
+		out << "{\"name\":\"" << event.name
+			<< "\",\"ph\":\"" << (event.duration ? "X" : "i")
+			<< "\",\"ts\":" << event.started;
+		if (event.duration) {
+			out << ",\"dur\":" << event.duration;
+		} else {
+			out << ",\"s\":\"g\"";
+		}
+		out << ",\"pid\":1,\"tid\":" << event.thread << "}";
+	}
+	out << "]}\n";
+	return path;
+}
+
+} // namespace
+
+bool Enabled() {
+	return Capturing.load(std::memory_order_relaxed);
+}
+
+QString Toggle() {
+	if (Capturing.load()) {
+		Capturing.store(false);
+		return Write();
+	}
+	auto &events = Events();
+	std::fill(events.begin(), events.end(), Event());
+	Counter.store(0);
+	Started.start();
+	Capturing.store(true);
+	return QString();
+}
+
+void Instant(const char *name) {
+	if (Enabled()) {
+		Record(name, details::NowMicroseconds(), 0);
+	}
+}
+
+namespace details {
+
+qint64 NowMicroseconds() {
+	return Started.nsecsElapsed() / 1000;
+}
+
+void RecordScope(const char *name, qint64 started) {
+	// The capture may have been stopped while the scope was running,
+	// recording one event late into the stopped ring is harmless.
+	Record(name, started, NowMicroseconds() - started);
+}
+
+} // namespace details
+
+} // namespace Tracing
+} // namespace Core
@@ -0,0 +1,63 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+namespace Tracing {
+
+// Lightweight scoped tracing across subsystems. Events go to a fixed
+// ring buffer, capture is toggled at runtime and written out in the
+// chrome://tracing JSON format, so a trace can be attached to a perf
+// ticket and opened in the browser. Recording an event is a relaxed
+// atomic increment and a few stores - probes may sit on hot paths.
+
+// Whether events are captured right now. Cheap, check it freely.
+bool Enabled();
+
+// Starts a fresh capture, or stops the running one and writes it to
+// tdata/trace-<time>.json. Returns the written path when stopping,
+// an empty string when starting (or when writing failed).
+QString Toggle();
+
+// Records a zero-length marker, e.g. an input event arriving.
+// The name must be a string literal - only the pointer is stored.
+void Instant(const char *name);
+
+namespace details {
+
+// Microseconds since the capture started - the unit of the format.
+qint64 NowMicroseconds();
+void RecordScope(const char *name, qint64 started);
+
+} // namespace details
+
+// Times the enclosing scope. The name must be a string literal.
+class Scope {
+public:
+	explicit Scope(const char *name) {
+		if (Enabled()) {
+			_name = name;
+			_started = details::NowMicroseconds();
+		}
+	}
+	Scope(const Scope &other) = delete;
+	Scope &operator=(const Scope &other) = delete;
+	~Scope() {
+		if (_name) {
+			details::RecordScope(_name, _started);
+		}
+	}
+
+private:
+	const char *_name = nullptr;
+	qint64 _started = 0;
+
+};
+
+} // namespace Tracing
+} // namespace Core
@@ -107,6 +107,7 @@ public:
 	// Thread-safe methods.
 	void onProgress(Progress progress);
 	void onFailed();
+	void onDeltaFailed();
 	void onReady();
 
 	~Updater();
@@ -124,7 +125,9 @@ private:
 	void startDownloadThread(
 		uint64 availableVersion,
 		bool isAvailableBeta,
-		QString url);
+		QString url,
+		QString deltaUrl = QString());
+	void handleDeltaFailed();
 	bool checkOldResponse(const QByteArray &response);
 	bool checkResponse(const QByteArray &response);
 
@@ -142,6 +145,10 @@ private:
 	std::unique_ptr<QThread> _thread;
 	Private *_private = nullptr;
 
+	// Full package link kept while a delta download is in flight, so
+	// that any delta failure falls back to the old full-download path.
+	QString _fallbackUrl;
+
 	rpl::lifetime _lifetime;
 
 };
@@ -151,7 +158,8 @@ public:
 	Private(
 		not_null<Updater*> parent,
 		not_null<QThread*> thread,
-		const QString &url);
+		const QString &url,
+		bool isDelta = false);
 
 	void unpackUpdate();
 
@@ -169,9 +177,11 @@ private:
 	void partFailed(QNetworkReply::NetworkError e);
 
 	void fatalFail();
+	void fail();
 
 	not_null<Updater*> _parent;
 	QString _url;
+	bool _isDelta = false;
 	QNetworkAccessManager _manager;
 	std::unique_ptr<QNetworkReply> _reply;
 	int _already = 0;
@@ -226,6 +236,12 @@ void Updater::onFailed() {
 	});
 }
 
+void Updater::onDeltaFailed() {
+	crl::on_main(this, [=] {
+		handleDeltaFailed();
+	});
+}
+
 void Updater::onReady() {
 	crl::on_main(this, [=] {
 		_ready.fire({});
@@ -338,6 +354,7 @@ bool Updater::checkResponse(const QByteArray &response) {
 	auto bestIsAvailableBeta = false;
 	auto bestAvailableVersion = 0ULL;
 	auto bestLink = QString();
+	auto bestDeltaLink = QString();
 	for (const auto &type : list) {
 		const auto it = types.constFind(type);
 		if (it == types.constEnd()) {
@@ -386,6 +403,22 @@ bool Updater::checkResponse(const QByteArray &response) {
 			bestAvailableVersion = availableVersion;
 			bestIsAvailableBeta = isAvailableBeta;
 			bestLink = (*link).toString();
+
+			// An optional "deltas" object maps installed versions to
+			// links of binary diff packages, much smaller than the
+			// full one. Use it only for our exact current version.
+			bestDeltaLink = QString();
+			const auto deltas = map.constFind("deltas");
+			if (deltas != map.constEnd() && (*deltas).isObject()) {
+				const auto deltasMap = (*deltas).toObject();
+				const auto myVersion = isAvailableBeta
+					? QString::number(cBetaVersion())
+					: QString::number(AppVersion);
+				const auto delta = deltasMap.constFind(myVersion);
+				if (delta != deltasMap.constEnd() && (*delta).isString()) {
+					bestDeltaLink = (*delta).toString();
+				}
+			}
 		}
 	}
 	if (!bestAvailableVersion) {
@@ -396,14 +429,18 @@ bool Updater::checkResponse(const QByteArray &response) {
 	startDownloadThread(
 		bestAvailableVersion,
 		bestIsAvailableBeta,
-		Local::readAutoupdatePrefix() + bestLink);
+		Local::readAutoupdatePrefix() + bestLink,
+		(bestDeltaLink.isEmpty()
+			? QString()
+			: Local::readAutoupdatePrefix() + bestDeltaLink));
 	return true;
 }
 
 void Updater::startDownloadThread(
 		uint64 availableVersion,
 		bool isAvailableBeta,
-		QString url) {
+		QString url,
+		QString deltaUrl) {
 	const auto myVersion = isAvailableBeta
 		? cBetaVersion()
 		: uint64(AppVersion);
@@ -411,19 +448,51 @@ void Updater::startDownloadThread(
 	if (!validVersion || availableVersion <= myVersion) {
 		return;
 	}
-	const auto versionUrl = url.replace(
-		"{version}",
-		QString::number(availableVersion));
-	const auto finalUrl = isAvailableBeta
-		? QString(versionUrl).replace(
-			"{signature}",
-			countBetaVersionSignature(availableVersion))
-		: versionUrl;
+	const auto prepare = [&](QString link) {
+		const auto versionUrl = link.replace(
+			"{version}",
+			QString::number(availableVersion));
+		return isAvailableBeta
+			? QString(versionUrl).replace(
+				"{signature}",
+				countBetaVersionSignature(availableVersion))
+			: versionUrl;
+	};
+	const auto finalUrl = prepare(url);
+	auto startUrl = finalUrl;
+	auto isDelta = false;
+	if (!deltaUrl.isEmpty()) {
+		// Prefer the much smaller diff package when the server offers
+		// one from our exact version, keeping the full package link
+		// around in case applying the delta fails.
+		startUrl = prepare(deltaUrl);
+		isDelta = true;
+		_fallbackUrl = finalUrl;
+	} else {
+		_fallbackUrl = QString();
+	}
 	_thread = std::make_unique<QThread>();
 	_private = new Private(
 		this,
 		_thread.get(),
-		finalUrl);
+		startUrl,
+		isDelta);
+	_thread->start();
+}
+
+void Updater::handleDeltaFailed() {
+	stop();
+
+	const auto fallback = base::take(_fallbackUrl);
+	if (fallback.isEmpty()) {
+		return;
+	}
+	LOG(("Update Info: delta update failed, downloading the full package."));
+	_thread = std::make_unique<QThread>();
+	_private = new Private(
+		this,
+		_thread.get(),
+		fallback);
 	_thread->start();
 }
 
@@ -605,8 +674,10 @@ int UpdateChecker::size() const {
 Updater::Private::Private(
 		not_null<Updater*> parent,
 		not_null<QThread*> thread,
-		const QString &url)
-: _parent(parent) {
+		const QString &url,
+		bool isDelta)
+: _parent(parent)
+, _isDelta(isDelta) {
 	_url = url;
 	moveToThread(thread);
 	_manager.moveToThread(thread);
@@ -781,12 +852,23 @@ void Updater::Private::partFailed(QNetworkReply::NetworkError e) {
 		}
 	}
 	LOG(("Update Error: failed to download part starting from %1, error %2").arg(_already).arg(e));
-	_parent->onFailed();
+	fail();
 }
 
 void Updater::Private::fatalFail() {
 	ClearAll();
-	_parent->onFailed();
+	fail();
+}
+
+void Updater::Private::fail() {
+	// Delta failures (missing diff package, corrupt patch, locally
+	// modified installation) retry with the full package instead of
+	// reporting a failed update check.
+	if (_isDelta) {
+		_parent->onDeltaFailed();
+	} else {
+		_parent->onFailed();
+	}
 }
 
 //QString winapiErrorWrap() {
@@ -804,6 +886,89 @@ void Updater::Private::fatalFail() {
 //	return QString::fromWCharArray(errMsg);
 //}
 
+namespace {
+
+// A delta package uses the same signed container as a full one, but
+// each file entry holds a patch stream instead of the file content:
+//
+//   quint32 resultSize
+//   QByteArray sha1 of the rebuilt file (20 bytes)
+//   a sequence of operations until the end of the stream:
+//     quint8(0), quint32 offset, quint32 length - copy bytes from the
+//       currently installed copy of the file,
+//     quint8(1), QByteArray data - insert literal bytes.
+//
+// Returns a null QByteArray if the patch could not be applied, for
+// example when the installed file was modified locally.
+QByteArray ApplyDeltaPatch(
+		const QString &oldFilePath,
+		const QByteArray &patch) {
+	auto oldData = QByteArray();
+	QFile old(oldFilePath);
+	if (old.exists()) {
+		if (!old.open(QIODevice::ReadOnly)) {
+			LOG(("Update Error: cant read installed file '%1' to apply delta.").arg(oldFilePath));
+			return QByteArray();
+		}
+		oldData = old.readAll();
+		old.close();
+	}
+
+	QDataStream stream(patch);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	quint32 resultSize = 0;
+	QByteArray expectedSha1;
+	stream >> resultSize >> expectedSha1;
+	if (stream.status() != QDataStream::Ok
+		|| expectedSha1.size() != 20) {
+		LOG(("Update Error: bad delta patch header for '%1'.").arg(oldFilePath));
+		return QByteArray();
+	}
+
+	auto result = QByteArray();
+	result.reserve(resultSize);
+	while (!stream.atEnd()) {
+		quint8 op = 0;
+		stream >> op;
+		if (op == 0) {
+			quint32 offset = 0, length = 0;
+			stream >> offset >> length;
+			if (stream.status() != QDataStream::Ok
+				|| quint64(offset) + length > quint64(oldData.size())) {
+				LOG(("Update Error: bad copy operation in delta patch for '%1'.").arg(oldFilePath));
+				return QByteArray();
+			}
+			result.append(oldData.constData() + offset, length);
+		} else if (op == 1) {
+			QByteArray data;
+			stream >> data;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("Update Error: bad insert operation in delta patch for '%1'.").arg(oldFilePath));
+				return QByteArray();
+			}
+			result.append(data);
+		} else {
+			LOG(("Update Error: unknown operation %1 in delta patch for '%2'.").arg(op).arg(oldFilePath));
+			return QByteArray();
+		}
+	}
+	if (quint32(result.size()) != resultSize) {
+		LOG(("Update Error: bad delta result size %1, expected %2 for '%3'.").arg(result.size()).arg(resultSize).arg(oldFilePath));
+		return QByteArray();
+	}
+
+	uchar sha1Buffer[20];
+	hashSha1(result.constData(), result.size(), sha1Buffer);
+	if (memcmp(sha1Buffer, expectedSha1.constData(), 20)) {
+		LOG(("Update Error: delta result hash mismatch for '%1', the installed file was probably modified.").arg(oldFilePath));
+		return QByteArray();
+	}
+	return result;
+}
+
+} // namespace
+
 void Updater::Private::unpackUpdate() {
 	QByteArray packed;
 	if (!_output.open(QIODevice::ReadOnly)) {
@@ -978,6 +1143,15 @@ void Updater::Private::unpackUpdate() {
 				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
 				return fatalFail();
 			}
+			if (_isDelta) {
+				fileInnerData = ApplyDeltaPatch(
+					cExeDir() + relativeName,
+					fileInnerData);
+				if (fileInnerData.isNull()) {
+					LOG(("Update Error: cant apply delta patch for file '%1'").arg(relativeName));
+					return fatalFail();
+				}
+			}
 			if (fileSize != quint32(fileInnerData.size())) {
 				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerData.size()));
 				return fatalFail();
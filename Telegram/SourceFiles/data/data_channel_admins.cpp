@@ -28,6 +28,7 @@ void ChannelAdminChanges::feed(UserId userId, bool isAdmin) {
 
 ChannelAdminChanges::~ChannelAdminChanges() {
 	if (!_changes.empty()) {
+		++_channel->mgInfo->adminsVersion;
 		if (auto history = App::historyLoaded(_channel)) {
 			history->applyGroupAdminChanges(_changes);
 		}
@@ -396,6 +396,14 @@ VoiceData::~VoiceData() {
 	}
 }
 
+VideoData::~VideoData() {
+	if (thumbsStripTask.size() == int(sizeof(TaskId))) {
+		TaskId taskId = 0;
+		memcpy(&taskId, thumbsStripTask.constData(), sizeof(taskId));
+		Local::cancelTask(taskId);
+	}
+}
+
 DocumentData::DocumentData(DocumentId id, not_null<AuthSession*> session)
 : id(id)
 , _session(session) {
@@ -433,6 +441,9 @@ void DocumentData::setattributes(const QVector<MTPDocumentAttribute> &attributes
 			auto &d = attributes[i].c_documentAttributeVideo();
 			if (type == FileDocument) {
 				type = d.is_round_message() ? RoundVideoDocument : VideoDocument;
+				if (type == VideoDocument) {
+					_additional = std::make_unique<VideoData>();
+				}
 			}
 			_duration = d.vduration.v;
 			dimensions = QSize(d.vw.v, d.vh.v);
@@ -690,6 +701,12 @@ int32 DocumentData::loadOffset() const {
 	return loading() ? _loader->currentOffset() : 0;
 }
 
+int32 DocumentData::streamedPrefixSize() const {
+	// The sequential prefix of a still loading file already written to
+	// the disk, for streaming playback of partially downloaded videos.
+	return loading() ? _loader->diskPrefixSize() : 0;
+}
+
 bool DocumentData::uploading() const {
 	return (uploadingData != nullptr);
 }
@@ -760,6 +777,10 @@ void DocumentData::save(
 
 		_loader->connect(_loader, SIGNAL(progress(FileLoader*)), App::main(), SLOT(documentLoadProgress(FileLoader*)));
 		_loader->connect(_loader, SIGNAL(failed(FileLoader*,bool)), App::main(), SLOT(documentLoadFailed(FileLoader*,bool)));
+		if (!autoLoading) {
+			// The user asked for this file explicitly.
+			_loader->setLoadPriority(LoadPriority::Viewport);
+		}
 		_loader->start();
 	}
 	_session->data().notifyDocumentLayoutChanged(this);
@@ -967,6 +988,16 @@ const VoiceData *DocumentData::voice() const {
 	return const_cast<DocumentData*>(this)->voice();
 }
 
+VideoData *DocumentData::video() {
+	return isVideoFile()
+		? static_cast<VideoData*>(_additional.get())
+		: nullptr;
+}
+
+const VideoData *DocumentData::video() const {
+	return const_cast<DocumentData*>(this)->video();
+}
+
 bool DocumentData::hasRemoteLocation() const {
 	return (_dc != 0 && _access != 0);
 }
@@ -63,6 +63,17 @@ struct VoiceData : public DocumentAdditionalData {
 	char wavemax = 0;
 };
 
+struct VideoData : public DocumentAdditionalData {
+	~VideoData();
+
+	// A horizontal strip of sparse keyframe thumbnails shown while
+	// scrubbing, see Local::countVideoThumbsStrip(). While the strip
+	// is being counted thumbsStripTask holds the TaskId bytes.
+	QImage thumbsStrip;
+	QByteArray thumbsStripTask;
+	bool thumbsStripFailed = false;
+};
+
 bool fileIsImage(const QString &name, const QString &mime);
 
 namespace Serialize {
@@ -101,6 +112,7 @@ public:
 	void cancel();
 	float64 progress() const;
 	int32 loadOffset() const;
+	int32 streamedPrefixSize() const;
 	bool uploading() const;
 
 	void setWaitingForAlbum();
@@ -128,6 +140,8 @@ public:
 	const SongData *song() const;
 	VoiceData *voice();
 	const VoiceData *voice() const;
+	VideoData *video();
+	const VideoData *video() const;
 
 	bool isVoiceMessage() const;
 	bool isVideoMessage() const;
@@ -73,8 +73,10 @@ void Feed::registerOne(not_null<ChannelData*> channel) {
 	if (!base::contains(_channels, history)) {
 		const auto invisible = (_channels.size() < 2);
 		_channels.push_back(history);
-		_parent->session().storage().invalidate(
-			Storage::FeedMessagesInvalidate(_id));
+		if (!_settingChannels) {
+			_parent->session().storage().invalidate(
+				Storage::FeedMessagesInvalidate(_id));
+		}
 
 		if (history->lastMessageKnown()) {
 			if (const auto last = history->lastMessage()) {
@@ -106,7 +108,9 @@ void Feed::registerOne(not_null<ChannelData*> channel) {
 		} else {
 			history->updateChatListExistence();
 		}
-		_parent->notifyFeedUpdated(this, FeedUpdateFlag::Channels);
+		if (!_settingChannels) {
+			_parent->notifyFeedUpdated(this, FeedUpdateFlag::Channels);
+		}
 	}
 }
 
@@ -143,7 +147,9 @@ void Feed::unregisterOne(not_null<ChannelData*> channel) {
 		} else {
 			history->updateChatListExistence();
 		}
-		_parent->notifyFeedUpdated(this, FeedUpdateFlag::Channels);
+		if (!_settingChannels) {
+			_parent->notifyFeedUpdated(this, FeedUpdateFlag::Channels);
+		}
 	}
 }
 
@@ -254,6 +260,17 @@ void Feed::changeChannelsList(
 		channel->setFeed(this);
 	}
 	_lastMessage = oldLastMessage;
+
+	// While _settingChannels is set registerOne() / unregisterOne()
+	// don't invalidate the merged messages slice and don't notify
+	// about the channels change, the whole batch does it here once.
+	if (!add.empty()) {
+		_parent->session().storage().invalidate(
+			Storage::FeedMessagesInvalidate(_id));
+	}
+	if (!add.empty() || !remove.empty()) {
+		_parent->notifyFeedUpdated(this, FeedUpdateFlag::Channels);
+	}
 }
 
 bool Feed::justUpdateLastMessage(not_null<HistoryItem*> item) {
@@ -283,22 +300,25 @@ void Feed::historyCleared(not_null<History*> history) {
 
 void Feed::recountLastMessage() {
 	_lastMessage = base::none;
-	for (const auto history : _channels) {
-		if (!history->lastMessageKnown()) {
-			_parent->session().api().requestDialogEntry(this);
-			return;
-		}
-	}
 	setLastMessageFromChannels();
 }
 
 void Feed::setLastMessageFromChannels() {
-	_lastMessage = nullptr;
+	// A single pass: collect the best last message while checking that
+	// all of them are known, instead of a separate validation loop.
+	auto best = (HistoryItem*)nullptr;
 	for (const auto history : _channels) {
-		if (const auto last = history->lastMessage()) {
-			justUpdateLastMessage(last);
+		if (!history->lastMessageKnown()) {
+			_lastMessage = base::none;
+			_parent->session().api().requestDialogEntry(this);
+			return;
+		} else if (const auto last = history->lastMessage()) {
+			if (!best || best->position() < last->position()) {
+				best = last;
+			}
 		}
 	}
+	_lastMessage = best;
 	updateChatsListDate();
 }
 
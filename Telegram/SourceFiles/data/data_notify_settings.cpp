@@ -34,6 +34,7 @@ public:
 		SilentPostsChange silent,
 		int muteForSeconds);
 	TimeMs muteFinishesIn() const;
+	bool muted() const;
 	bool silentPosts() const;
 	MTPinputPeerNotifySettings serialize() const;
 
@@ -42,17 +43,33 @@ private:
 		MTPDpeerNotifySettings::Flags flags,
 		TimeId mute,
 		QString sound);
+	void refreshMute() const;
 
 	MTPDpeerNotifySettings::Flags _flags;
 	TimeId _mute;
 	QString _sound;
 
+	// The resolved mute state, so that the per-message checks during
+	// floods read one flag instead of comparing against unixtime().
+	// Refreshed on every change and from the App::updateMuted() timer
+	// that fires when a mute deadline passes.
+	mutable bool _muted = false;
+
 };
 
 NotifySettingsValue::NotifySettingsValue(const MTPDpeerNotifySettings &data)
 : _flags(data.vflags.v)
 , _mute(data.vmute_until.v)
 , _sound(qs(data.vsound)) {
+	refreshMute();
+}
+
+void NotifySettingsValue::refreshMute() const {
+	_muted = (_mute > unixtime());
+}
+
+bool NotifySettingsValue::muted() const {
+	return _muted;
 }
 
 bool NotifySettingsValue::silentPosts() const {
@@ -90,19 +107,23 @@ bool NotifySettingsValue::change(
 		TimeId mute,
 		QString sound) {
 	if (_flags == flags && _mute == mute && _sound == sound) {
+		refreshMute();
 		return false;
 	}
 	_flags = flags;
 	_mute = mute;
 	_sound = sound;
+	refreshMute();
 	return true;
 }
 
 TimeMs NotifySettingsValue::muteFinishesIn() const {
 	auto now = unixtime();
 	if (_mute > now) {
+		_muted = true;
 		return (_mute - now + 1) * 1000LL;
 	}
+	_muted = false;
 	return 0;
 }
 
@@ -158,6 +179,12 @@ TimeMs NotifySettings::muteFinishesIn() const {
 		: 0LL;
 }
 
+bool NotifySettings::muted() const {
+	return _value
+		? _value->muted()
+		: false;
+}
+
 bool NotifySettings::settingsUnknown() const {
 	return !_known;
 }
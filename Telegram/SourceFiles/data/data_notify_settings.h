@@ -32,6 +32,7 @@ public:
 		SilentPostsChange silent,
 		int muteForSeconds);
 	TimeMs muteFinishesIn() const;
+	bool muted() const;
 	bool settingsUnknown() const;
 	bool silentPosts() const;
 	MTPinputPeerNotifySettings serialize() const;
@@ -90,7 +90,9 @@ public:
 		return _notify.serialize();
 	}
 	bool isMuted() const {
-		return (notifyMuteFinishesIn() > 0);
+		// One cached flag read, refreshed when the settings change
+		// and when a mute deadline passes in App::updateMuted().
+		return _notify.muted();
 	}
 
 	bool canWrite() const;
@@ -701,6 +703,11 @@ struct MegagroupInfo {
 	// For admin badges, full admins list.
 	base::flat_set<UserId> admins;
 
+	// Epoch of the admins set above, bumped on every change, so the
+	// cached admin badge state of a message can be validated with one
+	// comparison instead of a set lookup on each layout pass.
+	int adminsVersion = 1;
+
 	UserData *creator = nullptr; // nullptr means unknown
 	int botStatus = 0; // -1 - no bots, 0 - unknown, 1 - one bot, that sees all history, 2 - other
 	bool joinedMessageFound = false;
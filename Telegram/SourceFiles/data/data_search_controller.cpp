@@ -18,6 +18,8 @@ namespace {
 
 constexpr auto kSharedMediaLimit = 100;
 constexpr auto kDefaultSearchTimeoutMs = TimeMs(200);
+constexpr auto kCacheEntriesLimit = 16;
+constexpr auto kCacheEntryLifetime = 10 * 60 * TimeMs(1000);
 
 } // namespace
 
@@ -188,16 +190,72 @@ bool SearchController::hasInCache(const Query &query) const {
 }
 
 void SearchController::setQuery(const Query &query) {
-	if (query.query.isEmpty()) {
-		_cache.clear();
-		_current = _cache.end();
-	} else {
-		_current = _cache.find(query);
-	}
+	_current = _cache.find(query);
 	if (_current == _cache.end()) {
 		_current = _cache.emplace(
 			query,
 			std::make_unique<CacheEntry>(query)).first;
+		subscribeToRemovals(_current->second.get());
+	}
+	_current->second->lastUsed = getms(true);
+	trimCache();
+}
+
+void SearchController::subscribeToRemovals(not_null<CacheEntry*> entry) {
+	// Removals reach live viewers through their slice builders, but a
+	// cached list with no viewer would keep deleted ids and show them
+	// again when its query is re-run, so prune the lists themselves.
+	const auto subscribe = [&](Data *data) {
+		const auto peer = data->peer;
+		const auto list = &data->list;
+		Auth().data().itemRemoved(
+		) | rpl::filter([=](not_null<const HistoryItem*> item) {
+			return (item->history()->peer == peer);
+		}) | rpl::start_with_next([=](not_null<const HistoryItem*> item) {
+			list->removeOne(item->id);
+		}, entry->lifetime);
+
+		Auth().data().historyCleared(
+		) | rpl::filter([=](not_null<const History*> history) {
+			return (history->peer == peer);
+		}) | rpl::start_with_next([=] {
+			list->removeAll();
+		}, entry->lifetime);
+	};
+	subscribe(&entry->peerData);
+	if (entry->migratedData) {
+		subscribe(&*entry->migratedData);
+	}
+}
+
+void SearchController::trimCache() {
+	Expects(_current != _cache.end());
+
+	// Keeping recent queries cached lets a re-run of one of them paint
+	// the local results instantly. Viewers only exist for the current
+	// query, which is never evicted, so dropping an entry is safe - it
+	// also cancels the requests it keeps in flight.
+	const auto now = getms(true);
+	const auto currentQuery = _current->first;
+	while (true) {
+		auto evict = _cache.end();
+		for (auto i = _cache.begin(); i != _cache.end(); ++i) {
+			if (i == _current) {
+				continue;
+			} else if (i->second->lastUsed + kCacheEntryLifetime <= now) {
+				evict = i;
+				break;
+			} else if (_cache.size() > kCacheEntriesLimit
+				&& (evict == _cache.end()
+					|| i->second->lastUsed < evict->second->lastUsed)) {
+				evict = i;
+			}
+		}
+		if (evict == _cache.end()) {
+			break;
+		}
+		_cache.erase(evict);
+		_current = _cache.find(currentQuery);
 	}
 }
 
@@ -324,7 +382,9 @@ void SearchController::restoreState(SavedState &&state) {
 		it = _cache.emplace(
 			state.query,
 			std::make_unique<CacheEntry>(state.query)).first;
+		subscribeToRemovals(it->second.get());
 	}
+	it->second->lastUsed = getms(true);
 	auto replace = Data(it->second->peerData.peer);
 	replace.list = std::move(state.peerList);
 	it->second->peerData = std::move(replace);
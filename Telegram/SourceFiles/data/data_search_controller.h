@@ -101,6 +101,8 @@ private:
 
 		Data peerData;
 		base::optional<Data> migratedData;
+		TimeMs lastUsed = 0;
+		rpl::lifetime lifetime;
 	};
 
 	struct CacheLess {
@@ -123,6 +125,8 @@ private:
 		const SparseIdsSliceBuilder::AroundData &key,
 		const Query &query,
 		Data *listData);
+	void subscribeToRemovals(not_null<CacheEntry*> entry);
+	void trimCache();
 
 	Cache _cache;
 	Cache::iterator _current = _cache.end();
@@ -0,0 +1,107 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_search_index.h"
+
+#include "history/history.h"
+#include "history/history_item.h"
+
+namespace Data {
+namespace {
+
+// Protects the index from degenerate messages, a text this long is
+// not findable past that point, which is fine for instant results.
+constexpr auto kMaxWordsPerMessage = 128;
+
+} // namespace
+
+void SearchIndex::update(not_null<HistoryItem*> item, const QString &text) {
+	remove(item);
+	if (text.isEmpty()) {
+		return;
+	}
+	auto words = TextUtilities::PrepareSearchWords(text);
+	if (words.isEmpty()) {
+		return;
+	}
+	if (words.size() > kMaxWordsPerMessage) {
+		words.erase(words.begin() + kMaxWordsPerMessage, words.end());
+	}
+	auto &stored = _words[item];
+	stored.reserve(words.size());
+	for (const auto &word : words) {
+		_postings[word].insert(item);
+		stored.push_back(word);
+	}
+}
+
+void SearchIndex::remove(not_null<HistoryItem*> item) {
+	const auto i = _words.find(item);
+	if (i == _words.end()) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _postings.find(word);
+		if (j != _postings.end()) {
+			j->second.remove(item);
+			if (j->second.empty()) {
+				_postings.erase(j);
+			}
+		}
+	}
+	_words.erase(i);
+}
+
+std::vector<not_null<HistoryItem*>> SearchIndex::query(
+		const QString &query,
+		History *inHistory,
+		int limit) const {
+	auto result = std::vector<not_null<HistoryItem*>>();
+	const auto words = TextUtilities::PrepareSearchWords(query);
+	if (words.isEmpty()) {
+		return result;
+	}
+
+	// Intersect the prefix matches of all query words, checking the
+	// rarest-looking restriction (the already found set) first.
+	auto found = base::flat_set<not_null<HistoryItem*>>();
+	auto first = true;
+	for (const auto &word : words) {
+		auto matched = base::flat_set<not_null<HistoryItem*>>();
+		for (auto i = _postings.lower_bound(word)
+			; i != _postings.end() && i->first.startsWith(word)
+			; ++i) {
+			for (const auto item : i->second) {
+				if ((first || found.contains(item))
+					&& (!inHistory || item->history() == inHistory)) {
+					matched.insert(item);
+				}
+			}
+		}
+		if (matched.empty()) {
+			return result;
+		}
+		found = std::move(matched);
+		first = false;
+	}
+
+	result.reserve(found.size());
+	for (const auto item : found) {
+		result.push_back(item);
+	}
+	ranges::sort(result, [](not_null<HistoryItem*> a, auto b) {
+		return (a->date() != b->date())
+			? (a->date() > b->date())
+			: (a->id > b->id);
+	});
+	if (limit >= 0 && result.size() > size_t(limit)) {
+		result.resize(limit);
+	}
+	return result;
+}
+
+} // namespace Data
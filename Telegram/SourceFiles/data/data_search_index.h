@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class HistoryItem;
+class History;
+
+namespace Data {
+
+// Incremental inverted index over the message texts currently loaded
+// in memory. It powers instant local results in the messages search
+// while the server round-trip is in flight or unavailable offline.
+//
+// Message history is not persisted locally, so neither is the index —
+// it covers exactly the messages the client has seen in this session
+// and is filled for free as history slices arrive.
+class SearchIndex {
+public:
+	// (Re)indexes the item with the given text. Repeated calls
+	// replace the previously stored words, so edits just call this
+	// again. Items with empty text are not indexed.
+	void update(not_null<HistoryItem*> item, const QString &text);
+	void remove(not_null<HistoryItem*> item);
+
+	// Returns up to limit messages each of which contains a word
+	// starting with every word of the query, newest first. Passing
+	// a history restricts the results to that history.
+	std::vector<not_null<HistoryItem*>> query(
+		const QString &query,
+		History *inHistory,
+		int limit) const;
+
+private:
+	std::map<QString, base::flat_set<not_null<HistoryItem*>>> _postings;
+	std::map<not_null<HistoryItem*>, std::vector<QString>> _words;
+
+};
+
+} // namespace Data
@@ -22,6 +22,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_document.h"
 #include "data/data_web_page.h"
 #include "data/data_game.h"
+#include "platform/platform_specific.h"
 
 namespace Data {
 namespace {
@@ -37,6 +38,19 @@ using ViewElement = HistoryView::Element;
 // b: crop 320x320
 // c: crop 640x640
 // d: crop 1280x1280
+// Pinned dialogs carry sparse ordering keys so that pinning, unpinning
+// and reordering write only the keys of the dialogs that actually move.
+// The whole sequence is renumbered only when the key space runs out,
+// which can't happen in practice with the pinned dialogs count limits.
+constexpr auto kPinnedOrderStep = uint64(0x10000);
+constexpr auto kPinnedOrderLimit = uint64(0xFFFFFFFF);
+
+// Unreferenced media caches are collected this often, but only once
+// the user has been away from the keyboard for the idle delay, so an
+// image that is actually on screen is never forgotten mid-look.
+constexpr auto kMediaGarbageCollectEach = 60 * TimeMs(1000);
+constexpr auto kMediaGarbageIdleDelay = 60 * TimeMs(1000);
+
 const auto ThumbLevels = QByteArray::fromRawData("sambcxydw", 9);
 const auto MediumLevels = QByteArray::fromRawData("mbcxasydw", 9);
 const auto FullLevels = QByteArray::fromRawData("yxwmsdcba", 9);
@@ -59,9 +73,11 @@ void UpdateImage(ImagePtr &old, ImagePtr now) {
 
 Session::Session(not_null<AuthSession*> session)
 : _session(session)
-, _groups(this) {
+, _groups(this)
+, _mediaGarbageTimer([=] { collectMediaGarbage(); }) {
 	setupContactViewsViewer();
 	setupChannelLeavingViewer();
+	_mediaGarbageTimer.callEach(kMediaGarbageCollectEach);
 }
 
 void Session::setupContactViewsViewer() {
@@ -224,6 +240,14 @@ rpl::producer<not_null<const ViewElement*>> Session::viewRepaintRequest() const
 	return _viewRepaintRequest.events();
 }
 
+void Session::requestViewMediaRepaint(not_null<const ViewElement*> view) {
+	_viewMediaRepaintRequest.fire_copy(view);
+}
+
+rpl::producer<not_null<const ViewElement*>> Session::viewMediaRepaintRequest() const {
+	return _viewMediaRepaintRequest.events();
+}
+
 void Session::requestItemResize(not_null<const HistoryItem*> item) {
 	_itemResizeRequest.fire_copy(item);
 	enumerateItemViews(item, [&](not_null<ViewElement*> view) {
@@ -475,6 +499,27 @@ void Session::applyPinnedDialogs(const QVector<MTPDialogPeer> &list) {
 	}
 }
 
+void Session::addPendingLastMessage(const MTPMessage &data) {
+	const auto peerId = peerFromMessage(data);
+	const auto msgId = idFromMessage(data);
+	if (!peerId || !msgId) {
+		return;
+	}
+	const auto itemId = FullMsgId(peerToChannel(peerId), msgId);
+	_pendingLastMessages.insert_or_assign(itemId, data);
+}
+
+base::optional<MTPMessage> Session::takePendingLastMessage(
+		FullMsgId itemId) {
+	const auto i = _pendingLastMessages.find(itemId);
+	if (i == _pendingLastMessages.cend()) {
+		return base::none;
+	}
+	auto result = base::optional<MTPMessage>(std::move(i->second));
+	_pendingLastMessages.erase(i);
+	return result;
+}
+
 int Session::pinnedDialogsCount() const {
 	return _pinnedDialogs.size();
 }
@@ -499,45 +544,91 @@ void Session::reorderTwoPinnedDialogs(
 	Assert(index2 >= 0 && index2 < order.size());
 	Assert(index1 != index2);
 	std::swap(_pinnedDialogs[index1], _pinnedDialogs[index2]);
-	key1.entry()->cachePinnedIndex(index2 + 1);
-	key2.entry()->cachePinnedIndex(index1 + 1);
+	const auto order1 = key1.entry()->pinnedOrder();
+	const auto order2 = key2.entry()->pinnedOrder();
+	key1.entry()->cachePinnedOrder(order2);
+	key2.entry()->cachePinnedOrder(order1);
 }
 
 void Session::setIsPinned(const Dialogs::Key &key, bool pinned) {
 	const auto already = ranges::find(_pinnedDialogs, key);
 	if (pinned) {
 		if (already != end(_pinnedDialogs)) {
-			auto saved = std::move(*already);
-			const auto alreadyIndex = already - end(_pinnedDialogs);
-			const auto count = int(size(_pinnedDialogs));
-			Assert(alreadyIndex < count);
-			for (auto index = alreadyIndex + 1; index != count; ++index) {
-				_pinnedDialogs[index - 1] = std::move(_pinnedDialogs[index]);
-				_pinnedDialogs[index - 1].entry()->cachePinnedIndex(index);
+			if (already + 1 != end(_pinnedDialogs)) {
+				_pinnedDialogs.erase(already);
+				key.entry()->cachePinnedOrder(takeNextPinnedOrder());
+				_pinnedDialogs.push_back(key);
 			}
-			_pinnedDialogs.back() = std::move(saved);
-			_pinnedDialogs.back().entry()->cachePinnedIndex(count);
 		} else {
+			key.entry()->cachePinnedOrder(takeNextPinnedOrder());
 			_pinnedDialogs.push_back(key);
 			if (_pinnedDialogs.size() > Global::PinnedDialogsCountMax()) {
-				_pinnedDialogs.front().entry()->cachePinnedIndex(0);
+				_pinnedDialogs.front().entry()->cachePinnedOrder(0);
 				_pinnedDialogs.pop_front();
-
-				auto index = 0;
-				for (const auto &pinned : _pinnedDialogs) {
-					pinned.entry()->cachePinnedIndex(++index);
-				}
-			} else {
-				key.entry()->cachePinnedIndex(_pinnedDialogs.size());
 			}
 		}
 	} else if (!pinned && already != end(_pinnedDialogs)) {
-		key.entry()->cachePinnedIndex(0);
+		key.entry()->cachePinnedOrder(0);
 		_pinnedDialogs.erase(already);
-		auto index = 0;
-		for (const auto &pinned : _pinnedDialogs) {
-			pinned.entry()->cachePinnedIndex(++index);
+	}
+}
+
+uint64 Session::takeNextPinnedOrder() {
+	auto last = _pinnedDialogs.empty()
+		? uint64(0)
+		: _pinnedDialogs.back().entry()->pinnedOrder();
+	if (last > kPinnedOrderLimit - kPinnedOrderStep) {
+		renumberPinnedOrder();
+		last = _pinnedDialogs.back().entry()->pinnedOrder();
+	}
+	return last + kPinnedOrderStep;
+}
+
+void Session::renumberPinnedOrder() {
+	auto order = uint64(0);
+	for (const auto &pinned : _pinnedDialogs) {
+		pinned.entry()->cachePinnedOrder(order += kPinnedOrderStep);
+	}
+}
+
+void Session::collectMediaGarbage() {
+	if (psIdleTime() < kMediaGarbageIdleDelay) {
+		return;
+	}
+	auto photos = 0;
+	for (const auto &[id, photo] : _photos) {
+		if (photo->loading()
+			|| photo->uploading()
+			|| (_photoItems.find(photo.get()) != _photoItems.end())) {
+			continue;
+		}
+		photo->forget();
+		++photos;
+	}
+	auto documents = 0;
+	for (const auto &[id, document] : _documents) {
+		if (document->loading()
+			|| document->uploading()
+			|| (_documentItems.find(document.get())
+				!= _documentItems.end())) {
+			continue;
 		}
+		document->forget();
+		++documents;
+	}
+	if (photos || documents) {
+		DEBUG_LOG(("Media GC: Dropped the caches of %1 photos "
+			"and %2 documents.").arg(photos).arg(documents));
+	}
+}
+
+void Session::reserveFromDialogs(int dialogsCount) {
+	// Almost every dialog brings a last message and most of those
+	// carry media, reserve once instead of rehashing while the
+	// dialogs slices arrive.
+	if (dialogsCount > 0) {
+		_photos.reserve(dialogsCount);
+		_documents.reserve(dialogsCount);
 	}
 }
 
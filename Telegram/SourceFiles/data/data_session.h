@@ -10,6 +10,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "chat_helpers/stickers.h"
 #include "dialogs/dialogs_key.h"
 #include "data/data_groups.h"
+#include "data/data_search_index.h"
+#include "base/hash_map.h"
+#include "base/timer.h"
 
 class HistoryItem;
 
@@ -74,6 +77,11 @@ public:
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemRepaintRequest() const;
 	void requestViewRepaint(not_null<const ViewElement*> view);
 	[[nodiscard]] rpl::producer<not_null<const ViewElement*>> viewRepaintRequest() const;
+
+	// Repaint only the media rectangle of the view, for download /
+	// upload progress ticks that don't touch the rest of the item.
+	void requestViewMediaRepaint(not_null<const ViewElement*> view);
+	[[nodiscard]] rpl::producer<not_null<const ViewElement*>> viewMediaRepaintRequest() const;
 	void requestItemResize(not_null<const HistoryItem*> item);
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemResizeRequest() const;
 	void requestViewResize(not_null<ViewElement*> view);
@@ -194,6 +202,11 @@ public:
 	MessageIdsList itemsToIds(const HistoryItemsList &items) const;
 	MessageIdsList itemOrItsGroup(not_null<HistoryItem*> item) const;
 
+	// Raw last messages from the dialogs list, kept unparsed until the
+	// chat list preview or the history itself first needs the item.
+	void addPendingLastMessage(const MTPMessage &data);
+	base::optional<MTPMessage> takePendingLastMessage(FullMsgId itemId);
+
 	int pinnedDialogsCount() const;
 	const std::deque<Dialogs::Key> &pinnedDialogsOrder() const;
 	void setPinnedDialog(const Dialogs::Key &key, bool pinned);
@@ -213,6 +226,16 @@ public:
 	void requestDocumentViewRepaint(not_null<const DocumentData*> document);
 	void markMediaRead(not_null<const DocumentData*> document);
 
+	// The dialogs count from the server hints how much media metadata
+	// is about to arrive, so the lookup tables can be sized once.
+	void reserveFromDialogs(int dialogsCount);
+
+	// Drops the cached bytes and thumbnails of media objects that no
+	// loaded history item references, the counts go to the debug log.
+	// Runs on a timer while the user is idle. The descriptors stay
+	// alive because the UI may still hold raw pointers to them.
+	void collectMediaGarbage();
+
 	not_null<PhotoData*> photo(PhotoId id);
 	not_null<PhotoData*> photo(const MTPPhoto &data);
 	not_null<PhotoData*> photo(const MTPDphoto &data);
@@ -370,6 +393,13 @@ public:
 		return _groups;
 	}
 
+	SearchIndex &searchIndex() {
+		return _searchIndex;
+	}
+	const SearchIndex &searchIndex() const {
+		return _searchIndex;
+	}
+
 private:
 	void setupContactViewsViewer();
 	void setupChannelLeavingViewer();
@@ -449,6 +479,8 @@ private:
 
 	void clearPinnedDialogs();
 	void setIsPinned(const Dialogs::Key &key, bool pinned);
+	uint64 takeNextPinnedOrder();
+	void renumberPinnedOrder();
 
 	template <typename Method>
 	void enumerateItemViews(
@@ -466,6 +498,7 @@ private:
 	rpl::event_stream<not_null<const ViewElement*>> _viewLayoutChanges;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemRepaintRequest;
 	rpl::event_stream<not_null<const ViewElement*>> _viewRepaintRequest;
+	rpl::event_stream<not_null<const ViewElement*>> _viewMediaRepaintRequest;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemResizeRequest;
 	rpl::event_stream<not_null<ViewElement*>> _viewResizeRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _itemViewRefreshRequest;
@@ -495,13 +528,13 @@ private:
 	Stickers::Order _archivedStickerSetsOrder;
 	Stickers::SavedGifs _savedGifs;
 
-	std::unordered_map<
+	base::hash_map<
 		PhotoId,
 		std::unique_ptr<PhotoData>> _photos;
 	std::map<
 		not_null<const PhotoData*>,
 		base::flat_set<not_null<HistoryItem*>>> _photoItems;
-	std::unordered_map<
+	base::hash_map<
 		DocumentId,
 		std::unique_ptr<DocumentData>> _documents;
 	std::map<
@@ -536,9 +569,12 @@ private:
 	base::flat_set<not_null<GameData*>> _gamesUpdated;
 
 	std::deque<Dialogs::Key> _pinnedDialogs;
+	std::map<FullMsgId, MTPMessage> _pendingLastMessages;
 	base::flat_map<FeedId, std::unique_ptr<Feed>> _feeds;
 	rpl::variable<FeedId> _defaultFeedId = FeedId();
 	Groups _groups;
+	SearchIndex _searchIndex;
+	base::Timer _mediaGarbageTimer;
 	std::map<
 		not_null<const HistoryItem*>,
 		std::vector<not_null<ViewElement*>>> _views;
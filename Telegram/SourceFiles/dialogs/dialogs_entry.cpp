@@ -26,8 +26,8 @@ uint64 DialogPosFromDate(const QDateTime &date) {
 	return (uint64(date.toTime_t()) << 32) | (++DialogsPosToTopShift);
 }
 
-uint64 PinnedDialogPos(int pinnedIndex) {
-	return 0xFFFFFFFF00000000ULL + pinnedIndex;
+uint64 PinnedDialogPos(uint64 pinnedOrder) {
+	return 0xFFFFFFFF00000000ULL + pinnedOrder;
 }
 
 } // namespace
@@ -37,10 +37,10 @@ Entry::Entry(const Key &key)
 , _key(key) {
 }
 
-void Entry::cachePinnedIndex(int index) {
-	if (_pinnedIndex != index) {
+void Entry::cachePinnedOrder(uint64 order) {
+	if (_pinnedOrder != order) {
 		const auto wasPinned = isPinnedDialog();
-		_pinnedIndex = index;
+		_pinnedOrder = order;
 		updateChatListSortPosition();
 		updateChatListEntry();
 		if (wasPinned != isPinnedDialog()) {
@@ -55,7 +55,7 @@ bool Entry::needUpdateInChatList() const {
 
 void Entry::updateChatListSortPosition() {
 	_sortKeyInChatList = isPinnedDialog()
-		? PinnedDialogPos(_pinnedIndex)
+		? PinnedDialogPos(_pinnedOrder)
 		: DialogPosFromDate(adjustChatListDate());
 	if (needUpdateInChatList()) {
 		setChatListExistence(true);
@@ -53,9 +53,12 @@ public:
 		not_null<Row*> row);
 	void updateChatListEntry() const;
 	bool isPinnedDialog() const {
-		return _pinnedIndex > 0;
+		return _pinnedOrder > 0;
 	}
-	void cachePinnedIndex(int index);
+	uint64 pinnedOrder() const {
+		return _pinnedOrder;
+	}
+	void cachePinnedOrder(uint64 order);
 	uint64 sortKeyInChatList() const {
 		return _sortKeyInChatList;
 	}
@@ -110,7 +113,11 @@ private:
 	Dialogs::Key _key;
 	RowsByLetter _chatListLinks[2];
 	uint64 _sortKeyInChatList = 0;
-	int _pinnedIndex = 0;
+
+	// Sparse ordering key inside the pinned dialogs sequence, 0 means
+	// not pinned. Assigned in Data::Session, only the relative order of
+	// the values matters. Must fit in the lower 32 bits of the sort key.
+	uint64 _pinnedOrder = 0;
 	QDateTime _lastMessageDate;
 
 };
@@ -0,0 +1,135 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "dialogs/dialogs_fragment_index.h"
+
+namespace Dialogs {
+namespace {
+
+std::vector<QString> FragmentsFromWord(const QString &word) {
+	auto result = std::vector<QString>();
+	const auto length = word.size();
+	if (length < FragmentIndex::kFragmentLength) {
+		return result;
+	}
+	result.reserve(length - FragmentIndex::kFragmentLength + 1);
+	for (auto i = 0; i != length - FragmentIndex::kFragmentLength + 1; ++i) {
+		result.push_back(word.mid(i, FragmentIndex::kFragmentLength));
+	}
+	return result;
+}
+
+} // namespace
+
+void FragmentIndex::add(Key key, const base::flat_set<QString> &words) {
+	auto &stored = _words[key];
+	stored.assign(words.begin(), words.end());
+	for (const auto &word : stored) {
+		for (const auto &fragment : FragmentsFromWord(word)) {
+			_byFragment[fragment].insert(key);
+		}
+	}
+}
+
+void FragmentIndex::update(Key key, const base::flat_set<QString> &words) {
+	remove(key);
+	add(key, words);
+}
+
+void FragmentIndex::remove(Key key) {
+	const auto i = _words.find(key);
+	if (i == _words.cend()) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		for (const auto &fragment : FragmentsFromWord(word)) {
+			const auto j = _byFragment.find(fragment);
+			if (j != _byFragment.cend()) {
+				j->second.remove(key);
+				if (j->second.empty()) {
+					_byFragment.erase(j);
+				}
+			}
+		}
+	}
+	_words.erase(i);
+}
+
+std::vector<Key> FragmentIndex::search(const QStringList &words) const {
+	// An entry that contains a word also contains all of its fragments,
+	// so the candidates are the intersection of the fragment lists and
+	// only have to be verified against the actual words afterwards.
+	auto lists = std::vector<const base::flat_set<Key>*>();
+	for (const auto &word : words) {
+		for (const auto &fragment : FragmentsFromWord(word)) {
+			const auto i = _byFragment.find(fragment);
+			if (i == _byFragment.cend()) {
+				return {};
+			}
+			lists.push_back(&i->second);
+		}
+	}
+	if (lists.empty()) {
+		return {};
+	}
+	std::sort(lists.begin(), lists.end(), [](auto a, auto b) {
+		return a->size() < b->size();
+	});
+
+	auto ranked = std::vector<std::pair<int, Key>>();
+	for (const auto key : *lists.front()) {
+		const auto inAllLists = [&] {
+			for (auto i = lists.cbegin() + 1, e = lists.cend(); i != e; ++i) {
+				if (!(*i)->contains(key)) {
+					return false;
+				}
+			}
+			return true;
+		}();
+		if (!inAllLists) {
+			continue;
+		}
+		const auto &stored = _words.find(key)->second;
+		auto rank = 0;
+		const auto matches = [&] {
+			for (const auto &word : words) {
+				auto best = -1;
+				for (const auto &name : stored) {
+					const auto index = name.indexOf(word);
+					if (index >= 0 && (best < 0 || index < best)) {
+						best = index;
+						if (!best) {
+							break;
+						}
+					}
+				}
+				if (best < 0) {
+					return false;
+				}
+				rank += best;
+			}
+			return true;
+		}();
+		if (matches) {
+			ranked.push_back({ rank, key });
+		}
+	}
+	std::stable_sort(ranked.begin(), ranked.end(), [](
+			const auto &a,
+			const auto &b) {
+		return a.first < b.first;
+	});
+
+	auto result = std::vector<Key>();
+	result.reserve(ranked.size());
+	for (const auto &[rank, key] : ranked) {
+		result.push_back(key);
+	}
+	return result;
+}
+
+} // namespace Dialogs
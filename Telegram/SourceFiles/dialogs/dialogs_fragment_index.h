@@ -0,0 +1,39 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "dialogs/dialogs_key.h"
+#include "base/flat_set.h"
+
+namespace Dialogs {
+
+// Index over the lowercased dialog name words keyed by their short
+// fragments, so the filter can find matches anywhere inside a word
+// ("vano" finds "Ivanova"), unlike the first-letter index that only
+// supports matching by a word prefix.
+class FragmentIndex {
+public:
+	static constexpr auto kFragmentLength = 3;
+
+	void add(Key key, const base::flat_set<QString> &words);
+	void update(Key key, const base::flat_set<QString> &words);
+	void remove(Key key);
+
+	// Keys of the entries that contain every word of the query inside
+	// some of their name words, matches closer to a word start first.
+	// Returns nothing if no query word is at least kFragmentLength
+	// characters long, the index can't help with such queries.
+	std::vector<Key> search(const QStringList &words) const;
+
+private:
+	std::map<QString, base::flat_set<Key>> _byFragment;
+	std::map<Key, std::vector<QString>> _words;
+
+};
+
+} // namespace Dialogs
@@ -23,6 +23,7 @@ RowsByLetter IndexedList::addToEnd(Key key) {
 	RowsByLetter result;
 	if (!_list.contains(key)) {
 		result.emplace(0, _list.addToEnd(key));
+		_fragments.add(key, key.entry()->chatsListNameWords());
 		for (auto ch : key.entry()->chatsListFirstLetters()) {
 			auto j = _index.find(ch);
 			if (j == _index.cend()) {
@@ -42,6 +43,7 @@ Row *IndexedList::addByName(Key key) {
 	}
 
 	Row *result = _list.addByName(key);
+	_fragments.add(key, key.entry()->chatsListNameWords());
 	for (auto ch : key.entry()->chatsListFirstLetters()) {
 		auto j = _index.find(ch);
 		if (j == _index.cend()) {
@@ -121,6 +123,7 @@ void IndexedList::adjustByName(
 	const auto mainRow = _list.adjustByName(key);
 	if (!mainRow) return;
 
+	_fragments.update(key, key.entry()->chatsListNameWords());
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (auto ch : key.entry()->chatsListFirstLetters()) {
@@ -160,6 +163,7 @@ void IndexedList::adjustNames(
 	auto mainRow = _list.getRow(key);
 	if (!mainRow) return;
 
+	_fragments.update(key, key.entry()->chatsListNameWords());
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (auto ch : key.entry()->chatsListFirstLetters()) {
@@ -194,6 +198,7 @@ void IndexedList::adjustNames(
 
 void IndexedList::del(Key key, Row *replacedBy) {
 	if (_list.del(key, replacedBy)) {
+		_fragments.remove(key);
 		for (auto ch : key.entry()->chatsListFirstLetters()) {
 			if (auto it = _index.find(ch); it != _index.cend()) {
 				it->second->del(key, replacedBy);
@@ -202,6 +207,18 @@ void IndexedList::del(Key key, Row *replacedBy) {
 	}
 }
 
+std::vector<Row*> IndexedList::fragmentSearch(const QStringList &words) const {
+	const auto keys = _fragments.search(words);
+	auto result = std::vector<Row*>();
+	result.reserve(keys.size());
+	for (const auto &key : keys) {
+		if (const auto row = _list.getRow(key)) {
+			result.push_back(row);
+		}
+	}
+	return result;
+}
+
 void IndexedList::clear() {
 	_index.clear();
 }
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "dialogs/dialogs_entry.h"
 #include "dialogs/dialogs_list.h"
+#include "dialogs/dialogs_fragment_index.h"
 
 class History;
 
@@ -50,6 +51,10 @@ public:
 		return &_empty;
 	}
 
+	// Rows that contain every word of the query anywhere inside their
+	// name words, not only as a word prefix, best matches first.
+	std::vector<Row*> fragmentSearch(const QStringList &words) const;
+
 	~IndexedList();
 
 	// Part of List interface is duplicated here for all() list.
@@ -86,6 +91,7 @@ private:
 	SortMode _sortMode;
 	List _list, _empty;
 	base::flat_map<QChar, std::unique_ptr<List>> _index;
+	FragmentIndex _fragments;
 
 };
 
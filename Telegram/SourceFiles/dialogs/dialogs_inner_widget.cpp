@@ -31,6 +31,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "observer_peer.h"
 #include "chat_helpers/stickers.h"
 #include "auth_session.h"
+#include "core/startup_timeline.h"
 #include "window/notifications_manager.h"
 #include "window/window_controller.h"
 #include "window/window_peer_menu.h"
@@ -42,6 +43,29 @@ namespace {
 constexpr auto kHashtagResultsLimit = 5;
 constexpr auto kStartReorderThreshold = 30;
 
+// Bumped on palette changes so that all row render caches refill.
+auto RowPaintCacheGeneration = 0;
+
+// Returns true if every match of the new filter words is guaranteed
+// to be a match of the old ones, so the old result set can be narrowed
+// down instead of filtering all the entries again.
+bool FilterNarrows(const QStringList &was, const QStringList &now) {
+	for (const auto &word : was) {
+		const auto extended = [&] {
+			for (const auto &check : now) {
+				if (check.startsWith(word)) {
+					return true;
+				}
+			}
+			return false;
+		}();
+		if (!extended) {
+			return false;
+		}
+	}
+	return true;
+}
+
 } // namespace
 
 struct DialogsInner::ImportantSwitch {
@@ -117,6 +141,7 @@ DialogsInner::DialogsInner(QWidget *parent, not_null<Window::Controller*> contro
 	subscribe(Window::Theme::Background(), [=](const Window::Theme::BackgroundUpdate &data) {
 		if (data.paletteChanged()) {
 			Dialogs::Layout::clearUnreadBadgesCache();
+			++RowPaintCacheGeneration;
 		}
 	});
 
@@ -206,6 +231,9 @@ void DialogsInner::paintRegion(Painter &p, const QRegion &region, bool paintingO
 		_a_pinnedShifting.step(ms, false);
 
 		auto rows = shownDialogs();
+		if (!rows->isEmpty()) {
+			Core::StartupTimeline::MarkFirstDialogsPaint();
+		}
 		auto dialogsClip = r;
 		if (_dialogsImportant) {
 			auto selected = isPressed() ? _importantSwitchPressed : _importantSwitchSelected;
@@ -475,17 +503,97 @@ void DialogsInner::paintDialog(
 	if (xadd || yadd) p.translate(xadd, yadd);
 	const auto isActive = (row->key() == active);
 	const auto isSelected = (row->key() == selected);
-	Dialogs::Layout::RowPainter::paint(
-		p,
-		row,
-		fullWidth,
-		isActive,
-		isSelected,
-		onlyBackground,
-		ms);
+	if (onlyBackground
+		|| !paintDialogCached(p, row, fullWidth, isActive, isSelected, ms)) {
+		Dialogs::Layout::RowPainter::paint(
+			p,
+			row,
+			fullWidth,
+			isActive,
+			isSelected,
+			onlyBackground,
+			ms);
+	}
 	if (xadd || yadd) p.translate(-xadd, -yadd);
 }
 
+bool DialogsInner::paintDialogCached(
+		Painter &p,
+		not_null<Dialogs::Row*> row,
+		int fullWidth,
+		bool active,
+		bool selected,
+		TimeMs ms) {
+	const auto history = row->history();
+	if (!history || row->hasRipple() || history->hasSendActions()) {
+		row->paintCache = nullptr;
+		return false;
+	}
+	const auto entry = row->entry();
+	const auto item = entry->chatsListItem();
+	const auto peer = history->peer;
+	const auto from = peer->migrateTo()
+		? peer->migrateTo()
+		: peer.get();
+	const auto draft = history->cloudDraft();
+	auto &cache = row->paintCache;
+	const auto upToDate = cache
+		&& cache->width == fullWidth
+		&& cache->generation == RowPaintCacheGeneration
+		&& cache->active == active
+		&& cache->selected == selected
+		&& cache->item == item
+		&& cache->textCachedFor == entry->textCachedFor
+		&& cache->unreadCount == entry->chatListUnreadCount()
+		&& cache->unreadMuted == entry->chatListMutedBadge()
+		&& cache->unreadMentions == history->hasUnreadMentions()
+		&& cache->pinned == entry->isPinnedDialog()
+		&& cache->hasDraft == (draft != nullptr)
+		&& cache->draftDate == (draft ? draft->date : TimeId(0))
+		&& cache->draftRequestId == (draft ? draft->saveRequestId : 0)
+		&& cache->userpicKey == from->userpicUniqueKey();
+	if (!upToDate) {
+		if (!cache) {
+			cache = std::make_unique<Dialogs::Row::PaintCache>();
+		}
+		const auto ratio = cIntRetinaFactor();
+		if (cache->pixmap.width() != fullWidth * ratio
+			|| cache->pixmap.height() != st::dialogsRowHeight * ratio) {
+			cache->pixmap = QPixmap(
+				fullWidth * ratio,
+				st::dialogsRowHeight * ratio);
+			cache->pixmap.setDevicePixelRatio(cRetinaFactor());
+		}
+		{
+			Painter q(&cache->pixmap);
+			Dialogs::Layout::RowPainter::paint(
+				q,
+				row,
+				fullWidth,
+				active,
+				selected,
+				false,
+				ms);
+		}
+		cache->width = fullWidth;
+		cache->generation = RowPaintCacheGeneration;
+		cache->active = active;
+		cache->selected = selected;
+		cache->item = item;
+		cache->textCachedFor = entry->textCachedFor;
+		cache->unreadCount = entry->chatListUnreadCount();
+		cache->unreadMuted = entry->chatListMutedBadge();
+		cache->unreadMentions = history->hasUnreadMentions();
+		cache->pinned = entry->isPinnedDialog();
+		cache->hasDraft = (draft != nullptr);
+		cache->draftDate = draft ? draft->date : TimeId(0);
+		cache->draftRequestId = draft ? draft->saveRequestId : 0;
+		cache->userpicKey = from->userpicUniqueKey();
+	}
+	p.drawPixmap(0, 0, cache->pixmap);
+	return true;
+}
+
 void DialogsInner::paintPeerSearchResult(
 		Painter &p,
 		not_null<const PeerSearchResult*> result,
@@ -1221,6 +1329,11 @@ void DialogsInner::createDialog(Dialogs::Key key) {
 		}
 	}
 
+	if (_applyingBatch) {
+		// dialogsReceived() refreshes the whole list once at the end.
+		return;
+	}
+
 	const auto from = dialogsOffset() + changed.movedFrom * st::dialogsRowHeight;
 	const auto to = dialogsOffset() + changed.movedTo * st::dialogsRowHeight;
 	if (!_dragging) {
@@ -1272,6 +1385,7 @@ void DialogsInner::removeDialog(Dialogs::Key key) {
 void DialogsInner::repaintDialogRow(
 		Dialogs::Mode list,
 		not_null<Dialogs::Row*> row) {
+	row->paintCache = nullptr;
 	if (_state == State::Default) {
 		if (Global::DialogsMode() == list) {
 			auto position = row->pos();
@@ -1337,6 +1451,7 @@ void DialogsInner::updateDialogRow(
 			}
 		}
 	}
+	invalidateDialogRowCache(row.key);
 
 	const auto updateRow = [&](int rowTop) {
 		rtlupdate(
@@ -1554,9 +1669,33 @@ void DialogsInner::handlePeerNameChange(
 	}
 	_contactsNoDialogs->peerNameChanged(peer, oldLetters);
 	_contacts->peerNameChanged(peer, oldLetters);
+
+	// The filter results may become stale, don't narrow them down
+	// on the next filter update, run the full filtering pass instead.
+	_filterWords.clear();
+
+	// The name is rendered into the row caches.
+	if (const auto history = App::historyLoaded(peer)) {
+		invalidateDialogRowCache(Dialogs::Key(history));
+	}
+
 	update();
 }
 
+void DialogsInner::invalidateDialogRowCache(Dialogs::Key key) {
+	const auto drop = [&](Dialogs::IndexedList *list) {
+		if (list) {
+			if (const auto row = list->getRow(key)) {
+				row->paintCache = nullptr;
+			}
+		}
+	};
+	drop(_dialogs.get());
+	drop(_dialogsImportant.get());
+	drop(_contactsNoDialogs.get());
+	drop(_contacts.get());
+}
+
 void DialogsInner::onFilterUpdate(QString newFilter, bool force) {
 	const auto mentionsSearch = (newFilter == qstr("@"));
 	const auto words = mentionsSearch
@@ -1564,6 +1703,8 @@ void DialogsInner::onFilterUpdate(QString newFilter, bool force) {
 		: TextUtilities::PrepareSearchWords(newFilter);
 	newFilter = words.isEmpty() ? QString() : words.join(' ');
 	if (newFilter != _filter || force) {
+		const auto wasWords = base::take(_filterWords);
+		const auto wasFiltered = (_state == State::Filtered);
 		_filter = newFilter;
 		if (_filter.isEmpty() && !_searchFromUser) {
 			clearFilter();
@@ -1572,77 +1713,121 @@ void DialogsInner::onFilterUpdate(QString newFilter, bool force) {
 
 			_state = State::Filtered;
 			_waitingForSearch = true;
-			_filterResults.clear();
 			_filterResultsGlobal.clear();
-			if (!_searchInChat && !words.isEmpty()) {
-				const Dialogs::List *toFilter = nullptr;
-				if (!_dialogs->isEmpty()) {
-					for (fi = fb; fi != fe; ++fi) {
-						auto found = _dialogs->filtered(fi->at(0));
-						if (found->isEmpty()) {
-							toFilter = nullptr;
-							break;
-						}
-						if (!toFilter || toFilter->size() > found->size()) {
-							toFilter = found;
-						}
+			const auto matches = [&](Dialogs::Row *row) {
+				const auto &nameWords = row->entry()->chatsListNameWords();
+				const auto nb = nameWords.cbegin(), ne = nameWords.cend();
+				for (auto fi = fb; fi != fe; ++fi) {
+					auto ni = nb;
+					while (ni != ne && !ni->startsWith(*fi)) {
+						++ni;
+					}
+					if (ni == ne) {
+						return false;
 					}
 				}
-				const Dialogs::List *toFilterContacts = nullptr;
-				if (!_contactsNoDialogs->isEmpty()) {
-					for (fi = fb; fi != fe; ++fi) {
-						auto found = _contactsNoDialogs->filtered(fi->at(0));
-						if (found->isEmpty()) {
-							toFilterContacts = nullptr;
-							break;
-						}
-						if (!toFilterContacts || toFilterContacts->size() > found->size()) {
-							toFilterContacts = found;
-						}
+				return true;
+			};
+			const auto matchesAnywhere = [&](Dialogs::Row *row) {
+				const auto &nameWords = row->entry()->chatsListNameWords();
+				const auto nb = nameWords.cbegin(), ne = nameWords.cend();
+				for (auto fi = fb; fi != fe; ++fi) {
+					auto ni = nb;
+					while (ni != ne && ni->indexOf(*fi) < 0) {
+						++ni;
+					}
+					if (ni == ne) {
+						return false;
+					}
+				}
+				return true;
+			};
+			const auto hasFragments = [](const QStringList &list) {
+				for (const auto &word : list) {
+					if (word.size() >= Dialogs::FragmentIndex::kFragmentLength) {
+						return true;
 					}
 				}
-				_filterResults.reserve((toFilter ? toFilter->size() : 0)
-					+ (toFilterContacts ? toFilterContacts->size() : 0));
-				if (toFilter) {
-					for (const auto row : *toFilter) {
-						const auto &nameWords = row->entry()->chatsListNameWords();
-						auto nb = nameWords.cbegin(), ne = nameWords.cend(), ni = nb;
+				return false;
+			};
+			if (!_searchInChat && !words.isEmpty()) {
+				_filterWords = words;
+				if (wasFiltered
+					&& !force
+					&& !wasWords.isEmpty()
+					&& FilterNarrows(wasWords, words)
+					&& (hasFragments(wasWords) || !hasFragments(words))) {
+					// The old filter only got extended, so it is enough
+					// to narrow down the previous result set. Infix
+					// matches appear there only after some word reaches
+					// the fragment length, so don't reuse the results
+					// across that boundary.
+					const auto covered = hasFragments(words);
+					auto all = base::take(_filterResults);
+					_filterResults.reserve(all.size());
+					for (const auto row : all) {
+						if (matches(row) || (covered && matchesAnywhere(row))) {
+							_filterResults.push_back(row);
+						}
+					}
+				} else {
+					_filterResults.clear();
+					const Dialogs::List *toFilter = nullptr;
+					if (!_dialogs->isEmpty()) {
 						for (fi = fb; fi != fe; ++fi) {
-							auto filterWord = *fi;
-							for (ni = nb; ni != ne; ++ni) {
-								if (ni->startsWith(filterWord)) {
-									break;
-								}
-							}
-							if (ni == ne) {
+							auto found = _dialogs->filtered(fi->at(0));
+							if (found->isEmpty()) {
+								toFilter = nullptr;
 								break;
 							}
-						}
-						if (fi == fe) {
-							_filterResults.push_back(row);
+							if (!toFilter || toFilter->size() > found->size()) {
+								toFilter = found;
+							}
 						}
 					}
-				}
-				if (toFilterContacts) {
-					for (const auto row : *toFilterContacts) {
-						const auto &nameWords = row->entry()->chatsListNameWords();
-						auto nb = nameWords.cbegin(), ne = nameWords.cend(), ni = nb;
+					const Dialogs::List *toFilterContacts = nullptr;
+					if (!_contactsNoDialogs->isEmpty()) {
 						for (fi = fb; fi != fe; ++fi) {
-							auto filterWord = *fi;
-							for (ni = nb; ni != ne; ++ni) {
-								if (ni->startsWith(filterWord)) {
-									break;
-								}
-							}
-							if (ni == ne) {
+							auto found = _contactsNoDialogs->filtered(fi->at(0));
+							if (found->isEmpty()) {
+								toFilterContacts = nullptr;
 								break;
 							}
+							if (!toFilterContacts || toFilterContacts->size() > found->size()) {
+								toFilterContacts = found;
+							}
 						}
-						if (fi == fe) {
-							_filterResults.push_back(row);
+					}
+					_filterResults.reserve((toFilter ? toFilter->size() : 0)
+						+ (toFilterContacts ? toFilterContacts->size() : 0));
+					if (toFilter) {
+						for (const auto row : *toFilter) {
+							if (matches(row)) {
+								_filterResults.push_back(row);
+							}
+						}
+					}
+					if (toFilterContacts) {
+						for (const auto row : *toFilterContacts) {
+							if (matches(row)) {
+								_filterResults.push_back(row);
+							}
+						}
+					}
+
+					// Append the infix-only matches from the fragment
+					// index, the rows matching by a word prefix are
+					// already collected through the letter index above.
+					for (const auto list : { _dialogs.get(), _contactsNoDialogs.get() }) {
+						for (const auto row : list->fragmentSearch(words)) {
+							if (!matches(row)) {
+								_filterResults.push_back(row);
+							}
 						}
 					}
 				}
+			} else {
+				_filterResults.clear();
 			}
 			refresh(true);
 		}
@@ -1751,6 +1936,7 @@ void DialogsInner::itemRemoved(not_null<const HistoryItem*> item) {
 }
 
 void DialogsInner::dialogsReceived(const QVector<MTPDialog> &added) {
+	_applyingBatch = true;
 	for (const auto &dialog : added) {
 		switch (dialog.type()) {
 		case mtpc_dialog: applyDialog(dialog.c_dialog()); break;
@@ -1758,6 +1944,7 @@ void DialogsInner::dialogsReceived(const QVector<MTPDialog> &added) {
 		default: Unexpected("Type in DialogsInner::dialogsReceived");
 		}
 	}
+	_applyingBatch = false;
 	refresh();
 }
 
@@ -1815,6 +2002,20 @@ void DialogsInner::addAllSavedPeers() {
 	addSavedPeersAfter(QDateTime());
 }
 
+void DialogsInner::searchLocalResults(
+		const std::vector<not_null<HistoryItem*>> &items) {
+	clearSearchResults(false);
+	for (const auto item : items) {
+		_searchResults.push_back(
+			std::make_unique<Dialogs::FakeRow>(_searchInChat, item));
+	}
+	_searchedCount = int(_searchResults.size());
+	if (_waitingForSearch && !_searchResults.empty()) {
+		_waitingForSearch = false;
+	}
+	refresh();
+}
+
 bool DialogsInner::searchReceived(
 		const QVector<MTPMessage> &messages,
 		DialogsSearchRequestType type,
@@ -2139,6 +2340,7 @@ void DialogsInner::clearFilter() {
 		_lastSearchPeer = 0;
 		_lastSearchId = _lastSearchMigratedId = 0;
 		_filter = QString();
+		_filterWords.clear();
 		refresh(true);
 	}
 }
@@ -41,6 +41,11 @@ public:
 		const QVector<MTPMessage> &result,
 		DialogsSearchRequestType type,
 		int fullCount);
+
+	// Instant results from the local message index shown while the
+	// search request is in flight, the server results replace them.
+	void searchLocalResults(
+		const std::vector<not_null<HistoryItem*>> &items);
 	void peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -226,6 +231,18 @@ private:
 		Dialogs::Key selected,
 		bool onlyBackground,
 		TimeMs ms);
+
+	// Paints the row from its render cache, refilling the cache first
+	// if the row state changed. Returns false if the row is animating
+	// right now and must be painted directly.
+	bool paintDialogCached(
+		Painter &p,
+		not_null<Dialogs::Row*> row,
+		int fullWidth,
+		bool active,
+		bool selected,
+		TimeMs ms);
+	void invalidateDialogRowCache(Dialogs::Key key);
 	void paintPeerSearchResult(
 		Painter &p,
 		not_null<const PeerSearchResult*> result,
@@ -302,6 +319,10 @@ private:
 
 	Dialogs::Row *_dragging = nullptr;
 	int _draggingIndex = -1;
+
+	// Set while a whole dialogs slice is being applied, so that each
+	// created row doesn't refresh the list, one refresh at the end.
+	bool _applyingBatch = false;
 	int _aboveIndex = -1;
 	QPoint _dragStart;
 	struct PinnedRow {
@@ -318,6 +339,7 @@ private:
 	int _visibleTop = 0;
 	int _visibleBottom = 0;
 	QString _filter, _hashtagFilter;
+	QStringList _filterWords;
 
 	HashtagResults _hashtagResults;
 	int _hashtagSelected = -1;
@@ -261,10 +261,16 @@ void paintRow(
 	}
 }
 
+constexpr auto kUnreadBadgeCacheLimit = 128;
+
 struct UnreadBadgeSizeData {
 	QImage circle;
 	QPixmap left[6], right[6];
 };
+struct CachedUnreadBadge {
+	QPixmap image;
+	int width = 0;
+};
 class UnreadBadgeStyleData : public Data::AbstractStructure {
 public:
 	UnreadBadgeSizeData sizes[UnreadBadgeSizesCount];
@@ -276,6 +282,13 @@ public:
 		st::dialogsUnreadBgMutedOver,
 		st::dialogsUnreadBgMutedActive
 	};
+
+	// Fully rendered badges (background + text), keyed by the text and
+	// all the style values including the current colors. There are only
+	// dozens of distinct badges across thousands of dialog rows, so the
+	// per-row paint becomes a single blit. Keying by color values makes
+	// a theme switch miss the stale entries naturally.
+	QMap<QString, CachedUnreadBadge> badges;
 };
 Data::GlobalStructurePointer<UnreadBadgeStyleData> unreadBadgeStyle;
 
@@ -358,29 +371,70 @@ UnreadBadgeStyle::UnreadBadgeStyle()
 , font(st::dialogsUnreadFont) {
 }
 
-void paintUnreadCount(Painter &p, const QString &text, int x, int y, const UnreadBadgeStyle &st, int *outUnreadWidth) {
+namespace {
+
+CachedUnreadBadge renderUnreadBadge(const QString &text, const UnreadBadgeStyle &st, style::color fg) {
 	int unreadWidth = st.font->width(text);
 	int unreadRectWidth = unreadWidth + 2 * st.padding;
 	int unreadRectHeight = st.size;
 	accumulate_max(unreadRectWidth, unreadRectHeight);
 
+	auto result = CachedUnreadBadge();
+	result.width = unreadRectWidth;
+
+	auto image = QImage(QSize(unreadRectWidth, unreadRectHeight) * cIntRetinaFactor(), QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(cRetinaFactor());
+	image.fill(Qt::transparent);
+	{
+		Painter q(&image);
+		paintUnreadBadge(q, QRect(0, 0, unreadRectWidth, unreadRectHeight), st);
+
+		auto textTop = st.textTop ? st.textTop : (unreadRectHeight - st.font->height) / 2;
+		q.setFont(st.font);
+		q.setPen(fg);
+		q.drawText((unreadRectWidth - unreadWidth) / 2, textTop + st.font->ascent, text);
+	}
+	result.image = App::pixmapFromImageInPlace(std::move(image));
+	return result;
+}
+
+} // namespace
+
+void paintUnreadCount(Painter &p, const QString &text, int x, int y, const UnreadBadgeStyle &st, int *outUnreadWidth) {
+	int index = (st.muted ? 0x03 : 0x00) + (st.active ? 0x02 : (st.selected ? 0x01 : 0x00));
+
+	unreadBadgeStyle.createIfNull();
+	auto fg = st.active ? st::dialogsUnreadFgActive : (st.selected ? st::dialogsUnreadFgOver : st::dialogsUnreadFg);
+	auto key = text
+		+ QChar(':') + QString::number(index)
+		+ QChar(':') + QString::number(st.sizeId)
+		+ QChar(':') + QString::number(st.size)
+		+ QChar(':') + QString::number(st.padding)
+		+ QChar(':') + QString::number(st.textTop)
+		+ QChar(':') + QString::number(st.font->height)
+		+ QChar(':') + QString::number(unreadBadgeStyle->bg[index]->c.rgba(), 16)
+		+ QChar(':') + QString::number(fg->c.rgba(), 16);
+
+	auto &cache = unreadBadgeStyle->badges;
+	auto i = cache.constFind(key);
+	if (i == cache.cend()) {
+		if (cache.size() >= kUnreadBadgeCacheLimit) {
+			cache.clear();
+		}
+		i = cache.insert(key, renderUnreadBadge(text, st, fg));
+	}
+	auto &badge = i.value();
+
 	int unreadRectLeft = x;
 	if ((st.align & Qt::AlignHorizontal_Mask) & style::al_center) {
-		unreadRectLeft = (x - unreadRectWidth) / 2;
+		unreadRectLeft = (x - badge.width) / 2;
 	} else if ((st.align & Qt::AlignHorizontal_Mask) & style::al_right) {
-		unreadRectLeft = x - unreadRectWidth;
+		unreadRectLeft = x - badge.width;
 	}
-	int unreadRectTop = y;
 	if (outUnreadWidth) {
-		*outUnreadWidth = unreadRectWidth;
+		*outUnreadWidth = badge.width;
 	}
-
-	paintUnreadBadge(p, QRect(unreadRectLeft, unreadRectTop, unreadRectWidth, unreadRectHeight), st);
-
-	auto textTop = st.textTop ? st.textTop : (unreadRectHeight - st.font->height) / 2;
-	p.setFont(st.font);
-	p.setPen(st.active ? st::dialogsUnreadFgActive : (st.selected ? st::dialogsUnreadFgOver : st::dialogsUnreadFg));
-	p.drawText(unreadRectLeft + (unreadRectWidth - unreadWidth) / 2, unreadRectTop + textTop + st.font->ascent, text);
+	p.drawPixmap(unreadRectLeft, y, badge.image);
 }
 
 void RowPainter::paint(
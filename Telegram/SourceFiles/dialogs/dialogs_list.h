@@ -21,7 +21,7 @@ public:
 	List &operator=(const List &other) = delete;
 
 	int size() const {
-		return _count;
+		return int(_rows.size());
 	}
 	bool isEmpty() const {
 		return size() == 0;
@@ -47,80 +47,71 @@ public:
 	bool moveToTop(Key key);
 	void adjustByPos(Row *row);
 	bool del(Key key, Row *replacedBy = nullptr);
-	void remove(Row *row);
 	void clear();
 
+	// The rows are stored in a contiguous array, so the iterators are
+	// just pointers into it and enumeration scans linear memory.
 	class const_iterator {
 	public:
 		using value_type = Row*;
 		using pointer = Row**;
 		using reference = Row*&;
 
-		explicit const_iterator(Row *p) : _p(p) {
+		explicit const_iterator(Row* const* p) : _p(p) {
 		}
-		inline Row* operator*() const { return _p; }
-		inline Row* const* operator->() const { return &_p; }
+		inline Row* operator*() const { return *_p; }
+		inline Row* const* operator->() const { return _p; }
 		inline bool operator==(const const_iterator &other) const { return _p == other._p; }
 		inline bool operator!=(const const_iterator &other) const { return !(*this == other); }
-		inline const_iterator &operator++() { _p = next(_p); return *this; }
+		inline const_iterator &operator++() { ++_p; return *this; }
 		inline const_iterator operator++(int) { const_iterator result(*this); ++(*this); return result; }
-		inline const_iterator &operator--() { _p = prev(_p); return *this; }
+		inline const_iterator &operator--() { --_p; return *this; }
 		inline const_iterator operator--(int) { const_iterator result(*this); --(*this); return result; }
-		inline const_iterator operator+(int j) const { const_iterator result = *this; return result += j; }
-		inline const_iterator operator-(int j) const { const_iterator result = *this; return result -= j; }
-		inline const_iterator &operator+=(int j) { if (j < 0) return (*this -= (-j)); while (j--) ++*this; return *this; }
-		inline const_iterator &operator-=(int j) { if (j < 0) return (*this += (-j)); while (j--) --*this; return *this; }
+		inline const_iterator operator+(int j) const { return const_iterator(_p + j); }
+		inline const_iterator operator-(int j) const { return const_iterator(_p - j); }
+		inline const_iterator &operator+=(int j) { _p += j; return *this; }
+		inline const_iterator &operator-=(int j) { _p -= j; return *this; }
 
 	private:
-		Row *_p;
+		Row* const* _p;
 		friend class List;
 
 	};
 	friend class const_iterator;
 	using iterator = const_iterator;
 
-	const_iterator cbegin() const { return const_iterator(_begin); }
-	const_iterator cend() const { return const_iterator(_end); }
+	const_iterator cbegin() const { return const_iterator(_rows.data()); }
+	const_iterator cend() const { return const_iterator(_rows.data() + _rows.size()); }
 	const_iterator begin() const { return cbegin(); }
 	const_iterator end() const { return cend(); }
-	iterator begin() { return iterator(_begin); }
-	iterator end() { return iterator(_end); }
-	const_iterator cfind(Row *value) const { return value ? const_iterator(value) : cend(); }
+	iterator begin() { return cbegin(); }
+	iterator end() { return cend(); }
+	const_iterator cfind(Row *value) const {
+		return value ? const_iterator(_rows.data() + value->pos()) : cend();
+	}
 	const_iterator find(Row *value) const { return cfind(value); }
-	iterator find(Row *value) { return value ? iterator(value) : end(); }
+	iterator find(Row *value) { return cfind(value); }
 	const_iterator cfind(int y, int h) const {
-		adjustCurrent(y, h);
-		return iterator(_current);
+		const auto index = (y > 0) ? (y / h) : 0;
+		const auto count = size();
+		return const_iterator(_rows.data()
+			+ ((index < count) ? index : count ? (count - 1) : 0));
 	}
 	const_iterator find(int y, int h) const { return cfind(y, h); }
-	iterator find(int y, int h) {
-		adjustCurrent(y, h);
-		return iterator(_current);
-	}
+	iterator find(int y, int h) { return cfind(y, h); }
 
 	~List();
 
 private:
-	void adjustCurrent(int y, int h) const;
-	bool insertBefore(Row *row, Row *before);
-	bool insertAfter(Row *row, Row *after);
-	static Row *next(Row *row) {
-		return row->_next;
-	}
-	static Row *prev(Row *row) {
-		return row->_prev;
-	}
+	// Moves the row at index from to index to, shifting the rows
+	// in between and refreshing their cached positions.
+	void moveRow(int from, int to);
 
-	std::unique_ptr<Row> _last;
-	Row *_begin;
-	Row *_end;
+	std::vector<Row*> _rows;
 	SortMode _sortMode;
-	int _count = 0;
 
 	std::map<Key, not_null<Row*>> _rowByKey;
 
-	mutable Row *_current; // cache
-
 };
 
 } // namespace Dialogs
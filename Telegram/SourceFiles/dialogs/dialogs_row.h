@@ -30,6 +30,10 @@ public:
 	void addRipple(QPoint origin, QSize size, base::lambda<void()> updateCallback);
 	void stopLastRipple();
 
+	bool hasRipple() const {
+		return (_ripple != nullptr);
+	}
+
 	void paintRipple(Painter &p, int x, int y, int outerWidth, TimeMs ms, const QColor *colorOverride = nullptr) const;
 
 private:
@@ -40,13 +44,7 @@ private:
 class List;
 class Row : public RippleRow {
 public:
-	explicit Row(std::nullptr_t) {
-	}
-	Row(Key key, Row *prev, Row *next, int pos)
-	: _id(key)
-	, _prev(prev)
-	, _next(next)
-	, _pos(pos) {
+	Row(Key key, int pos) : _id(key), _pos(pos) {
 	}
 
 	Key key() const {
@@ -69,12 +67,32 @@ public:
 	// for any attached data, for example View in contacts list
 	void *attached = nullptr;
 
+	// Cached rendering of the whole row content together with the state
+	// it was rendered for, so that steady-state scrolling can blit it.
+	// Filled and validated in DialogsInner::paintDialogCached().
+	struct PaintCache {
+		QPixmap pixmap;
+		QPair<uint64, uint64> userpicKey;
+		const HistoryItem *item = nullptr;
+		const HistoryItem *textCachedFor = nullptr;
+		TimeId draftDate = 0;
+		mtpRequestId draftRequestId = 0;
+		int width = 0;
+		int generation = 0;
+		int unreadCount = 0;
+		bool active = false;
+		bool selected = false;
+		bool unreadMuted = false;
+		bool unreadMentions = false;
+		bool pinned = false;
+		bool hasDraft = false;
+	};
+	mutable std::unique_ptr<PaintCache> paintCache;
+
 private:
 	friend class List;
 
 	Key _id;
-	Row *_prev = nullptr;
-	Row *_next = nullptr;
 	int _pos = 0;
 
 };
@@ -352,8 +352,15 @@ void DialogsWidget::dialogsReceived(
 			_dialogsFull = true;
 			return process(dialogs.c_messages_dialogs());
 
-		case mtpc_messages_dialogsSlice:
-			return process(dialogs.c_messages_dialogsSlice());
+		case mtpc_messages_dialogsSlice: {
+			const auto &data = dialogs.c_messages_dialogsSlice();
+			// The full count hints how many peers and media entries
+			// are about to be loaded, size the lookup tables once
+			// instead of rehashing them while the slices arrive.
+			App::reservePeers(data.vcount.v);
+			Auth().data().reserveFromDialogs(data.vcount.v);
+			return process(data);
+		}
 		}
 		Unexpected("Type in DialogsWidget::dialogsReceived");
 	}();
@@ -447,7 +454,12 @@ void DialogsWidget::pinnedDialogsReceived(
 void DialogsWidget::applyReceivedDialogs(
 		const QVector<MTPDialog> &dialogs,
 		const QVector<MTPMessage> &messages) {
-	App::feedMsgs(messages, NewMessageLast);
+	// The messages here are the last messages of the dialogs in the
+	// list. Don't construct items for all of them right away, each
+	// dialog takes its own message lazily in applyDialogTopMessage().
+	for (const auto &message : messages) {
+		Auth().data().addPendingLastMessage(message);
+	}
 	_inner->dialogsReceived(dialogs);
 	onListScroll();
 }
@@ -557,6 +569,18 @@ bool DialogsWidget::onSearchMessages(bool searchCache) {
 				rpcFail(&DialogsWidget::searchFailed, DialogsSearchFromStart));
 		}
 		_searchQueries.insert(_searchRequest, _searchQuery);
+
+		// Show instant results from the local message index while the
+		// request is in flight (or forever, if we are offline).
+		const auto local = Auth().data().searchIndex().query(
+			_searchQuery,
+			_searchInChat.peer()
+				? App::history(_searchInChat.peer()->id).get()
+				: nullptr,
+			SearchPerPage);
+		if (!local.empty()) {
+			_inner->searchLocalResults(local);
+		}
 	}
 	if (searchForPeersRequired(q)) {
 		if (searchCache) {
@@ -490,6 +490,8 @@ struct Data {
 	Dialogs::Mode DialogsMode = Dialogs::Mode::All;
 	bool ModerateModeEnabled = false;
 
+	qint64 LocalStorageLimit = 0;
+
 	bool ScreenIsLocked = false;
 
 	int32 DebugLoggingFlags = 0;
@@ -615,6 +617,8 @@ DefineVar(Global, bool, DialogsModeEnabled);
 DefineVar(Global, Dialogs::Mode, DialogsMode);
 DefineVar(Global, bool, ModerateModeEnabled);
 
+DefineVar(Global, qint64, LocalStorageLimit);
+
 DefineVar(Global, bool, ScreenIsLocked);
 
 DefineVar(Global, int32, DebugLoggingFlags);
@@ -305,6 +305,9 @@ DeclareVar(bool, DialogsModeEnabled);
 DeclareVar(Dialogs::Mode, DialogsMode);
 DeclareVar(bool, ModerateModeEnabled);
 
+// Cap for the encrypted media cache in bytes, 0 means no limit.
+DeclareVar(qint64, LocalStorageLimit);
+
 DeclareVar(bool, ScreenIsLocked);
 
 DeclareVar(int32, DebugLoggingFlags);
@@ -44,6 +44,15 @@ constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kEventsFirstPage = 20;
 constexpr auto kEventsPerPage = 50;
 
+// Keep only a limited window of event layouts in memory, evicting the ones
+// at the end opposite to the loading direction. They are requested from the
+// server again when the log is scrolled back to them.
+constexpr auto kMaxItemsCount = 600;
+
+// How many recently used (filter, search query) states keep their
+// parsed events cached for an instant local restore.
+constexpr auto kFilteredStatesCacheLimit = 4;
+
 } // namespace
 
 template <InnerWidget::EnumItemsDirection direction, typename Method>
@@ -225,6 +234,12 @@ InnerWidget::InnerWidget(
 			repaintItem(view);
 		}
 	}, lifetime());
+	Auth().data().viewMediaRepaintRequest(
+	) | rpl::start_with_next([this](auto view) {
+		if (view->delegate() == this) {
+			repaintItem(view);
+		}
+	}, lifetime());
 	Auth().data().viewResizeRequest(
 	) | rpl::start_with_next([this](auto view) {
 		if (view->delegate() == this) {
@@ -360,7 +375,9 @@ void InnerWidget::checkPreloadMore() {
 void InnerWidget::applyFilter(FilterValue &&value) {
 	if (_filter != value) {
 		_filter = value;
-		clearAndRequestLog();
+		if (!restoreFilteredState()) {
+			clearAndRequestLog();
+		}
 	}
 }
 
@@ -368,7 +385,9 @@ void InnerWidget::applySearch(const QString &query) {
 	auto clearQuery = query.trimmed();
 	if (_searchQuery != query) {
 		_searchQuery = query;
-		clearAndRequestLog();
+		if (!restoreFilteredState()) {
+			clearAndRequestLog();
+		}
 	}
 }
 
@@ -430,13 +449,92 @@ void InnerWidget::showFilter(base::lambda<void(FilterValue &&filter)> callback)
 void InnerWidget::clearAndRequestLog() {
 	request(base::take(_preloadUpRequestId)).cancel();
 	request(base::take(_preloadDownRequestId)).cancel();
-	_filterChanged = true;
+	if (!_filterChanged) {
+		// The items still show the previous (filter, query) state, so
+		// remember its loaded bounds for stashing once the old items
+		// get replaced by the ones for the new filter.
+		_itemsUpLoaded = _upLoaded;
+		_itemsDownLoaded = _downLoaded;
+		_filterChanged = true;
+	}
 	_upLoaded = false;
 	_downLoaded = true;
 	updateMinMaxIds();
 	preloadMore(Direction::Up);
 }
 
+void InnerWidget::stashFilteredState() {
+	const auto i = ranges::find_if(_filteredStatesCache, [&](
+			const FilteredState &state) {
+		return (state.filter == _itemsFilter)
+			&& (state.searchQuery == _itemsSearchQuery);
+	});
+	if (i != _filteredStatesCache.end()) {
+		_filteredStatesCache.erase(i);
+	}
+	if (_items.empty()) {
+		_itemsByIds.clear();
+		_itemsByData.clear();
+		return;
+	}
+	while (_filteredStatesCache.size() >= kFilteredStatesCacheLimit) {
+		_filteredStatesCache.erase(_filteredStatesCache.begin());
+	}
+	auto state = FilteredState();
+	state.filter = _itemsFilter;
+	state.searchQuery = _itemsSearchQuery;
+	state.items = std::move(_items);
+	state.itemsByIds = std::move(_itemsByIds);
+	state.itemsByData = std::move(_itemsByData);
+	state.upLoaded = _itemsUpLoaded;
+	state.downLoaded = _itemsDownLoaded;
+	_filteredStatesCache.push_back(std::move(state));
+	_items.clear();
+	_itemsByIds.clear();
+	_itemsByData.clear();
+}
+
+bool InnerWidget::restoreFilteredState() {
+	const auto i = ranges::find_if(_filteredStatesCache, [&](
+			const FilteredState &state) {
+		return (state.filter == _filter)
+			&& (state.searchQuery == _searchQuery);
+	});
+	if (i == _filteredStatesCache.end()) {
+		return false;
+	}
+	request(base::take(_preloadUpRequestId)).cancel();
+	request(base::take(_preloadDownRequestId)).cancel();
+	auto state = std::move(*i);
+	_filteredStatesCache.erase(i);
+
+	_visibleTopItem = nullptr;
+	_visibleTopFromItem = 0;
+	_scrollDateLastItem = nullptr;
+	_scrollDateLastItemTop = 0;
+	_mouseActionItem = nullptr;
+	_selectedItem = nullptr;
+	_selectedText = TextSelection();
+	if (!_filterChanged) {
+		_itemsUpLoaded = _upLoaded;
+		_itemsDownLoaded = _downLoaded;
+	}
+	_filterChanged = false;
+	stashFilteredState();
+
+	_items = std::move(state.items);
+	_itemsByIds = std::move(state.itemsByIds);
+	_itemsByData = std::move(state.itemsByData);
+	_upLoaded = _itemsUpLoaded = state.upLoaded;
+	_downLoaded = _itemsDownLoaded = state.downLoaded;
+	_itemsFilter = _filter;
+	_itemsSearchQuery = _searchQuery;
+	updateEmptyText();
+	updateMinMaxIds();
+	updateSize();
+	return true;
+}
+
 void InnerWidget::updateEmptyText() {
 	auto options = _defaultOptions;
 	options.flags |= TextParseMarkdown;
@@ -545,6 +643,10 @@ void InnerWidget::restoreState(not_null<SectionMemento*> memento) {
 	_upLoaded = memento->upLoaded();
 	_downLoaded = memento->downLoaded();
 	_filterChanged = false;
+	_itemsFilter = _filter;
+	_itemsSearchQuery = _searchQuery;
+	_itemsUpLoaded = _upLoaded;
+	_itemsDownLoaded = _downLoaded;
 	updateMinMaxIds();
 	updateSize();
 }
@@ -650,6 +752,7 @@ void InnerWidget::addEvents(Direction direction, const QVector<MTPChannelAdminLo
 		}
 		updateMinMaxIds();
 		itemsAdded(direction, newItemsCount - oldItemsCount);
+		clipItemsToWindow(direction);
 	}
 	update();
 }
@@ -666,6 +769,73 @@ void InnerWidget::updateMinMaxIds() {
 	}
 }
 
+void InnerWidget::clipItemsToWindow(Direction direction) {
+	if (_items.size() <= kMaxItemsCount) {
+		return;
+	}
+
+	// The ids map points to the top-most layout of each event, so a cut
+	// keeps whole events only if the layout just before it is in the map.
+	auto registered = base::flat_set<Element*>();
+	for (const auto &pair : _itemsByIds) {
+		registered.emplace(pair.second.get());
+	}
+	const auto up = (direction == Direction::Up);
+	const auto count = int(_items.size());
+	auto removeCount = count - kMaxItemsCount;
+	const auto aligned = [&](int remove) {
+		const auto index = up ? (remove - 1) : (count - remove - 1);
+		return registered.contains(_items[index].get());
+	};
+	while (removeCount < count && !aligned(removeCount)) {
+		++removeCount;
+	}
+	if (removeCount >= count) {
+		return;
+	}
+
+	const auto from = _items.begin() + (up ? 0 : (count - removeCount));
+	const auto till = from + removeCount;
+	auto evicted = base::flat_set<Element*>();
+	for (auto i = from; i != till; ++i) {
+		const auto view = i->get();
+		if (_visibleTopItem == view) {
+			_visibleTopItem = nullptr;
+			_visibleTopFromItem = 0;
+		}
+		if (_scrollDateLastItem == view) {
+			_scrollDateLastItem = nullptr;
+			_scrollDateLastItemTop = 0;
+		}
+		if (_mouseActionItem == view) {
+			mouseActionCancel();
+		}
+		if (_selectedItem == view) {
+			_selectedItem = nullptr;
+			_selectedText = TextSelection();
+		}
+		_itemsByData.erase(view->data());
+		evicted.emplace(view);
+	}
+	for (auto i = _itemsByIds.begin(); i != _itemsByIds.end();) {
+		if (evicted.contains(i->second.get())) {
+			i = _itemsByIds.erase(i);
+		} else {
+			++i;
+		}
+	}
+	_items.erase(from, till);
+
+	// The evicted side is no longer fully loaded, a scroll back to it
+	// will request the events from the server again. Cancel the preload
+	// in that direction so it can't add events with a gap in between.
+	auto &requestId = up ? _preloadDownRequestId : _preloadUpRequestId;
+	request(base::take(requestId)).cancel();
+	(up ? _downLoaded : _upLoaded) = false;
+	updateMinMaxIds();
+	updateSize();
+}
+
 void InnerWidget::itemsAdded(Direction direction, int addedCount) {
 	Expects(addedCount >= 0);
 	auto checkFrom = (direction == Direction::Up)
@@ -828,10 +998,12 @@ void InnerWidget::clearAfterFilterChange() {
 	_selectedItem = nullptr;
 	_selectedText = TextSelection();
 	_filterChanged = false;
-	_items.clear();
-	_itemsByIds.clear();
-	_idManager = nullptr;
-	_idManager = _history->adminLogIdManager();
+	// The id manager is kept so that items stashed in the filtered
+	// states cache never share a local id with the freshly generated
+	// ones.
+	stashFilteredState();
+	_itemsFilter = _filter;
+	_itemsSearchQuery = _searchQuery;
 	updateEmptyText();
 	updateSize();
 }
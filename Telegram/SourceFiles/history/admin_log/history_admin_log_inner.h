@@ -164,10 +164,13 @@ private:
 	void itemsAdded(Direction direction, int addedCount);
 	void updateSize();
 	void updateMinMaxIds();
+	void clipItemsToWindow(Direction direction);
 	void updateEmptyText();
 	void paintEmpty(Painter &p);
 	void clearAfterFilterChange();
 	void clearAndRequestLog();
+	void stashFilteredState();
+	bool restoreFilteredState();
 	void addEvents(Direction direction, const QVector<MTPChannelAdminLogEvent> &events);
 	Element *viewForItem(const HistoryItem *item);
 
@@ -262,6 +265,28 @@ private:
 	std::vector<not_null<UserData*>> _adminsCanEdit;
 	base::lambda<void(FilterValue &&filter)> _showFilterCallback;
 
+	// Parsed events are kept per (filter, search query) combination,
+	// so toggling filter checkboxes back and forth restores them
+	// locally instead of re-requesting and re-parsing the whole log.
+	struct FilteredState {
+		FilterValue filter;
+		QString searchQuery;
+		std::vector<OwnedItem> items;
+		std::map<uint64, not_null<Element*>> itemsByIds;
+		std::map<not_null<HistoryItem*>, not_null<Element*>, std::less<>> itemsByData;
+		bool upLoaded = false;
+		bool downLoaded = true;
+	};
+	std::vector<FilteredState> _filteredStatesCache;
+
+	// What the _items currently correspond to - during a filter change
+	// the _filter already differs while the old items are still shown
+	// until the first events for the new one arrive.
+	FilterValue _itemsFilter;
+	QString _itemsSearchQuery;
+	bool _itemsUpLoaded = false;
+	bool _itemsDownLoaded = true;
+
 	std::shared_ptr<LocalIdManager> _idManager;
 
 };
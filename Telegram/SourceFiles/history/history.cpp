@@ -166,6 +166,14 @@ int Histories::unreadMutedCount() const {
 	return _unreadMuted;
 }
 
+rpl::producer<Histories::UnreadBadge> Histories::unreadBadgeValue() const {
+	return _unreadBadge.value();
+}
+
+void Histories::refreshUnreadBadge() {
+	_unreadBadge = UnreadBadge{ unreadBadge(), _unreadMuted };
+}
+
 void Histories::unreadIncrement(int count, bool muted) {
 	_unreadFull += count;
 	if (muted) {
@@ -1304,6 +1312,7 @@ void History::addItemToBlock(not_null<HistoryItem*> item) {
 		HistoryInner::ElementDelegate()));
 	const auto view = block->messages.back().get();
 	view->attachToBlock(block, block->messages.size() - 1);
+	block->messageAdded(item);
 
 	if (isBuildingFrontBlock() && _buildingFrontBlock->expectedItemsCount > 0) {
 		--_buildingFrontBlock->expectedItemsCount;
@@ -1517,6 +1526,12 @@ int History::countUnread(MsgId upTo) {
 	for (auto i = blocks.cend(), e = blocks.cbegin(); i != e;) {
 		--i;
 		const auto &messages = (*i)->messages;
+		if (!messages.empty() && messages.front()->data()->id > upTo) {
+			// The whole block is above the read position, take the
+			// maintained subtotal instead of walking the messages.
+			result += (*i)->unreadCount();
+			continue;
+		}
 		for (auto j = messages.cend(), en = messages.cbegin(); j != en;) {
 			--j;
 			const auto item = (*j)->data();
@@ -1910,6 +1925,7 @@ not_null<HistoryItem*> History::addNewInTheMiddle(
 		item->createView(
 			HistoryInner::ElementDelegate()));
 	(*it)->attachToBlock(block.get(), itemIndex);
+	block->messageAdded(item);
 	if (itemIndex + 1 < block->messages.size()) {
 		for (auto i = itemIndex + 1, l = int(block->messages.size()); i != l; ++i) {
 			block->messages[i]->setIndexInBlock(i);
@@ -2099,6 +2115,7 @@ void History::markFullyLoaded() {
 }
 
 void History::setLastMessage(HistoryItem *item) {
+	_lastMessagePending = base::none;
 	if (item) {
 		if (_lastMessage && !*_lastMessage) {
 			Local::removeSavedPeer(peer);
@@ -2115,11 +2132,21 @@ void History::setLastMessage(HistoryItem *item) {
 }
 
 HistoryItem *History::lastMessage() const {
+	if (_lastMessagePending) {
+		const_cast<History*>(this)->materializeLastMessage();
+	}
 	return _lastMessage ? (*_lastMessage) : nullptr;
 }
 
 bool History::lastMessageKnown() const {
-	return !!_lastMessage;
+	return _lastMessagePending || !!_lastMessage;
+}
+
+void History::materializeLastMessage() {
+	const auto data = *base::take(_lastMessagePending);
+	if (!addNewMessage(data, NewMessageLast)) {
+		setLastMessage(nullptr);
+	}
 }
 
 void History::updateChatListExistence() {
@@ -2178,10 +2205,16 @@ void History::applyDialog(const MTPDdialog &data) {
 			const auto topMessageId = FullMsgId(
 				peerToChannel(channel->id),
 				data.vtop_message.v);
-			if (const auto item = App::histItemById(topMessageId)) {
-				if (item->date() <= channel->date) {
-					Auth().api().requestSelfParticipant(channel);
+			const auto topMessageDate = [&]() -> TimeId {
+				if (const auto item = App::histItemById(topMessageId)) {
+					return item->date();
+				} else if (_lastMessagePending) {
+					return dateFromMessage(*_lastMessagePending);
 				}
+				return 0;
+			}();
+			if (topMessageDate && topMessageDate <= channel->date) {
+				Auth().api().requestSelfParticipant(channel);
 			}
 		}
 	}
@@ -2210,6 +2243,20 @@ void History::applyDialogTopMessage(MsgId topMessageId) {
 			topMessageId);
 		if (const auto item = App::histItemById(itemId)) {
 			setLastMessage(item);
+		} else if (auto pending = Auth().data().takePendingLastMessage(
+				itemId)) {
+			// Don't build an item for the last message of each dialog
+			// in the list, just take the date for sorting and keep the
+			// raw message until the item is really needed. Most of the
+			// dialogs are never opened or even scrolled to.
+			if (_lastMessage && !*_lastMessage) {
+				Local::removeSavedPeer(peer);
+			}
+			_lastMessage = base::none;
+			_lastMessagePending = std::move(pending);
+			if (const auto date = dateFromMessage(*_lastMessagePending)) {
+				setChatsListDate(ParseDateTime(date));
+			}
 		} else {
 			setLastMessage(nullptr);
 		}
@@ -2219,11 +2266,30 @@ void History::applyDialogTopMessage(MsgId topMessageId) {
 }
 
 void History::setInboxReadTill(MsgId upTo) {
+	const auto before = _inboxReadBefore;
 	if (_inboxReadBefore) {
 		accumulate_max(*_inboxReadBefore, upTo + 1);
 	} else {
 		_inboxReadBefore = upTo + 1;
 	}
+	if (!before || *_inboxReadBefore > *before) {
+		refreshBlocksUnreadCount(before ? *before : 0);
+	}
+}
+
+void History::refreshBlocksUnreadCount(MsgId wasReadBefore) {
+	// Only the messages in [wasReadBefore, *_inboxReadBefore) became
+	// read, the blocks below that range keep their subtotals.
+	for (auto i = blocks.cend(), e = blocks.cbegin(); i != e;) {
+		--i;
+		const auto block = i->get();
+		block->recountUnreadCount();
+		const auto &messages = block->messages;
+		if (!messages.empty()
+			&& messages.front()->data()->id < wasReadBefore) {
+			break;
+		}
+	}
 }
 
 void History::setOutboxReadTill(MsgId upTo) {
@@ -2284,6 +2350,10 @@ HistoryItem *History::lastSentMessage() const {
 }
 
 void History::resizeToWidth(int newWidth) {
+	resizeToWidth(newWidth, 0, 0);
+}
+
+void History::resizeToWidth(int newWidth, int visibleTop, int visibleBottom) {
 	const auto resizeAllItems = (_width != newWidth);
 
 	if (!resizeAllItems && !hasPendingResizedItems()) {
@@ -2291,15 +2361,42 @@ void History::resizeToWidth(int newWidth) {
 	}
 	_flags &= ~(Flag::f_has_pending_resized_items);
 
+	// Keep a viewport of margin around the visible area measured
+	// exactly, the rest may reuse cached heights of their views.
+	const auto margin = (visibleBottom - visibleTop);
+	const auto estimateBefore = visibleTop - margin;
+	const auto estimateAfter = visibleBottom + margin;
+
 	_width = newWidth;
 	int y = 0;
 	for (const auto &block : blocks) {
+		// The visible area is given in coordinates of the previous
+		// layout, so the old geometry tells what is on screen now.
+		const auto allowEstimates = (margin > 0)
+			&& (block->y() + block->height() <= estimateBefore
+				|| block->y() >= estimateAfter);
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, resizeAllItems);
+		y += block->resizeGetHeight(newWidth, resizeAllItems, allowEstimates);
 	}
 	_height = y;
 }
 
+void History::cacheItemHeight(MsgId itemId, int width, int height) {
+	if (_itemHeightCacheWidth != width) {
+		_itemHeightCacheWidth = width;
+		_itemHeightCache.clear();
+	}
+	_itemHeightCache[itemId] = height;
+}
+
+int History::cachedItemHeight(MsgId itemId, int width) const {
+	if (_itemHeightCacheWidth != width) {
+		return 0;
+	}
+	const auto i = _itemHeightCache.find(itemId);
+	return (i != _itemHeightCache.end()) ? i->second : 0;
+}
+
 ChannelId History::channelId() const {
 	return peerToChannel(peer->id);
 }
@@ -2534,6 +2631,9 @@ void History::clearBlocks(bool leaveItems) {
 	if (scrollTopItem) {
 		forgetScrollState();
 	}
+	// Detach the whole block list at once, the views and items are
+	// destroyed in one batch below after the aggregate notifications.
+	auto detached = base::take(blocks);
 	if (leaveItems) {
 		Auth().data().notifyHistoryUnloaded(this);
 	} else {
@@ -2541,7 +2641,6 @@ void History::clearBlocks(bool leaveItems) {
 		notifies.clear();
 		Auth().data().notifyHistoryCleared(this);
 	}
-	blocks.clear();
 	if (leaveItems) {
 		lastKeyboardInited = false;
 	} else {
@@ -2557,6 +2656,39 @@ void History::clearBlocks(bool leaveItems) {
 	}
 	Auth().data().notifyHistoryChangeDelayed(this);
 
+	if (!leaveItems && !detached.empty()) {
+		// Bulk-destroy path. Destroying the items one by one through
+		// HistoryItem::destroy() pays for the block surgery and a shared
+		// media storage update per item, which hangs the UI on really big
+		// histories. All of that is covered by the aggregate cleanup
+		// above, so here the items are only unregistered and freed.
+		Auth().storage().remove(Storage::SharedMediaRemoveAll(peer->id));
+		if (!_unreadMentions.empty()
+			|| (_unreadMentionsCount && *_unreadMentionsCount > 0)) {
+			_unreadMentions.clear();
+			_unreadMentionsCount = 0;
+			Notify::peerUpdatedDelayed(
+				peer,
+				Notify::PeerUpdate::Flag::UnreadMentionsChanged);
+		}
+		auto items = std::vector<HistoryItem*>();
+		for (const auto &block : detached) {
+			for (const auto &message : block->messages) {
+				items.push_back(message->data());
+			}
+		}
+
+		// The views must be destroyed before the items they display.
+		detached.clear();
+
+		for (const auto item : items) {
+			if (!IsServerMsgId(item->id)) {
+				Auth().api().cancelLocalItem(item);
+			}
+			delete item;
+		}
+	}
+
 	_loadedAtTop = false;
 	_loadedAtBottom = !leaveItems;
 	forgetScrollState();
@@ -2648,12 +2780,14 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 : _history(history) {
 }
 
-int HistoryBlock::resizeGetHeight(int newWidth, bool resizeAllItems) {
+int HistoryBlock::resizeGetHeight(int newWidth, bool resizeAllItems, bool allowEstimates) {
 	auto y = 0;
 	for (const auto &message : messages) {
 		message->setY(y);
 		if (resizeAllItems || message->pendingResize()) {
-			y += message->resizeGetHeight(newWidth);
+			y += allowEstimates
+				? message->resizeEstimatedGetHeight(newWidth)
+				: message->resizeGetHeight(newWidth);
 		} else {
 			y += message->height();
 		}
@@ -2670,6 +2804,9 @@ void HistoryBlock::remove(not_null<Element*> view) {
 	const auto blockIndex = indexInHistory();
 	const auto itemIndex = view->indexInBlock();
 	const auto item = view->data();
+	if (!item->out() && item->unread()) {
+		--_unreadCount;
+	}
 	item->clearMainView();
 	messages.erase(messages.begin() + itemIndex);
 	for (auto i = itemIndex, l = int(messages.size()); i < l; ++i) {
@@ -2687,6 +2824,22 @@ void HistoryBlock::remove(not_null<Element*> view) {
 	}
 }
 
+void HistoryBlock::messageAdded(not_null<HistoryItem*> item) {
+	if (!item->out() && item->unread()) {
+		++_unreadCount;
+	}
+}
+
+void HistoryBlock::recountUnreadCount() {
+	_unreadCount = 0;
+	for (const auto &message : messages) {
+		const auto item = message->data();
+		if (!item->out() && item->unread()) {
+			++_unreadCount;
+		}
+	}
+}
+
 void HistoryBlock::refreshView(not_null<Element*> view) {
 	Expects(view->block() == this);
 
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include <rpl/variable.h>
 #include "data/data_types.h"
 #include "data/data_peer.h"
 #include "dialogs/dialogs_entry.h"
@@ -71,9 +72,25 @@ public:
 	TypingHistories typing;
 	BasicAnimation _a_typings;
 
+	// Incrementally maintained aggregate of the unread counters of all
+	// the histories, so reading it never requires a pass over the map.
+	struct UnreadBadge {
+		int count = 0;
+		int muted = 0;
+
+		friend inline bool operator==(UnreadBadge a, UnreadBadge b) {
+			return (a.count == b.count) && (a.muted == b.muted);
+		}
+		friend inline bool operator!=(UnreadBadge a, UnreadBadge b) {
+			return !(a == b);
+		}
+	};
+
 	int unreadBadge() const;
 	int unreadMutedCount() const;
 	bool unreadOnlyMuted() const;
+	rpl::producer<UnreadBadge> unreadBadgeValue() const;
+	void refreshUnreadBadge();
 	void unreadIncrement(int count, bool muted);
 	void unreadMuteChanged(int count, bool muted);
 
@@ -95,6 +112,7 @@ private:
 
 	int _unreadFull = 0;
 	int _unreadMuted = 0;
+	rpl::variable<UnreadBadge> _unreadBadge;
 	base::Observable<SendActionAnimationUpdate> _sendActionAnimationUpdated;
 
 	base::Timer _selfDestructTimer;
@@ -245,6 +263,21 @@ public:
 	HistoryItem *lastSentMessage() const;
 
 	void resizeToWidth(int newWidth);
+
+	// Same, but blocks outside of the given visible area (in history
+	// coordinates of the previous layout) may reuse cached heights of
+	// their never-measured views instead of measuring them, see
+	// cacheItemHeight(). Those views are measured lazily when scrolled
+	// into view.
+	void resizeToWidth(int newWidth, int visibleTop, int visibleBottom);
+
+	// Reopening a chat rebuilds all views and used to re-measure every
+	// item before the scrollbar stabilized, so measured heights are
+	// remembered across view rebuilds. The cache is only valid for one
+	// width and is rebuilt after a resize.
+	void cacheItemHeight(MsgId itemId, int width, int height);
+	int cachedItemHeight(MsgId itemId, int width) const;
+
 	int height() const;
 
 	void itemRemoved(not_null<HistoryItem*> item);
@@ -260,6 +293,9 @@ public:
 
 	bool mySendActionUpdated(SendAction::Type type, bool doing);
 	bool paintSendAction(Painter &p, int x, int y, int availableWidth, int outerWidth, style::color color, TimeMs ms);
+	bool hasSendActions() const {
+		return !_typing.isEmpty() || !_sendActions.isEmpty();
+	}
 
 	// Interface for Histories
 	bool updateSendActionNeedsAnimating(TimeMs ms, bool force = false);
@@ -442,6 +478,10 @@ private:
 	void setInboxReadTill(MsgId upTo);
 	void setOutboxReadTill(MsgId upTo);
 
+	// Refreshes per-block unread subtotals after the inbox read
+	// position moved forward from wasReadBefore, see countUnread().
+	void refreshBlocksUnreadCount(MsgId wasReadBefore);
+
 	void applyMessageChanges(
 		not_null<HistoryItem*> item,
 		const MTPMessage &original);
@@ -452,6 +492,7 @@ private:
 	// After adding a new history slice check lastMessage / loadedAtBottom.
 	void checkLastMessage();
 	void setLastMessage(HistoryItem *item);
+	void materializeLastMessage();
 
 	// Add all items to the unread mentions if we were not loaded at bottom and now are.
 	void checkAddAllToUnreadMentions();
@@ -475,6 +516,12 @@ private:
 	bool _mute = false;
 	int _width = 0;
 	int _height = 0;
+
+	// Measured view heights surviving view rebuilds, valid for
+	// _itemHeightCacheWidth only, see cacheItemHeight().
+	base::flat_map<MsgId, int> _itemHeightCache;
+	int _itemHeightCacheWidth = 0;
+
 	Element *_unreadBarView = nullptr;
 	Element *_firstUnreadView = nullptr;
 	HistoryService *_joinedMessage = nullptr;
@@ -488,6 +535,10 @@ private:
 	base::flat_set<MsgId> _unreadMentions;
 	base::optional<HistoryItem*> _lastMessage;
 
+	// Raw last message from the dialogs list that was not built into
+	// a HistoryItem yet, see materializeLastMessage().
+	base::optional<MTPMessage> _lastMessagePending;
+
 	// A pointer to the block that is currently being built.
 	// We hold this pointer so we can destroy it while building
 	// and then create a new one if it is necessary.
@@ -528,7 +579,17 @@ public:
 	void remove(not_null<Element*> view);
 	void refreshView(not_null<Element*> view);
 
-	int resizeGetHeight(int newWidth, bool resizeAllItems);
+	// Subtotal of unread incoming messages in this block. It is
+	// maintained on insert / remove and refreshed by the history when
+	// the inbox read position moves, so History::countUnread() can
+	// take whole blocks by subtotal instead of walking the messages.
+	int unreadCount() const {
+		return _unreadCount;
+	}
+	void messageAdded(not_null<HistoryItem*> item);
+	void recountUnreadCount();
+
+	int resizeGetHeight(int newWidth, bool resizeAllItems, bool allowEstimates = false);
 	int y() const {
 		return _y;
 	}
@@ -573,5 +634,6 @@ protected:
 	int _y = 0;
 	int _height = 0;
 	int _indexInHistory = -1;
+	int _unreadCount = 0;
 
 };
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 #include "core/file_utilities.h"
 #include "core/crash_reports.h"
+#include "core/tracing.h"
 #include "history/history.h"
 #include "history/history_message.h"
 #include "history/history_media_types.h"
@@ -36,11 +37,30 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "data/data_session.h"
 #include "data/data_media_types.h"
+#include "data/data_photo.h"
+#include "data/data_document.h"
 
 namespace {
 
 constexpr auto kScrollDateHideTimeout = 1000;
 
+// After the scroll settles, media of items further than this many
+// viewport heights from the visible area get their pixmaps released.
+constexpr auto kReleaseOffscreenTimeout = 3000;
+constexpr auto kReleaseOffscreenMarginFactor = 2;
+
+// Shortly after a scroll settles, the views this many viewport
+// heights ahead of the scroll direction get measured, so that
+// scrolling them into view does no layout work inside the frame.
+constexpr auto kPreLayoutTimeout = 10;
+constexpr auto kPreLayoutHeightsCount = 2;
+
+// Media of the items the viewport will reach within this time at the
+// current scroll speed is requested before it is painted, so that a
+// fast wheel scroll through a media chat shows fewer placeholders.
+constexpr auto kPrefetchAheadMs = 600;
+constexpr auto kPrefetchMaxHeightsCount = 4;
+
 // Helper binary search for an item in a list that is not completely
 // above the given top of the visible area or below the given bottom of the visible area
 // is applied once for blocks list in a history and once for items list in the found block.
@@ -115,7 +135,9 @@ HistoryInner::HistoryInner(
 , _widget(historyWidget)
 , _scroll(scroll)
 , _scrollDateCheck([this] { scrollDateCheck(); })
-, _scrollDateHideTimer([this] { scrollDateHideByTimer(); }) {
+, _scrollDateHideTimer([this] { scrollDateHideByTimer(); })
+, _releaseOffscreenTimer([this] { releaseOffscreenMedia(); })
+, _preLayoutTimer([this] { preLayoutAheadOfScroll(); }) {
 	_touchSelectTimer.setSingleShot(true);
 	connect(&_touchSelectTimer, SIGNAL(timeout()), this, SLOT(onTouchSelect()));
 
@@ -159,6 +181,10 @@ HistoryInner::HistoryInner(
 	) | rpl::start_with_next([this](not_null<const Element*> view) {
 		repaintItem(view);
 	}, lifetime());
+	Auth().data().viewMediaRepaintRequest(
+	) | rpl::start_with_next([this](not_null<const Element*> view) {
+		repaintItemMedia(view);
+	}, lifetime());
 	Auth().data().viewLayoutChanged(
 	) | rpl::filter([](not_null<const Element*> view) {
 		return (view == view->data()->mainView()) && view->isUnderCursor();
@@ -214,6 +240,21 @@ void HistoryInner::repaintItem(const Element *view) {
 	}
 }
 
+void HistoryInner::repaintItemMedia(const Element *view) {
+	if (_widget->skipItemRepaint()) {
+		return;
+	}
+	const auto top = itemTop(view);
+	if (top >= 0) {
+		const auto rect = view->mediaRect();
+		if (rect.isEmpty()) {
+			update(0, top, width(), view->height());
+		} else {
+			update(rect.translated(0, top));
+		}
+	}
+}
+
 template <bool TopToBottom, typename Method>
 void HistoryInner::enumerateItemsInHistory(History *history, int historytop, Method method) {
 	// No displayed messages in this history.
@@ -517,6 +558,12 @@ TextSelection HistoryInner::itemRenderSelection(
 	return TextSelection();
 }
 
+// Scrolling can not be turned into a pure translation of cached item
+// layers here: items are painted with alpha over a wallpaper that stays
+// fixed while the content moves, so a scroll blit would drag the
+// wallpaper along with the bubbles. Repaint cost is kept down instead
+// by clipping the draw pass to the dirty region and by the narrow
+// per-view repaint requests (see Element::mediaRect()).
 void HistoryInner::paintEvent(QPaintEvent *e) {
 	if (Ui::skipPaintEvent(this, e)) {
 		return;
@@ -524,6 +571,7 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 	if (hasPendingResizedItems()) {
 		return;
 	}
+	Core::Tracing::Scope tracing("history paint");
 
 	Painter p(this);
 	auto clip = e->rect();
@@ -1914,9 +1962,20 @@ void HistoryInner::recountHistoryGeometry() {
 		accumulate_max(oldHistoryPaddingTop, st::msgMargin.top() + st::msgMargin.bottom() + st::msgPadding.top() + st::msgPadding.bottom() + st::msgNameFont->height + st::botDescSkip + _botAbout->height);
 	}
 
-	_history->resizeToWidth(_contentWidth);
+	// The visible area is passed in coordinates of the still current
+	// layout, so that offscreen views may reuse cached heights while
+	// everything near the viewport gets a real measurement.
+	const auto htop = historyTop();
+	const auto mtop = migratedTop();
+	_history->resizeToWidth(
+		_contentWidth,
+		_visibleAreaTop - htop,
+		_visibleAreaBottom - htop);
 	if (_migrated) {
-		_migrated->resizeToWidth(_contentWidth);
+		_migrated->resizeToWidth(
+			_contentWidth,
+			_visibleAreaTop - mtop,
+			_visibleAreaBottom - mtop);
 	}
 
 	// with migrated history we perhaps do not need to display first _history message
@@ -2026,6 +2085,7 @@ void HistoryInner::setFirstLoading(bool loading) {
 
 void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	auto scrolledUp = (top < _visibleAreaTop);
+	const auto scrolledDelta = (top - _visibleAreaTop);
 	_visibleAreaTop = top;
 	_visibleAreaBottom = bottom;
 
@@ -2061,6 +2121,159 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	} else {
 		scrollDateHideByTimer();
 	}
+	measureVisibleEstimated();
+	prefetchMediaByScroll(scrolledDelta);
+	_preLayoutUp = scrolledUp;
+	_preLayoutTimer.callOnce(kPreLayoutTimeout);
+	_releaseOffscreenTimer.callOnce(kReleaseOffscreenTimeout);
+}
+
+void HistoryInner::prefetchMediaByScroll(int scrolledDelta) {
+	const auto now = getms();
+	const auto elapsed = now - _prefetchLastTime;
+	_prefetchLastTime = now;
+	if (!scrolledDelta || elapsed <= 0 || elapsed > 1000) {
+		return;
+	}
+	const auto viewport = (_visibleAreaBottom - _visibleAreaTop);
+	auto shift = int(scrolledDelta * TimeMs(kPrefetchAheadMs) / elapsed);
+	shift = snap(
+		shift,
+		-kPrefetchMaxHeightsCount * viewport,
+		kPrefetchMaxHeightsCount * viewport);
+	const auto from = (shift > 0)
+		? _visibleAreaBottom
+		: _visibleAreaTop + shift;
+	const auto till = (shift > 0)
+		? _visibleAreaBottom + shift
+		: _visibleAreaTop;
+	if (from >= till) {
+		return;
+	}
+	const auto prefetchInHistory = [&](History *history, int historytop) {
+		if (historytop < 0 || history->isEmpty()) {
+			return;
+		}
+		for (const auto &block : history->blocks) {
+			const auto blocktop = historytop + block->y();
+			const auto blockbottom = blocktop + block->height();
+			if (blockbottom <= from || blocktop >= till) {
+				continue;
+			}
+			for (const auto &view : block->messages) {
+				const auto item = view->data();
+				if (const auto media = item->media()) {
+					// automaticLoad() respects the user's automatic
+					// download settings, this only starts earlier.
+					if (const auto photo = media->photo()) {
+						photo->automaticLoad(item);
+					} else if (const auto document = media->document()) {
+						document->automaticLoad(item);
+					}
+				}
+			}
+		}
+	};
+	prefetchInHistory(_migrated, migratedTop());
+	prefetchInHistory(_history, historyTop());
+}
+
+void HistoryInner::releaseOffscreenMedia() {
+	if (hasPendingResizedItems()) {
+		_releaseOffscreenTimer.callOnce(kReleaseOffscreenTimeout);
+		return;
+	}
+	const auto margin = kReleaseOffscreenMarginFactor
+		* (_visibleAreaBottom - _visibleAreaTop);
+	const auto keepTop = _visibleAreaTop - margin;
+	const auto keepBottom = _visibleAreaBottom + margin;
+	const auto releaseInHistory = [&](History *history, int historytop) {
+		if (historytop < 0 || history->isEmpty()) {
+			return;
+		}
+		for (const auto &block : history->blocks) {
+			const auto blocktop = historytop + block->y();
+			const auto blockbottom = blocktop + block->height();
+			if (blockbottom > keepTop && blocktop < keepBottom) {
+				continue;
+			}
+			for (const auto &view : block->messages) {
+				if (const auto media = view->media()) {
+					if (const auto photo = media->getPhoto()) {
+						photo->forget();
+					} else if (const auto document = media->getDocument()) {
+						document->forget();
+					}
+				}
+			}
+		}
+	};
+	releaseInHistory(_migrated, migratedTop());
+	releaseInHistory(_history, historyTop());
+}
+
+bool HistoryInner::measurePendingInRange(int from, int till) {
+	auto changed = false;
+	const auto measureInHistory = [&](History *history, int historytop) {
+		if (historytop < 0 || history->isEmpty()) {
+			return;
+		}
+		for (const auto &block : history->blocks) {
+			const auto blocktop = historytop + block->y();
+			const auto blockbottom = blocktop + block->height();
+			if (blockbottom <= from || blocktop >= till) {
+				continue;
+			}
+			for (const auto &view : block->messages) {
+				if (!view->pendingResize()) {
+					continue;
+				}
+				const auto was = view->height();
+				if (view->resizeGetHeight(_contentWidth) != was) {
+					changed = true;
+				}
+			}
+		}
+	};
+	measureInHistory(_migrated, migratedTop());
+	measureInHistory(_history, historyTop());
+	return changed;
+}
+
+void HistoryInner::measureVisibleEstimated() {
+	// Normally the estimates come from real measurements at the same
+	// width, so measuring again keeps the geometry and we just clear
+	// the pending resize flags. If some height did change we recount
+	// the whole geometry, which measures the rest of the estimates.
+	for (auto i = 0; i != 4; ++i) {
+		const auto margin = (_visibleAreaBottom - _visibleAreaTop);
+		if (!measurePendingInRange(
+				_visibleAreaTop - margin,
+				_visibleAreaBottom + margin)) {
+			return;
+		}
+		_history->setHasPendingResizedItems();
+		recountHistoryGeometry();
+		updateSize();
+	}
+}
+
+void HistoryInner::preLayoutAheadOfScroll() {
+	if (hasPendingResizedItems()) {
+		return;
+	}
+	const auto viewport = (_visibleAreaBottom - _visibleAreaTop);
+	const auto ahead = kPreLayoutHeightsCount * viewport;
+	const auto changed = _preLayoutUp
+		? measurePendingInRange(_visibleAreaTop - ahead, _visibleAreaTop)
+		: measurePendingInRange(
+			_visibleAreaBottom,
+			_visibleAreaBottom + ahead);
+	if (changed) {
+		_history->setHasPendingResizedItems();
+		recountHistoryGeometry();
+		updateSize();
+	}
 }
 
 bool HistoryInner::displayScrollDate() const {
@@ -61,6 +61,7 @@ public:
 
 	void repaintItem(const HistoryItem *item);
 	void repaintItem(const Element *view);
+	void repaintItemMedia(const Element *view);
 
 	bool canCopySelected() const;
 	bool canDeleteSelected() const;
@@ -189,6 +190,25 @@ private:
 
 	void scrollDateCheck();
 	void scrollDateHideByTimer();
+	void releaseOffscreenMedia();
+
+	// Replaces cached height estimates of the views near the visible
+	// area with real measurements before they can get painted.
+	void measureVisibleEstimated();
+
+	// Measures the views a couple of viewport heights ahead of the
+	// last scroll direction while the scroll is idle, so that they
+	// come into view already laid out.
+	void preLayoutAheadOfScroll();
+
+	// Measures the pending views in the given widget coordinates
+	// range, returns true if some height changed and the history
+	// geometry must be recounted.
+	bool measurePendingInRange(int from, int till);
+
+	// Starts automatic media loads for the items the viewport is
+	// about to reach at the current scroll speed.
+	void prefetchMediaByScroll(int scrolledDelta);
 	bool canHaveFromUserpics() const;
 	void mouseActionStart(const QPoint &screenPos, Qt::MouseButton button);
 	void mouseActionUpdate();
@@ -356,6 +376,10 @@ private:
 	Animation _scrollDateOpacity;
 	SingleQueuedInvokation _scrollDateCheck;
 	base::Timer _scrollDateHideTimer;
+	base::Timer _releaseOffscreenTimer;
+	base::Timer _preLayoutTimer;
+	bool _preLayoutUp = false;
+	TimeMs _prefetchLastTime = 0;
 	Element *_scrollDateLastItem = nullptr;
 	int _scrollDateLastItemTop = 0;
 	ClickHandlerPtr _scrollDateLink;
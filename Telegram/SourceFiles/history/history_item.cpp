@@ -69,8 +69,63 @@ not_null<HistoryItem*> CreateUnsupportedMessage(
 		text);
 }
 
+// Slots are grouped into classes of kPoolGranularity steps, each class
+// has its own free list and all classes carve fresh slots from shared
+// slabs. Slabs are never returned to the system, freed slots get
+// recycled. Sizes above the largest class fall back to the heap.
+constexpr auto kPoolGranularity = size_t(64);
+constexpr auto kPoolClasses = size_t(16);
+constexpr auto kPoolSlabSize = size_t(64 * 1024);
+
+struct PoolFreeSlot {
+	PoolFreeSlot *next;
+};
+PoolFreeSlot *PoolFreeLists[kPoolClasses] = { nullptr };
+char *PoolSlabPointer = nullptr;
+size_t PoolSlabLeft = 0;
+
 } // namespace
 
+namespace HistoryPool {
+
+void *Allocate(size_t size) {
+	Expects(size > 0);
+
+	const auto index = (size - 1) / kPoolGranularity;
+	if (index >= kPoolClasses) {
+		return ::operator new(size);
+	}
+	if (const auto slot = PoolFreeLists[index]) {
+		PoolFreeLists[index] = slot->next;
+		return slot;
+	}
+	const auto slotSize = (index + 1) * kPoolGranularity;
+	if (PoolSlabLeft < slotSize) {
+		PoolSlabPointer = static_cast<char*>(::operator new(kPoolSlabSize));
+		PoolSlabLeft = kPoolSlabSize;
+	}
+	const auto result = PoolSlabPointer;
+	PoolSlabPointer += slotSize;
+	PoolSlabLeft -= slotSize;
+	return result;
+}
+
+void Free(void *pointer, size_t size) {
+	if (!pointer) {
+		return;
+	}
+	const auto index = (size - 1) / kPoolGranularity;
+	if (index >= kPoolClasses) {
+		::operator delete(pointer);
+		return;
+	}
+	const auto slot = static_cast<PoolFreeSlot*>(pointer);
+	slot->next = PoolFreeLists[index];
+	PoolFreeLists[index] = slot;
+}
+
+} // namespace HistoryPool
+
 void HistoryItem::HistoryItem::Destroyer::operator()(HistoryItem *value) {
 	if (value) {
 		value->destroy();
@@ -281,9 +336,15 @@ void HistoryItem::addToUnreadMentions(UnreadMentionType type) {
 
 void HistoryItem::indexAsNewItem() {
 	if (IsServerMsgId(id)) {
-		CrashReports::SetAnnotation("addToUnreadMentions", QString::number(id));
+		// This runs for every new message, so use the lock-free
+		// annotation slot instead of the allocating SetAnnotation.
+		const auto annotation = QString::number(id);
+		CrashReports::SetAnnotationSlot(
+			CrashReports::AnnotationSlot::IndexAsNewItemId,
+			&annotation);
 		addToUnreadMentions(UnreadMentionType::New);
-		CrashReports::ClearAnnotation("addToUnreadMentions");
+		CrashReports::ClearAnnotationSlot(
+			CrashReports::AnnotationSlot::IndexAsNewItemId);
 		if (const auto types = sharedMediaTypes()) {
 			Auth().storage().add(Storage::SharedMediaAddNew(
 				history()->peer->id,
@@ -557,7 +618,7 @@ MessageGroupId HistoryItem::groupId() const {
 }
 
 bool HistoryItem::isEmpty() const {
-	return _text.isEmpty()
+	return emptyText()
 		&& !_media
 		&& !Has<HistoryMessageLogEntryOriginal>();
 }
@@ -567,6 +628,7 @@ QString HistoryItem::notificationText() const {
 		if (_media) {
 			return _media->notificationText();
 		} else if (!emptyText()) {
+			const_cast<HistoryItem*>(this)->checkTextLayout();
 			return _text.originalText();
 		}
 		return QString();
@@ -584,6 +646,7 @@ QString HistoryItem::inDialogsText(DrawInDialog way) const {
 		if (_media) {
 			return _media->chatsListText();
 		} else if (!emptyText()) {
+			const_cast<HistoryItem*>(this)->checkTextLayout();
 			return TextUtilities::Clean(_text.originalText());
 		}
 		return QString();
@@ -629,6 +692,7 @@ void HistoryItem::drawInDialog(
 }
 
 HistoryItem::~HistoryItem() {
+	Auth().data().searchIndex().remove(this);
 	Auth().data().notifyItemRemoved(this);
 	App::historyUnregItem(this);
 	if (id < 0 && !App::quitting()) {
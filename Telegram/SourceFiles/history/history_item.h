@@ -54,8 +54,26 @@ enum class Context : char;
 class ElementDelegate;
 } // namespace HistoryView
 
+// Shared slab pool for history items and their view elements: loading
+// a big history slice creates thousands of such small objects, so they
+// are carved from size-classed slabs instead of the general allocator
+// and recycled through free lists. Main thread only.
+namespace HistoryPool {
+
+void *Allocate(size_t size);
+void Free(void *pointer, size_t size);
+
+} // namespace HistoryPool
+
 class HistoryItem : public RuntimeComposer<HistoryItem> {
 public:
+	void *operator new(size_t size) {
+		return HistoryPool::Allocate(size);
+	}
+	void operator delete(void *pointer, size_t size) {
+		HistoryPool::Free(pointer, size);
+	}
+
 	static not_null<HistoryItem*> Create(
 		not_null<History*> history,
 		const MTPMessage &message);
@@ -205,10 +223,16 @@ public:
 		const HistoryItem *&cacheFor,
 		Text &cache) const;
 
-	bool emptyText() const {
+	virtual bool emptyText() const {
 		return _text.isEmpty();
 	}
 
+	// Run the deferred text layout, if there is one. Parsing the text
+	// into blocks is postponed until the message is first measured or
+	// its text is actually read.
+	virtual void checkTextLayout() {
+	}
+
 	bool isPinned() const;
 	bool canPin() const;
 	virtual bool allowsForward() const;
@@ -22,6 +22,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_widgets.h"
 #include "styles/style_history.h"
 
+QString InternedMetadataString(const QString &string) {
+	if (string.isEmpty()) {
+		return string;
+	}
+	// Called from the main thread only, where history items are created.
+	// The set only ever grows, but it is bounded by the count of distinct
+	// author names and bot usernames the client has seen.
+	static auto Strings = QSet<QString>();
+	return *Strings.insert(string);
+}
+
 void HistoryMessageVia::create(UserId userId) {
 	bot = App::user(peerFromUser(userId));
 	maxWidth = st::msgServiceNameFont->width(
@@ -36,7 +47,8 @@ void HistoryMessageVia::resize(int32 availw) const {
 		text = QString();
 		width = 0;
 	} else {
-		text = lng_inline_bot_via(lt_inline_bot, '@' + bot->username);
+		text = InternedMetadataString(
+			lng_inline_bot_via(lt_inline_bot, '@' + bot->username));
 		if (availw < maxWidth) {
 			text = st::msgServiceNameFont->elided(text, availw);
 			width = st::msgServiceNameFont->width(text);
@@ -401,7 +413,13 @@ void ReplyKeyboard::updateMessageId() {
 }
 
 void ReplyKeyboard::resize(int width, int height) {
+	if (_width == width && _height == height) {
+		// The button texts are fixed, so the same size always produces
+		// the same layout (including the style chosen for it).
+		return;
+	}
 	_width = width;
+	_height = height;
 
 	auto markup = _item->Get<HistoryMessageReplyMarkup>();
 	auto y = 0.;
@@ -752,6 +770,7 @@ void HistoryMessageReplyMarkup::create(const MTPReplyMarkup &markup) {
 	flags = 0;
 	rows.clear();
 	inlineKeyboard = nullptr;
+	replyKeyboard = nullptr;
 
 	switch (markup.type()) {
 	case mtpc_replyKeyboardMarkup: {
@@ -784,6 +803,7 @@ void HistoryMessageReplyMarkup::create(
 		const HistoryMessageReplyMarkup &markup) {
 	flags = markup.flags;
 	inlineKeyboard = nullptr;
+	replyKeyboard = nullptr;
 
 	rows.clear();
 	for (const auto &row : markup.rows) {
@@ -16,6 +16,12 @@ namespace HistoryView {
 class Element;
 } // namespace HistoryView
 
+// Message metadata like post authors, forwarded-from labels and via-bot
+// strings repeats the same few values across thousands of items, so the
+// result shares one buffer per distinct value instead of keeping a
+// fresh copy in each item.
+QString InternedMetadataString(const QString &string);
+
 struct HistoryMessageVia : public RuntimeComponent<HistoryMessageVia, HistoryItem> {
 	void create(UserId userId);
 	void resize(int32 availw) const;
@@ -163,6 +169,11 @@ struct HistoryMessageReplyMarkup : public RuntimeComponent<HistoryMessageReplyMa
 
 	std::unique_ptr<ReplyKeyboard> inlineKeyboard;
 
+	// The bottom keyboard of this message with the measured button
+	// texts, kept here so that switching back to the chat shows the
+	// keyboard without laying it out again, see BotKeyboard.
+	std::unique_ptr<ReplyKeyboard> replyKeyboard;
+
 	// If >= 0 it holds the y coord of the inlineKeyboard before the last edition.
 	int oldTop = -1;
 
@@ -310,6 +321,7 @@ private:
 
 	const not_null<const HistoryItem*> _item;
 	int _width = 0;
+	int _height = 0;
 
 	std::vector<std::vector<Button>> _rows;
 
@@ -28,6 +28,44 @@ using TextState = HistoryView::TextState;
 using PointState = HistoryView::PointState;
 
 constexpr auto kMaxDisplayedGroupSize = 10;
+constexpr auto kGroupLayoutsMax = 128;
+
+// The group layout solver result depends only on the part sizes and
+// the style metrics, so albums with the same content (views rebuilt
+// for the same items, identical forwarded albums) share one solution.
+QMap<QString, std::vector<Ui::GroupMediaLayout>> GroupLayouts;
+
+QString GroupLayoutKey(const std::vector<QSize> &sizes) {
+	auto result = QString::number(st::historyGroupWidthMax)
+		+ ':'
+		+ QString::number(st::historyGroupWidthMin)
+		+ ':'
+		+ QString::number(st::historyGroupSkip);
+	for (const auto &size : sizes) {
+		result += '-'
+			+ QString::number(size.width())
+			+ 'x'
+			+ QString::number(size.height());
+	}
+	return result;
+}
+
+const std::vector<Ui::GroupMediaLayout> &CachedLayoutMediaGroup(
+		const std::vector<QSize> &sizes) {
+	const auto key = GroupLayoutKey(sizes);
+	auto i = GroupLayouts.find(key);
+	if (i == GroupLayouts.end()) {
+		if (GroupLayouts.size() >= kGroupLayoutsMax) {
+			GroupLayouts.clear();
+		}
+		i = GroupLayouts.insert(key, Ui::LayoutMediaGroup(
+			sizes,
+			st::historyGroupWidthMax,
+			st::historyGroupWidthMin,
+			st::historyGroupSkip));
+	}
+	return i.value();
+}
 
 } // namespace
 
@@ -64,11 +102,7 @@ QSize HistoryGroupedMedia::countOptimalSize() {
 		sizes.push_back(media->sizeForGrouping());
 	}
 
-	const auto layout = Ui::LayoutMediaGroup(
-		sizes,
-		st::historyGroupWidthMax,
-		st::historyGroupWidthMin,
-		st::historyGroupSkip);
+	const auto &layout = CachedLayoutMediaGroup(sizes);
 	Assert(layout.size() == _parts.size());
 
 	auto maxWidth = 0;
@@ -151,7 +151,7 @@ void HistoryFileMedia::setStatusSize(int newSize, int fullSize, int duration, qi
 
 void HistoryFileMedia::step_radial(TimeMs ms, bool timer) {
 	if (timer) {
-		Auth().data().requestViewRepaint(_parent);
+		Auth().data().requestViewMediaRepaint(_parent);
 	} else {
 		_animation->radial.update(dataProgress(), dataFinished(), ms);
 		if (!_animation->radial.animating()) {
@@ -39,6 +39,30 @@ namespace {
 
 constexpr auto kPinnedMessageTextLimit = 16;
 
+// Mass-forwarding the same announcement to many chats lays out an
+// identical text in every copy. Finished layouts of long texts are
+// cached by content, so further copies just clone the ready blocks
+// instead of parsing and measuring the text again.
+constexpr auto kSharedLayoutsMax = 128;
+constexpr auto kSharedLayoutMinLength = 128;
+QMap<QString, Text> SharedLayouts;
+
+QString SharedLayoutKey(
+		const TextWithEntities &textWithEntities,
+		int32 optionsFlags) {
+	auto key = QString::number(optionsFlags);
+	for (const auto &entity : textWithEntities.entities) {
+		key += QString("-%1:%2:%3"
+		).arg(entity.type()
+		).arg(entity.offset()
+		).arg(entity.length());
+		if (!entity.data().isEmpty()) {
+			key += ':' + entity.data();
+		}
+	}
+	return key + '|' + textWithEntities.text;
+}
+
 MTPDmessage::Flags NewForwardedFlags(
 		not_null<PeerData*> peer,
 		UserId from,
@@ -544,8 +568,15 @@ bool HistoryMessage::updateDependencyItem() {
 }
 
 void HistoryMessage::updateAdminBadgeState() {
+	const auto channel = history()->peer->asChannel();
+	const auto info = channel ? channel->mgInfo.get() : nullptr;
+	const auto version = info ? info->adminsVersion : 0;
+	if (_adminBadgeVersion == version) {
+		return;
+	}
+	_adminBadgeVersion = version;
 	auto hasAdminBadge = [&] {
-		if (auto channel = history()->peer->asChannel()) {
+		if (channel) {
 			if (auto user = author()->asUser()) {
 				return channel->isGroupAdmin(user);
 			}
@@ -678,13 +709,13 @@ void HistoryMessage::createComponents(const CreateConfig &config) {
 		edited->date = config.editDate;
 	}
 	if (const auto msgsigned = Get<HistoryMessageSigned>()) {
-		msgsigned->author = config.author;
+		msgsigned->author = InternedMetadataString(config.author);
 	}
 	if (const auto forwarded = Get<HistoryMessageForwarded>()) {
 		forwarded->originalDate = config.originalDate;
 		forwarded->originalSender = App::peer(config.senderOriginal);
 		forwarded->originalId = config.originalId;
-		forwarded->originalAuthor = config.authorOriginal;
+		forwarded->originalAuthor = InternedMetadataString(config.authorOriginal);
 		forwarded->savedFromPeer = App::peerLoaded(config.savedFromPeer);
 		forwarded->savedFromMsgId = config.savedFromMsgId;
 	}
@@ -967,25 +998,62 @@ void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
 
 	if (_media && _media->consumeMessageText(textWithEntities)) {
 		setEmptyText();
+	} else {
+		// Loading a history slice creates thousands of messages that
+		// may never get shown, so the expensive parse into blocks is
+		// deferred until the first measurement or text read.
+		_pendingText = textWithEntities;
+		_textWidth = -1;
+		_textHeight = 0;
+	}
+	Auth().data().searchIndex().update(this, textWithEntities.text);
+}
+
+bool HistoryMessage::emptyText() const {
+	return _pendingText ? _pendingText->text.isEmpty() : _text.isEmpty();
+}
+
+void HistoryMessage::checkTextLayout() {
+	if (!_pendingText) {
+		return;
+	}
+	const auto textWithEntities = *base::take(_pendingText);
+	const auto options = Ui::ItemTextOptions(this);
+	if (textWithEntities.text.size() >= kSharedLayoutMinLength) {
+		const auto key = SharedLayoutKey(textWithEntities, options.flags);
+		auto i = SharedLayouts.find(key);
+		if (i == SharedLayouts.end()) {
+			if (SharedLayouts.size() >= kSharedLayoutsMax) {
+				SharedLayouts.clear();
+			}
+			auto layout = Text(int(st::msgMinWidth));
+			layout.setMarkedText(
+				st::messageTextStyle,
+				textWithEntities,
+				options);
+			i = SharedLayouts.insert(key, layout);
+		}
+		_text = i.value();
 	} else {
 		_text.setMarkedText(
 			st::messageTextStyle,
 			textWithEntities,
+			options);
+	}
+	if (!textWithEntities.text.isEmpty() && _text.isEmpty()) {
+		// If server has allowed some text that we've trim-ed entirely,
+		// just replace it with something so that UI won't look buggy.
+		_text.setMarkedText(
+			st::messageTextStyle,
+			{ QString::fromUtf8("\xF0\x9F\x98\x94"), EntitiesInText() },
 			Ui::ItemTextOptions(this));
-		if (!textWithEntities.text.isEmpty() && _text.isEmpty()) {
-			// If server has allowed some text that we've trim-ed entirely,
-			// just replace it with something so that UI won't look buggy.
-			_text.setMarkedText(
-				st::messageTextStyle,
-				{ QString::fromUtf8("\xF0\x9F\x98\x94"), EntitiesInText() },
-				Ui::ItemTextOptions(this));
-		}
-		_textWidth = -1;
-		_textHeight = 0;
 	}
+	_textWidth = -1;
+	_textHeight = 0;
 }
 
 void HistoryMessage::setEmptyText() {
+	_pendingText = base::none;
 	_text.setMarkedText(
 		st::messageTextStyle,
 		{ QString(), EntitiesInText() },
@@ -1038,7 +1106,10 @@ void HistoryMessage::setReplyMarkup(const MTPReplyMarkup *markup) {
 }
 
 TextWithEntities HistoryMessage::originalText() const {
-	if (emptyText()) {
+	if (_pendingText) {
+		// No need to force the layout, the raw text is still here.
+		return *_pendingText;
+	} else if (emptyText()) {
 		return { QString(), EntitiesInText() };
 	}
 	return _text.originalTextWithEntities();
@@ -1048,11 +1119,16 @@ TextWithEntities HistoryMessage::clipboardText() const {
 	if (emptyText()) {
 		return { QString(), EntitiesInText() };
 	}
+	const_cast<HistoryMessage*>(this)->checkTextLayout();
 	return _text.originalTextWithEntities(AllTextSelection, ExpandLinksAll);
 }
 
 bool HistoryMessage::textHasLinks() const {
-	return emptyText() ? false : _text.hasLinks();
+	if (emptyText()) {
+		return false;
+	}
+	const_cast<HistoryMessage*>(this)->checkTextLayout();
+	return _text.hasLinks();
 }
 
 void HistoryMessage::setViewsCount(int32 count) {
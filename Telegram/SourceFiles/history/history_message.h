@@ -120,6 +120,8 @@ public:
 	Storage::SharedMediaTypesMask sharedMediaTypes() const override;
 
 	void setText(const TextWithEntities &textWithEntities) override;
+	bool emptyText() const override;
+	void checkTextLayout() override;
 	TextWithEntities originalText() const override;
 	TextWithEntities clipboardText() const override;
 	bool textHasLinks() const override;
@@ -145,6 +147,9 @@ public:
 
 private:
 	void setEmptyText();
+
+	// Not yet parsed into _text, see checkTextLayout().
+	base::optional<TextWithEntities> _pendingText;
 	bool hasAdminBadge() const {
 		return _flags & MTPDmessage_ClientFlag::f_has_admin_badge;
 	}
@@ -169,6 +174,10 @@ private:
 
 	mutable int32 _fromNameVersion = 0;
 
+	// Admins epoch for which the admin badge flag was computed, see
+	// MegagroupInfo::adminsVersion.
+	int32 _adminBadgeVersion = 0;
+
 	friend class HistoryView::Element;
 	friend class HistoryView::Message;
 
@@ -84,6 +84,7 @@ namespace {
 constexpr auto kMessagesPerPageFirst = 30;
 constexpr auto kMessagesPerPage = 50;
 constexpr auto kPreloadHeightsCount = 3; // when 3 screens to scroll left make a preload request
+constexpr auto kFastPreloadHeightsCount = 6; // preload earlier in the direction of a fast scroll
 constexpr auto kTabbedSelectorToggleTooltipTimeoutMs = 3000;
 constexpr auto kTabbedSelectorToggleTooltipCount = 3;
 constexpr auto kScrollToVoiceAfterScrolledMs = 1000;
@@ -2247,12 +2248,15 @@ void HistoryWidget::destroyUnreadBar() {
 void HistoryWidget::newUnreadMsg(
 		not_null<History*> history,
 		not_null<HistoryItem*> item) {
-	if (_history == history) {
+	if (_history == history && !App::main()->handlingDifference()) {
 		// If we get here in non-resized state we can't rely on results of
 		// doWeReadServerHistory() and mark chat as read.
 		// If we receive N messages being not at bottom:
 		// - on first message we set unreadcount += 1, firstUnreadMessage.
 		// - on second we get wrong doWeReadServerHistory() and read both.
+		//
+		// While a difference is applied this check is done once for the
+		// whole batch instead, see MainWidget::feedDifference().
 		Auth().data().sendHistoryChangeNotifications();
 
 		if (_scroll->scrollTop() + 1 > _scroll->scrollTopMax()) {
@@ -2739,10 +2743,23 @@ void HistoryWidget::preloadHistoryByScroll() {
 	auto scrollTop = _scroll->scrollTop();
 	auto scrollTopMax = _scroll->scrollTopMax();
 	auto scrollHeight = _scroll->height();
-	if (scrollTop + kPreloadHeightsCount * scrollHeight >= scrollTopMax) {
+
+	// When scrolling a viewport per second or faster request the next
+	// slice earlier in that direction, so it arrives before the edge.
+	const auto elapsed = getms() - _lastScrolled;
+	const auto delta = scrollTop - _lastScrollTop;
+	const auto fast = (elapsed > 0)
+		&& (qAbs(delta) * 1000 >= scrollHeight * elapsed);
+	const auto heightsDown = (fast && delta > 0)
+		? kFastPreloadHeightsCount
+		: kPreloadHeightsCount;
+	const auto heightsUp = (fast && delta < 0)
+		? kFastPreloadHeightsCount
+		: kPreloadHeightsCount;
+	if (scrollTop + heightsDown * scrollHeight >= scrollTopMax) {
 		loadMessagesDown();
 	}
-	if (scrollTop <= kPreloadHeightsCount * scrollHeight) {
+	if (scrollTop <= heightsUp * scrollHeight) {
 		loadMessages();
 	}
 }
@@ -4625,6 +4642,11 @@ void HistoryWidget::itemRemoved(not_null<const HistoryItem*> item) {
 		onKbToggle();
 		_kbReplyTo = 0;
 	}
+	if (_keyboard->forMsgId() == item->fullId()) {
+		// The shown keyboard is owned by the markup component of the
+		// item and dies together with it.
+		_keyboard->updateMarkup(nullptr, true);
+	}
 	auto found = ranges::find(_toForward, item);
 	if (found != _toForward.end()) {
 		_toForward.erase(found);
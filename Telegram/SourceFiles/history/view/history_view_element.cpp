@@ -132,6 +132,14 @@ void DateBadge::paint(Painter &p, int y, int w) const {
 	ServiceMessagePainter::paintDate(p, text, width, y, w);
 }
 
+void *Element::operator new(size_t size) {
+	return HistoryPool::Allocate(size);
+}
+
+void Element::operator delete(void *pointer, size_t size) {
+	HistoryPool::Free(pointer, size);
+}
+
 Element::Element(
 	not_null<ElementDelegate*> delegate,
 	not_null<HistoryItem*> data)
@@ -395,10 +403,31 @@ QSize Element::countOptimalSize() {
 
 QSize Element::countCurrentSize(int newWidth) {
 	if (_flags & Flag::NeedsResize) {
-		_flags &= ~Flag::NeedsResize;
+		_flags &= ~(Flag::NeedsResize | Flag::HeightEstimated);
 		initDimensions();
 	}
-	return performCountCurrentSize(newWidth);
+	const auto result = performCountCurrentSize(newWidth);
+	if (result.height() > 0) {
+		data()->history()->cacheItemHeight(
+			data()->id,
+			newWidth,
+			result.height());
+	}
+	return result;
+}
+
+int Element::resizeEstimatedGetHeight(int newWidth) {
+	if ((_flags & Flag::NeedsResize) && !maxWidth()) {
+		const auto cached = data()->history()->cachedItemHeight(
+			data()->id,
+			newWidth);
+		if (cached > 0) {
+			_flags |= Flag::HeightEstimated;
+			setCurrentSize({ newWidth, cached });
+			return height();
+		}
+	}
+	return resizeGetHeight(newWidth);
 }
 
 void Element::setDisplayDate(bool displayDate) {
@@ -477,6 +506,10 @@ bool Element::displayRightAction() const {
 	return false;
 }
 
+QRect Element::mediaRect() const {
+	return QRect(0, 0, width(), height());
+}
+
 void Element::drawRightAction(
 	Painter &p,
 	int left,
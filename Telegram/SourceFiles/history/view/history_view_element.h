@@ -109,11 +109,17 @@ public:
 		not_null<ElementDelegate*> delegate,
 		not_null<HistoryItem*> data);
 
+	// Views are carved from the same slab pool as the items they show,
+	// see HistoryPool in history_item.h.
+	void *operator new(size_t size);
+	void operator delete(void *pointer, size_t size);
+
 	enum class Flag : uchar {
 		NeedsResize        = 0x01,
 		AttachedToPrevious = 0x02,
 		AttachedToNext     = 0x04,
 		HiddenByGroup      = 0x08,
+		HeightEstimated    = 0x10,
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) { return true; }
@@ -136,6 +142,12 @@ public:
 	bool pendingResize() const;
 	bool isUnderCursor() const;
 
+	// Like resizeGetHeight(), but a view that was never measured may
+	// reuse a height cached in the history instead of a full layout.
+	// It keeps its pending resize flag so that the next ordinary
+	// resizeGetHeight() call performs the real measurement.
+	int resizeEstimatedGetHeight(int newWidth);
+
 	bool isAttachedToPrevious() const;
 	bool isAttachedToNext() const;
 
@@ -220,6 +232,9 @@ public:
 	virtual bool hasFastReply() const;
 	virtual bool displayFastReply() const;
 	virtual bool displayRightAction() const;
+	// Rectangle of the displayed media in item coordinates, used to
+	// narrow progress tick repaints to the damaged part of the item.
+	virtual QRect mediaRect() const;
 	virtual void drawRightAction(
 		Painter &p,
 		int left,
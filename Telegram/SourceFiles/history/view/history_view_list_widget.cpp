@@ -249,6 +249,12 @@ ListWidget::ListWidget(
 			repaintItem(view);
 		}
 	}, lifetime());
+	Auth().data().viewMediaRepaintRequest(
+	) | rpl::start_with_next([this](auto view) {
+		if (view->delegate() == this) {
+			repaintItemMedia(view);
+		}
+	}, lifetime());
 	Auth().data().viewResizeRequest(
 	) | rpl::start_with_next([this](auto view) {
 		if (view->delegate() == this) {
@@ -2338,6 +2344,18 @@ void ListWidget::repaintItem(const Element *view) {
 	update(0, itemTop(view), width(), view->height());
 }
 
+void ListWidget::repaintItemMedia(const Element *view) {
+	if (!view) {
+		return;
+	}
+	const auto rect = view->mediaRect();
+	if (rect.isEmpty()) {
+		update(0, itemTop(view), width(), view->height());
+	} else {
+		update(rect.translated(0, itemTop(view)));
+	}
+}
+
 void ListWidget::repaintItem(FullMsgId itemId) {
 	if (const auto view = viewForItem(itemId)) {
 		repaintItem(view);
@@ -207,6 +207,8 @@ QSize Message::performCountOptimalSize() {
 	const auto item = message();
 	const auto media = this->media();
 
+	item->checkTextLayout();
+
 	auto maxWidth = 0;
 	auto minHeight = 0;
 
@@ -668,6 +670,34 @@ PointState Message::pointState(QPoint point) const {
 	return PointState::Outside;
 }
 
+QRect Message::mediaRect() const {
+	const auto media = this->media();
+	if (!media || !media->isDisplayed()) {
+		return QRect(0, 0, width(), height());
+	}
+	const auto g = countGeometry();
+	if (g.width() < 1 || isHidden()) {
+		return QRect();
+	}
+	if (!drawBubble()) {
+		return g;
+	}
+
+	// The media rectangle is counted the same way draw() places it.
+	auto entry = logEntryOriginal();
+	auto mediaOnBottom = media->isBubbleBottom() || entry;
+	auto trect = g.marginsRemoved(st::msgPadding);
+	if (mediaOnBottom) {
+		trect.setHeight(trect.height() + st::msgPadding.bottom());
+	}
+	if (entry) {
+		trect.setHeight(trect.height() - entry->height());
+	}
+	const auto mediaHeight = media->height();
+	const auto mediaTop = (trect.y() + trect.height() - mediaHeight);
+	return QRect(g.left(), mediaTop, media->width(), mediaHeight);
+}
+
 bool Message::displayFromPhoto() const {
 	return hasFromPhoto() && !isAttachedToNext();
 }
@@ -74,6 +74,7 @@ public:
 	bool hasFastReply() const override;
 	bool displayFastReply() const override;
 	bool displayRightAction() const override;
+	QRect mediaRect() const override;
 	void drawRightAction(
 		Painter &p,
 		int left,
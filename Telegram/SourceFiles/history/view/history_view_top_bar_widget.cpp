@@ -677,7 +677,7 @@ void TopBarWidget::updateAdaptiveLayout() {
 	if (Adaptive::OneColumn()) {
 		createUnreadBadge();
 	} else if (_unreadBadge) {
-		unsubscribe(base::take(_unreadCounterSubscription));
+		_unreadBadgeLifetime.destroy();
 		_unreadBadge.destroy();
 	}
 	updateInfoToggleActive();
@@ -691,10 +691,10 @@ void TopBarWidget::createUnreadBadge() {
 	_unreadBadge->setGeometryToLeft(0, st::titleUnreadCounterTop, _back->width(), st::dialogsUnreadHeight);
 	_unreadBadge->show();
 	_unreadBadge->setAttribute(Qt::WA_TransparentForMouseEvents);
-	_unreadCounterSubscription = subscribe(
-		Global::RefUnreadCounterUpdate(),
-		[this] { updateUnreadBadge(); });
-	updateUnreadBadge();
+	App::histories().unreadBadgeValue(
+	) | rpl::start_with_next(
+		[=] { updateUnreadBadge(); },
+		_unreadBadgeLifetime);
 }
 
 void TopBarWidget::updateUnreadBadge() {
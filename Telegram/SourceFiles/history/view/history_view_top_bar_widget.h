@@ -144,7 +144,7 @@ private:
 	bool _animatingMode = false;
 	std::unique_ptr<Ui::InfiniteRadialAnimation> _connecting;
 
-	int _unreadCounterSubscription = 0;
+	rpl::lifetime _unreadBadgeLifetime;
 	base::Timer _onlineUpdater;
 
 	rpl::event_stream<> _forwardSelection;
@@ -632,6 +632,10 @@ rpl::producer<SelectedItems> WrapWidget::selectedListValue() const {
 //	Unexpected("Tab value in Info::WrapWidget::createInner()");
 //}
 
+// Only the section being navigated to is ever constructed - the
+// memento describes it and builds the widget on demand, so sections
+// the user never visits (media, members, settings) cost nothing at
+// profile open. Keep it that way when adding section types.
 object_ptr<ContentWidget> WrapWidget::createContent(
 		not_null<ContentMemento*> memento,
 		not_null<Controller*> controller) {
@@ -38,6 +38,11 @@ namespace Info {
 namespace Media {
 namespace {
 
+// The grid is windowed: layouts exist only for the current message ids
+// slice, about kPreloadedScreensCountFull screens around the viewport.
+// Scrolling re-centers the slice (see checkMoveToOtherViewer()) and
+// layouts that fall out of it are dropped in clearStaleLayouts(), so
+// memory stays bounded no matter how large the shared media history is.
 constexpr auto kPreloadedScreensCount = 4;
 constexpr auto kPreloadIfLessThanScreens = 2;
 constexpr auto kPreloadedScreensCountFull
@@ -168,8 +168,8 @@ void Instance::switchToId(const QString &id) {
 	reset();
 	_id = id;
 	if (_id == qstr("TEST_X") || _id == qstr("TEST_0")) {
-		for (auto &value : _values) {
-			value = PrepareTestValue(value, _id[5]);
+		for (auto i = 0; i != kLangKeysCount; ++i) {
+			_values[i] = PrepareTestValue(getValue(LangKey(i)), _id[5]);
 		}
 		_updated.notify();
 	}
@@ -198,10 +198,11 @@ void Instance::reset() {
 
 void Instance::fillDefaults() {
 	Expects(_values.empty());
-	_values.reserve(kLangKeysCount);
-	for (auto i = 0; i != kLangKeysCount; ++i) {
-		_values.emplace_back(GetOriginalValue(LangKey(i)));
-	}
+
+	// Values are pulled from the generated pack on first getValue()
+	// call, see the comment there.
+	_values.resize(kLangKeysCount);
+	_valueSet = std::vector<uchar>(kLangKeysCount, 0);
 	_nonDefaultSet = std::vector<uchar>(kLangKeysCount, 0);
 }
 
@@ -456,6 +457,7 @@ void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	auto index = ParseKeyValue(key, value, _values);
 	if (index != kLangKeysCount) {
 		_nonDefaultSet[index] = 1;
+		_valueSet[index] = 1;
 	}
 }
 
@@ -479,6 +481,7 @@ void Instance::resetValue(const QByteArray &key) {
 	auto keyIndex = GetKeyIndex(QLatin1String(key));
 	if (keyIndex != kLangKeysCount) {
 		_values[keyIndex] = GetOriginalValue(keyIndex);
+		_valueSet[keyIndex] = 1;
 	}
 }
 
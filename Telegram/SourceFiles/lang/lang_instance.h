@@ -77,6 +77,14 @@ public:
 	QString getValue(LangKey key) const {
 		Expects(key >= 0 && key < kLangKeysCount);
 		Expects(_values.size() == kLangKeysCount);
+		if (!_valueSet[key]) {
+			// Default values materialize lazily on first access: the
+			// generated pack is a static offset-indexed table and a
+			// session touches only a fraction of the keys, so filling
+			// all of them eagerly wastes startup time.
+			_valueSet[key] = 1;
+			_values[key] = GetOriginalValue(key);
+		}
 		return _values[key];
 	}
 	bool isNonDefaultPlural(LangKey key) const {
@@ -120,7 +128,8 @@ private:
 
 	mutable QString _systemLanguage;
 
-	std::vector<QString> _values;
+	mutable std::vector<QString> _values;
+	mutable std::vector<uchar> _valueSet;
 	std::vector<uchar> _nonDefaultSet;
 	std::map<QByteArray, QByteArray> _nonDefaultValues;
 
@@ -236,15 +236,97 @@ NEW LOGGING INSTANCE STARTED!!!\n\
 LogsDataFields *LogsData = 0;
 
 typedef QList<QPair<LogDataType, QString> > LogsInMemoryList;
+
+// Debug-class records (debug / tcp / mtp logs) are written by this
+// thread, so that with debug logs enabled the call site only pays for
+// formatting the message and a short enqueue, not for the disk write.
+// The main log is not routed here - it is read back for crash reports
+// and must reach the disk synchronously.
+//
+// The queue is bounded: on overflow new records are dropped and a
+// single summary line is written when the writer catches up.
+constexpr auto kDebugLogsQueueLimit = 8192;
+
+class DebugLogsWriteThread : public QThread {
+public:
+	void enqueue(LogDataType type, const QString &msg) {
+		QMutexLocker lock(&_mutex);
+		if (_queue.size() >= kDebugLogsQueueLimit) {
+			++_dropped;
+			return;
+		}
+		_queue.push_back(qMakePair(type, msg));
+		_woken.wakeOne();
+	}
+
+	void stop() {
+		{
+			QMutexLocker lock(&_mutex);
+			_stopping = true;
+			_woken.wakeOne();
+		}
+		wait();
+	}
+
+protected:
+	void run() override;
+
+private:
+	QMutex _mutex;
+	QWaitCondition _woken;
+	LogsInMemoryList _queue;
+	int32 _dropped = 0;
+	bool _stopping = false;
+
+};
+
+DebugLogsWriteThread *DebugLogsThread = 0;
+
 LogsInMemoryList *LogsInMemory = 0;
 LogsInMemoryList *DeletedLogsInMemory = SharedMemoryLocation<LogsInMemoryList, 0>();
 
 QString LogsBeforeSingleInstanceChecked; // LogsInMemory already dumped in LogsData, but LogsData is about to be deleted
 
+void DebugLogsWriteThread::run() {
+	while (true) {
+		LogsInMemoryList drain;
+		int32 dropped = 0;
+		bool stopping = false;
+		{
+			QMutexLocker lock(&_mutex);
+			while (_queue.isEmpty() && !_stopping) {
+				_woken.wait(&_mutex);
+			}
+			std::swap(drain, _queue);
+			dropped = _dropped;
+			_dropped = 0;
+			stopping = _stopping;
+		}
+		for (LogsInMemoryList::const_iterator i = drain.cbegin(), e = drain.cend(); i != e; ++i) {
+			if (LogsData) {
+				LogsData->write(i->first, i->second);
+			}
+		}
+		if (dropped > 0 && LogsData) {
+			LogsData->write(LogDataDebug, QString("%1 WARNING: %2 debug log records were dropped on queue overflow.\n").arg(_logsEntryStart()).arg(dropped));
+		}
+		if (stopping) {
+			return;
+		}
+	}
+}
+
 void _logsWrite(LogDataType type, const QString &msg) {
 	if (LogsData && (type == LogDataMain || LogsStartIndexChosen < 0)) {
-		if (type == LogDataMain || cDebug()) {
+		if (type == LogDataMain) {
 			LogsData->write(type, msg);
+		} else if (cDebug()) {
+			// The writer thread is started in Logs::instanceChecked(),
+			// before LogsStartIndexChosen is reset, so any record that
+			// reaches this branch can be enqueued safely.
+			if (DebugLogsThread) {
+				DebugLogsThread->enqueue(type, msg);
+			}
 		}
 	} else if (LogsInMemory != DeletedLogsInMemory) {
 		if (!LogsInMemory) {
@@ -419,6 +501,12 @@ void start(not_null<Core::Launcher*> launcher) {
 }
 
 void finish() {
+	if (DebugLogsThread) {
+		DebugLogsThread->stop();
+		delete DebugLogsThread;
+		DebugLogsThread = 0;
+	}
+
 	delete LogsData;
 	LogsData = 0;
 
@@ -448,6 +536,13 @@ bool instanceChecked() {
 		return false;
 	}
 
+	// Started here, while writes still come from a single thread, so
+	// that the replay below and all later debug records go through it.
+	if (!DebugLogsThread) {
+		DebugLogsThread = new DebugLogsWriteThread();
+		DebugLogsThread->start();
+	}
+
 	if (LogsInMemory) {
 		Assert(LogsInMemory != DeletedLogsInMemory);
 		LogsInMemoryList list = *LogsInMemory;
@@ -76,6 +76,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/themes/window_theme.h"
 #include "mtproto/dc_options.h"
 #include "core/file_utilities.h"
+#include "core/tracing.h"
 #include "core/update_checker.h"
 #include "calls/calls_instance.h"
 #include "calls/calls_top_bar.h"
@@ -87,6 +88,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 #include "styles/style_boxes.h"
 
+namespace {
+
+// Relayout at most 25 times per second during an interactive resize.
+constexpr auto kInteractiveResizeThrottle = TimeMs(40);
+
+// How many per-size background renders are kept for instant reuse.
+constexpr auto kCachedBackgroundVariantsLimit = 4;
+
+// When one long text is sent as several messages, all the parts except
+// the last one are only queued with this timeout and the last part
+// flushes the whole batch, so the session packs them into a single
+// container with invokeAfterMsg chaining instead of a packet per part.
+constexpr auto kPipelinedSendWait = TimeMs(1000);
+
+} // namespace
+
 enum StackItemType {
 	HistoryStackItem,
 	SectionStackItem,
@@ -278,6 +295,10 @@ MainWidget::MainWidget(
 		}
 	});
 	connect(&_cacheBackgroundTimer, SIGNAL(timeout()), this, SLOT(onCacheBackground()));
+	_resizeSettleTimer.setTimeoutHandler([this] {
+		_lastResizeLayout = getms();
+		updateControlsGeometry();
+	});
 
 	_playerPanel->setPinCallback([this] { switchToFixedPlayer(); });
 	_playerPanel->setCloseCallback([this] { closeBothPlayers(); });
@@ -1193,43 +1214,79 @@ bool MainWidget::sendMessageFail(const RPCError &error) {
 }
 
 void MainWidget::onCacheBackground() {
+	// Rendering the wallpaper at the widget size smooth-scales or
+	// tiles the full image, which takes long enough on 4K wallpapers
+	// to stall the UI, so bake it on a worker. Until the result is
+	// swapped in the paint keeps drawing the quick unscaled version.
+	const auto forRect = _willCacheFor;
+	const auto generation = _cacheBackgroundGeneration;
 	if (Window::Theme::Background()->tile()) {
-		auto &bg = Window::Theme::Background()->pixmapForTiled();
-
-		auto result = QImage(_willCacheFor.width() * cIntRetinaFactor(), _willCacheFor.height() * cIntRetinaFactor(), QImage::Format_RGB32);
-        result.setDevicePixelRatio(cRetinaFactor());
-		{
-			QPainter p(&result);
-			auto left = 0;
-			auto top = 0;
-			auto right = _willCacheFor.width();
-			auto bottom = _willCacheFor.height();
-			auto w = bg.width() / cRetinaFactor();
-			auto h = bg.height() / cRetinaFactor();
-			auto sx = 0;
-			auto sy = 0;
-			auto cx = qCeil(_willCacheFor.width() / w);
-			auto cy = qCeil(_willCacheFor.height() / h);
-			for (int i = sx; i < cx; ++i) {
-				for (int j = sy; j < cy; ++j) {
-					p.drawPixmap(QPointF(i * w, j * h), bg);
+		auto bg = Window::Theme::Background()->pixmapForTiled().toImage();
+		crl::async([=, bg = std::move(bg)]() mutable {
+			auto result = QImage(forRect.width() * cIntRetinaFactor(), forRect.height() * cIntRetinaFactor(), QImage::Format_RGB32);
+			result.setDevicePixelRatio(cRetinaFactor());
+			{
+				QPainter p(&result);
+				auto w = bg.width() / cRetinaFactor();
+				auto h = bg.height() / cRetinaFactor();
+				auto cx = qCeil(forRect.width() / w);
+				auto cy = qCeil(forRect.height() / h);
+				for (int i = 0; i < cx; ++i) {
+					for (int j = 0; j < cy; ++j) {
+						p.drawImage(QPointF(i * w, j * h), bg);
+					}
 				}
 			}
-		}
-		_cachedX = 0;
-		_cachedY = 0;
-		_cachedBackground = App::pixmapFromImageInPlace(std::move(result));
+			crl::on_main(this, [=, result = std::move(result)]() mutable {
+				cachedBackgroundReady(generation, forRect, 0, 0, std::move(result));
+			});
+		});
 	} else {
-		auto &bg = Window::Theme::Background()->pixmap();
+		auto bg = Window::Theme::Background()->pixmap().toImage();
 
 		QRect to, from;
-		Window::Theme::ComputeBackgroundRects(_willCacheFor, bg.size(), to, from);
-		_cachedX = to.x();
-		_cachedY = to.y();
-		_cachedBackground = App::pixmapFromImageInPlace(bg.toImage().copy(from).scaled(to.width() * cIntRetinaFactor(), to.height() * cIntRetinaFactor(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-		_cachedBackground.setDevicePixelRatio(cRetinaFactor());
+		Window::Theme::ComputeBackgroundRects(forRect, bg.size(), to, from);
+		const auto x = to.x();
+		const auto y = to.y();
+		crl::async([=, bg = std::move(bg)]() mutable {
+			auto result = bg.copy(from).scaled(to.width() * cIntRetinaFactor(), to.height() * cIntRetinaFactor(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+			result.setDevicePixelRatio(cRetinaFactor());
+			crl::on_main(this, [=, result = std::move(result)]() mutable {
+				cachedBackgroundReady(generation, forRect, x, y, std::move(result));
+			});
+		});
 	}
-	_cachedFor = _willCacheFor;
+}
+
+void MainWidget::cachedBackgroundReady(
+		int generation,
+		QRect forRect,
+		int x,
+		int y,
+		QImage &&image) {
+	if (generation != _cacheBackgroundGeneration) {
+		// The background changed while this render was in flight.
+		return;
+	}
+	_cachedX = x;
+	_cachedY = y;
+	_cachedBackground = App::pixmapFromImageInPlace(std::move(image));
+	_cachedBackground.setDevicePixelRatio(cRetinaFactor());
+	_cachedFor = forRect;
+
+	const auto i = ranges::find_if(_cachedBackgroundVariants, [&](
+			const CachedBackgroundVariant &variant) {
+		return (variant.forRect == forRect);
+	});
+	if (i != _cachedBackgroundVariants.end()) {
+		_cachedBackgroundVariants.erase(i);
+	}
+	while (_cachedBackgroundVariants.size() >= kCachedBackgroundVariantsLimit) {
+		_cachedBackgroundVariants.erase(_cachedBackgroundVariants.begin());
+	}
+	_cachedBackgroundVariants.push_back(
+		{ forRect, x, y, _cachedBackground });
+	update();
 }
 
 Dialogs::IndexedList *MainWidget::contactsList() {
@@ -1351,7 +1408,7 @@ void MainWidget::sendMessage(const MessageToSend &message) {
 			rpcDone(&MainWidget::sentUpdatesReceived, randomId),
 			rpcFail(&MainWidget::sendMessageFail),
 			0,
-			0,
+			left.text.isEmpty() ? 0 : kPipelinedSendWait,
 			history->sendRequestId);
 	}
 
@@ -1660,6 +1717,13 @@ void MainWidget::documentLoadProgress(FileLoader *loader) {
 void MainWidget::documentLoadProgress(DocumentData *document) {
 	if (document->loaded()) {
 		document->performActionOnLoad();
+		if (const auto voice = document->voice()) {
+			if (voice->waveform.isEmpty()) {
+				// Count and cache the waveform right away instead of
+				// waiting for the message to be painted first.
+				Local::countVoiceWaveform(document);
+			}
+		}
 	}
 
 	Auth().data().requestDocumentViewRepaint(document);
@@ -1802,6 +1866,8 @@ bool MainWidget::isIdle() const {
 
 void MainWidget::clearCachedBackground() {
 	_cachedBackground = QPixmap();
+	_cachedBackgroundVariants.clear();
+	++_cacheBackgroundGeneration;
 	_cacheBackgroundTimer.stop();
 	update();
 }
@@ -1812,6 +1878,19 @@ QPixmap MainWidget::cachedBackground(const QRect &forRect, int &x, int &y) {
 		y = _cachedY;
 		return _cachedBackground;
 	}
+	// A variant rendered for this size earlier (another monitor, a
+	// restored window) is reused right away instead of rescaling.
+	for (const auto &variant : _cachedBackgroundVariants) {
+		if (variant.forRect == forRect) {
+			_cachedFor = variant.forRect;
+			_cachedX = variant.x;
+			_cachedY = variant.y;
+			_cachedBackground = variant.pixmap;
+			x = _cachedX;
+			y = _cachedY;
+			return _cachedBackground;
+		}
+	}
 	if (_willCacheFor != forRect || !_cacheBackgroundTimer.isActive()) {
 		_willCacheFor = forRect;
 		_cacheBackgroundTimer.start(CacheBackgroundTimeout);
@@ -2875,7 +2954,19 @@ void MainWidget::showAll() {
 }
 
 void MainWidget::resizeEvent(QResizeEvent *e) {
-	updateControlsGeometry();
+	// An interactive resize delivers an event per mouse move and each
+	// one cascaded a synchronous relayout of the dialogs, the history
+	// and the third column, which visibly chugs on large monitors.
+	// Throttle the cascade while the events keep coming and settle
+	// with one full relayout as soon as they pause.
+	const auto ms = getms();
+	if (ms >= _lastResizeLayout + kInteractiveResizeThrottle) {
+		_lastResizeLayout = ms;
+		_resizeSettleTimer.stop();
+		updateControlsGeometry();
+	} else if (!_resizeSettleTimer.isActive()) {
+		_resizeSettleTimer.start(kInteractiveResizeThrottle);
+	}
 }
 
 void MainWidget::updateControlsGeometry() {
@@ -3448,10 +3539,14 @@ void MainWidget::feedChannelDifference(
 	App::feedChats(data.vchats);
 
 	_handlingChannelDifference = true;
+	_handlingDifference = true;
 	feedMessageIds(data.vother_updates);
 	App::feedMsgs(data.vnew_messages, NewMessageUnread);
 	feedUpdateVector(data.vother_updates, true);
+	_handlingDifference = false;
 	_handlingChannelDifference = false;
+
+	App::wnd()->checkHistoryActivation();
 }
 
 bool MainWidget::failChannelDifference(ChannelData *channel, const RPCError &error) {
@@ -3602,8 +3697,18 @@ void MainWidget::feedDifference(
 	App::feedUsers(users);
 	App::feedChats(chats);
 	feedMessageIds(other);
+
+	// A difference after sleep can bring tens of thousands of messages
+	// and updates. While it is applied each new message in the active
+	// chat would check the scroll state and flush the queued history
+	// change notifications, so suppress the per-message checks and do
+	// a single check for the active chat after the whole batch.
+	_handlingDifference = true;
 	App::feedMsgs(msgs, NewMessageUnread);
 	feedUpdateVector(other, true);
+	_handlingDifference = false;
+
+	App::wnd()->checkHistoryActivation();
 }
 
 bool MainWidget::failDifference(const RPCError &error) {
@@ -3722,6 +3827,7 @@ void MainWidget::start(const MTPUser *self) {
 		return;
 	}
 
+	Local::readPeersSnapshot();
 	Local::readSavedPeers();
 	cSetOtherOnline(0);
 	if (auto user = App::feedUsers(MTP_vector<MTPUser>(1, *self))) {
@@ -4129,7 +4235,9 @@ void MainWidget::incrementSticker(DocumentData *sticker) {
 	}
 
 	if (writeOldRecent) {
-		Local::writeUserSettings();
+		// The old recent pack lives in user settings, don't serialize
+		// the whole settings file on every sticker sent.
+		Auth().saveSettingsDelayed();
 	}
 
 	// Remove that sticker from custom stickers, now it is in cloud recent stickers.
@@ -4444,6 +4552,7 @@ DataIsLoadedResult allDataLoadedForMessage(const MTPMessage &msg) {
 } // namespace
 
 void MainWidget::feedUpdates(const MTPUpdates &updates, uint64 randomId) {
+	Core::Tracing::Scope tracing("updates apply");
 	switch (updates.type()) {
 	case mtpc_updates: {
 		auto &d = updates.c_updates();
@@ -284,6 +284,13 @@ public:
 	void ptsWaiterStartTimerFor(ChannelData *channel, int32 ms); // ms <= 0 - stop timer
 	void feedUpdates(const MTPUpdates &updates, uint64 randomId = 0);
 
+	// True while a whole updates.getDifference result is being applied,
+	// the per-message active chat checks are replaced by one check
+	// after the batch.
+	bool handlingDifference() const {
+		return _handlingDifference;
+	}
+
 	void ctrlEnterSubmitUpdated();
 	void setInnerFocus();
 
@@ -499,6 +506,12 @@ private:
 	void showAll();
 
 	void clearCachedBackground();
+	void cachedBackgroundReady(
+		int generation,
+		QRect forRect,
+		int x,
+		int y,
+		QImage &&image);
 	void checkCurrentFloatPlayer();
 	void createFloatPlayer(not_null<HistoryItem*> item);
 	void toggleFloatPlayer(not_null<Float*> instance);
@@ -554,6 +567,10 @@ private:
 	int _thirdColumnWidth = 0;
 	Animation _a_dialogsWidth;
 
+	// Interactive resize relayout throttling, see resizeEvent().
+	SingleTimer _resizeSettleTimer;
+	TimeMs _lastResizeLayout = 0;
+
 	object_ptr<Ui::PlainShadow> _sideShadow;
 	object_ptr<Ui::PlainShadow> _thirdShadow = { nullptr };
 	object_ptr<Ui::ResizeArea> _firstColumnResizeArea = { nullptr };
@@ -617,11 +634,27 @@ private:
 
 	TimeMs _lastUpdateTime = 0;
 	bool _handlingChannelDifference = false;
+	bool _handlingDifference = false;
 
 	QPixmap _cachedBackground;
 	QRect _cachedFor, _willCacheFor;
 	int _cachedX = 0;
 	int _cachedY = 0;
+
+	// Backgrounds rendered for recently used widget sizes, so moving
+	// between monitors or restoring the window reuses them instead of
+	// rescaling the wallpaper again.
+	struct CachedBackgroundVariant {
+		QRect forRect;
+		int x = 0;
+		int y = 0;
+		QPixmap pixmap;
+	};
+	std::vector<CachedBackgroundVariant> _cachedBackgroundVariants;
+
+	// Bumped when the background changes, so that worker renders that
+	// are still in flight for the old one get discarded.
+	int _cacheBackgroundGeneration = 0;
 	SingleTimer _cacheBackgroundTimer;
 
 	typedef QMap<ChannelData*, bool> UpdatedChannels;
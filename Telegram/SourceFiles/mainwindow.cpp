@@ -176,6 +176,7 @@ void MainWindow::setupPasscode() {
 	} else {
 		setInnerFocus();
 	}
+	destroyWarmSnapshot(anim::type::instant);
 }
 
 void MainWindow::setupIntro() {
@@ -197,6 +198,7 @@ void MainWindow::setupIntro() {
 	} else {
 		setInnerFocus();
 	}
+	destroyWarmSnapshot(anim::type::normal);
 
 	fixOrder();
 
@@ -283,6 +285,7 @@ void MainWindow::setupMain(const MTPUser *self) {
 	} else {
 		_main->activate();
 	}
+	destroyWarmSnapshot(anim::type::normal);
 	_main->start(self);
 
 	fixOrder();
@@ -801,6 +804,10 @@ void MainWindow::onClearFinished(int task, void *manager) {
 		_clearManager->stop();
 		_clearManager = nullptr;
 	}
+	if ((task & Local::ClearManagerStorage) && !(task & Local::ClearManagerCompact)) {
+		// Clearing dropped map entries, sweep the dead blob files too.
+		tempDirDelete(Local::ClearManagerCompact);
+	}
 	emit tempDirCleared(task);
 }
 
@@ -21,8 +21,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <numeric>
 
+#if defined Q_PROCESSOR_X86_64 || defined __SSE2__ || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define TDESKTOP_AUDIO_USE_SSE2
+#include <emmintrin.h>
+#endif // x86 with SSE2
+
 Q_DECLARE_METATYPE(AudioMsgId);
 Q_DECLARE_METATYPE(VoiceWaveform);
+Q_DECLARE_METATYPE(FileLocation);
 
 namespace {
 
@@ -170,12 +176,18 @@ void Start() {
 
 	qRegisterMetaType<AudioMsgId>();
 	qRegisterMetaType<VoiceWaveform>();
+	qRegisterMetaType<FileLocation>();
 
 	auto loglevel = getenv("ALSOFT_LOGLEVEL");
 	LOG(("OpenAL Logging Level: %1").arg(loglevel ? loglevel : "(not set)"));
 
-	EnumeratePlaybackDevices();
-	EnumerateCaptureDevices();
+	// Enumeration only produces log lines, but it may probe the audio
+	// backend and block for a while on some systems, so keep it off
+	// the main thread - alcGetString(nullptr, ..) is safe from any thread.
+	crl::async([] {
+		EnumeratePlaybackDevices();
+		EnumerateCaptureDevices();
+	});
 
 	MixerInstance = new Player::Mixer();
 
@@ -249,13 +261,76 @@ void StopDetachIfNotUsedSafe() {
 	});
 }
 
+uint16 CountSamplesPeak(gsl::span<const uchar> samples) {
+	auto peak = uint16(0);
+	auto data = samples.data();
+	auto count = samples.size();
+#ifdef TDESKTOP_AUDIO_USE_SSE2
+	constexpr auto kBlockSize = 16;
+	if (count >= kBlockSize) {
+		auto center = _mm_set1_epi8(char(0x80));
+		auto accumulated = _mm_setzero_si128();
+		for (; count >= kBlockSize; count -= kBlockSize, data += kBlockSize) {
+			auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			auto difference = _mm_max_epu8(
+				_mm_subs_epu8(value, center),
+				_mm_subs_epu8(center, value));
+			accumulated = _mm_max_epu8(accumulated, difference);
+		}
+		uchar lanes[kBlockSize];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), accumulated);
+		for (auto lane : lanes) {
+			accumulate_max(peak, uint16(lane));
+		}
+		peak *= 0x100;
+	}
+#endif // TDESKTOP_AUDIO_USE_SSE2
+	for (; count != 0; --count, ++data) {
+		accumulate_max(peak, ReadOneSample(*data));
+	}
+	return peak;
+}
+
+uint16 CountSamplesPeak(gsl::span<const int16> samples) {
+	auto peak = uint16(0);
+	auto data = samples.data();
+	auto count = samples.size();
+#ifdef TDESKTOP_AUDIO_USE_SSE2
+	constexpr auto kBlockSize = 8;
+	if (count >= kBlockSize) {
+		// There is no unsigned 16 bit max in SSE2, so the absolute
+		// values are biased by 0x8000 and compared as signed ones.
+		auto zero = _mm_setzero_si128();
+		auto bias = _mm_set1_epi16(int16(0x8000));
+		auto accumulated = bias;
+		for (; count >= kBlockSize; count -= kBlockSize, data += kBlockSize) {
+			auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			auto absolute = _mm_max_epi16(value, _mm_sub_epi16(zero, value));
+			accumulated = _mm_max_epi16(
+				accumulated,
+				_mm_xor_si128(absolute, bias));
+		}
+		accumulated = _mm_xor_si128(accumulated, bias);
+		uint16 lanes[kBlockSize];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), accumulated);
+		for (auto lane : lanes) {
+			accumulate_max(peak, lane);
+		}
+	}
+#endif // TDESKTOP_AUDIO_USE_SSE2
+	for (; count != 0; --count, ++data) {
+		accumulate_max(peak, ReadOneSample(*data));
+	}
+	return peak;
+}
+
 } // namespace Audio
 
 namespace Player {
 namespace {
 
 constexpr auto kVolumeRound = 10000;
-constexpr auto kPreloadSamples = 2LL * kDefaultFrequency; // preload next part if less than 2 seconds remains
+constexpr auto kPreloadSamples = 5LL * kDefaultFrequency; // low-water mark, refill the decode-ahead ring if less than 5 seconds remain
 constexpr auto kFadeDuration = TimeMs(500);
 constexpr auto kCheckPlaybackPositionTimeout = TimeMs(100); // 100ms per check audio position
 constexpr auto kCheckPlaybackPositionDelta = 2400LL; // update position called each 2400 samples
@@ -357,6 +432,9 @@ void Mixer::Track::clear() {
 	videoData = nullptr;
 	lastUpdateWhen = 0;
 	lastUpdateCorrectedMs = 0;
+
+	refillRequestedAt = 0;
+	underrunReported = false;
 }
 
 void Mixer::Track::started() {
@@ -367,6 +445,9 @@ void Mixer::Track::started() {
 	loaded = false;
 	fadeStartPosition = 0;
 
+	refillRequestedAt = 0;
+	underrunReported = false;
+
 	format = 0;
 	frequency = kDefaultFrequency;
 	for (auto i = 0; i != kBuffersCount; ++i) {
@@ -457,6 +538,7 @@ Mixer::Mixer()
 		QMetaObject::invokeMethod(_fader, "onVideoVolumeChanged");
 	});
 	connect(this, SIGNAL(loaderOnStart(const AudioMsgId&, qint64)), _loader, SLOT(onStart(const AudioMsgId&, qint64)));
+	connect(this, SIGNAL(loaderOnPrepare(const AudioMsgId&, const FileLocation&, const QByteArray&)), _loader, SLOT(onPrepare(const AudioMsgId&, const FileLocation&, const QByteArray&)));
 	connect(this, SIGNAL(loaderOnCancel(const AudioMsgId&)), _loader, SLOT(onCancel(const AudioMsgId&)));
 	connect(_loader, SIGNAL(needToCheck()), _fader, SLOT(onTimer()));
 	connect(_loader, SIGNAL(error(const AudioMsgId&)), this, SLOT(onError(const AudioMsgId&)));
@@ -720,6 +802,20 @@ void Mixer::play(
 	}
 }
 
+void Mixer::prepareNext(const AudioMsgId &audio) {
+	Expects(audio.type() == AudioMsgId::Type::Song);
+
+	if (!audio.audio()) {
+		return;
+	}
+	const auto file = audio.audio()->location(true);
+	const auto data = audio.audio()->data();
+	if (file.isEmpty() && data.isEmpty()) {
+		return;
+	}
+	emit loaderOnPrepare(audio, file, data);
+}
+
 void Mixer::feedFromVideo(VideoSoundPart &&part) {
 	_loader->feedFromVideo(std::move(part));
 }
@@ -1023,6 +1119,22 @@ TrackState Mixer::currentState(AudioMsgId::Type type) {
 	return current->state;
 }
 
+PlaybackTelemetry Mixer::telemetry(AudioMsgId::Type type) {
+	QMutexLocker lock(&AudioMutex);
+	auto result = PlaybackTelemetry();
+	const auto count = (type == AudioMsgId::Type::Video)
+		? 1
+		: int(kTogetherLimit);
+	for (auto index = 0; index != count; ++index) {
+		const auto track = trackForType(type, index);
+		result.underruns += track->underruns;
+		result.refills += track->refills;
+		result.refillLatencyTotal += track->refillLatencyTotal;
+		accumulate_max(result.refillLatencyMax, track->refillLatencyMax);
+	}
+	return result;
+}
+
 void Mixer::setStoppedState(Track *current, State state) {
 	current->state.state = state;
 	current->state.position = 0;
@@ -1225,6 +1337,18 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 	} break;
 	}
 
+	if (state == AL_PLAYING) {
+		track->underrunReported = false;
+	} else if ((playing || fading) && track->loading && !track->loaded) {
+		// The source ran out of queued buffers while the loader was
+		// still refilling them - this is the audible dropout we count.
+		if (!track->underrunReported) {
+			track->underrunReported = true;
+			++track->underruns;
+			DEBUG_LOG(("Audio Info: Playback underrun %1, refill requested %2ms ago, buffered %3 samples.").arg(track->underruns).arg(track->refillRequestedAt ? (getms() - track->refillRequestedAt) : 0).arg(track->bufferedLength));
+		}
+	}
+
 	auto fullPosition = track->bufferedPosition + positionInBuffered;
 	if (state != AL_PLAYING && !track->loading) {
 		if (fading || playing) {
@@ -1287,6 +1411,7 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 			auto needPreload = (track->state.position + kPreloadSamples > track->bufferedPosition + track->bufferedLength);
 			if (needPreload) {
 				track->loading = true;
+				track->refillRequestedAt = getms();
 				emitSignals |= EmitNeedToPreload;
 			}
 		}
@@ -1541,14 +1666,8 @@ public:
 
 		auto fmt = format();
 		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
-				peaks.push_back(peak);
-				peak = 0;
-			}
+		auto emitPeak = [&](uint16 value) {
+			peaks.push_back(value);
 		};
 		while (processed < countbytes) {
 			buffer.resize(0);
@@ -1564,9 +1683,9 @@ public:
 
 			auto sampleBytes = gsl::as_bytes(gsl::make_span(buffer));
 			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
+				Media::Audio::CollectPeaks<uchar>(sampleBytes, sumbytes, Media::Player::kWaveformSamplesCount, countbytes, peak, emitPeak);
 			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+				Media::Audio::CollectPeaks<int16>(sampleBytes, sumbytes, Media::Player::kWaveformSamplesCount, countbytes, peak, emitPeak);
 			}
 			processed += sampleSize() * samples;
 		}
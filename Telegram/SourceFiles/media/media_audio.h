@@ -102,6 +102,15 @@ struct TrackState {
 	int frequency = kDefaultFrequency;
 };
 
+// Cumulative playback diagnostics for one track type,
+// see Mixer::telemetry().
+struct PlaybackTelemetry {
+	int underruns = 0;
+	int refills = 0;
+	TimeMs refillLatencyTotal = 0;
+	TimeMs refillLatencyMax = 0;
+};
+
 class Mixer : public QObject, private base::Subscriber {
 	Q_OBJECT
 
@@ -110,6 +119,11 @@ public:
 
 	void play(const AudioMsgId &audio, TimeMs positionMs = 0);
 	void play(const AudioMsgId &audio, std::unique_ptr<VideoSoundData> videoData, TimeMs positionMs = 0);
+
+	// Thread: Main. Pre-opens the decoder of the next playlist track
+	// and decodes its first samples, so that when the current track
+	// ends the switch to the next one happens without an audible gap.
+	void prepareNext(const AudioMsgId &audio);
 	void pause(const AudioMsgId &audio, bool fast = false);
 	void resume(const AudioMsgId &audio, bool fast = false);
 	void seek(AudioMsgId::Type type, TimeMs positionMs); // type == AudioMsgId::Type::Song
@@ -124,6 +138,10 @@ public:
 
 	TrackState currentState(AudioMsgId::Type type);
 
+	// Thread: Any. Counters for diagnosing audible dropouts,
+	// accumulated since the application start.
+	PlaybackTelemetry telemetry(AudioMsgId::Type type);
+
 	void clearStoppedAtStart(const AudioMsgId &audio);
 
 	// Thread: Main. Must be locked: AudioMutex.
@@ -153,6 +171,7 @@ signals:
 	void updated(const AudioMsgId &audio);
 	void stoppedOnError(const AudioMsgId &audio);
 	void loaderOnStart(const AudioMsgId &audio, qint64 positionMs);
+	void loaderOnPrepare(const AudioMsgId &audio, const FileLocation &file, const QByteArray &data);
 	void loaderOnCancel(const AudioMsgId &audio);
 
 	void faderOnTimer();
@@ -170,7 +189,9 @@ private:
 
 	class Track {
 	public:
-		static constexpr int kBuffersCount = 3;
+		// Decode-ahead ring, enough buffers for 10-20 seconds of
+		// playback, so short CPU spikes don't drain the queue.
+		static constexpr int kBuffersCount = 8;
 
 		// Thread: Any. Must be locked: AudioMutex.
 		void reattach(AudioMsgId::Type type);
@@ -211,6 +232,15 @@ private:
 		TimeMs lastUpdateWhen = 0;
 		TimeMs lastUpdateCorrectedMs = 0;
 
+		// Telemetry, the counters survive clear() on purpose,
+		// they are accumulated in Mixer::telemetry().
+		TimeMs refillRequestedAt = 0;
+		bool underrunReported = false;
+		int underruns = 0;
+		int refills = 0;
+		TimeMs refillLatencyTotal = 0;
+		TimeMs refillLatencyMax = 0;
+
 	private:
 		void createStream();
 		void destroyStream();
@@ -341,5 +371,43 @@ void IterateSamples(base::const_byte_span bytes, Callback &&callback) {
 	}
 }
 
+// The peak value of ReadOneSample() over a range of samples,
+// uses SSE2 on x86 instead of the per-sample loop.
+uint16 CountSamplesPeak(gsl::span<const uchar> samples);
+uint16 CountSamplesPeak(gsl::span<const int16> samples);
+
+// Collects sample peaks the way the waveform counters do: `advance`
+// is added to `accumulated` for each sample and every time it reaches
+// `period` the peak gathered so far is emitted and started over.
+// Internally the samples are processed in whole-peak spans through
+// the vectorized CountSamplesPeak().
+template <typename SampleType, typename Emit>
+void CollectPeaks(
+		base::const_byte_span bytes,
+		int64 &accumulated,
+		int64 advance,
+		int64 period,
+		uint16 &peak,
+		Emit &&emit) {
+	Expects(advance > 0 && period > 0);
+
+	auto samplesPointer = reinterpret_cast<const SampleType*>(bytes.data());
+	auto samplesCount = int64(bytes.size() / sizeof(SampleType));
+	auto samples = gsl::make_span(samplesPointer, samplesCount);
+	auto from = int64(0);
+	while (from != samplesCount) {
+		auto till = (period - accumulated + advance - 1) / advance;
+		auto take = qMin(samplesCount - from, till);
+		accumulate_max(peak, CountSamplesPeak(samples.subspan(from, take)));
+		accumulated += take * advance;
+		from += take;
+		if (accumulated >= period) {
+			accumulated -= period;
+			emit(peak);
+			peak = 0;
+		}
+	}
+}
+
 } // namespace Audio
 } // namespace Media
@@ -59,14 +59,25 @@ Instance::Instance() : _inner(new Inner(&_thread)) {
 }
 
 void Instance::check() {
+	// Opening and closing a real capture device just to see that it
+	// works can block for a long time, so run the probe on a worker
+	// thread and write the result back on the main thread.
 	_available = false;
-	if (auto defaultDevice = alcGetString(0, ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER)) {
-		if (auto device = alcCaptureOpenDevice(defaultDevice, kCaptureFrequency, AL_FORMAT_MONO16, kCaptureFrequency / 5)) {
-			auto error = ErrorHappened(device);
-			alcCaptureCloseDevice(device);
-			_available = !error;
+	crl::async([] {
+		auto available = false;
+		if (auto defaultDevice = alcGetString(0, ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER)) {
+			if (auto device = alcCaptureOpenDevice(defaultDevice, kCaptureFrequency, AL_FORMAT_MONO16, kCaptureFrequency / 5)) {
+				auto error = ErrorHappened(device);
+				alcCaptureCloseDevice(device);
+				available = !error;
+			}
 		}
-	}
+		crl::on_main([=] {
+			if (auto instance = Capture::instance()) {
+				instance->_available = available;
+			}
+		});
+	});
 }
 
 Instance::~Instance() {
@@ -31,7 +31,7 @@ public:
 		EndOfFile,
 	};
 	virtual ReadResult readMore(QByteArray &samples, int64 &samplesCount) = 0;
-	virtual void enqueuePackets(QQueue<FFMpeg::AVPacketDataWrap> &packets) {
+	virtual void enqueuePackets(std::vector<FFMpeg::AVPacketDataWrap> &packets) {
 		Unexpected("enqueuePackets() call on not ChildFFMpegLoader.");
 	}
 
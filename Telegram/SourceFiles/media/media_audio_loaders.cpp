@@ -25,7 +25,13 @@ void Loaders::feedFromVideo(VideoSoundPart &&part) {
 	auto invoke = false;
 	{
 		QMutexLocker lock(&_fromVideoMutex);
-		_fromVideoQueues[part.audio].enqueue(FFMpeg::dataWrapFromPacket(*part.packet));
+		auto i = _fromVideoQueues.find(part.audio);
+		if (i == _fromVideoQueues.end()) {
+			i = _fromVideoQueues.insert(
+				part.audio,
+				takeFromVideoQueuesPool());
+		}
+		i->push_back(FFMpeg::dataWrapFromPacket(*part.packet));
 		invoke = true;
 	}
 	if (invoke) {
@@ -33,6 +39,24 @@ void Loaders::feedFromVideo(VideoSoundPart &&part) {
 	}
 }
 
+std::vector<FFMpeg::AVPacketDataWrap> Loaders::takeFromVideoQueuesPool() {
+	if (_fromVideoQueuesPool.empty()) {
+		return {};
+	}
+	auto result = std::move(_fromVideoQueuesPool.back());
+	_fromVideoQueuesPool.pop_back();
+	return result;
+}
+
+void Loaders::returnToVideoQueuesPool(std::vector<FFMpeg::AVPacketDataWrap> &&batch) {
+	constexpr auto kMaxPooledBatches = 4;
+	batch.clear();
+	if (batch.capacity() > 0
+		&& _fromVideoQueuesPool.size() < kMaxPooledBatches) {
+		_fromVideoQueuesPool.push_back(std::move(batch));
+	}
+}
+
 void Loaders::videoSoundAdded() {
 	auto waitingAndAdded = false;
 	auto queues = decltype(_fromVideoQueues)();
@@ -61,6 +85,13 @@ void Loaders::videoSoundAdded() {
 			}
 		}
 	}
+	{
+		// Keep the emptied batch vectors for the next packets.
+		QMutexLocker lock(&_fromVideoMutex);
+		for (auto &queue : queues) {
+			returnToVideoQueuesPool(std::move(queue));
+		}
+	}
 	if (waitingAndAdded) {
 		onLoad(_video);
 	}
@@ -101,6 +132,43 @@ void Loaders::onStart(const AudioMsgId &audio, qint64 positionMs) {
 	loadData(audio, positionMs);
 }
 
+void Loaders::onPrepare(
+		const AudioMsgId &audio,
+		const FileLocation &file,
+		const QByteArray &data) {
+	if (audio.type() != AudioMsgId::Type::Song || audio.playId()) {
+		return;
+	} else if (audio == _song || audio == _songPrepared) {
+		return;
+	}
+	auto loader = std::make_unique<FFMpegLoader>(
+		file,
+		data,
+		base::byte_vector());
+	if (!loader->open(0) || loader->samplesCount() <= 0) {
+		return;
+	}
+
+	// Decode the first buffer right away, loadData() will pick it up
+	// from the saved samples when the track actually starts playing.
+	QByteArray samples;
+	int64 samplesCount = 0;
+	while (samples.size() < AudioVoiceMsgBufferSize) {
+		auto res = loader->readMore(samples, samplesCount);
+		using Result = AudioPlayerLoader::ReadResult;
+		if (res == Result::Error) {
+			return;
+		} else if (res == Result::EndOfFile || res == Result::Wait) {
+			break;
+		}
+	}
+	if (samplesCount > 0) {
+		loader->saveDecodedSamples(&samples, &samplesCount);
+	}
+	_songPrepared = audio;
+	_songPreparedLoader = std::move(loader);
+}
+
 AudioMsgId Loaders::clear(AudioMsgId::Type type) {
 	AudioMsgId result;
 	switch (type) {
@@ -233,6 +301,16 @@ void Loaders::loadData(AudioMsgId audio, TimeMs positionMs) {
 			emitError(type);
 			return;
 		}
+
+		if (track->refillRequestedAt) {
+			// Telemetry for the fader-requested refills,
+			// see Mixer::telemetry().
+			const auto latency = getms() - track->refillRequestedAt;
+			track->refillRequestedAt = 0;
+			++track->refills;
+			track->refillLatencyTotal += latency;
+			accumulate_max(track->refillLatencyMax, latency);
+		}
 	} else {
 		if (waiting) {
 			return;
@@ -316,6 +394,7 @@ AudioPlayerLoader *Loaders::setupLoader(
 		case AudioMsgId::Type::Video: _video = audio; loader = &_videoLoader; break;
 		}
 
+		auto alreadyOpened = false;
 		if (audio.playId()) {
 			if (!track->videoData) {
 				clear(audio.type());
@@ -325,12 +404,21 @@ AudioPlayerLoader *Loaders::setupLoader(
 				return nullptr;
 			}
 			*loader = std::make_unique<ChildFFMpegLoader>(std::move(track->videoData));
+		} else if (!positionMs
+			&& audio == _songPrepared
+			&& _songPreparedLoader
+			&& _songPreparedLoader->check(track->file, track->data)) {
+			// The decoder of this track was opened in advance by
+			// onPrepare(), adopt it instead of opening a new one.
+			*loader = std::move(_songPreparedLoader);
+			_songPrepared = AudioMsgId();
+			alreadyOpened = true;
 		} else {
 			*loader = std::make_unique<FFMpegLoader>(track->file, track->data, base::byte_vector());
 		}
 		l = loader->get();
 
-		if (!l->open(positionMs)) {
+		if (!alreadyOpened && !l->open(positionMs)) {
 			track->state.state = State::StoppedAtStart;
 			return nullptr;
 		}
@@ -374,7 +462,13 @@ Mixer::Track *Loaders::checkLoader(AudioMsgId::Type type) {
 void Loaders::onCancel(const AudioMsgId &audio) {
 	switch (audio.type()) {
 	case AudioMsgId::Type::Voice: if (_audio == audio) clear(audio.type()); break;
-	case AudioMsgId::Type::Song: if (_song == audio) clear(audio.type()); break;
+	case AudioMsgId::Type::Song:
+		if (_song == audio) clear(audio.type());
+		if (_songPrepared == audio) {
+			_songPrepared = AudioMsgId();
+			_songPreparedLoader = nullptr;
+		}
+		break;
 	case AudioMsgId::Type::Video: if (_video == audio) clear(audio.type()); break;
 	}
 
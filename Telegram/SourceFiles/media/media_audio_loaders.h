@@ -33,6 +33,7 @@ signals:
 	void onInit();
 
 	void onStart(const AudioMsgId &audio, qint64 positionMs);
+	void onPrepare(const AudioMsgId &audio, const FileLocation &file, const QByteArray &data);
 	void onLoad(const AudioMsgId &audio);
 	void onCancel(const AudioMsgId &audio);
 
@@ -45,10 +46,23 @@ private:
 	std::unique_ptr<AudioPlayerLoader> _songLoader;
 	std::unique_ptr<AudioPlayerLoader> _videoLoader;
 
+	// The next track of the Song playlist with its decoder already
+	// opened and the first samples decoded, so that the switch to it
+	// happens without an audible gap.
+	AudioMsgId _songPrepared;
+	std::unique_ptr<AudioPlayerLoader> _songPreparedLoader;
+
 	QMutex _fromVideoMutex;
-	QMap<AudioMsgId, QQueue<FFMpeg::AVPacketDataWrap>> _fromVideoQueues;
+	QMap<AudioMsgId, std::vector<FFMpeg::AVPacketDataWrap>> _fromVideoQueues;
+
+	// Emptied batch vectors are returned here to be reused with their
+	// grown capacity, so long playback doesn't allocate per packet.
+	std::vector<std::vector<FFMpeg::AVPacketDataWrap>> _fromVideoQueuesPool;
 	SingleQueuedInvokation _fromVideoNotify;
 
+	std::vector<FFMpeg::AVPacketDataWrap> takeFromVideoQueuesPool();
+	void returnToVideoQueuesPool(std::vector<FFMpeg::AVPacketDataWrap> &&batch);
+
 	void emitError(AudioMsgId::Type type);
 	AudioMsgId clear(AudioMsgId::Type type);
 	void setStoppedState(Mixer::Track *m, State state = State::Stopped);
@@ -60,12 +60,13 @@ AudioPlayerLoader::ReadResult ChildFFMpegLoader::readMore(
 		return readResult;
 	}
 
-	if (_queue.isEmpty()) {
+	if (_queue.empty()) {
 		return _eofReached ? ReadResult::EndOfFile : ReadResult::Wait;
 	}
 
 	AVPacket packet;
-	FFMpeg::packetFromDataWrap(packet, _queue.dequeue());
+	FFMpeg::packetFromDataWrap(packet, _queue.front());
+	_queue.pop_front();
 
 	_eofReached = FFMpeg::isNullPacket(packet);
 	if (_eofReached) {
@@ -90,8 +91,8 @@ AudioPlayerLoader::ReadResult ChildFFMpegLoader::readMore(
 	return ReadResult::Ok;
 }
 
-void ChildFFMpegLoader::enqueuePackets(QQueue<FFMpeg::AVPacketDataWrap> &packets) {
-	_queue += std::move(packets);
+void ChildFFMpegLoader::enqueuePackets(std::vector<FFMpeg::AVPacketDataWrap> &packets) {
+	_queue.insert(_queue.end(), packets.begin(), packets.end());
 	packets.clear();
 }
 
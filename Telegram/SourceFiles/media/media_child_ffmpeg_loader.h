@@ -9,6 +9,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/media_audio_ffmpeg_loader.h"
 
+#include <deque>
+
 struct VideoSoundData {
 	AVCodecContext *context = nullptr;
 	int32 frequency = Media::Player::kDefaultFrequency;
@@ -69,7 +71,7 @@ public:
 	}
 
 	ReadResult readMore(QByteArray &result, int64 &samplesAdded) override;
-	void enqueuePackets(QQueue<FFMpeg::AVPacketDataWrap> &packets) override;
+	void enqueuePackets(std::vector<FFMpeg::AVPacketDataWrap> &packets) override;
 
 	bool eofReached() const {
 		return _eofReached;
@@ -79,7 +81,10 @@ public:
 
 private:
 	std::unique_ptr<VideoSoundData> _parentData;
-	QQueue<FFMpeg::AVPacketDataWrap> _queue;
+
+	// A deque instead of QQueue, so that batches of packets are
+	// inserted without a separate heap allocation for each of them.
+	std::deque<FFMpeg::AVPacketDataWrap> _queue;
 	bool _eofReached = false;
 
 };
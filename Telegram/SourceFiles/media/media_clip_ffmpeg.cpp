@@ -19,6 +19,14 @@ namespace {
 constexpr int kSkipInvalidDataPackets = 10;
 constexpr int kAlignImageBy = 16;
 
+// While streaming a partially downloaded file require that much data
+// after the current read position before decoding further, so that the
+// demuxer doesn't hit the not yet downloaded part in the middle of a
+// frame. The margin is the maximum of this byte count and the average
+// byte rate of the file multiplied by the read ahead duration.
+constexpr auto kStreamedReadAhead = int64(512 * 1024);
+constexpr auto kStreamedReadAheadMs = TimeMs(2000);
+
 void alignedImageBufferCleanupHandler(void *data) {
 	auto buffer = static_cast<uchar*>(data);
 	delete[] buffer;
@@ -61,12 +69,22 @@ ReaderImplementation::ReadResult FFMpegReaderImplementation::readNextFrame() {
 	do {
 		int res = avcodec_receive_frame(_codecContext, _frame);
 		if (res >= 0) {
+			if (_hwPixelFormat != AV_PIX_FMT_NONE
+				&& _frame->format == _hwPixelFormat
+				&& !downloadHwFrame()) {
+				return ReadResult::Error;
+			}
 			processReadFrame();
 			return ReadResult::Success;
 		}
 
 		if (res == AVERROR_EOF) {
 			clearPacketQueue();
+			if (streamedIncomplete()) {
+				// That is not a real end of file, just the end of the
+				// downloaded part, recover and wait for more data.
+				return recoverAfterStreamedEof();
+			}
 			if (_mode == Mode::Normal) {
 				return ReadResult::EndOfFile;
 			}
@@ -157,7 +175,77 @@ void FFMpegReaderImplementation::processReadFrame() {
 	_frameTime += _currentFrameDelay;
 }
 
+void FFMpegReaderImplementation::createHwDeviceContext() {
+#if defined Q_OS_WIN
+	const auto type = AV_HWDEVICE_TYPE_DXVA2;
+	const auto format = AV_PIX_FMT_DXVA2_VLD;
+#elif defined Q_OS_MAC // Q_OS_WIN
+	const auto type = AV_HWDEVICE_TYPE_VIDEOTOOLBOX;
+	const auto format = AV_PIX_FMT_VIDEOTOOLBOX;
+#else // Q_OS_WIN || Q_OS_MAC
+	const auto type = AV_HWDEVICE_TYPE_VAAPI;
+	const auto format = AV_PIX_FMT_VAAPI;
+#endif // !Q_OS_WIN && !Q_OS_MAC
+	int res = 0;
+	if ((res = av_hwdevice_ctx_create(&_hwDeviceContext, type, nullptr, nullptr, 0)) < 0) {
+		// No hardware decoding device, decode in software as before.
+		_hwDeviceContext = nullptr;
+		return;
+	}
+	_hwPixelFormat = format;
+	_codecContext->opaque = static_cast<void*>(this);
+	_codecContext->get_format = _getFormat;
+	_codecContext->hw_device_ctx = av_buffer_ref(_hwDeviceContext);
+}
+
+bool FFMpegReaderImplementation::downloadHwFrame() {
+	// Copy the decoded frame from the hardware surface to a software
+	// frame together with the timing fields, so the code after this
+	// point doesn't see the difference from a software decoded frame.
+	auto transferred = av_frame_alloc();
+	int res = 0;
+	if ((res = av_hwframe_transfer_data(transferred, _frame, 0)) < 0) {
+		char err[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+		LOG(("Gif Error: Unable to av_hwframe_transfer_data %1, error %2, %3").arg(logData()).arg(res).arg(av_make_error_string(err, sizeof(err), res)));
+		av_frame_free(&transferred);
+		return false;
+	}
+	av_frame_copy_props(transferred, _frame);
+	av_frame_unref(_frame);
+	av_frame_move_ref(_frame, transferred);
+	av_frame_free(&transferred);
+	return true;
+}
+
+bool FFMpegReaderImplementation::enoughStreamedData() const {
+	if (!streamedIncomplete()) {
+		return true;
+	}
+	const auto duration = durationMs();
+	const auto readAhead = (duration > 0)
+		? qMax(kStreamedReadAhead, (_dataSize * kStreamedReadAheadMs) / duration)
+		: kStreamedReadAhead;
+	return (_streamedAvailableSize >= _device->pos() + readAhead);
+}
+
+ReaderImplementation::ReadResult FFMpegReaderImplementation::recoverAfterStreamedEof() {
+	// The custom AVIOContext remembers that it got a zero length read
+	// and keeps reporting the end of file, reset it and re-enter the
+	// stream at the current position keyframe when the data arrives.
+	_ioContext->eof_reached = 0;
+	_ioContext->error = 0;
+
+	const auto timeBase = _fmtContext->streams[_streamId]->time_base;
+	const auto timeStamp = (_frameMs * timeBase.den) / (1000LL * timeBase.num);
+	av_seek_frame(_fmtContext, _streamId, timeStamp, AVSEEK_FLAG_BACKWARD);
+	avcodec_flush_buffers(_codecContext);
+	return ReadResult::Buffering;
+}
+
 ReaderImplementation::ReadResult FFMpegReaderImplementation::readFramesTill(TimeMs frameMs, TimeMs systemMs) {
+	if (!enoughStreamedData()) {
+		return ReadResult::Buffering;
+	}
 	if (_audioStreamId < 0) { // just keep up
 		if (_frameRead && _frameTime > frameMs) {
 			return ReadResult::Success;
@@ -259,7 +347,8 @@ bool FFMpegReaderImplementation::renderFrame(QImage &to, bool &hasAlpha, const Q
 	// Read some future packets for audio stream.
 	if (_audioStreamId >= 0) {
 		while (_frameMs + 5000 > _lastReadAudioMs
-			&& _frameMs + 15000 > _lastReadVideoMs) {
+			&& _frameMs + 15000 > _lastReadVideoMs
+			&& enoughStreamedData()) {
 			auto packetResult = readAndProcessPacket();
 			if (packetResult != PacketResult::Ok) {
 				break;
@@ -351,6 +440,13 @@ bool FFMpegReaderImplementation::start(Mode mode, TimeMs &positionMs) {
 		_audioStreamId = -1;
 	}
 
+	if (_mode != Mode::Inspecting) {
+		// Try to decode through the hardware, Inspecting mode reads
+		// a single frame from many files at once and a hardware device
+		// has a limited number of decoding sessions.
+		createHwDeviceContext();
+	}
+
 	if ((res = avcodec_open2(_codecContext, _codec, 0)) < 0) {
 		LOG(("Gif Error: Unable to avcodec_open2 %1, error %2, %3").arg(logData()).arg(res).arg(av_make_error_string(err, sizeof(err), res)));
 		return false;
@@ -424,6 +520,10 @@ bool FFMpegReaderImplementation::inspectAt(TimeMs &positionMs) {
 				return false;
 			}
 		}
+
+		// Drop the frames decoded before the seek, so that the next
+		// readFramesTill() returns the keyframe we've just seeked to.
+		avcodec_flush_buffers(_codecContext);
 	}
 
 	_packetQueue.clear();
@@ -466,6 +566,7 @@ FFMpegReaderImplementation::~FFMpegReaderImplementation() {
 		_frameRead = false;
 	}
 	if (_codecContext) avcodec_free_context(&_codecContext);
+	if (_hwDeviceContext) av_buffer_unref(&_hwDeviceContext);
 	if (_swsContext) sws_freeContext(_swsContext);
 	if (_opened) {
 		avformat_close_input(&_fmtContext);
@@ -488,7 +589,7 @@ FFMpegReaderImplementation::PacketResult FFMpegReaderImplementation::readPacket(
 	int res = 0;
 	if ((res = av_read_frame(_fmtContext, packet)) < 0) {
 		if (res == AVERROR_EOF) {
-			if (_audioStreamId >= 0) {
+			if (_audioStreamId >= 0 && !streamedIncomplete()) {
 				// queue terminating packet to audio player
 				VideoSoundPart part;
 				part.packet = &_packetNull;
@@ -575,9 +676,32 @@ void FFMpegReaderImplementation::clearPacketQueue() {
 
 int FFMpegReaderImplementation::_read(void *opaque, uint8_t *buf, int buf_size) {
 	FFMpegReaderImplementation *l = reinterpret_cast<FFMpegReaderImplementation*>(opaque);
+	if (l->streamedIncomplete()) {
+		// Don't read the preallocated but not yet downloaded part of
+		// the file, it is filled with zeros, not the file content.
+		const auto available = l->_streamedAvailableSize - l->_device->pos();
+		if (available <= 0) {
+			return 0;
+		}
+		accumulate_min(buf_size, int(qMin(available, int64(buf_size))));
+	}
 	return int(l->_device->read((char*)(buf), buf_size));
 }
 
+AVPixelFormat FFMpegReaderImplementation::_getFormat(AVCodecContext *context, const AVPixelFormat *formats) {
+	FFMpegReaderImplementation *l = reinterpret_cast<FFMpegReaderImplementation*>(context->opaque);
+	for (auto format = formats; *format != AV_PIX_FMT_NONE; ++format) {
+		if (*format == l->_hwPixelFormat) {
+			return *format;
+		}
+	}
+
+	// The stream can't be decoded through our hardware device,
+	// let the decoder choose a software format by itself.
+	l->_hwPixelFormat = AV_PIX_FMT_NONE;
+	return avcodec_default_get_format(context, formats);
+}
+
 int64_t FFMpegReaderImplementation::_seek(void *opaque, int64_t offset, int whence) {
 	FFMpegReaderImplementation *l = reinterpret_cast<FFMpegReaderImplementation*>(opaque);
 
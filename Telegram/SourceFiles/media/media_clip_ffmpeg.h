@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 extern "C" {
 
+#include <libavutil/hwcontext.h>
 #include <libswscale/swscale.h>
 
 } // extern "C"
@@ -39,6 +40,10 @@ public:
 	bool start(Mode mode, TimeMs &positionMs) override;
 	bool inspectAt(TimeMs &positionMs);
 
+	void setStreamedAvailable(int64 availableSize) override {
+		_streamedAvailableSize = availableSize;
+	}
+
 	QString logData() const;
 
 	bool isGifv() const;
@@ -48,6 +53,14 @@ public:
 private:
 	ReadResult readNextFrame();
 	void processReadFrame();
+	void createHwDeviceContext();
+	bool downloadHwFrame();
+
+	bool streamedIncomplete() const {
+		return (_streamedAvailableSize > 0) && (_streamedAvailableSize < _dataSize);
+	}
+	bool enoughStreamedData() const;
+	ReadResult recoverAfterStreamedEof();
 
 	enum class PacketResult {
 		Ok,
@@ -76,16 +89,21 @@ private:
 
 	static int _read(void *opaque, uint8_t *buf, int buf_size);
 	static int64_t _seek(void *opaque, int64_t offset, int whence);
+	static AVPixelFormat _getFormat(AVCodecContext *context, const AVPixelFormat *formats);
 
 	Mode _mode = Mode::Normal;
 
 	Rotation _rotation = Rotation::None;
 
+	int64 _streamedAvailableSize = 0; // 0 means the whole file is here
+
 	uchar *_ioBuffer = nullptr;
 	AVIOContext *_ioContext = nullptr;
 	AVFormatContext *_fmtContext = nullptr;
 	AVCodec *_codec = nullptr;
 	AVCodecContext *_codecContext = nullptr;
+	AVBufferRef *_hwDeviceContext = nullptr;
+	AVPixelFormat _hwPixelFormat = AV_PIX_FMT_NONE;
 	int _streamId = 0;
 	AVFrame *_frame = nullptr;
 	bool _opened = false;
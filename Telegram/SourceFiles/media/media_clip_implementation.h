@@ -29,6 +29,7 @@ public:
 		Success,
 		Error,
 		EndOfFile,
+		Buffering, // Streaming and the downloaded part has run out.
 	};
 	// Read frames till current frame will have presentation time > frameMs, systemMs = getms().
 	virtual ReadResult readFramesTill(TimeMs frameMs, TimeMs systemMs) = 0;
@@ -45,6 +46,11 @@ public:
 
 	virtual bool start(Mode mode, TimeMs &positionMs) = 0;
 
+	// The file is still being downloaded, only availableSize bytes of
+	// the sequential prefix are valid, the rest is preallocated zeros.
+	virtual void setStreamedAvailable(int64 availableSize) {
+	}
+
 	virtual ~ReaderImplementation() {
 	}
 	int64 dataSize() const {
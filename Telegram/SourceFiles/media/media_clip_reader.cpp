@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/media_clip_qtgif.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
+#include "core/tracing.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -28,6 +29,18 @@ namespace {
 QVector<QThread*> threads;
 QVector<Manager*> managers;
 
+// Memory budget for the decoded frames cache of one looping clip,
+// if a whole loop doesn't fit the clip is just decoded again.
+constexpr auto kMaxFrameCacheSize = int64(10 * 1024 * 1024);
+
+// Don't replay cached frames faster than this, see the "keep up"
+// logic in FFMpegReaderImplementation::readFramesTill().
+constexpr auto kMinCachedFrameDelay = TimeMs(5);
+
+// While a streamed playback waits for the download to catch up
+// poll the implementation for new data this often.
+constexpr auto kStreamedBufferingDelay = TimeMs(100);
+
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
 	auto needOuterFill = (request.outerw != request.framew) || (request.outerh != request.frameh);
@@ -87,30 +100,45 @@ Reader::Reader(const QString &filepath, Callback &&callback, Mode mode, int64 se
 	init(FileLocation(filepath), QByteArray());
 }
 
-Reader::Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode, int64 seekMs)
+Reader::Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode, int64 seekMs, int64 streamedSize)
 : _callback(std::move(callback))
 , _mode(mode)
 , _audioMsgId(document, msgId, (mode == Mode::Video) ? rand_value<uint32>() : 0)
 , _seekPositionMs(seekMs) {
-	init(document->location(), document->data());
+	if (streamedSize > 0) {
+		// The document is still being downloaded, play the growing
+		// file, only streamedSize bytes of the prefix are valid so far.
+		_streamedSize.storeRelease(streamedSize);
+		init(FileLocation(document->loadingFilePath()), QByteArray());
+	} else {
+		init(document->location(), document->data());
+	}
 }
 
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	// Don't spawn more decode threads than there are cores, on small
+	// machines extra threads only add contention between the clips.
+	const auto threadsCount = qMax(
+		1,
+		qMin(int(ClipThreadsCount), QThread::idealThreadCount()));
+
+	// Prefer an existing idle manager to spawning another dedicated
+	// thread, so that a burst of clips doesn't leave the full set of
+	// decode threads idling around for the rest of the session.
+	_threadIndex = -1;
+	int32 loadLevel = 0x7FFFFFFF;
+	for (int32 i = 0, l = threads.size(); i < l; ++i) {
+		int32 level = managers.at(i)->loadLevel();
+		if (level < loadLevel) {
+			_threadIndex = i;
+			loadLevel = level;
+		}
+	}
+	if (loadLevel > 0 && threads.size() < threadsCount) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
 		threads.back()->start();
-	} else {
-		_threadIndex = int32(rand_value<uint32>() % threads.size());
-		int32 loadLevel = 0x7FFFFFFF;
-		for (int32 i = 0, l = threads.size(); i < l; ++i) {
-			int32 level = managers.at(i)->loadLevel();
-			if (level < loadLevel) {
-				_threadIndex = i;
-				loadLevel = level;
-			}
-		}
 	}
 	managers.at(_threadIndex)->append(this, location, data);
 }
@@ -185,6 +213,7 @@ void Reader::moveToNextWrite() const {
 }
 
 void Reader::callback(Reader *reader, int32 threadIndex, Notification notification) {
+	Core::Tracing::Scope tracing("clip callback");
 	// check if reader is not deleted already
 	if (managers.size() > threadIndex && managers.at(threadIndex)->carries(reader) && reader->_callback) {
 		reader->_callback(notification);
@@ -314,6 +343,17 @@ bool Reader::videoPaused() const {
 	return _videoPauseRequest.loadAcquire() != 0;
 }
 
+void Reader::setStreamedSize(int64 availableSize) {
+	if (_streamedSize.loadAcquire() == availableSize) {
+		return;
+	}
+	_streamedSize.storeRelease(availableSize);
+	if (managers.size() <= _threadIndex) error();
+	if (_state != State::Error) {
+		managers.at(_threadIndex)->update(this);
+	}
+}
+
 int32 Reader::width() const {
 	return _width;
 }
@@ -354,7 +394,8 @@ public:
 	, _mode(reader->mode())
 	, _audioMsgId(reader->audioMsgId())
 	, _seekPositionMs(reader->seekPositionMs())
-	, _data(data) {
+	, _data(data)
+	, _streamedAvailableSize(reader->streamedSize()) {
 		if (_data.isEmpty()) {
 			_location = std::make_unique<FileLocation>(location);
 			if (!_location->accessEnable()) {
@@ -369,8 +410,14 @@ public:
 		if (!_implementation && !init()) {
 			return error();
 		}
+		_implementation->setStreamedAvailable(_streamedAvailableSize);
 		if (frame() && frame()->original.isNull()) {
 			auto readResult = _implementation->readFramesTill(-1, ms);
+			if (readResult == internal::ReaderImplementation::ReadResult::Buffering) {
+				// Streaming, wait for a bigger downloaded prefix. The
+				// reader is woken up by Reader::setStreamedSize().
+				return ProcessResult::Wait;
+			}
 			if (readResult == internal::ReaderImplementation::ReadResult::EndOfFile && _seekPositionMs > 0) {
 				// If seek was done to the end: try to read the first frame,
 				// get the frame size and return a black frame with that size.
@@ -407,6 +454,12 @@ public:
 			_height = frame()->original.height();
 			_durationMs = _implementation->durationMs();
 			_hasAudio = _implementation->hasAudio();
+			if (_mode == Reader::Mode::Gif) {
+				// A looping gif decodes the same frames over and over
+				// again, cache one full loop if it fits the budget and
+				// replay it without touching the decoder.
+				_cacheState = CacheState::Waiting;
+			}
 			return ProcessResult::Started;
 		}
 		return ProcessResult::Wait;
@@ -436,8 +489,41 @@ public:
 	}
 
 	ProcessResult finishProcess(TimeMs ms) {
+		auto wasBuffering = (_streamedBufferingFromMs != 0);
+		if (wasBuffering) {
+			// The playback was frozen while the download was catching
+			// up, shift the timeline as if the pause never happened.
+			_animationStarted += (ms - _streamedBufferingFromMs);
+			_streamedBufferingFromMs = 0;
+		}
+		if (_cacheState == CacheState::Using) {
+			if (QSize(_request.framew, _request.frameh) == _cacheFrameSize) {
+				return finishWithCache(ms);
+			}
+
+			// The request size changed, the cached frames don't fit it.
+			// Fall back to the decoder, it catches up with the current
+			// time by the "keep up" logic in readFramesTill().
+			dropCache();
+		}
+		_implementation->setStreamedAvailable(_streamedAvailableSize);
+		auto previousPositionMs = _nextFramePositionMs;
 		auto frameMs = _seekPositionMs + ms - _animationStarted;
 		auto readResult = _implementation->readFramesTill(frameMs, ms);
+		if (readResult == internal::ReaderImplementation::ReadResult::Buffering) {
+			// Not enough of the file is downloaded to go on, freeze
+			// the playback till a bigger prefix arrives, polling the
+			// implementation meanwhile (the download may have no one
+			// to call Reader::setStreamedSize() while we are here).
+			_streamedBufferingFromMs = ms;
+			_nextFrameWhen = ms + kStreamedBufferingDelay;
+			if (!wasBuffering && _hasAudio && !_videoPausedAtMs) {
+				Player::mixer()->pause(_audioMsgId, true);
+			}
+			return ProcessResult::Wait;
+		} else if (wasBuffering && _hasAudio && !_videoPausedAtMs) {
+			Player::mixer()->resume(_audioMsgId, true);
+		}
 		if (readResult == internal::ReaderImplementation::ReadResult::EndOfFile) {
 			stop(Player::State::StoppedAtEnd);
 			_state = State::Finished;
@@ -456,9 +542,96 @@ public:
 		if (!renderFrame()) {
 			return error();
 		}
+		cacheFrame(previousPositionMs);
+		return ProcessResult::CopyFrame;
+	}
+
+	ProcessResult finishWithCache(TimeMs ms) {
+		Expects(!_cache.empty());
+
+		if (_nextFrameWhen + _cacheLoopDurationMs <= ms) {
+			// Skip the whole missed loops at once after a long pause.
+			auto skipLoops = (ms - _nextFrameWhen) / _cacheLoopDurationMs;
+			_nextFrameWhen += skipLoops * _cacheLoopDurationMs;
+		}
+		auto count = int(_cache.size());
+		while (_nextFrameWhen <= ms) {
+			_nextFrameWhen += _cache[_cacheIndex].delay;
+			_cacheIndex = (_cacheIndex + 1) % count;
+		}
+		_nextFramePositionMs = _cache[_cacheIndex].positionMs;
+
+		Assert(frame() != 0 && _request.valid());
+		auto &cached = _cache[_cacheIndex];
+		frame()->original = cached.original;
+		frame()->alpha = cached.alpha;
+		frame()->original.setDevicePixelRatio(_request.factor);
+		frame()->pix = QPixmap();
+		frame()->pix = PrepareFrame(_request, frame()->original, frame()->alpha, frame()->cache);
+		frame()->when = _nextFrameWhen;
+		frame()->positionMs = _nextFramePositionMs;
 		return ProcessResult::CopyFrame;
 	}
 
+	void cacheFrame(TimeMs previousPositionMs) {
+		if (_cacheState == CacheState::Disabled) {
+			return;
+		}
+		auto wrapped = (_nextFramePositionMs < previousPositionMs);
+		if (_cacheState == CacheState::Waiting) {
+			if (!wrapped) {
+				return;
+			}
+
+			// The clip starts over, record the loop from this frame on.
+			_cacheState = CacheState::Recording;
+			_cacheFrameSize = QSize(_request.framew, _request.frameh);
+		} else if (QSize(_request.framew, _request.frameh) != _cacheFrameSize) {
+			// Frames recorded for another size are useless, start over.
+			dropCache();
+			return;
+		} else if (wrapped) {
+			// The whole loop is recorded, replay it from now on. The
+			// last frame is shown till the loop starts over again.
+			auto &last = _cache.back();
+			last.delay = qMax(
+				_durationMs - last.positionMs + _cache.front().positionMs,
+				kMinCachedFrameDelay);
+			_cacheLoopDurationMs = 0;
+			for (auto &cached : _cache) {
+				_cacheLoopDurationMs += cached.delay;
+			}
+			_cacheIndex = 0;
+			_cacheState = CacheState::Using;
+			return;
+		}
+		auto cached = CachedFrame();
+		cached.original = frame()->original;
+		cached.alpha = frame()->alpha;
+		cached.positionMs = _nextFramePositionMs;
+		_cacheSize += cached.original.byteCount();
+		if (_cacheSize > kMaxFrameCacheSize) {
+			// The loop doesn't fit the budget, never try this clip again.
+			dropCache();
+			_cacheState = CacheState::Disabled;
+			return;
+		}
+		if (!_cache.empty()) {
+			_cache.back().delay = qMax(
+				_nextFramePositionMs - previousPositionMs,
+				kMinCachedFrameDelay);
+		}
+		_cache.push_back(std::move(cached));
+	}
+
+	void dropCache() {
+		_cache.clear();
+		_cacheSize = 0;
+		_cacheIndex = 0;
+		_cacheLoopDurationMs = 0;
+		_cacheState = CacheState::Waiting;
+	}
+
 	bool renderFrame() {
 		Assert(frame() != 0 && _request.valid());
 		if (!_implementation->renderFrame(frame()->original, frame()->alpha, QSize(_request.framew, _request.frameh))) {
@@ -473,7 +646,9 @@ public:
 	}
 
 	bool init() {
-		if (_data.isEmpty() && QFileInfo(_location->name()).size() <= Storage::kMaxAnimationInMemory) {
+		// A streamed file is preallocated to the full size on disk, it
+		// cannot be read to memory while the download is in progress.
+		if (_data.isEmpty() && !_streamedAvailableSize && QFileInfo(_location->name()).size() <= Storage::kMaxAnimationInMemory) {
 			QFile f(_location->name());
 			if (f.open(QIODevice::ReadOnly)) {
 				_data = f.readAll();
@@ -581,6 +756,25 @@ private:
 	int _width = 0;
 	int _height = 0;
 
+	enum class CacheState {
+		Disabled, // Not a looping gif or the loop doesn't fit the budget.
+		Waiting, // Playing the first pass, waiting for the loop to restart.
+		Recording, // Collecting the frames of one full loop.
+		Using, // Replaying the collected loop without the decoder.
+	};
+	struct CachedFrame {
+		QImage original;
+		bool alpha = true;
+		TimeMs delay = 0;
+		TimeMs positionMs = 0;
+	};
+	CacheState _cacheState = CacheState::Disabled;
+	std::vector<CachedFrame> _cache;
+	QSize _cacheFrameSize;
+	int64 _cacheSize = 0;
+	int _cacheIndex = 0;
+	TimeMs _cacheLoopDurationMs = 0;
+
 	bool _hasAudio = false;
 	TimeMs _durationMs = 0;
 	TimeMs _animationStarted = 0;
@@ -591,6 +785,12 @@ private:
 	bool _started = false;
 	TimeMs _videoPausedAtMs = 0;
 
+	// Streaming playback of a still-downloading file: size of the
+	// downloaded sequential prefix and when the playback was frozen
+	// because the decoder ran out of that prefix.
+	int64 _streamedAvailableSize = 0;
+	TimeMs _streamedBufferingFromMs = 0;
+
 	friend class Manager;
 
 };
@@ -780,6 +980,7 @@ void Manager::process() {
 					} else {
 						i.key()->resumeVideo(ms);
 					}
+					i.key()->_streamedAvailableSize = it.key()->streamedSize();
 				}
 				auto frame = it.key()->frameToWrite();
 				if (frame) it.key()->_private->_request = frame->request;
@@ -789,26 +990,43 @@ void Manager::process() {
 		checkAllReaders = (_readers.size() > _readerPointers.size());
 	}
 
-	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
-		ReaderPrivate *reader = i.key();
+	// Decode the reader with the nearest frame deadline first, so that
+	// one clip with a slow frame doesn't push all the other visible
+	// clips of this manager past their display deadlines.
+	auto due = std::vector<std::pair<TimeMs, ReaderPrivate*>>();
+	due.reserve(_readers.size());
+	for (auto i = _readers.cbegin(), e = _readers.cend(); i != e; ++i) {
 		if (i.value() <= ms) {
-			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
-			if (state == ResultHandleRemove) {
-				i = _readers.erase(i);
-				continue;
-			} else if (state == ResultHandleStop) {
-				_processingInThread = 0;
-				return;
-			}
-			ms = getms();
-			if (reader->_videoPausedAtMs) {
-				i.value() = ms + 86400 * 1000ULL;
-			} else if (reader->_nextFrameWhen && reader->_started) {
-				i.value() = reader->_nextFrameWhen;
-			} else {
-				i.value() = (ms + 86400 * 1000ULL);
-			}
-		} else if (checkAllReaders) {
+			due.push_back({ i.value(), i.key() });
+		}
+	}
+	std::sort(due.begin(), due.end());
+	for (const auto &pair : due) {
+		const auto reader = pair.second;
+		auto i = _readers.find(reader);
+		if (i == _readers.end()) {
+			continue;
+		}
+		ResultHandleState state = handleResult(reader, reader->process(ms), ms);
+		if (state == ResultHandleRemove) {
+			_readers.erase(i);
+			continue;
+		} else if (state == ResultHandleStop) {
+			_processingInThread = 0;
+			return;
+		}
+		ms = getms();
+		if (reader->_videoPausedAtMs) {
+			i.value() = ms + 86400 * 1000ULL;
+		} else if (reader->_nextFrameWhen && reader->_started) {
+			i.value() = reader->_nextFrameWhen;
+		} else {
+			i.value() = (ms + 86400 * 1000ULL);
+		}
+	}
+	for (auto i = _readers.begin(); i != _readers.end();) {
+		ReaderPrivate *reader = i.key();
+		if (checkAllReaders) {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it == _readerPointers.cend()) {
@@ -895,6 +1113,61 @@ FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteA
 	return result;
 }
 
+QImage CountThumbsStrip(
+		const FileLocation &location,
+		const QByteArray &data,
+		int count,
+		int thumbHeight) {
+	Expects(count > 0);
+	Expects(thumbHeight > 0);
+
+	auto localLocation = FileLocation(location);
+	auto localData = QByteArray(data);
+
+	auto seekPositionMs = 0LL;
+	auto reader = std::make_unique<internal::FFMpegReaderImplementation>(&localLocation, &localData, AudioMsgId());
+	if (!reader->start(internal::ReaderImplementation::Mode::Inspecting, seekPositionMs)) {
+		return QImage();
+	}
+	const auto durationMs = reader->durationMs();
+	if (durationMs <= 0) {
+		return QImage();
+	}
+
+	auto result = QImage();
+	auto thumbSize = QSize();
+	auto painter = std::unique_ptr<Painter>();
+	for (auto i = 0; i != count; ++i) {
+		// The middle of each of the `count` equal timeline pieces,
+		// the seek lands on the nearest keyframe before it.
+		auto positionMs = TimeMs((durationMs * (2 * i + 1)) / (2 * count));
+		if (!reader->inspectAt(positionMs)) {
+			return QImage();
+		}
+		auto readResult = reader->readFramesTill(-1, getms());
+		if (readResult != internal::ReaderImplementation::ReadResult::Success) {
+			return QImage();
+		}
+		auto hasAlpha = false;
+		auto frame = QImage();
+		if (!reader->renderFrame(frame, hasAlpha, thumbSize)) {
+			return QImage();
+		}
+		if (result.isNull()) {
+			// Derive the strip geometry from the first frame aspect.
+			const auto single = qMax((frame.width() * thumbHeight) / qMax(frame.height(), 1), 1);
+			thumbSize = QSize(single, thumbHeight);
+			result = QImage(single * count, thumbHeight, QImage::Format_ARGB32_Premultiplied);
+			result.fill(Qt::black);
+			painter = std::make_unique<Painter>(&result);
+			painter->setRenderHint(QPainter::SmoothPixmapTransform);
+		}
+		painter->drawImage(QRect(i * thumbSize.width(), 0, thumbSize.width(), thumbHeight), frame);
+	}
+	painter = nullptr;
+	return result;
+}
+
 void Finish() {
 	if (!threads.isEmpty()) {
 		for (int32 i = 0, l = threads.size(); i < l; ++i) {
@@ -49,7 +49,7 @@ public:
 	};
 
 	Reader(const QString &filepath, Callback &&callback, Mode mode = Mode::Gif, TimeMs seekMs = 0);
-	Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode = Mode::Gif, TimeMs seekMs = 0);
+	Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode = Mode::Gif, TimeMs seekMs = 0, int64 streamedSize = 0);
 
 	static void callback(Reader *reader, int threadIndex, Notification notification); // reader can be deleted
 
@@ -67,6 +67,14 @@ public:
 		return _seekPositionMs;
 	}
 
+	// Streaming playback of a file that is still being downloaded,
+	// availableSize is the downloaded sequential prefix byte count.
+	// Thread: Main.
+	void setStreamedSize(int64 availableSize);
+	int64 streamedSize() const {
+		return _streamedSize.loadAcquire();
+	}
+
 	void start(int framew, int frameh, int outerw, int outerh, ImageRoundRadius radius, RectParts corners);
 	QPixmap current(int framew, int frameh, int outerw, int outerh, ImageRoundRadius radius, RectParts corners, TimeMs ms);
 	QPixmap current();
@@ -156,6 +164,7 @@ private:
 
 	QAtomicInt _autoPausedGif = 0;
 	QAtomicInt _videoPauseRequest = 0;
+	QAtomicInteger<qint64> _streamedSize = 0;
 	int32 _threadIndex;
 
 	bool _autoplay = false;
@@ -238,6 +247,10 @@ private:
 
 FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteArray &data);
 
+// Decodes `count` evenly spaced keyframes of a video and glues them
+// into one horizontal strip, for instant previews while scrubbing.
+QImage CountThumbsStrip(const FileLocation &location, const QByteArray &data, int count, int thumbHeight);
+
 void Finish();
 
 } // namespace Clip
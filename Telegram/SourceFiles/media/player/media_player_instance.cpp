@@ -32,6 +32,10 @@ constexpr auto kIdsLimit = 32;
 // Preload next messages if we went further from current than that.
 constexpr auto kIdsPreloadAfter = 28;
 
+// Pre-open the decoder of the next track this long before
+// the current one ends, so the switch happens without a gap.
+constexpr auto kPrepareNextAdvanceMs = TimeMs(10000);
+
 } // namespace
 
 void start() {
@@ -426,6 +430,9 @@ void Instance::emitUpdate(AudioMsgId::Type type, CheckCallback check) {
 				preloadNext(data);
 			}
 		}
+		if (isPlaying && type == AudioMsgId::Type::Song) {
+			prepareNext(data, state);
+		}
 	}
 }
 
@@ -450,6 +457,33 @@ void Instance::preloadNext(not_null<Data*> data) {
 	}
 }
 
+void Instance::prepareNext(not_null<Data*> data, const TrackState &state) {
+	if (!state.length
+		|| (state.length - state.position)
+			> (kPrepareNextAdvanceMs * state.frequency) / 1000LL
+		|| data->repeatEnabled
+		|| !data->playlistIndex) {
+		return;
+	}
+	const auto item = itemByIndex(data, *data->playlistIndex + 1);
+	if (!item) {
+		return;
+	}
+	const auto media = item->media();
+	const auto document = media ? media->document() : nullptr;
+	if (!document || !document->isAudioFile()) {
+		return;
+	}
+	const auto audioId = AudioMsgId(document, item->fullId());
+	if (data->preparedNext == audioId
+		|| !document->loaded(
+			DocumentData::FilePathResolveSaveFromDataSilent)) {
+		return;
+	}
+	data->preparedNext = audioId;
+	mixer()->prepareNext(audioId);
+}
+
 void Instance::handleLogout() {
 	const auto reset = [&](AudioMsgId::Type type) {
 		const auto data = getData(type);
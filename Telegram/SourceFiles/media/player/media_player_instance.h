@@ -139,6 +139,7 @@ private:
 		Storage::SharedMediaType overview;
 		AudioMsgId current;
 		AudioMsgId seeking;
+		AudioMsgId preparedNext;
 		base::optional<SparseIdsMergedSlice> playlistSlice;
 		base::optional<SliceKey> playlistSliceKey;
 		base::optional<SliceKey> playlistRequestedKey;
@@ -162,6 +163,7 @@ private:
 	void playlistUpdated(not_null<Data*> data);
 	bool moveInPlaylist(not_null<Data*> data, int delta, bool autonext);
 	void preloadNext(not_null<Data*> data);
+	void prepareNext(not_null<Data*> data, const TrackState &state);
 	HistoryItem *itemByIndex(not_null<Data*> data, int index);
 	void handleLogout();
 
@@ -38,6 +38,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace {
 
 constexpr auto kPreloadCount = 4;
+constexpr auto kPreloadByteBudget = int64(32 * 1024 * 1024);
+constexpr auto kPreloadPhotoNominalSize = int64(512 * 1024);
 
 // Preload X message ids before and after current.
 constexpr auto kIdsLimit = 48;
@@ -45,6 +47,37 @@ constexpr auto kIdsLimit = 48;
 // Preload next messages if we went further from current than that.
 constexpr auto kIdsPreloadAfter = 28;
 
+// Re-decode a partially loaded photo after each quarter arrives.
+constexpr auto kPartialDecodeStep = 0.25;
+
+// Start streaming playback of a downloading video once that much of
+// its sequential prefix was written to the disk, enough for the
+// header and a few seconds of playback of most of the files.
+constexpr auto kStreamedVideoPrefix = int64(3 * 1024 * 1024);
+
+// A truncated progressive JPEG decodes to a complete, just less
+// refined picture, while a truncated baseline one decodes to a sharp
+// top half over a gray bottom, which looks worse than the blurred
+// preview. So partial decode is attempted for progressive files only,
+// detected by an SOF2 marker before the first scan.
+bool IsProgressiveJpeg(const QByteArray &bytes) {
+	const auto data = reinterpret_cast<const uchar*>(bytes.constData());
+	const auto size = bytes.size();
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+		return false;
+	}
+	for (auto offset = 2; offset + 4 <= size && data[offset] == 0xFF;) {
+		const auto marker = data[offset + 1];
+		if (marker == 0xC2) {
+			return true;
+		} else if (marker == 0xC0 || marker == 0xC1 || marker == 0xDA) {
+			return false;
+		}
+		offset += 2 + ((data[offset + 2] << 8) | data[offset + 3]);
+	}
+	return false;
+}
+
 } // namespace
 
 struct MediaView::SharedMedia {
@@ -218,6 +251,8 @@ bool MediaView::gifShown() const {
 
 void MediaView::stopGif() {
 	_gif = nullptr;
+	_streamedVideo = false;
+	_videoSeekPreviewMs = -1;
 	_videoPaused = _videoStopped = _videoIsSilent = false;
 	_fullScreenVideo = false;
 	_clipController.destroy();
@@ -225,6 +260,15 @@ void MediaView::stopGif() {
 }
 
 void MediaView::documentUpdated(DocumentData *doc) {
+	if (_streamedVideo && _gif && _doc && _doc == doc) {
+		// Feed the new size of the downloaded prefix to the playback.
+		if (doc->loading()) {
+			_gif->setStreamedSize(doc->streamedPrefixSize());
+		} else {
+			_gif->setStreamedSize(doc->size);
+			_streamedVideo = false;
+		}
+	}
 	if (fileBubbleShown() && _doc && _doc == doc) {
 		if ((_doc->loading() && _docCancel->isHidden()) || (!_doc->loading() && !_docCancel->isHidden())) {
 			updateControls();
@@ -579,6 +623,13 @@ void MediaView::step_radial(TimeMs ms, bool timer) {
 	if (timer && (wasAnimating || _radial.animating())) {
 		update(radialRect());
 	}
+	if (_photo && _full <= 0 && _photo->full->loading()) {
+		const auto progress = radialProgress();
+		if (progress >= _partialDecoded + kPartialDecodeStep) {
+			_partialDecoded = progress;
+			decodePartialPhoto();
+		}
+	}
 	const auto ready = _doc && _doc->loaded();
 	const auto streamVideo = ready && (_doc->isAnimation() || _doc->isVideoFile());
 	const auto tryOpenImage = ready && (_doc->size < App::kImageSizeLimit);
@@ -602,6 +653,25 @@ void MediaView::step_radial(TimeMs ms, bool timer) {
 	}
 }
 
+void MediaView::decodePartialPhoto() {
+	const auto bytes = _photo->full->partialBytes();
+	if (bytes.isEmpty() || !IsProgressiveJpeg(bytes)) {
+		return;
+	}
+	auto image = App::readImage(bytes, nullptr, false, nullptr);
+	if (image.isNull()) {
+		return;
+	}
+	const auto w = _width * cIntRetinaFactor();
+	if (image.width() > w) {
+		image = image.scaledToWidth(w, Qt::SmoothTransformation);
+	}
+	_current = App::pixmapFromImageInPlace(std::move(image));
+	if (cRetina()) _current.setDevicePixelRatio(cRetinaFactor());
+	_full = 0;
+	update(QRect(_x, _y, _w, _h));
+}
+
 void MediaView::zoomIn() {
 	int32 newZoom = _zoom;
 	if (newZoom == ZoomToScreenLevel) {
@@ -893,6 +963,11 @@ void MediaView::clipCallback(Media::Clip::Notification notification) {
 	case NotificationReinit: {
 		if (auto item = App::histItemById(_msgid)) {
 			if (_gif->state() == State::Error) {
+				if (_streamedVideo) {
+					// E.g. the moov atom is in the end of the file, such
+					// files can't be played while they are downloading.
+					_streamedVideoFailed = true;
+				}
 				stopGif();
 				updateControls();
 				update();
@@ -1422,6 +1497,7 @@ void MediaView::displayPhoto(not_null<PhotoData*> photo, HistoryItem *item) {
 	_zoomToScreen = 0;
 	Auth().downloader().clearPriorities();
 	_full = -1;
+	_partialDecoded = 0.;
 	_current = QPixmap();
 	_down = OverNone;
 	_w = convertScale(photo->full->width());
@@ -1480,6 +1556,7 @@ void MediaView::displayDocument(DocumentData *doc, HistoryItem *item) { // empty
 	}
 
 	if (documentChanged) {
+		_streamedVideoFailed = false;
 		refreshCaption(item);
 	}
 	if (_doc) {
@@ -1645,6 +1722,19 @@ void MediaView::displayFinished() {
 	}
 }
 
+int64 MediaView::streamedVideoSize() const {
+	// Playback of a partially downloaded video is possible once enough
+	// of its sequential prefix was written to the destination file.
+	if (!_doc
+		|| !_doc->isVideoFile()
+		|| !_doc->loading()
+		|| _streamedVideoFailed) {
+		return 0;
+	}
+	const auto prefix = int64(_doc->streamedPrefixSize());
+	return (prefix >= kStreamedVideoPrefix) ? prefix : 0;
+}
+
 Images::Options MediaView::videoThumbOptions() const {
 	auto options = Images::Option::Smooth | Images::Option::Blurred;
 	if (_doc && _doc->isVideoMessage()) {
@@ -1663,6 +1753,8 @@ void MediaView::initAnimation() {
 	} else if (location.accessEnable()) {
 		createClipReader();
 		location.accessDisable();
+	} else if (streamedVideoSize() > 0) {
+		createClipReader();
 	} else if (_doc->dimensions.width() && _doc->dimensions.height()) {
 		auto w = _doc->dimensions.width();
 		auto h = _doc->dimensions.height();
@@ -1690,9 +1782,11 @@ void MediaView::createClipReader() {
 	auto mode = (_doc->isVideoFile() || _doc->isVideoMessage())
 		? Media::Clip::Reader::Mode::Video
 		: Media::Clip::Reader::Mode::Gif;
+	auto streamedSize = streamedVideoSize();
+	_streamedVideo = (streamedSize > 0);
 	_gif = Media::Clip::MakeReader(_doc, _msgid, [this](Media::Clip::Notification notification) {
 		clipCallback(notification);
-	}, mode);
+	}, mode, 0, streamedSize);
 
 	// Correct values will be set when gif gets inited.
 	_videoPaused = _videoIsSilent = _videoStopped = false;
@@ -1770,6 +1864,12 @@ void MediaView::createClipController() {
 	connect(_clipController, SIGNAL(fromFullScreenPressed()), this, SLOT(onVideoToggleFullScreen()));
 
 	connect(Media::Player::mixer(), SIGNAL(updated(const AudioMsgId&)), this, SLOT(onVideoPlayProgress(const AudioMsgId&)));
+
+	if (_doc->isVideoFile() && _doc->loaded()) {
+		// Pre-warm the seekbar previews, cheap because only sparse
+		// keyframes are decoded, cached between sessions.
+		Local::countVideoThumbsStrip(_doc);
+	}
 }
 
 void MediaView::refreshClipControllerGeometry() {
@@ -1825,9 +1925,18 @@ void MediaView::restartVideoAtSeekPosition(TimeMs positionMs) {
 		auto rounding = (_doc && _doc->isVideoMessage()) ? ImageRoundRadius::Ellipse : ImageRoundRadius::None;
 		_current = _gif->current(_gif->width() / cIntRetinaFactor(), _gif->height() / cIntRetinaFactor(), _gif->width() / cIntRetinaFactor(), _gif->height() / cIntRetinaFactor(), rounding, RectPart::AllCorners, getms());
 	}
+	auto streamedSize = streamedVideoSize();
+	if (streamedSize > 0 && _doc->size > 0 && _videoDurationMs > 0) {
+		// The loader downloads strictly sequentially, so only the
+		// downloaded part of the timeline can be seeked to, with a
+		// margin so the playback doesn't buffer right after the seek.
+		auto availableMs = _videoDurationMs * streamedSize / _doc->size;
+		accumulate_min(positionMs, qMax(availableMs - 1000, TimeMs(0)));
+	}
+	_streamedVideo = (streamedSize > 0);
 	_gif = Media::Clip::MakeReader(_doc, _msgid, [this](Media::Clip::Notification notification) {
 		clipCallback(notification);
-	}, Media::Clip::Reader::Mode::Video, positionMs);
+	}, Media::Clip::Reader::Mode::Video, positionMs, streamedSize);
 
 	// Correct values will be set when gif gets inited.
 	_videoPaused = _videoIsSilent = _videoStopped = false;
@@ -1845,10 +1954,14 @@ void MediaView::onVideoSeekProgress(TimeMs positionMs) {
 	if (!_videoPaused && !_videoStopped) {
 		onVideoPauseResume();
 	}
+	_videoSeekPreviewMs = positionMs;
+	update();
 }
 
 void MediaView::onVideoSeekFinished(TimeMs positionMs) {
+	_videoSeekPreviewMs = -1;
 	restartVideoAtSeekPosition(positionMs);
+	update();
 }
 
 void MediaView::onVideoVolumeChanged(float64 volume) {
@@ -2218,10 +2331,43 @@ void MediaView::paintEvent(QPaintEvent *e) {
 				_groupThumbsRect = QRect();
 			}
 		}
+
+		if (_videoSeekPreviewMs >= 0 && _clipController) {
+			paintVideoSeekPreview(p, co);
+		}
 	}
 	checkGroupThumbsAnimation();
 }
 
+void MediaView::paintVideoSeekPreview(Painter &p, float64 opacity) {
+	const auto video = _doc ? _doc->video() : nullptr;
+	if (!video || video->thumbsStrip.isNull() || _videoDurationMs <= 0) {
+		return;
+	}
+	const auto &strip = video->thumbsStrip;
+	const auto count = Local::kVideoThumbsInStrip;
+	const auto single = strip.width() / count;
+	if (single <= 0) {
+		return;
+	}
+	const auto index = qMin(
+		int((_videoSeekPreviewMs * count) / _videoDurationMs),
+		count - 1);
+	const auto controller = _clipController->geometry();
+	const auto previewHeight = strip.height();
+	const auto progress = _videoSeekPreviewMs / float64(_videoDurationMs);
+	const auto left = controller.x()
+		+ int(progress * (controller.width() - single));
+	const auto top = controller.y()
+		- previewHeight
+		- st::mediaviewCaptionPadding.bottom();
+	p.setOpacity(opacity);
+	p.drawImage(
+		QRect(left, top, single, previewHeight),
+		strip,
+		QRect(index * single, 0, single, previewHeight));
+}
+
 void MediaView::checkGroupThumbsAnimation() {
 	if (_groupThumbs && (!_gif || _gif->started())) {
 		_groupThumbs->checkForAnimationStart();
@@ -2547,8 +2693,8 @@ void MediaView::preloadData(int delta) {
 	if (!_index) {
 		return;
 	}
-	auto from = *_index + (delta ? delta : -1);
-	auto till = *_index + (delta ? delta * kPreloadCount : 1);
+	auto from = *_index + (delta ? delta : -kPreloadCount);
+	auto till = *_index + (delta ? delta * kPreloadCount : kPreloadCount + 1);
 	if (from > till) std::swap(from, till);
 
 	if (delta != 0) {
@@ -2561,14 +2707,35 @@ void MediaView::preloadData(int delta) {
 		}
 	}
 
+	// Warm the neighbors at prefetch priority, bounded by a byte budget
+	// so one huge album video does not eat the whole link. The closest
+	// neighbors are always loaded, swiping to them is the common case.
+	auto budget = kPreloadByteBudget;
 	for (auto index = from; index != till; ++index) {
+		if (index == *_index) {
+			continue;
+		}
+		const auto near = (std::abs(index - *_index) <= 1);
 		auto entity = entityByIndex(index);
 		if (auto photo = base::get_if<not_null<PhotoData*>>(&entity.data)) {
-			(*photo)->download();
+			if (!near && budget < kPreloadPhotoNominalSize) {
+				continue;
+			}
+			budget -= kPreloadPhotoNominalSize;
+			if (near) {
+				(*photo)->download();
+			} else {
+				(*photo)->full->prefetch();
+			}
 		} else if (auto document = base::get_if<not_null<DocumentData*>>(&entity.data)) {
 			if (auto sticker = (*document)->sticker()) {
 				sticker->img->load();
 			} else {
+				const auto cost = int64((*document)->size);
+				if (!near && budget < cost) {
+					continue;
+				}
+				budget -= cost;
 				(*document)->thumb->load();
 				(*document)->automaticLoad(entity.item);
 			}
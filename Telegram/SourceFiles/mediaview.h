@@ -205,6 +205,7 @@ private:
 
 	void initAnimation();
 	void createClipReader();
+	int64 streamedVideoSize() const;
 	Images::Options videoThumbOptions() const;
 
 	void initThemePreview();
@@ -226,6 +227,7 @@ private:
 
 	void step_state(TimeMs ms, bool timer);
 	void step_radial(TimeMs ms, bool timer);
+	void decodePartialPhoto();
 
 	void zoomIn();
 	void zoomOut();
@@ -288,7 +290,10 @@ private:
 	int32 _dragging = 0;
 	QPixmap _current;
 	Media::Clip::ReaderPointer _gif;
+	bool _streamedVideo = false; // _gif plays a still-downloading _doc
+	bool _streamedVideoFailed = false;
 	int32 _full = -1; // -1 - thumb, 0 - medium, 1 - full
+	float64 _partialDecoded = 0.; // progress at the last partial decode
 
 	// Video without audio stream playback information.
 	bool _videoIsSilent = false;
@@ -297,11 +302,13 @@ private:
 	TimeMs _videoPositionMs = 0;
 	TimeMs _videoDurationMs = 0;
 	int32 _videoFrequencyMs = 1000; // 1000 ms per second.
+	TimeMs _videoSeekPreviewMs = -1; // -1 - not seeking right now.
 
 	bool fileShown() const;
 	bool gifShown() const;
 	bool fileBubbleShown() const;
 	void stopGif();
+	void paintVideoSeekPreview(Painter &p, float64 opacity);
 
 	const style::icon *_docIcon = nullptr;
 	style::color _docIconColor;
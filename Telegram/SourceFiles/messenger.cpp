@@ -42,6 +42,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/window_controller.h"
 #include "base/qthelp_regex.h"
 #include "base/qthelp_url.h"
+#include "core/startup_timeline.h"
+#include "core/tracing.h"
 #include "boxes/connection_box.h"
 #include "boxes/confirm_phone_box.h"
 #include "boxes/share_box.h"
@@ -87,6 +89,7 @@ Messenger::Messenger(not_null<Core::Launcher*> launcher)
 	Sandbox::refreshGlobalProxy(); // Depends on Global::started().
 
 	startLocalStorage();
+	Core::StartupTimeline::Mark(qsl("local settings read"));
 
 	if (Local::oldSettingsVersion() < AppVersion) {
 		psNewVersion();
@@ -122,7 +125,12 @@ Messenger::Messenger(not_null<Core::Launcher*> launcher)
 	DEBUG_LOG(("Application Info: starting app..."));
 
 	// Create mime database, so it won't be slow later.
-	QMimeDatabase().mimeTypeForName(qsl("text/plain"));
+	// Reading the shared mime info from disk can take a while on
+	// slow drives, so warm it up on a worker thread - QMimeDatabase
+	// is documented to be thread-safe.
+	crl::async([] {
+		QMimeDatabase().mimeTypeForName(qsl("text/plain"));
+	});
 
 	_window = std::make_unique<MainWindow>();
 	_window->init();
@@ -131,10 +139,15 @@ Messenger::Messenger(not_null<Core::Launcher*> launcher)
 	_mediaView = std::make_unique<MediaView>();
 	_window->setGeometry(currentGeometry);
 
+	// Show the screenshot saved at the last quit right away, the local
+	// cache read and the widget creation below can take a while.
+	_window->showWarmSnapshot();
+
 	QCoreApplication::instance()->installEventFilter(this);
 	Sandbox::connect(SIGNAL(applicationStateChanged(Qt::ApplicationState)), this, SLOT(onAppStateChanged(Qt::ApplicationState)));
 
 	DEBUG_LOG(("Application Info: window created..."));
+	Core::StartupTimeline::Mark(qsl("main window created"));
 
 	Shortcuts::start();
 
@@ -142,6 +155,7 @@ Messenger::Messenger(not_null<Core::Launcher*> launcher)
 	App::initMedia();
 
 	Local::ReadMapState state = Local::readMap(QByteArray());
+	Core::StartupTimeline::Mark(qsl("local map read"));
 	if (state == Local::ReadMapPassNeeded) {
 		Global::SetLocalPasscode(true);
 		Global::RefLocalPasscodeChanged().notify();
@@ -152,6 +166,7 @@ Messenger::Messenger(not_null<Core::Launcher*> launcher)
 	}
 
 	DEBUG_LOG(("Application Info: MTP started..."));
+	Core::StartupTimeline::Mark(qsl("mtp started"));
 
 	DEBUG_LOG(("Application Info: showing."));
 	if (state == Local::ReadMapPassNeeded) {
@@ -164,6 +179,7 @@ Messenger::Messenger(not_null<Core::Launcher*> launcher)
 		}
 	}
 	_window->firstShow();
+	Core::StartupTimeline::Mark(qsl("first window show"));
 
 	if (cStartToSettings()) {
 		_window->showSettings();
@@ -242,6 +258,13 @@ bool Messenger::eventFilter(QObject *object, QEvent *e) {
 	case QEvent::MouseButtonPress:
 	case QEvent::TouchBegin:
 	case QEvent::Wheel: {
+		if (Core::Tracing::Enabled()) {
+			// Marks when the input arrived, the work it causes shows
+			// up as the scopes that follow it in the trace.
+			Core::Tracing::Instant((e->type() == QEvent::KeyPress)
+				? "input key"
+				: "input pointer");
+		}
 		psUserActionDone();
 	} break;
 
@@ -289,7 +312,7 @@ void Messenger::setMtpKey(MTP::DcId dcId, const MTP::AuthKey::Data &keyData) {
 }
 
 QByteArray Messenger::serializeMtpAuthorization() const {
-	auto serialize = [this](auto mainDcId, auto &keys, auto &keysToDestroy) {
+	auto serialize = [this](auto mainDcId, auto &keys, auto &keysToDestroy, auto &salts) {
 		auto keysSize = [](auto &list) {
 			return sizeof(qint32) + list.size() * (sizeof(qint32) + MTP::AuthKey::Data().size());
 		};
@@ -304,6 +327,7 @@ QByteArray Messenger::serializeMtpAuthorization() const {
 		auto result = QByteArray();
 		auto size = sizeof(qint32) + sizeof(qint32); // userId + mainDcId
 		size += keysSize(keys) + keysSize(keysToDestroy);
+		size += sizeof(qint32) + salts.size() * (sizeof(qint32) + sizeof(quint64));
 		result.reserve(size);
 		{
 			QDataStream stream(&result, QIODevice::WriteOnly);
@@ -314,6 +338,13 @@ QByteArray Messenger::serializeMtpAuthorization() const {
 			writeKeys(stream, keys);
 			writeKeys(stream, keysToDestroy);
 
+			// Server salts follow the keys so older versions simply
+			// ignore them when reading this blob back.
+			stream << qint32(salts.size());
+			for (const auto &salt : salts) {
+				stream << qint32(salt.first) << quint64(salt.second);
+			}
+
 			DEBUG_LOG(("MTP Info: Keys written, userId: %1, dcId: %2").arg(currentUserId).arg(mainDcId));
 		}
 		return result;
@@ -321,11 +352,13 @@ QByteArray Messenger::serializeMtpAuthorization() const {
 	if (_mtproto) {
 		auto keys = _mtproto->getKeysForWrite();
 		auto keysToDestroy = _mtprotoForKeysDestroy ? _mtprotoForKeysDestroy->getKeysForWrite() : MTP::AuthKeysList();
-		return serialize(_mtproto->mainDcId(), keys, keysToDestroy);
+		auto salts = _mtproto->serverSaltsForWrite();
+		return serialize(_mtproto->mainDcId(), keys, keysToDestroy, salts);
 	}
 	auto &keys = _private->mtpConfig.keys;
 	auto &keysToDestroy = _private->mtpKeysToDestroy;
-	return serialize(_private->mtpConfig.mainDcId, keys, keysToDestroy);
+	auto &salts = _private->mtpConfig.serverSalts;
+	return serialize(_private->mtpConfig.mainDcId, keys, keysToDestroy, salts);
 }
 
 void Messenger::setAuthSessionUserId(UserId userId) {
@@ -385,6 +418,22 @@ void Messenger::setMtpAuthorization(const QByteArray &serialized) {
 	readKeys(_private->mtpConfig.keys);
 	readKeys(_private->mtpKeysToDestroy);
 	LOG(("MTP Info: read keys, current: %1, to destroy: %2").arg(_private->mtpConfig.keys.size()).arg(_private->mtpKeysToDestroy.size()));
+
+	// Optional trailing section with the last known server salts,
+	// written since the session snapshot was extended.
+	if (!stream.atEnd()) {
+		auto count = Serialize::read<qint32>(stream);
+		if (stream.status() == QDataStream::Ok) {
+			for (auto i = 0; i != count; ++i) {
+				auto dcId = Serialize::read<qint32>(stream);
+				auto salt = Serialize::read<quint64>(stream);
+				if (stream.status() != QDataStream::Ok) {
+					break;
+				}
+				_private->mtpConfig.serverSalts[dcId] = salt;
+			}
+		}
+	}
 }
 
 void Messenger::startMtp() {
@@ -629,6 +678,9 @@ void Messenger::handleAppDeactivated() {
 }
 
 void Messenger::call_handleUnreadCounterUpdate() {
+	// A whole burst of changes was coalesced into this single queued
+	// call, so the badge listeners are notified at most once for it.
+	App::histories().refreshUnreadBadge();
 	Global::RefUnreadCounterUpdate().notify(true);
 }
 
@@ -917,11 +969,21 @@ void Messenger::clearPasscode() {
 Messenger::~Messenger() {
 	Expects(SingleInstance == this);
 
+	if (_window) {
+		_window->saveWarmSnapshot();
+	}
 	_window.reset();
 	_mediaView.reset();
 
+	// One sequential write of all the loaded peers, read back in one
+	// pass at the next launch instead of piecemeal per-peer reads.
+	Local::writePeersSnapshot();
+
 	// Some MTP requests can be cancelled from data clearing.
 	App::clearHistories();
+
+	// The scheduled sticker sets writes read the sets from the session.
+	Local::flushStickersWrites();
 	authSessionDestroy();
 
 	// The langpack manager should be destroyed before MTProto instance,
@@ -12,7 +12,170 @@ extern "C" {
 #include <openssl/modes.h>
 }
 
+#ifdef ARCH_CPU_X86_FAMILY
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#else // COMPILER_MSVC
+#include <cpuid.h>
+#endif // COMPILER_MSVC
+#include <wmmintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
 namespace MTP {
+namespace {
+
+#ifdef ARCH_CPU_X86_FAMILY
+
+#ifdef COMPILER_MSVC
+#define AES_TARGET
+#else // COMPILER_MSVC
+#define AES_TARGET __attribute__((target("aes,sse2")))
+#endif // COMPILER_MSVC
+
+// OpenSSL's AES_ige_encrypt() is built on the table-based software AES
+// core even when the CPU supports AES-NI (the hardware path lives only
+// behind EVP). IGE chaining is inherently serial, but replacing each
+// block transform with AESENC/AESDEC rounds still makes bulk payload
+// encryption several times cheaper, so we dispatch to a hardware
+// implementation at runtime when CPUID reports AES support.
+bool HardwareAesAvailable() {
+	static const auto available = [] {
+#ifdef COMPILER_MSVC
+		int data[4] = { 0 };
+		__cpuid(data, 1);
+		return (data[2] & (1 << 25)) != 0;
+#else // COMPILER_MSVC
+		unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+			return false;
+		}
+		return (ecx & (1U << 25)) != 0;
+#endif // COMPILER_MSVC
+	}();
+	return available;
+}
+
+struct HardwareAesKey {
+	__m128i rounds[15];
+};
+
+AES_TARGET inline __m128i KeyExpansionStep(__m128i prev, __m128i assist) {
+	assist = _mm_shuffle_epi32(assist, 0xFF);
+	prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+	prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 8));
+	return _mm_xor_si128(prev, assist);
+}
+
+AES_TARGET inline __m128i KeyExpansionStepOdd(__m128i prev, __m128i assist) {
+	assist = _mm_shuffle_epi32(assist, 0xAA);
+	prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+	prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 8));
+	return _mm_xor_si128(prev, assist);
+}
+
+AES_TARGET void ExpandEncryptKey(const void *key, HardwareAesKey &expanded) {
+	auto data = static_cast<const __m128i*>(key);
+	auto a = _mm_loadu_si128(data);
+	auto b = _mm_loadu_si128(data + 1);
+	expanded.rounds[0] = a;
+	expanded.rounds[1] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x01));
+	expanded.rounds[2] = a;
+	b = KeyExpansionStepOdd(b, _mm_aeskeygenassist_si128(a, 0x00));
+	expanded.rounds[3] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x02));
+	expanded.rounds[4] = a;
+	b = KeyExpansionStepOdd(b, _mm_aeskeygenassist_si128(a, 0x00));
+	expanded.rounds[5] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x04));
+	expanded.rounds[6] = a;
+	b = KeyExpansionStepOdd(b, _mm_aeskeygenassist_si128(a, 0x00));
+	expanded.rounds[7] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x08));
+	expanded.rounds[8] = a;
+	b = KeyExpansionStepOdd(b, _mm_aeskeygenassist_si128(a, 0x00));
+	expanded.rounds[9] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x10));
+	expanded.rounds[10] = a;
+	b = KeyExpansionStepOdd(b, _mm_aeskeygenassist_si128(a, 0x00));
+	expanded.rounds[11] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x20));
+	expanded.rounds[12] = a;
+	b = KeyExpansionStepOdd(b, _mm_aeskeygenassist_si128(a, 0x00));
+	expanded.rounds[13] = b;
+	a = KeyExpansionStep(a, _mm_aeskeygenassist_si128(b, 0x40));
+	expanded.rounds[14] = a;
+}
+
+AES_TARGET void ExpandDecryptKey(const void *key, HardwareAesKey &expanded) {
+	HardwareAesKey forward;
+	ExpandEncryptKey(key, forward);
+	expanded.rounds[0] = forward.rounds[14];
+	for (auto i = 1; i != 14; ++i) {
+		expanded.rounds[i] = _mm_aesimc_si128(forward.rounds[14 - i]);
+	}
+	expanded.rounds[14] = forward.rounds[0];
+}
+
+AES_TARGET inline __m128i EncryptBlock(__m128i block, const HardwareAesKey &key) {
+	block = _mm_xor_si128(block, key.rounds[0]);
+	for (auto i = 1; i != 14; ++i) {
+		block = _mm_aesenc_si128(block, key.rounds[i]);
+	}
+	return _mm_aesenclast_si128(block, key.rounds[14]);
+}
+
+AES_TARGET inline __m128i DecryptBlock(__m128i block, const HardwareAesKey &key) {
+	block = _mm_xor_si128(block, key.rounds[0]);
+	for (auto i = 1; i != 14; ++i) {
+		block = _mm_aesdec_si128(block, key.rounds[i]);
+	}
+	return _mm_aesdeclast_si128(block, key.rounds[14]);
+}
+
+// Chaining matches OpenSSL AES_ige_encrypt(): for encryption
+// c[i] = E(m[i] ^ c[i-1]) ^ m[i-1], for decryption
+// m[i] = D(c[i] ^ m[i-1]) ^ c[i-1], with (c[-1], m[-1]) taken from
+// the first and second halves of the 32-byte iv.
+AES_TARGET void HardwareIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+	HardwareAesKey expanded;
+	ExpandEncryptKey(key, expanded);
+
+	auto in = static_cast<const __m128i*>(src);
+	auto out = static_cast<__m128i*>(dst);
+	auto ivBlocks = static_cast<const __m128i*>(iv);
+	auto chainCipher = _mm_loadu_si128(ivBlocks);
+	auto chainPlain = _mm_loadu_si128(ivBlocks + 1);
+	for (auto count = len / 16; count != 0; --count) {
+		const auto plain = _mm_loadu_si128(in++);
+		chainCipher = _mm_xor_si128(EncryptBlock(_mm_xor_si128(plain, chainCipher), expanded), chainPlain);
+		chainPlain = plain;
+		_mm_storeu_si128(out++, chainCipher);
+	}
+}
+
+AES_TARGET void HardwareIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+	HardwareAesKey expanded;
+	ExpandDecryptKey(key, expanded);
+
+	auto in = static_cast<const __m128i*>(src);
+	auto out = static_cast<__m128i*>(dst);
+	auto ivBlocks = static_cast<const __m128i*>(iv);
+	auto chainCipher = _mm_loadu_si128(ivBlocks);
+	auto chainPlain = _mm_loadu_si128(ivBlocks + 1);
+	for (auto count = len / 16; count != 0; --count) {
+		const auto cipher = _mm_loadu_si128(in++);
+		chainPlain = _mm_xor_si128(DecryptBlock(_mm_xor_si128(cipher, chainPlain), expanded), chainCipher);
+		chainCipher = cipher;
+		_mm_storeu_si128(out++, chainPlain);
+	}
+}
+
+#undef AES_TARGET
+
+#endif // ARCH_CPU_X86_FAMILY
+
+} // namespace
 
 void AuthKey::prepareAES_oldmtp(const MTPint128 &msgKey, MTPint256 &aesKey, MTPint256 &aesIV, bool send) const {
 	uint32 x = send ? 0 : 8;
@@ -73,6 +236,13 @@ void AuthKey::prepareAES(const MTPint128 &msgKey, MTPint256 &aesKey, MTPint256 &
 }
 
 void aesIgeEncryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+#ifdef ARCH_CPU_X86_FAMILY
+	if (HardwareAesAvailable()) {
+		HardwareIgeEncrypt(src, dst, len, key, iv);
+		return;
+	}
+#endif // ARCH_CPU_X86_FAMILY
+
 	uchar aes_key[32], aes_iv[32];
 	memcpy(aes_key, key, 32);
 	memcpy(aes_iv, iv, 32);
@@ -83,6 +253,13 @@ void aesIgeEncryptRaw(const void *src, void *dst, uint32 len, const void *key, c
 }
 
 void aesIgeDecryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+#ifdef ARCH_CPU_X86_FAMILY
+	if (HardwareAesAvailable()) {
+		HardwareIgeDecrypt(src, dst, len, key, iv);
+		return;
+	}
+#endif // ARCH_CPU_X86_FAMILY
+
 	uchar aes_key[32], aes_iv[32];
 	memcpy(aes_key, key, 32);
 	memcpy(aes_iv, iv, 32);
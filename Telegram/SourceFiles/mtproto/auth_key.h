@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/bytes.h"
+
 #include <array>
 #include <memory>
 
@@ -57,7 +59,13 @@ public:
 	}
 
 	bool equals(const std::shared_ptr<AuthKey> &other) const {
-		return other ? (_key == other->_key) : false;
+		// The keys are secret, don't leak the position of the first
+		// mismatch through the comparison timing.
+		return other
+			? bytes::compare_constant_time(
+				bytes::make_span(_key),
+				bytes::make_span(other->_key))
+			: false;
 	}
 
 	static void FillData(Data &authKey, base::const_byte_span computedAuthKey) {
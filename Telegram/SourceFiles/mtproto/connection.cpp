@@ -43,9 +43,166 @@ constexpr auto kPingSendAfterForce = TimeMs(45000);
 // If we can't connect for this time we will ask _instance to update config.
 constexpr auto kRequestConfigTimeout = TimeMs(8000);
 
+// A filled ack batch departs immediately instead of waiting the
+// full MTPAckSendWaiting window.
+constexpr auto kMaxPendingAcks = 32;
+
+// How long a losing test connection is kept warm as a standby.
+constexpr auto kStandbyConnectionTtl = TimeMs(30000);
+
 // Don't try to handle messages larger than this size.
 constexpr auto kMaxMessageLength = 16 * 1024 * 1024;
 
+constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
+constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
+constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
+constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
+
+// The client DH computation posts its result back from a worker
+// thread. QPointer can't be dereferenced off the owner thread and the
+// connection is deleted on its own thread, so live connections are
+// tracked here instead: the destructor removes its entry under the
+// same mutex the worker takes for the lookup, which keeps the target
+// alive while the queued invokation is being set up.
+QMutex DhWaitersMutex;
+std::map<quint64, ConnectionPrivate*> DhWaiters;
+quint64 DhWaitersCounter = 0;
+
+quint64 RegisterDhWaiter(ConnectionPrivate *connection) {
+	QMutexLocker lock(&DhWaitersMutex);
+	DhWaiters.emplace(++DhWaitersCounter, connection);
+	return DhWaitersCounter;
+}
+
+void UnregisterDhWaiter(quint64 waiterId) {
+	QMutexLocker lock(&DhWaitersMutex);
+	DhWaiters.erase(waiterId);
+}
+
+template <typename Callback>
+void PostToDhWaiter(quint64 waiterId, Callback &&callback) {
+	QMutexLocker lock(&DhWaitersMutex);
+	const auto i = DhWaiters.find(waiterId);
+	if (i == DhWaiters.cend()) {
+		return;
+	}
+	const auto strong = i->second;
+	InvokeQueued(strong, [=, callback = std::forward<Callback>(callback)]() mutable {
+		callback(strong);
+	});
+}
+
+// A frame received from the transport, decrypted and integrity-checked
+// before dispatch. Decryption of queued frames runs on worker threads
+// during bursts while dispatch stays ordered on the connection thread.
+struct ReceivedFrame {
+	mtpBuffer ints;
+	QByteArray decrypted;
+	uint32 messageLength = 0;
+	bool failed = false;
+};
+
+void DecryptReceivedFrame(ReceivedFrame &frame, const AuthKeyPtr &key, uint64 keyId) {
+	const auto intsCount = uint32(frame.ints.size());
+	const auto ints = frame.ints.constData();
+	if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
+		LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+
+		frame.failed = true;
+		return;
+	}
+	if (keyId != *(uint64*)ints) {
+		LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(keyId).arg(*(uint64*)ints));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+
+		frame.failed = true;
+		return;
+	}
+
+	auto encryptedInts = ints + kExternalHeaderIntsCount;
+	auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount);
+	auto encryptedBytesCount = encryptedIntsCount * kIntSize;
+	frame.decrypted = QByteArray(encryptedBytesCount, Qt::Uninitialized);
+	auto msgKey = *(MTPint128*)(ints + 2);
+
+#ifdef TDESKTOP_MTPROTO_OLD
+	aesIgeDecrypt_oldmtp(encryptedInts, frame.decrypted.data(), encryptedBytesCount, key, msgKey);
+#else // TDESKTOP_MTPROTO_OLD
+	aesIgeDecrypt(encryptedInts, frame.decrypted.data(), encryptedBytesCount, key, msgKey);
+#endif // TDESKTOP_MTPROTO_OLD
+
+	auto decryptedInts = reinterpret_cast<const mtpPrime*>(frame.decrypted.constData());
+	auto messageLength = *(uint32*)&decryptedInts[7];
+	if (messageLength > kMaxMessageLength) {
+		LOG(("TCP Error: bad messageLength %1").arg(messageLength));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+
+		frame.failed = true;
+		return;
+	}
+	auto fullDataLength = kEncryptedHeaderIntsCount * kIntSize + messageLength; // Without padding.
+
+	// Can underflow, but it is an unsigned type, so we just check the range later.
+	auto paddingSize = static_cast<uint32>(encryptedBytesCount) - static_cast<uint32>(fullDataLength);
+
+#ifdef TDESKTOP_MTPROTO_OLD
+	constexpr auto kMinPaddingSize_oldmtp = 0U;
+	constexpr auto kMaxPaddingSize_oldmtp = 15U;
+	auto badMessageLength = (/*paddingSize < kMinPaddingSize_oldmtp || */paddingSize > kMaxPaddingSize_oldmtp);
+
+	auto hashedDataLength = badMessageLength ? encryptedBytesCount : fullDataLength;
+	auto sha1ForMsgKeyCheck = hashSha1(decryptedInts, hashedDataLength);
+
+	constexpr auto kMsgKeyShift_oldmtp = 4U;
+	if (!bytes::compare_constant_time(
+			bytes::make_span(&msgKey, 1),
+			bytes::make_span(sha1ForMsgKeyCheck).subspan(
+				kMsgKeyShift_oldmtp,
+				sizeof(msgKey)))) {
+		LOG(("TCP Error: bad SHA1 hash after aesDecrypt in message."));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+
+		frame.failed = true;
+		return;
+	}
+#else // TDESKTOP_MTPROTO_OLD
+	constexpr auto kMinPaddingSize = 12U;
+	constexpr auto kMaxPaddingSize = 1024U;
+	auto badMessageLength = (paddingSize < kMinPaddingSize || paddingSize > kMaxPaddingSize);
+
+	auto msgKeyLarge = openssl::Sha256Digest();
+	msgKeyLarge.feed(bytes::make_span(
+		static_cast<const gsl::byte*>(key->partForMsgKey(false)),
+		32));
+	msgKeyLarge.feed(bytes::make_span(decryptedInts, encryptedIntsCount));
+	const auto sha256Buffer = msgKeyLarge.result();
+
+	constexpr auto kMsgKeyShift = 8U;
+	if (!bytes::compare_constant_time(
+			bytes::make_span(&msgKey, 1),
+			bytes::make_span(sha256Buffer).subspan(
+				kMsgKeyShift,
+				sizeof(msgKey)))) {
+		LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+
+		frame.failed = true;
+		return;
+	}
+#endif // TDESKTOP_MTPROTO_OLD
+
+	if (badMessageLength || (messageLength & 0x03)) {
+		LOG(("TCP Error: bad msg_len received %1, data size: %2").arg(messageLength).arg(encryptedBytesCount));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+
+		frame.failed = true;
+		return;
+	}
+
+	frame.messageLength = messageLength;
+}
+
 QString LogIdsVector(const QVector<MTPlong> &ids) {
 	if (!ids.size()) return "[]";
 	auto idsStr = QString("[%1").arg(ids.cbegin()->v);
@@ -220,9 +377,7 @@ ModExpFirst CreateModExp(
 	constexpr auto kMaxModExpFirstTries = 5;
 	for (auto tries = 0; tries != kMaxModExpFirstTries; ++tries) {
 		bytes::set_random(result.randomPower);
-		for (auto i = 0; i != ModExpFirst::kRandomPowerSize; ++i) {
-			result.randomPower[i] ^= randomSeed[i];
-		}
+		bytes::xor_with(bytes::make_span(result.randomPower), randomSeed);
 		auto modexp = BigNum::ModExp(BigNum(g), BigNum(result.randomPower), prime);
 		if (IsGoodModExpFirst(modexp, prime)) {
 			result.modexp = modexp.getBytes();
@@ -366,7 +521,9 @@ void ConnectionPrivate::appendTestConnection(
 		+ (protocolSecret.empty() ? 0 : 1);
 	_testConnections.push_back({
 		AbstractConnection::create(protocol, thread()),
-		priority
+		priority,
+		ip,
+		port
 	});
 	auto weak = _testConnections.back().data.get();
 	connect(weak, &AbstractConnection::error, [=](int errorCode) {
@@ -430,6 +587,8 @@ ConnectionPrivate::ConnectionPrivate(
 , sessionData(data) {
 	Expects(_shiftedDcId != 0);
 
+	_dhWaiterId = RegisterDhWaiter(this);
+
 	moveToThread(thread);
 
 	connect(thread, &QThread::started, this, [=] { connectToServer(); });
@@ -1082,6 +1241,24 @@ void ConnectionPrivate::connectToServer(bool afterConfig) {
 	}
 
 	destroyAllConnections();
+	if (_standbyConnection
+		&& (getms(true) - _standbyKeptAt < kStandbyConnectionTtl)
+		&& _standbyConnection->isConnected()) {
+		DEBUG_LOG(("MTP Info: promoting standby connection %1."
+			).arg(_standbyConnection->tag()));
+		_connection = std::move(_standbyConnection);
+
+		_retryTimer.cancel();
+		_waitForConnectedTimer.cancel();
+
+		setState(ConnectingState);
+		_pingId = _pingMsgId = _pingIdToSend = _pingSendAt = 0;
+		_pingSender.cancel();
+
+		updateAuthKey();
+		return;
+	}
+	_standbyConnection = nullptr;
 	if (_connectionOptions->proxy.type == ProxyData::Type::Mtproto) {
 		appendTestConnection(
 			DcOptions::Variants::Tcp,
@@ -1322,6 +1499,7 @@ void ConnectionPrivate::doDisconnect() {
 }
 
 void ConnectionPrivate::finishAndDestroy() {
+	_standbyConnection = nullptr;
 	doDisconnect();
 	_finished = true;
 	emit finished(_owner);
@@ -1359,105 +1537,46 @@ void ConnectionPrivate::handleReceived() {
 		return restartOnError();
 	}
 
+	auto frames = std::vector<ReceivedFrame>();
+	frames.reserve(_connection->received().size());
 	while (!_connection->received().empty()) {
-		auto intsBuffer = std::move(_connection->received().front());
+		frames.emplace_back();
+		frames.back().ints = std::move(_connection->received().front());
 		_connection->received().pop_front();
+	}
 
-		constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
-		constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
-		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
-		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
-		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
-		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
-			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
-
-			return restartOnError();
+	// Decrypt and integrity-check all queued frames before dispatching
+	// any of them. With more than one frame queued (a media burst) the
+	// decryption scales across worker threads instead of saturating
+	// this one, while the dispatch below keeps the received order.
+	if (frames.size() > 1) {
+		QSemaphore semaphore;
+		for (auto &frame : frames) {
+			crl::async([&semaphore, key, keyId = keyId, frame = &frame] {
+				DecryptReceivedFrame(*frame, key, keyId);
+				semaphore.release();
+			});
 		}
-		if (keyId != *(uint64*)ints) {
-			LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(keyId).arg(*(uint64*)ints));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+		semaphore.acquire(int(frames.size()));
+	} else if (!frames.empty()) {
+		DecryptReceivedFrame(frames.front(), key, keyId);
+	}
 
+	for (auto &frame : frames) {
+		if (frame.failed) {
 			return restartOnError();
 		}
 
-		auto encryptedInts = ints + kExternalHeaderIntsCount;
-		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount);
-		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
-		auto msgKey = *(MTPint128*)(ints + 2);
-
-#ifdef TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt_oldmtp(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
-#else // TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
-#endif // TDESKTOP_MTPROTO_OLD
-
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
+		auto decryptedInts = reinterpret_cast<const mtpPrime*>(frame.decrypted.constData());
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
 		auto msgId = *(uint64*)&decryptedInts[4];
 		auto seqNo = *(uint32*)&decryptedInts[6];
 		auto needAck = ((seqNo & 0x01) != 0);
 
-		auto messageLength = *(uint32*)&decryptedInts[7];
-		if (messageLength > kMaxMessageLength) {
-			LOG(("TCP Error: bad messageLength %1").arg(messageLength));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
-
-			return restartOnError();
-
-		}
+		auto messageLength = frame.messageLength;
 		auto fullDataLength = kEncryptedHeaderIntsCount * kIntSize + messageLength; // Without padding.
 
-		// Can underflow, but it is an unsigned type, so we just check the range later.
-		auto paddingSize = static_cast<uint32>(encryptedBytesCount) - static_cast<uint32>(fullDataLength);
-
-#ifdef TDESKTOP_MTPROTO_OLD
-		constexpr auto kMinPaddingSize_oldmtp = 0U;
-		constexpr auto kMaxPaddingSize_oldmtp = 15U;
-		auto badMessageLength = (/*paddingSize < kMinPaddingSize_oldmtp || */paddingSize > kMaxPaddingSize_oldmtp);
-
-		auto hashedDataLength = badMessageLength ? encryptedBytesCount : fullDataLength;
-		auto sha1ForMsgKeyCheck = hashSha1(decryptedInts, hashedDataLength);
-
-		constexpr auto kMsgKeyShift_oldmtp = 4U;
-		if (memcmp(&msgKey, sha1ForMsgKeyCheck.data() + kMsgKeyShift_oldmtp, sizeof(msgKey)) != 0) {
-			LOG(("TCP Error: bad SHA1 hash after aesDecrypt in message."));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
-
-			return restartOnError();
-		}
-#else // TDESKTOP_MTPROTO_OLD
-		constexpr auto kMinPaddingSize = 12U;
-		constexpr auto kMaxPaddingSize = 1024U;
-		auto badMessageLength = (paddingSize < kMinPaddingSize || paddingSize > kMaxPaddingSize);
-
-		std::array<uchar, 32> sha256Buffer = { { 0 } };
-
-		SHA256_CTX msgKeyLargeContext;
-		SHA256_Init(&msgKeyLargeContext);
-		SHA256_Update(&msgKeyLargeContext, key->partForMsgKey(false), 32);
-		SHA256_Update(&msgKeyLargeContext, decryptedInts, encryptedBytesCount);
-		SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
-
-		constexpr auto kMsgKeyShift = 8U;
-		if (memcmp(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey)) != 0) {
-			LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
-
-			return restartOnError();
-		}
-#endif // TDESKTOP_MTPROTO_OLD
-
-		if (badMessageLength || (messageLength & 0x03)) {
-			LOG(("TCP Error: bad msg_len received %1, data size: %2").arg(messageLength).arg(encryptedBytesCount));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
-
-			return restartOnError();
-		}
-
 		TCP_LOG(("TCP Info: decrypted message %1,%2,%3 is %4 len").arg(msgId).arg(seqNo).arg(Logs::b(needAck)).arg(fullDataLength));
 
 		uint64 serverSession = sessionData->getSession();
@@ -1526,7 +1645,14 @@ void ConnectionPrivate::handleReceived() {
 		uint32 toAckSize = ackRequestData.size();
 		if (toAckSize) {
 			DEBUG_LOG(("MTP Info: will send %1 acks, ids: %2").arg(toAckSize).arg(LogIdsVector(ackRequestData)));
-			emit sendAnythingAsync(MTPAckSendWaiting);
+
+			// Acks ride along with the next payload packet or go out
+			// when the window closes, but a message storm should not
+			// grow the batch without bound, so a filled one is sent
+			// right away.
+			emit sendAnythingAsync((toAckSize >= kMaxPendingAcks)
+				? 0
+				: MTPAckSendWaiting);
 		}
 
 		bool emitSignal = false;
@@ -2151,41 +2277,27 @@ mtpBuffer ConnectionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) c
 
 	mtpBuffer result; // * 4 because of mtpPrime type
 	result.resize(0);
-	z_stream stream;
-	stream.zalloc = 0;
-	stream.zfree = 0;
-	stream.opaque = 0;
-	stream.avail_in = 0;
-	stream.next_in = 0;
-	int res = inflateInit2(&stream, 16 + MAX_WBITS);
-	if (res != Z_OK) {
-		LOG(("RPC Error: could not init zlib stream, code: %1").arg(res));
+	if (!_ungzipContext.begin(packed.v.constData(), packedLen)) {
+		LOG(("RPC Error: could not init zlib stream, code: %1").arg(_ungzipContext.error()));
 		return result;
 	}
-	stream.avail_in = packedLen;
-	stream.next_in = reinterpret_cast<Bytef*>(packed.v.data());
-
-	stream.avail_out = 0;
-	while (!stream.avail_out) {
+	auto fullSize = uint32(0);
+	while (!_ungzipContext.finished()) {
 		result.resize(result.size() + unpackedChunk);
-		stream.avail_out = unpackedChunk * sizeof(mtpPrime);
-		stream.next_out = (Bytef*)&result[result.size() - unpackedChunk];
-		int res = inflate(&stream, Z_NO_FLUSH);
-		if (res != Z_OK && res != Z_STREAM_END) {
-			inflateEnd(&stream);
-			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(res));
+		auto written = _ungzipContext.unpackSome(reinterpret_cast<char*>(&result[result.size() - unpackedChunk]), unpackedChunk * sizeof(mtpPrime));
+		if (written < 0) {
+			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(_ungzipContext.error()));
 			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.v.constData(), packedLen).str()));
 			return mtpBuffer();
 		}
+		fullSize += uint32(written);
 	}
-	if (stream.avail_out & 0x03) {
-		uint32 badSize = result.size() * sizeof(mtpPrime) - stream.avail_out;
-		LOG(("RPC Error: bad length of unpacked data %1").arg(badSize));
-		DEBUG_LOG(("RPC Error: bad unpacked data %1").arg(Logs::mb(result.data(), badSize).str()));
+	if (fullSize & 0x03) {
+		LOG(("RPC Error: bad length of unpacked data %1").arg(fullSize));
+		DEBUG_LOG(("RPC Error: bad unpacked data %1").arg(Logs::mb(result.data(), fullSize).str()));
 		return mtpBuffer();
 	}
-	result.resize(result.size() - (stream.avail_out >> 2));
-	inflateEnd(&stream);
+	result.resize(fullSize >> 2);
 	if (!result.size()) {
 		LOG(("RPC Error: bad length of unpacked data 0"));
 	}
@@ -2401,7 +2513,12 @@ void ConnectionPrivate::onConnected(
 	} else {
 		DEBUG_LOG(("MTP Info: connection through IPv4 succeed."));
 		_waitForBetterTimer.cancel();
+		_instance->dcOptions()->reportEndpointSuccess(
+			i->ip.toStdString(),
+			i->port,
+			i->data->pingTime());
 		_connection = std::move(i->data);
+		keepStandbyConnection();
 		_testConnections.clear();
 
 		lockFinished.unlock();
@@ -2411,6 +2528,11 @@ void ConnectionPrivate::onConnected(
 
 void ConnectionPrivate::onDisconnected(
 		not_null<AbstractConnection*> connection) {
+	if (connection == _standbyConnection.get()) {
+		DEBUG_LOG(("MTP Info: standby connection disconnected."));
+		_standbyConnection = nullptr;
+		return;
+	}
 	removeTestConnection(connection);
 
 	if (_testConnections.empty()) {
@@ -2441,7 +2563,12 @@ void ConnectionPrivate::confirmBestConnection() {
 	DEBUG_LOG(("MTP Info: can't connect through better, using %1."
 		).arg(i->data->tag()));
 
+	_instance->dcOptions()->reportEndpointSuccess(
+		i->ip.toStdString(),
+		i->port,
+		i->data->pingTime());
 	_connection = std::move(i->data);
+	keepStandbyConnection();
 	_testConnections.clear();
 
 	updateAuthKey();
@@ -2449,6 +2576,17 @@ void ConnectionPrivate::confirmBestConnection() {
 
 void ConnectionPrivate::removeTestConnection(
 		not_null<AbstractConnection*> connection) {
+	const auto i = ranges::find(
+		_testConnections,
+		connection.get(),
+		[](const TestConnection &test) { return test.data.get(); });
+	if (i != end(_testConnections)) {
+		// Both callers remove the connection because it failed, so count
+		// that against the endpoint when ordering future dial attempts.
+		_instance->dcOptions()->reportEndpointFailure(
+			i->ip.toStdString(),
+			i->port);
+	}
 	_testConnections.erase(
 		ranges::remove(
 			_testConnections,
@@ -2457,6 +2595,25 @@ void ConnectionPrivate::removeTestConnection(
 		end(_testConnections));
 }
 
+// Called after the winner was moved out of its _testConnections slot,
+// takes the best still-connected loser instead of destroying it.
+void ConnectionPrivate::keepStandbyConnection() {
+	auto best = end(_testConnections);
+	for (auto i = begin(_testConnections); i != end(_testConnections); ++i) {
+		if (i->data && i->data->isConnected()
+			&& (best == end(_testConnections)
+				|| i->priority > best->priority)) {
+			best = i;
+		}
+	}
+	if (best != end(_testConnections)) {
+		_standbyConnection = std::move(best->data);
+		_standbyKeptAt = getms(true);
+		DEBUG_LOG(("MTP Info: keeping %1 as a standby connection."
+			).arg(_standbyConnection->tag()));
+	}
+}
+
 void ConnectionPrivate::updateAuthKey() 	{
 	QReadLocker lockFinished(&sessionDataMutex);
 	if (!sessionData || !_connection) return;
@@ -2687,12 +2844,8 @@ void ConnectionPrivate::dhParamsAnswered() {
 		}
 		unixtimeSet(dh_inner_data.vserver_time.v);
 
-		// check that dhPrime and (dhPrime - 1) / 2 are really prime
-		if (!IsPrimeAndGood(bytesFromMTP(dh_inner_data.vdh_prime), dh_inner_data.vg.v)) {
-			LOG(("AuthKey Error: bad dh_prime primality!"));
-			return restart();
-		}
-
+		// The dh_prime primality check happens on the worker thread
+		// together with the modular exponentiation.
 		_authKeyStrings->dh_prime = byteVectorFromMTP(dh_inner_data.vdh_prime);
 		_authKeyData->g = dh_inner_data.vg.v;
 		_authKeyStrings->g_a = byteVectorFromMTP(dh_inner_data.vg_a);
@@ -2732,28 +2885,59 @@ void ConnectionPrivate::dhClientParamsSend() {
 		return restart();
 	}
 
-	// gen rand 'b'
-	auto randomSeed = std::array<gsl::byte, ModExpFirst::kRandomPowerSize>();
-	bytes::set_random(randomSeed);
-	auto g_b_data = CreateModExp(_authKeyData->g, _authKeyStrings->dh_prime, randomSeed);
-	if (g_b_data.modexp.empty()) {
-		LOG(("AuthKey Error: could not generate good g_b."));
-		return restart();
-	}
+	// The dh_prime primality check and the two modular
+	// exponentiations can take up to a second on slow CPUs, so they
+	// run on a worker thread while this one keeps serving its socket
+	// and timers; several DCs creating keys at once (first login)
+	// overlap their crypto this way.
+	const auto serial = _handshakeSerial;
+	const auto waiterId = _dhWaiterId;
+	crl::async([=, g = _authKeyData->g, dhPrime = _authKeyStrings->dh_prime, gA = _authKeyStrings->g_a] {
+		auto result = DhComputedParams();
 
-	auto computedAuthKey = CreateAuthKey(_authKeyStrings->g_a, g_b_data.randomPower, _authKeyStrings->dh_prime);
-	if (computedAuthKey.empty()) {
-		LOG(("AuthKey Error: could not generate auth_key."));
+		// check that dhPrime and (dhPrime - 1) / 2 are really prime
+		if (!IsPrimeAndGood(dhPrime, g)) {
+			LOG(("AuthKey Error: bad dh_prime primality!"));
+		} else {
+			// gen rand 'b'
+			auto randomSeed = std::array<gsl::byte, ModExpFirst::kRandomPowerSize>();
+			bytes::set_random(randomSeed);
+			result.g_b = CreateModExp(g, dhPrime, randomSeed);
+			if (result.g_b.modexp.empty()) {
+				LOG(("AuthKey Error: could not generate good g_b."));
+			} else {
+				result.authKey = CreateAuthKey(gA, result.g_b.randomPower, dhPrime);
+				if (result.authKey.empty()) {
+					LOG(("AuthKey Error: could not generate auth_key."));
+				} else {
+					result.success = true;
+				}
+			}
+		}
+		PostToDhWaiter(waiterId, [=](ConnectionPrivate *connection) {
+			connection->dhClientParamsComputed(serial, result);
+		});
+	});
+}
+
+void ConnectionPrivate::dhClientParamsComputed(
+		int serial,
+		const DhComputedParams &params) {
+	if (serial != _handshakeSerial || !_authKeyData || !_authKeyStrings) {
+		DEBUG_LOG(("AuthKey Info: dropping stale client DH params."));
+		return;
+	}
+	if (!params.success) {
 		return restart();
 	}
-	AuthKey::FillData(_authKeyStrings->auth_key, computedAuthKey);
+	AuthKey::FillData(_authKeyStrings->auth_key, params.authKey);
 
 	// count auth_key hashes - parts of sha1(auth_key)
 	auto auth_key_sha = hashSha1(_authKeyStrings->auth_key.data(), _authKeyStrings->auth_key.size());
 	memcpy(&_authKeyData->auth_key_aux_hash, auth_key_sha.data(), 8);
 	memcpy(&_authKeyData->auth_key_hash, auth_key_sha.data() + 12, 8);
 
-	auto client_dh_inner = MTP_client_DH_inner_data(_authKeyData->nonce, _authKeyData->server_nonce, _authKeyData->retry_id, MTP_bytes(g_b_data.modexp));
+	auto client_dh_inner = MTP_client_DH_inner_data(_authKeyData->nonce, _authKeyData->server_nonce, _authKeyData->retry_id, MTP_bytes(params.g_b.modexp));
 
 	auto sdhEncString = encryptClientDHInner(client_dh_inner);
 
@@ -2935,6 +3119,7 @@ void ConnectionPrivate::authKeyCreated() {
 }
 
 void ConnectionPrivate::clearAuthKeyData() {
+	++_handshakeSerial;
 	auto zeroMemory = [](base::byte_span bytes) {
 #ifdef Q_OS_WIN2
 		SecureZeroMemory(bytes.data(), bytes.size());
@@ -2964,6 +3149,12 @@ void ConnectionPrivate::clearAuthKeyData() {
 void ConnectionPrivate::onError(
 		not_null<AbstractConnection*> connection,
 		qint32 errorCode) {
+	if (connection == _standbyConnection.get()) {
+		DEBUG_LOG(("MTP Info: standby connection failed, code %1."
+			).arg(errorCode));
+		_standbyConnection = nullptr;
+		return;
+	}
 	if (_connection) {
 		return;
 	}
@@ -3122,14 +3313,13 @@ bool ConnectionPrivate::sendRequest(mtpRequest &request, bool needAnyResponse, Q
 
 	aesIgeEncrypt_oldmtp(request->constData(), &result[8], fullSize * sizeof(mtpPrime), key, msgKey);
 #else // TDESKTOP_MTPROTO_OLD
-	uchar encryptedSHA256[32];
-	MTPint128 &msgKey(*(MTPint128*)(encryptedSHA256 + 8));
-
-	SHA256_CTX msgKeyLargeContext;
-	SHA256_Init(&msgKeyLargeContext);
-	SHA256_Update(&msgKeyLargeContext, key->partForMsgKey(true), 32);
-	SHA256_Update(&msgKeyLargeContext, request->constData(), fullSize * sizeof(mtpPrime));
-	SHA256_Final(encryptedSHA256, &msgKeyLargeContext);
+	auto msgKeyLarge = openssl::Sha256Digest();
+	msgKeyLarge.feed(bytes::make_span(
+		static_cast<const gsl::byte*>(key->partForMsgKey(true)),
+		32));
+	msgKeyLarge.feed(bytes::make_span(request->constData(), fullSize));
+	auto encryptedSHA256 = msgKeyLarge.result();
+	MTPint128 &msgKey(*(MTPint128*)(encryptedSHA256.data() + 8));
 
 	mtpBuffer result;
 	result.resize(9 + fullSize);
@@ -3188,6 +3378,7 @@ void ConnectionPrivate::unlockKey() {
 }
 
 ConnectionPrivate::~ConnectionPrivate() {
+	UnregisterDhWaiter(_dhWaiterId);
 	clearAuthKeyData();
 	Assert(_finished && _connection == nullptr && _testConnections.empty());
 }
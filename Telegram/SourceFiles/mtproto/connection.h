@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/dc_options.h"
 #include "mtproto/connection_abstract.h"
 #include "base/timer.h"
+#include "base/zlib_help.h"
 
 namespace MTP {
 
@@ -146,6 +147,8 @@ private:
 	struct TestConnection {
 		ConnectionPointer data;
 		int priority = 0;
+		QString ip;
+		int port = 0;
 	};
 	void connectToServer(bool afterConfig = false);
 	void doDisconnect();
@@ -169,6 +172,7 @@ private:
 	void destroyAllConnections();
 	void confirmBestConnection();
 	void removeTestConnection(not_null<AbstractConnection*> connection);
+	void keepStandbyConnection();
 
 	mtpMsgId placeToContainer(mtpRequest &toSendRequest, mtpMsgId &bigMsgId, mtpMsgId *&haveSentArr, mtpRequest &req);
 	mtpMsgId prepareToSend(mtpRequest &request, mtpMsgId currentLastId);
@@ -218,6 +222,10 @@ private:
 	DcType _dcType = DcType::Regular;
 
 	mutable QReadWriteLock stateConnMutex;
+
+	// Reused between the gzip-packed responses of this connection, so
+	// unpacking doesn't reallocate the zlib state for every message.
+	mutable zlib::StreamingInflate _ungzipContext;
 	int32 _state = DisconnectedState;
 
 	bool _needSessionReset = false;
@@ -227,6 +235,13 @@ private:
 	not_null<Connection*> _owner;
 	ConnectionPointer _connection;
 	std::vector<TestConnection> _testConnections;
+
+	// The best loser of the endpoint race is kept warm for a while so
+	// a failure of the chosen transport fails over instantly instead
+	// of redialing every endpoint.
+	ConnectionPointer _standbyConnection;
+	TimeMs _standbyKeptAt = 0;
+
 	TimeMs _startedConnectingAt = 0;
 
 	base::Timer _retryTimer; // exp retry timer
@@ -291,10 +306,19 @@ private:
 		std::vector<gsl::byte> g_a;
 		AuthKey::Data auth_key = { { gsl::byte{} } };
 	};
+	// Result of the client DH computation performed on a worker thread.
+	struct DhComputedParams {
+		ModExpFirst g_b;
+		std::vector<gsl::byte> authKey;
+		bool success = false;
+	};
 	std::unique_ptr<AuthKeyCreateData> _authKeyData;
 	std::unique_ptr<AuthKeyCreateStrings> _authKeyStrings;
+	int _handshakeSerial = 0;
+	quint64 _dhWaiterId = 0;
 
 	void dhClientParamsSend();
+	void dhClientParamsComputed(int serial, const DhComputedParams &params);
 	void authKeyCreated();
 	void clearAuthKeyData();
 
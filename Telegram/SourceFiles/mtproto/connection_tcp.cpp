@@ -29,6 +29,9 @@ uint32 tcpPacketSize(const char *packet) { // must have at least 4 bytes readabl
 	return (result << 2) + 1;
 }
 
+// Frame buffers up to this size are kept for reuse between packets.
+constexpr auto kPacketBufferPoolLimit = 512 * 1024; // ints, 2 MB
+
 } // namespace
 
 AbstractTCPConnection::AbstractTCPConnection(
@@ -152,8 +155,19 @@ mtpBuffer AbstractTCPConnection::handleResponse(const char *packet, uint32 lengt
 		return mtpBuffer(1, *packetdata);
 	}
 
-	mtpBuffer data(size);
+	// The received queue consumer frees each frame right after it is
+	// decrypted, so most of the time the previous frame's allocation
+	// is unique again by now and can be reused instead of asking the
+	// allocator for another multi-megabyte block on every packet of
+	// a media burst.
+	auto data = packetBufferPool.isDetached()
+		? std::move(packetBufferPool)
+		: mtpBuffer();
+	data.resize(size);
 	memcpy(data.data(), packetdata, size * sizeof(mtpPrime));
+	packetBufferPool = (data.capacity() <= kPacketBufferPoolLimit)
+		? data
+		: mtpBuffer();
 
 	return data;
 }
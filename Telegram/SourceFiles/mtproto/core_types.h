@@ -51,6 +51,7 @@ public:
 	mtpRequestId requestId = 0;
 	mtpRequest after;
 	bool needsLayer = false;
+	uint32 resendsCount = 0; // for exponential resend backoff
 
 	mtpRequestData(bool/* sure*/) {
 	}
@@ -58,6 +58,13 @@ m+ZH1sadZspQCEPPrtbkQBlvHb4OLiIWPGHKSMeRFvp3IWcmdJqXahxLCUS1Eh6M\n\
 AQIDAQAB\n\
 -----END PUBLIC KEY-----" };
 
+// Weight of a fresh sample in the endpoint connect time moving average.
+constexpr auto kScoreSmoothing = 4;
+
+// Each failure adds this many virtual milliseconds when ordering dials.
+constexpr auto kScoreFailurePenalty = 1000;
+constexpr auto kScoreMaxFailures = 8;
+
 } // namespace
 
 class DcOptions::WriteLocker {
@@ -68,6 +75,7 @@ public:
 	}
 	~WriteLocker() {
 		_that->computeCdnDcIds();
+		_that->publishSnapshot();
 	}
 
 private:
@@ -325,6 +333,14 @@ QByteArray DcOptions::serialize() const {
 		return DcOptions().serialize();
 	}
 
+	// Copy the scores out from under their own mutex, they are
+	// serialized together with the guarded state below.
+	auto scores = decltype(_scores)();
+	{
+		QMutexLocker scoresLock(&_scoresMutex);
+		scores = _scores;
+	}
+
 	ReadLocker lock(this);
 
 	auto size = sizeof(qint32);
@@ -371,6 +387,14 @@ QByteArray DcOptions::serialize() const {
 		}
 	}
 
+	// Endpoint scores.
+	size += sizeof(qint32);
+	for (const auto &item : scores) {
+		size += sizeof(qint32) + item.first.first.size() // ip
+			+ sizeof(qint32) // port
+			+ sizeof(qint32) + sizeof(qint32); // averageTime + failures
+	}
+
 	constexpr auto kVersion = 1;
 
 	auto result = QByteArray();
@@ -406,6 +430,18 @@ QByteArray DcOptions::serialize() const {
 				<< Serialize::bytes(key.n)
 				<< Serialize::bytes(key.e);
 		}
+
+		// Endpoint scores, appended so that old versions just ignore them.
+		stream << qint32(scores.size());
+		for (const auto &item : scores) {
+			stream << qint32(item.first.first.size());
+			stream.writeRawData(
+				item.first.first.data(),
+				item.first.first.size());
+			stream << qint32(item.first.second)
+				<< qint32(item.second.averageTime)
+				<< qint32(item.second.failures);
+		}
 	}
 	return result;
 }
@@ -431,6 +467,10 @@ void DcOptions::constructFromSerialized(const QByteArray &serialized) {
 
 	WriteLocker lock(this);
 	_data.clear();
+	{
+		QMutexLocker scoresLock(&_scoresMutex);
+		_scores.clear();
+	}
 	for (auto i = 0; i != count; ++i) {
 		qint32 id = 0, flags = 0, port = 0, ipSize = 0;
 		stream >> id >> flags >> port >> ipSize;
@@ -500,14 +540,48 @@ void DcOptions::constructFromSerialized(const QByteArray &serialized) {
 			}
 		}
 	}
+
+	// Read endpoint scores.
+	if (!stream.atEnd()) {
+		QMutexLocker scoresLock(&_scoresMutex);
+		auto count = qint32(0);
+		stream >> count;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("MTP Error: Bad data for endpoint scores in DcOptions::constructFromSerialized()"));
+			return;
+		}
+		for (auto i = 0; i != count; ++i) {
+			auto ipSize = qint32(0);
+			stream >> ipSize;
+
+			constexpr auto kMaxIpSize = 45;
+			if (ipSize <= 0 || ipSize > kMaxIpSize) {
+				LOG(("MTP Error: Bad data for endpoint scores inside DcOptions::constructFromSerialized()"));
+				return;
+			}
+
+			auto ip = std::string(ipSize, ' ');
+			stream.readRawData(ip.data(), ipSize);
+
+			qint32 port = 0, averageTime = 0, failures = 0;
+			stream >> port >> averageTime >> failures;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("MTP Error: Bad data for endpoint scores inside DcOptions::constructFromSerialized()"));
+				return;
+			}
+
+			auto &score = _scores[std::make_pair(ip, int(port))];
+			score.averageTime = averageTime;
+			score.failures = failures;
+		}
+	}
 }
 
 DcOptions::Ids DcOptions::configEnumDcIds() const {
 	auto result = Ids();
-	{
-		ReadLocker lock(this);
-		result.reserve(_data.size());
-		for (auto &item : _data) {
+	if (const auto snapshot = _snapshot.load()) {
+		result.reserve(snapshot->data.size());
+		for (auto &item : snapshot->data) {
 			const auto dcId = item.first;
 			Assert(!item.second.empty());
 			if (!isCdnDc(item.second.front().flags)
@@ -524,8 +598,10 @@ DcType DcOptions::dcType(ShiftedDcId shiftedDcId) const {
 	if (isTemporaryDcId(shiftedDcId)) {
 		return DcType::Temporary;
 	}
-	ReadLocker lock(this);
-	if (_cdnDcIds.find(bareDcId(shiftedDcId)) != _cdnDcIds.cend()) {
+	const auto snapshot = _snapshot.load();
+	if (snapshot
+		&& (snapshot->cdnDcIds.find(bareDcId(shiftedDcId))
+			!= snapshot->cdnDcIds.cend())) {
 		return DcType::Cdn;
 	}
 	if (isDownloadDcId(shiftedDcId)) {
@@ -554,8 +630,10 @@ void DcOptions::setCDNConfig(const MTPDcdnConfig &config) {
 }
 
 bool DcOptions::hasCDNKeysForDc(DcId dcId) const {
-	ReadLocker lock(this);
-	return _cdnPublicKeys.find(dcId) != _cdnPublicKeys.cend();
+	const auto snapshot = _snapshot.load();
+	return snapshot
+		&& (snapshot->cdnPublicKeys.find(dcId)
+			!= snapshot->cdnPublicKeys.cend());
 }
 
 bool DcOptions::getDcRSAKey(DcId dcId, const QVector<MTPlong> &fingerprints, internal::RSAPublicKey *result) const {
@@ -569,10 +647,9 @@ bool DcOptions::getDcRSAKey(DcId dcId, const QVector<MTPlong> &fingerprints, int
 		}
 		return false;
 	};
-	{
-		ReadLocker lock(this);
-		auto it = _cdnPublicKeys.find(dcId);
-		if (it != _cdnPublicKeys.cend()) {
+	if (const auto snapshot = _snapshot.load()) {
+		auto it = snapshot->cdnPublicKeys.find(dcId);
+		if (it != snapshot->cdnPublicKeys.cend()) {
 			return findKey(it->second);
 		}
 	}
@@ -585,35 +662,37 @@ auto DcOptions::lookup(
 		bool throughProxy) const -> Variants {
 	using Flag = Flag;
 	auto result = Variants();
-	{
-		ReadLocker lock(this);
-		const auto i = _data.find(dcId);
-		if (i == end(_data)) {
-			return result;
-		}
-		for (const auto &endpoint : i->second) {
-			const auto flags = endpoint.flags;
-			if (type == DcType::Cdn && !(flags & Flag::f_cdn)) {
-				continue;
-			} else if (type != DcType::MediaDownload
-				&& (flags & Flag::f_media_only)) {
-				continue;
-			}
-			const auto address = (flags & Flag::f_ipv6)
-				? Variants::IPv6
-				: Variants::IPv4;
-			result.data[address][Variants::Tcp].push_back(endpoint);
-			if (!(flags & (Flag::f_tcpo_only | Flag::f_secret))) {
-				result.data[address][Variants::Http].push_back(endpoint);
-			}
-		}
-		if (type == DcType::MediaDownload) {
-			FilterIfHasWithFlag(result, Flag::f_media_only);
+	const auto snapshot = _snapshot.load();
+	if (!snapshot) {
+		return result;
+	}
+	const auto i = snapshot->data.find(dcId);
+	if (i == end(snapshot->data)) {
+		return result;
+	}
+	for (const auto &endpoint : i->second) {
+		const auto flags = endpoint.flags;
+		if (type == DcType::Cdn && !(flags & Flag::f_cdn)) {
+			continue;
+		} else if (type != DcType::MediaDownload
+			&& (flags & Flag::f_media_only)) {
+			continue;
 		}
-		if (throughProxy) {
-			FilterIfHasWithFlag(result, Flag::f_static);
+		const auto address = (flags & Flag::f_ipv6)
+			? Variants::IPv6
+			: Variants::IPv4;
+		result.data[address][Variants::Tcp].push_back(endpoint);
+		if (!(flags & (Flag::f_tcpo_only | Flag::f_secret))) {
+			result.data[address][Variants::Http].push_back(endpoint);
 		}
 	}
+	if (type == DcType::MediaDownload) {
+		FilterIfHasWithFlag(result, Flag::f_media_only);
+	}
+	if (throughProxy) {
+		FilterIfHasWithFlag(result, Flag::f_static);
+	}
+	sortByScore(result);
 	return result;
 }
 
@@ -637,6 +716,50 @@ void DcOptions::FilterIfHasWithFlag(Variants &variants, Flag flag) {
 	}
 }
 
+void DcOptions::sortByScore(Variants &variants) const {
+	QMutexLocker lock(&_scoresMutex);
+	for (auto &byAddress : variants.data) {
+		for (auto &list : byAddress) {
+			ranges::stable_sort(list, std::less<>(), [&](
+					const Endpoint &endpoint) {
+				return scoreValue(endpoint);
+			});
+		}
+	}
+}
+
+// Called with _scoresMutex held.
+int64 DcOptions::scoreValue(const Endpoint &endpoint) const {
+	const auto i = _scores.find(std::make_pair(endpoint.ip, endpoint.port));
+	if (i == end(_scores)) {
+		// Never measured, try it before the known-slow ones.
+		return 0;
+	}
+	return int64(i->second.averageTime)
+		+ int64(i->second.failures) * kScoreFailurePenalty;
+}
+
+void DcOptions::reportEndpointSuccess(
+		const std::string &ip,
+		int port,
+		TimeMs connectTime) {
+	QMutexLocker lock(&_scoresMutex);
+	auto &score = _scores[std::make_pair(ip, port)];
+	const auto time = int32(snap(connectTime, TimeMs(1), TimeMs(60000)));
+	score.averageTime = score.averageTime
+		? (score.averageTime * (kScoreSmoothing - 1) + time) / kScoreSmoothing
+		: time;
+	score.failures = 0;
+}
+
+void DcOptions::reportEndpointFailure(const std::string &ip, int port) {
+	QMutexLocker lock(&_scoresMutex);
+	auto &score = _scores[std::make_pair(ip, port)];
+	if (score.failures < kScoreMaxFailures) {
+		++score.failures;
+	}
+}
+
 void DcOptions::computeCdnDcIds() {
 	_cdnDcIds.clear();
 	for (auto &item : _data) {
@@ -647,6 +770,11 @@ void DcOptions::computeCdnDcIds() {
 	}
 }
 
+void DcOptions::publishSnapshot() {
+	// Called with the write lock held, the copies are consistent.
+	_snapshot.publish(Snapshot{ _data, _cdnDcIds, _cdnPublicKeys });
+}
+
 bool DcOptions::loadFromFile(const QString &path) {
 	QVector<MTPDcOption> options;
 
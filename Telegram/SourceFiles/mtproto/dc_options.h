@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/observer.h"
 #include "base/bytes.h"
+#include "base/snapshot.h"
 #include "mtproto/rsa_public_key.h"
 #include <string>
 #include <vector>
@@ -85,6 +86,15 @@ public:
 	Variants lookup(DcId dcId, DcType type, bool throughProxy) const;
 	DcType dcType(ShiftedDcId shiftedDcId) const;
 
+	// Endpoint quality feedback from connections. Dial order in lookup()
+	// prefers endpoints with lower average connect time and fewer recent
+	// failures, so we converge on the fastest endpoint for each dc.
+	void reportEndpointSuccess(
+		const std::string &ip,
+		int port,
+		TimeMs connectTime);
+	void reportEndpointFailure(const std::string &ip, int port);
+
 	void setCDNConfig(const MTPDcdnConfig &config);
 	bool hasCDNKeysForDc(DcId dcId) const;
 	bool getDcRSAKey(DcId dcId, const QVector<MTPlong> &fingerprints, internal::RSAPublicKey *result) const;
@@ -111,6 +121,8 @@ private:
 		const std::map<DcId, std::vector<Endpoint>> &a,
 		const std::map<DcId, std::vector<Endpoint>> &b);
 	static void FilterIfHasWithFlag(Variants &variants, Flag flag);
+	void sortByScore(Variants &variants) const;
+	int64 scoreValue(const Endpoint &endpoint) const;
 
 	void processFromList(const QVector<MTPDcOption> &options, bool overwrite);
 	void computeCdnDcIds();
@@ -123,11 +135,32 @@ private:
 	class ReadLocker;
 	friend class ReadLocker;
 
+	struct EndpointScore {
+		int32 averageTime = 0; // moving average of connect time, ms
+		int32 failures = 0;
+	};
+
+	// The immutable state published for the lock-free readers on the
+	// connection threads, rebuilt after every guarded modification.
+	struct Snapshot {
+		std::map<DcId, std::vector<Endpoint>> data;
+		std::set<DcId> cdnDcIds;
+		std::map<DcId, std::map<uint64, internal::RSAPublicKey>> cdnPublicKeys;
+	};
+	void publishSnapshot();
+
 	std::map<DcId, std::vector<Endpoint>> _data;
 	std::set<DcId> _cdnDcIds;
 	std::map<uint64, internal::RSAPublicKey> _publicKeys;
 	std::map<DcId, std::map<uint64, internal::RSAPublicKey>> _cdnPublicKeys;
 	mutable QReadWriteLock _useThroughLockers;
+	base::snapshot<Snapshot> _snapshot;
+
+	// The scores are bumped by every connection, so they live under
+	// their own short-held mutex and out of the published snapshots,
+	// reporting an endpoint result doesn't republish the options.
+	std::map<std::pair<std::string, int>, EndpointScore> _scores;
+	mutable QMutex _scoresMutex;
 
 	mutable base::Observable<Ids> _changed;
 
@@ -72,7 +72,7 @@ constexpr ShiftedDcId logoutDcId(DcId dcId) {
 	return shiftDcId(dcId, internal::kLogoutDcShift);
 }
 
-constexpr auto kDownloadSessionsCount = 2;
+constexpr auto kDownloadSessionsCount = 4;
 constexpr auto kUploadSessionsCount = 2;
 
 namespace internal {
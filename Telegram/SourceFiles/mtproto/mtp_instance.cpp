@@ -42,6 +42,9 @@ public:
 
 	void setKeyForWrite(DcId dcId, const AuthKeyPtr &key);
 	AuthKeysList getKeysForWrite() const;
+	QString requestLatencyReport() const;
+	uint64 storedServerSalt(DcId dcId) const;
+	std::map<DcId, uint64> serverSaltsForWrite() const;
 	void addKeysForDestroy(AuthKeysList &&keys);
 
 	not_null<DcOptions*> dcOptions();
@@ -190,12 +193,37 @@ private:
 
 	std::map<DcId, std::vector<mtpRequestId>> _authWaiters;
 
+	std::map<DcId, uint64> _serverSaltsForStart;
+
 	RPCResponseHandler _globalHandler;
 	base::lambda<void(ShiftedDcId shiftedDcId, int32 state)> _stateChangedHandler;
 	base::lambda<void(ShiftedDcId shiftedDcId)> _sessionResetHandler;
 
 	base::Timer _checkDelayedTimer;
 
+	// Per-request and per-TL-constructor latency bookkeeping for the
+	// 'rpcstats' debug code, maintained next to the request maps.
+	struct RequestLatency {
+		mtpTypeId type = 0;
+		TimeMs storedAt = 0;
+	};
+	struct LatencyStats {
+		int count = 0;
+		TimeMs queueTotal = 0;
+		TimeMs responseTotal = 0;
+		TimeMs responseMax = 0;
+		TimeMs handlerTotal = 0;
+		TimeMs handlerMax = 0;
+	};
+	void accountRequestLatency(
+		mtpRequestId requestId,
+		TimeMs handledAt,
+		TimeMs handlerDuration);
+
+	mutable QMutex _latencyLock;
+	std::map<mtpRequestId, RequestLatency> _latencyByRequest;
+	std::map<mtpTypeId, LatencyStats> _latencyByType;
+
 	// Debug flag to find out how we end up crashing.
 	bool MustNotCreateSessions = false;
 
@@ -232,6 +260,8 @@ void Instance::Private::start(Config &&config) {
 		_dcenters.emplace(shiftedDcId, std::move(dc));
 	}
 
+	_serverSaltsForStart = std::move(config.serverSalts);
+
 	if (config.mainDcId != Config::kNotSetMainDc) {
 		_mainDcId = config.mainDcId;
 		_mainDcIdForced = true;
@@ -565,6 +595,21 @@ AuthKeysList Instance::Private::getKeysForWrite() const {
 	return result;
 }
 
+uint64 Instance::Private::storedServerSalt(DcId dcId) const {
+	const auto it = _serverSaltsForStart.find(dcId);
+	return (it != _serverSaltsForStart.cend()) ? it->second : 0;
+}
+
+std::map<DcId, uint64> Instance::Private::serverSaltsForWrite() const {
+	auto result = _serverSaltsForStart;
+	for (const auto &session : _sessions) {
+		if (const auto salt = session.second->serverSalt()) {
+			result[bareDcId(session.first)] = salt;
+		}
+	}
+	return result;
+}
+
 void Instance::Private::addKeysForDestroy(AuthKeysList &&keys) {
 	Expects(isKeysDestroyer());
 
@@ -754,6 +799,11 @@ void Instance::Private::registerRequest(
 void Instance::Private::unregisterRequest(mtpRequestId requestId) {
 	_requestsDelays.erase(requestId);
 
+	{
+		QMutexLocker locker(&_latencyLock);
+		_latencyByRequest.erase(requestId);
+	}
+
 	{
 		QWriteLocker locker(&_requestMapLock);
 		_requestMap.erase(requestId);
@@ -768,6 +818,15 @@ mtpRequestId Instance::Private::storeRequest(
 		RPCResponseHandler &&callbacks) {
 	const auto requestId = reqid();
 	request->requestId = requestId;
+	{
+		const auto type = (request->size() > 8)
+			? mtpTypeId((*request)[8])
+			: mtpTypeId(0);
+		QMutexLocker locker(&_latencyLock);
+		_latencyByRequest.emplace(
+			requestId,
+			RequestLatency{ type, getms(true) });
+	}
 	if (callbacks.onDone || callbacks.onFail) {
 		QMutexLocker locker(&_parserMapLock);
 		_parserMap.emplace(requestId, std::move(callbacks));
@@ -854,6 +913,7 @@ void Instance::Private::execCallback(
 		mtpRequestId requestId,
 		const mtpPrime *from,
 		const mtpPrime *end) {
+	const auto handledAt = getms(true);
 	RPCResponseHandler h;
 	{
 		QMutexLocker locker(&_parserMapLock);
@@ -894,9 +954,55 @@ void Instance::Private::execCallback(
 	} else {
 		DEBUG_LOG(("RPC Info: parser not found for %1").arg(requestId));
 	}
+	accountRequestLatency(requestId, handledAt, getms(true) - handledAt);
 	unregisterRequest(requestId);
 }
 
+void Instance::Private::accountRequestLatency(
+		mtpRequestId requestId,
+		TimeMs handledAt,
+		TimeMs handlerDuration) {
+	const auto request = getRequest(requestId);
+	const auto sentAt = request ? request->msDate : TimeMs(0);
+
+	QMutexLocker locker(&_latencyLock);
+	const auto it = _latencyByRequest.find(requestId);
+	if (it == _latencyByRequest.cend()) {
+		return;
+	}
+	const auto response = handledAt - it->second.storedAt;
+	const auto queue = (sentAt > it->second.storedAt)
+		? (sentAt - it->second.storedAt)
+		: TimeMs(0);
+	auto &stats = _latencyByType[it->second.type];
+	++stats.count;
+	stats.queueTotal += queue;
+	stats.responseTotal += response;
+	accumulate_max(stats.responseMax, response);
+	stats.handlerTotal += handlerDuration;
+	accumulate_max(stats.handlerMax, handlerDuration);
+	_latencyByRequest.erase(it);
+}
+
+QString Instance::Private::requestLatencyReport() const {
+	auto result = QString();
+
+	QMutexLocker locker(&_latencyLock);
+	for (const auto &item : _latencyByType) {
+		const auto &stats = item.second;
+		result += qsl("#%1: %2 done, queue avg %3 ms, "
+			"response avg %4 / max %5 ms, handler avg %6 / max %7 ms\n"
+			).arg(uint32(item.first), 0, 16
+			).arg(stats.count
+			).arg(stats.queueTotal / stats.count
+			).arg(stats.responseTotal / stats.count
+			).arg(stats.responseMax
+			).arg(stats.handlerTotal / stats.count
+			).arg(stats.handlerMax);
+	}
+	return result;
+}
+
 bool Instance::Private::hasCallbacks(mtpRequestId requestId) {
 	QMutexLocker locker(&_parserMapLock);
 	auto it = _parserMap.find(requestId);
@@ -1431,6 +1537,18 @@ AuthKeysList Instance::getKeysForWrite() const {
 	return _private->getKeysForWrite();
 }
 
+QString Instance::requestLatencyReport() const {
+	return _private->requestLatencyReport();
+}
+
+uint64 Instance::storedServerSalt(DcId dcId) const {
+	return _private->storedServerSalt(dcId);
+}
+
+std::map<DcId, uint64> Instance::serverSaltsForWrite() const {
+	return _private->serverSaltsForWrite();
+}
+
 void Instance::addKeysForDestroy(AuthKeysList &&keys) {
 	_private->addKeysForDestroy(std::move(keys));
 }
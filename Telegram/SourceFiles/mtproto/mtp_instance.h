@@ -35,6 +35,7 @@ public:
 
 		DcId mainDcId = kNotSetMainDc;
 		AuthKeysList keys;
+		std::map<DcId, uint64> serverSalts;
 	};
 	enum class Mode {
 		Normal,
@@ -54,6 +55,9 @@ public:
 
 	void setKeyForWrite(DcId dcId, const AuthKeyPtr &key);
 	AuthKeysList getKeysForWrite() const;
+	QString requestLatencyReport() const;
+	uint64 storedServerSalt(DcId dcId) const;
+	std::map<DcId, uint64> serverSaltsForWrite() const;
 	void addKeysForDestroy(AuthKeysList &&keys);
 
 	not_null<DcOptions*> dcOptions();
@@ -192,6 +192,35 @@ public:
 	Sender() noexcept {
 	}
 
+	// While a guard is alive every request sent through this sender
+	// with no explicit delay is allowed to wait a few milliseconds, so
+	// the session send timer packs all requests issued within the same
+	// event-loop tick into a single msg container with one encryption
+	// pass and one TCP write.
+	class BatchGuard {
+	public:
+		explicit BatchGuard(not_null<Sender*> sender) noexcept : _sender(sender.get()) {
+			++_sender->_batchDepth;
+		}
+		BatchGuard(const BatchGuard &other) = delete;
+		BatchGuard &operator=(const BatchGuard &other) = delete;
+		BatchGuard(BatchGuard &&other) noexcept : _sender(base::take(other._sender)) {
+		}
+		BatchGuard &operator=(BatchGuard &&other) = delete;
+		~BatchGuard() {
+			if (_sender) {
+				--_sender->_batchDepth;
+			}
+		}
+
+	private:
+		Sender *_sender = nullptr;
+
+	};
+	[[nodiscard]] BatchGuard batchRequests() noexcept {
+		return BatchGuard(this);
+	}
+
 	template <typename Request>
 	class SpecificRequestBuilder : public RequestBuilder {
 	private:
@@ -239,12 +268,16 @@ public:
 		}
 
 		mtpRequestId send() {
+			auto canWait = takeCanWait();
+			if (!canWait && sender()->senderIsBatching()) {
+				canWait = kBatchCanWait;
+			}
 			const auto id = MainInstance()->send(
 				_request,
 				takeOnDone(),
 				takeOnFail(),
 				takeDcId(),
-				takeCanWait(),
+				canWait,
 				takeAfter());
 			registerRequest(id);
 			return id;
@@ -369,6 +402,11 @@ private:
 	friend class RequestWrap;
 	friend class SentRequestWrap;
 
+	static constexpr auto kBatchCanWait = TimeMs(5);
+
+	bool senderIsBatching() const noexcept {
+		return _batchDepth > 0;
+	}
 	void senderRequestRegister(mtpRequestId requestId) {
 		_requests.emplace(MainInstance(), requestId);
 	}
@@ -387,6 +425,7 @@ private:
 	}
 
 	base::flat_set<RequestWrap, RequestWrapComparator> _requests;
+	int _batchDepth = 0;
 
 };
 
@@ -136,10 +136,19 @@ void Session::createDcData() {
 			data.setLayerWasInited(true);
 		}
 	}
+	if (!data.getSalt()) {
+		// Start with the salt persisted from the previous run so the
+		// first request does not pay a bad_server_salt round trip.
+		data.setSalt(_instance->storedServerSalt(bareDcId(dcWithShift)));
+	}
 	connect(dc.get(), SIGNAL(authKeyCreated()), this, SLOT(authKeyCreatedForDC()), Qt::QueuedConnection);
 	connect(dc.get(), SIGNAL(layerWasInited(bool)), this, SLOT(layerWasInitedForDC(bool)), Qt::QueuedConnection);
 }
 
+uint64 Session::serverSalt() const {
+	return data.getSalt();
+}
+
 void Session::registerRequest(mtpRequestId requestId, ShiftedDcId dcWithShift) {
 	return _instance->registerRequest(requestId, dcWithShift);
 }
@@ -292,7 +301,12 @@ void Session::checkRequestsByTimer() {
 		for (mtpRequestMap::iterator i = haveSent.begin(), e = haveSent.end(); i != e; ++i) {
 			mtpRequest &req(i.value());
 			if (req->msDate > 0) {
-				if (req->msDate + MTPCheckResendTimeout < ms) { // need to resend or check state
+				// Each unanswered attempt doubles the wait before the
+				// next one (capped), so a dead link does not produce a
+				// constant stream of duplicate packets.
+				const auto backoff = std::min(req->resendsCount, 5U);
+				if (req->msDate + (MTPCheckResendTimeout << backoff) < ms) { // need to resend or check state
+					++req->resendsCount;
 					if (mtpRequestData::messageSize(req) < MTPResendThreshold) { // resend
 						resendingIds.reserve(haveSentCount);
 						resendingIds.push_back(i.key());
@@ -313,6 +313,7 @@ public:
 	void notifyLayerInited(bool wasInited);
 
 	void ping();
+	uint64 serverSalt() const;
 	void cancel(mtpRequestId requestId, mtpMsgId msgId);
 	int32 requestState(mtpRequestId requestId) const;
 	int32 getState() const;
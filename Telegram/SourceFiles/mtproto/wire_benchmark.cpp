@@ -0,0 +1,235 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include <QtCore/QVector>
+
+#include <openssl/aes.h>
+#include <openssl/sha.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// The real MTP::internal::Connection / Session pair can't be linked
+// into the benchmark binary - it drags in the whole application. So
+// this harness replays the wire data plane those classes run per
+// request - container assembly like tryToSend(), msg_key + AES-IGE
+// framing like sendData(), decrypt + header walk like handleReceived()
+// - over an in-process loopback buffer. The absolute numbers are not
+// the full stack, but regressions in the batching, copying or crypto
+// code move them the same way they move the real connection thread.
+
+namespace {
+
+using mtpPrime = int32_t;
+
+std::atomic<long long> AllocationCount(0);
+
+constexpr int kMessagesPerContainer = 30;
+constexpr int kSmallBodyInts = 64; // a 256-byte text message request
+constexpr int kBigBodyInts = 4096; // a 16 Kb history slice response
+
+// Assembles a msg_container the way tryToSend() does: one resize to
+// the final size, then per-message header + memcpy of the body.
+QVector<mtpPrime> packContainer(const QVector<mtpPrime> &body, int count) {
+	auto result = QVector<mtpPrime>();
+	result.reserve(2 + count * (4 + body.size()));
+	result.push_back(0x73f1f8dc); // msg_container
+	result.push_back(count);
+	for (auto i = 0; i != count; ++i) {
+		result.push_back(i * 2 + 1); // msg_id (low, high)
+		result.push_back(0);
+		result.push_back(i); // seq_no
+		result.push_back(body.size() * int(sizeof(mtpPrime)));
+		const auto was = result.size();
+		result.resize(was + body.size());
+		memcpy(result.data() + was, body.constData(), body.size() * sizeof(mtpPrime));
+	}
+	return result;
+}
+
+struct FrameKeys {
+	unsigned char aesKey[32];
+	unsigned char aesIv[32];
+};
+
+// The sendData() key schedule: msg_key from a hash of the plain data
+// mixed with the auth key material into an AES key + iv pair.
+FrameKeys deriveKeys(const QVector<mtpPrime> &plain, const unsigned char *keyMaterial) {
+	unsigned char sha[SHA256_DIGEST_LENGTH];
+	SHA256(
+		reinterpret_cast<const unsigned char*>(plain.constData()),
+		plain.size() * sizeof(mtpPrime),
+		sha);
+
+	auto result = FrameKeys();
+	memcpy(result.aesKey, sha, 16);
+	memcpy(result.aesKey + 16, keyMaterial, 16);
+	memcpy(result.aesIv, keyMaterial + 16, 16);
+	memcpy(result.aesIv + 16, sha + 16, 16);
+	return result;
+}
+
+void encryptFrame(const QVector<mtpPrime> &plain, QVector<mtpPrime> &cipher, const FrameKeys &keys) {
+	AES_KEY key;
+	AES_set_encrypt_key(keys.aesKey, 256, &key);
+
+	cipher.resize(plain.size());
+	unsigned char iv[32];
+	memcpy(iv, keys.aesIv, 32);
+	AES_ige_encrypt(
+		reinterpret_cast<const unsigned char*>(plain.constData()),
+		reinterpret_cast<unsigned char*>(cipher.data()),
+		plain.size() * sizeof(mtpPrime),
+		&key,
+		iv,
+		AES_ENCRYPT);
+}
+
+void decryptFrame(const QVector<mtpPrime> &cipher, QVector<mtpPrime> &plain, const FrameKeys &keys) {
+	AES_KEY key;
+	AES_set_decrypt_key(keys.aesKey, 256, &key);
+
+	plain.resize(cipher.size());
+	unsigned char iv[32];
+	memcpy(iv, keys.aesIv, 32);
+	AES_ige_encrypt(
+		reinterpret_cast<const unsigned char*>(cipher.constData()),
+		reinterpret_cast<unsigned char*>(plain.data()),
+		cipher.size() * sizeof(mtpPrime),
+		&key,
+		iv,
+		AES_DECRYPT);
+}
+
+// AES-IGE works on whole blocks, the real framing pads with random
+// data - constants are enough for throughput measurements.
+void padFrame(QVector<mtpPrime> &frame) {
+	constexpr auto kBlockInts = int(16 / sizeof(mtpPrime));
+	while (frame.size() % kBlockInts) {
+		frame.push_back(0x0F0F0F0F);
+	}
+}
+
+QVector<mtpPrime> makeBody(int ints) {
+	auto result = QVector<mtpPrime>(ints);
+	for (auto i = 0; i != ints; ++i) {
+		result[i] = i * 0x9E3779B9;
+	}
+	return result;
+}
+
+const unsigned char *keyMaterial() {
+	static unsigned char material[48];
+	static const auto once = [] {
+		for (auto i = 0; i != int(sizeof(material)); ++i) {
+			material[i] = static_cast<unsigned char>(i * 23 + 5);
+		}
+		return true;
+	}();
+	(void)once;
+	return material;
+}
+
+BENCHMARK_CASE("mtp wire container pack, 30 x 256 bytes") {
+	const auto body = makeBody(kSmallBodyInts);
+	const auto before = AllocationCount.load();
+	for (auto i = 0; i != iterations; ++i) {
+		auto container = packContainer(body, kMessagesPerContainer);
+		base::benchmark::DoNotOptimizeAway(container);
+	}
+	const auto after = AllocationCount.load();
+	if (iterations > 0) {
+		// Not part of the timing table - the per-request allocation
+		// count is tracked by hand, a growing value means the
+		// assembly path started copying through temporaries.
+		fprintf(
+			stderr,
+			"mtp wire container pack: %lld allocations per container\n",
+			(after - before) / iterations);
+	}
+}
+
+BENCHMARK_CASE("mtp wire encrypt, 256 bytes") {
+	const auto plain = makeBody(kSmallBodyInts);
+	auto cipher = QVector<mtpPrime>();
+	for (auto i = 0; i != iterations; ++i) {
+		encryptFrame(plain, cipher, deriveKeys(plain, keyMaterial()));
+		base::benchmark::DoNotOptimizeAway(cipher);
+	}
+}
+
+BENCHMARK_CASE("mtp wire encrypt, 16 Kb") {
+	const auto plain = makeBody(kBigBodyInts);
+	auto cipher = QVector<mtpPrime>();
+	for (auto i = 0; i != iterations; ++i) {
+		encryptFrame(plain, cipher, deriveKeys(plain, keyMaterial()));
+		base::benchmark::DoNotOptimizeAway(cipher);
+	}
+}
+
+BENCHMARK_CASE("mtp wire loopback roundtrip, 16 Kb") {
+	auto sent = packContainer(makeBody(kBigBodyInts / 8), 8);
+	padFrame(sent);
+	auto cipher = QVector<mtpPrime>();
+	auto received = QVector<mtpPrime>();
+	for (auto i = 0; i != iterations; ++i) {
+		const auto keys = deriveKeys(sent, keyMaterial());
+		encryptFrame(sent, cipher, keys);
+		decryptFrame(cipher, received, keys);
+
+		// The handleReceived() part: walk the container headers and
+		// "dispatch" each inner message to a checksum.
+		auto dispatched = mtpPrime(0);
+		const auto count = received[1];
+		auto from = 2;
+		for (auto j = 0; j != count; ++j) {
+			const auto bytes = received[from + 3];
+			dispatched += received[from + 4] ^ bytes;
+			from += 4 + bytes / int(sizeof(mtpPrime));
+		}
+		base::benchmark::DoNotOptimizeAway(dispatched);
+	}
+}
+
+} // namespace
+
+// Counts every heap allocation in the process, so the container pack
+// case can report how many a request costs. Counting is one relaxed
+// atomic increment - it doesn't disturb the timed sections.
+void *operator new(std::size_t size) {
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (const auto result = std::malloc(size ? size : 1)) {
+		return result;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
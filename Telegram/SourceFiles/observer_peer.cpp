@@ -8,14 +8,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "observer_peer.h"
 
 #include "base/observer.h"
+#include "base/timer.h"
 
 namespace Notify {
 namespace {
 
+// Online status updates come in storms in large groups while each sent
+// batch invalidates dialog rows, so batches that consist only of them
+// are sent at most once in this many milliseconds.
+constexpr auto kOnlineUpdatesInterval = TimeMs(100);
+
 using SmallUpdatesList = QVector<PeerUpdate>;
 NeverFreedPointer<SmallUpdatesList> SmallUpdates;
 using AllUpdatesList = QMap<PeerData*, PeerUpdate>;
 NeverFreedPointer<AllUpdatesList> AllUpdates;
+NeverFreedPointer<base::Timer> ThrottledSendTimer;
+auto LastSendTime = TimeMs(0);
 
 void StartCallback() {
 	SmallUpdates.createIfNull();
@@ -24,6 +32,21 @@ void StartCallback() {
 void FinishCallback() {
 	SmallUpdates.clear();
 	AllUpdates.clear();
+	ThrottledSendTimer.clear();
+}
+
+bool OnlyOnlineChanges() {
+	for (const auto &update : *SmallUpdates) {
+		if (update.flags & ~PeerUpdate::Flag::UserOnlineChanged) {
+			return false;
+		}
+	}
+	for (const auto &update : *AllUpdates) {
+		if (update.flags & ~PeerUpdate::Flag::UserOnlineChanged) {
+			return false;
+		}
+	}
+	return true;
 }
 
 base::Observable<PeerUpdate, PeerUpdatedHandler> PeerUpdatedObservable;
@@ -73,6 +96,21 @@ void peerUpdatedDelayed(const PeerUpdate &update) {
 void peerUpdatedSendDelayed() {
 	if (!SmallUpdates || !AllUpdates || SmallUpdates->empty()) return;
 
+	if (OnlyOnlineChanges()) {
+		const auto now = getms(true);
+		if (now < LastSendTime + kOnlineUpdatesInterval) {
+			ThrottledSendTimer.createIfNull([] {
+				peerUpdatedSendDelayed();
+			});
+			if (!ThrottledSendTimer->isActive()) {
+				ThrottledSendTimer->callOnce(
+					LastSendTime + kOnlineUpdatesInterval - now);
+			}
+			return;
+		}
+	}
+	LastSendTime = getms(true);
+
 	auto smallList = base::take(*SmallUpdates);
 	auto allList = base::take(*AllUpdates);
 	for (auto &update : smallList) {
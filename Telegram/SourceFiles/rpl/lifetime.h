@@ -8,7 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/lambda.h"
-#include <deque>
+#include <vector>
 
 namespace rpl {
 namespace details {
@@ -49,7 +49,10 @@ public:
 	~lifetime() { destroy(); }
 
 private:
-	std::deque<base::lambda_once<void()>> _callbacks;
+	// The callbacks are appended and invoked in reverse order, so the
+	// one added last runs first, like the deque-with-push_front did,
+	// but with a single allocation sized to the content.
+	std::vector<base::lambda_once<void()>> _callbacks;
 
 };
 
@@ -70,20 +73,21 @@ inline lifetime::lifetime(Destroy &&destroy) {
 
 template <typename Destroy, typename>
 inline void lifetime::add(Destroy &&destroy) {
-	_callbacks.push_front(destroy);
+	_callbacks.push_back(destroy);
 }
 
 inline void lifetime::add(lifetime &&other) {
 	auto callbacks = details::take(other._callbacks);
 	_callbacks.insert(
-		_callbacks.begin(),
+		_callbacks.end(),
 		std::make_move_iterator(callbacks.begin()),
 		std::make_move_iterator(callbacks.end()));
 }
 
 inline void lifetime::destroy() {
-	for (auto &callback : details::take(_callbacks)) {
-		callback();
+	auto callbacks = details::take(_callbacks);
+	for (auto i = callbacks.rbegin(), e = callbacks.rend(); i != e; ++i) {
+		(*i)();
 	}
 }
 
@@ -0,0 +1,77 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include <rpl/producer.h>
+#include <rpl/event_stream.h>
+#include <rpl/map.h>
+#include <rpl/filter.h>
+
+namespace {
+
+// Cost of pushing one value from an event stream to its consumers,
+// the shape of every "value changed" signal in the client.
+void fireEventStream(int iterations, int consumers) {
+	auto stream = rpl::event_stream<int>();
+	auto lifetime = rpl::lifetime();
+	auto received = 0;
+	for (auto i = 0; i != consumers; ++i) {
+		stream.events(
+		) | rpl::start_with_next([&](int value) {
+			received += value;
+		}, lifetime);
+	}
+	for (auto i = 0; i != iterations; ++i) {
+		stream.fire_copy(i);
+	}
+	base::benchmark::DoNotOptimizeAway(received);
+}
+
+} // namespace
+
+BENCHMARK_CASE("rpl.event_stream.fire.1") {
+	fireEventStream(iterations, 1);
+}
+
+BENCHMARK_CASE("rpl.event_stream.fire.16") {
+	fireEventStream(iterations, 16);
+}
+
+BENCHMARK_CASE("rpl.pipeline.map_filter") {
+	// A typical settings-style pipeline with transform stages.
+	auto stream = rpl::event_stream<int>();
+	auto lifetime = rpl::lifetime();
+	auto received = 0;
+	stream.events(
+	) | rpl::map([](int value) {
+		return value * 2;
+	}) | rpl::filter([](int value) {
+		return (value % 4) == 0;
+	}) | rpl::start_with_next([&](int value) {
+		received += value;
+	}, lifetime);
+	for (auto i = 0; i != iterations; ++i) {
+		stream.fire_copy(i);
+	}
+	base::benchmark::DoNotOptimizeAway(received);
+}
+
+BENCHMARK_CASE("rpl.subscribe_unsubscribe") {
+	// Cost of building and tearing down one pipeline, paid on every
+	// widget construction.
+	auto stream = rpl::event_stream<int>();
+	for (auto i = 0; i != iterations; ++i) {
+		auto lifetime = rpl::lifetime();
+		auto received = 0;
+		stream.events(
+		) | rpl::start_with_next([&](int value) {
+			received += value;
+		}, lifetime);
+		base::benchmark::DoNotOptimizeAway(received);
+	}
+}
@@ -439,3 +439,29 @@ TEST_CASE("basic piping tests", "[rpl::producer]") {
 		REQUIRE(*sum == 3);
 	}
 }
+
+TEST_CASE("lifetime callbacks order", "[rpl::lifetime]") {
+	SECTION("callbacks run in reverse order of addition") {
+		auto order = std::string();
+		{
+			auto test = lifetime();
+			test.add([&] { order += 'a'; });
+			test.add([&] { order += 'b'; });
+			test.add([&] { order += 'c'; });
+		}
+		REQUIRE(order == "cba");
+	}
+	SECTION("added lifetime is destroyed before the owner") {
+		auto order = std::string();
+		{
+			auto outer = lifetime();
+			outer.add([&] { order += 'a'; });
+
+			auto inner = lifetime();
+			inner.add([&] { order += 'b'; });
+			inner.add([&] { order += 'c'; });
+			outer.add(std::move(inner));
+		}
+		REQUIRE(order == "cba");
+	}
+}
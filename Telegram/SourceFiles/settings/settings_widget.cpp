@@ -13,21 +13,27 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_window.h"
 #include "styles/style_boxes.h"
 #include "ui/widgets/scroll_area.h"
+#include "ui/images.h"
+#include "ui/paint_profiler.h"
+#include "ui/text/text.h"
 #include "ui/widgets/buttons.h"
 #include "mainwindow.h"
 #include "mainwidget.h"
 #include "storage/localstorage.h"
 #include "boxes/confirm_box.h"
+#include "calls/calls_instance.h"
 #include "lang/lang_keys.h"
 #include "lang/lang_cloud_manager.h"
 #include "messenger.h"
 #include "mtproto/mtp_instance.h"
 #include "mtproto/dc_options.h"
 #include "core/file_utilities.h"
+#include "core/startup_timeline.h"
 #include "core/update_checker.h"
 #include "window/themes/window_theme.h"
 #include "window/themes/window_theme_editor.h"
 #include "media/media_audio_track.h"
+#include "layout.h"
 
 namespace Settings {
 namespace {
@@ -105,6 +111,69 @@ void fillCodes() {
 			Ui::hideLayer();
 		}));
 	});
+	Codes.insert(qsl("storagelimit"), [] {
+		const auto presets = std::vector<qint64>{
+			0,
+			qint64(500) * 1024 * 1024,
+			qint64(2) * 1024 * 1024 * 1024,
+			qint64(10) * 1024 * 1024 * 1024,
+		};
+		auto next = presets.front();
+		for (auto i = size_t(0); i != presets.size(); ++i) {
+			if (presets[i] == Global::LocalStorageLimit()) {
+				next = presets[(i + 1) % presets.size()];
+				break;
+			}
+		}
+		Global::SetLocalStorageLimit(next);
+		Local::writeUserSettings();
+		Local::enforceStorageLimit(next);
+		Ui::show(Box<InformBox>(next
+			? qsl("Local storage limit: %1.").arg(formatSizeText(next))
+			: qsl("Local storage limit disabled.")));
+	});
+	Codes.insert(qsl("imagestats"), [] {
+		const auto report = imageCacheReport();
+		LOG(("Image Cache Report:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
+	Codes.insert(qsl("textperf"), [] {
+		const auto report = textPerformanceReport();
+		LOG(("Text Performance Report:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
+	Codes.insert(qsl("rpcstats"), [] {
+		if (const auto mtproto = Messenger::Instance().mtp()) {
+			const auto report = mtproto->requestLatencyReport();
+			LOG(("RPC Latency Report:\n%1").arg(report));
+			Ui::show(Box<InformBox>(report.isEmpty()
+				? qsl("No RPC stats collected yet.")
+				: report));
+		}
+	});
+	Codes.insert(qsl("startuptime"), [] {
+		const auto report = Core::StartupTimeline::Report();
+		LOG(("Startup Timeline:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report.isEmpty()
+			? qsl("No startup timeline recorded.")
+			: report));
+	});
+	Codes.insert(qsl("callstats"), [] {
+		const auto call = Calls::Current().currentCall();
+		const auto report = call ? call->getDebugLog() : QString();
+		if (!report.isEmpty()) {
+			LOG(("Call Stats:\n%1").arg(report));
+		}
+		Ui::show(Box<InformBox>(report.isEmpty()
+			? qsl("No active call.")
+			: report));
+	});
+	Codes.insert(qsl("paintprofile"), [] {
+		Ui::PaintProfiler::Toggle();
+		Ui::show(Box<InformBox>(Ui::PaintProfiler::Enabled()
+			? qsl("Paint profiling enabled.")
+			: qsl("Paint profiling disabled, report dumped to 'log.txt'.")));
+	});
 	Codes.insert(qsl("endpoints"), [] {
 		FileDialog::GetOpenPath("Open DC endpoints", "DC Endpoints (*.tdesktop-endpoints)", [](const FileDialog::OpenResult &result) {
 			if (!result.paths.isEmpty()) {
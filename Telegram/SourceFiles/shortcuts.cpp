@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/player/media_player_instance.h"
 #include "platform/platform_specific.h"
 #include "base/parse_helper.h"
+#include "core/tracing.h"
 
 namespace ShortcutCommands {
 
@@ -99,6 +100,16 @@ bool next_chat() {
 	return false;
 }
 
+bool toggle_tracing() {
+	const auto path = Core::Tracing::Toggle();
+	if (path.isEmpty()) {
+		LOG(("Tracing: capture started."));
+	} else {
+		LOG(("Tracing: capture written to '%1'.").arg(path));
+	}
+	return true;
+}
+
 // other commands here
 
 } // namespace ShortcutCommands
@@ -179,6 +190,10 @@ struct DataStruct {
 			DeclareAlias("ctrl+backtab", previous_chat);
 		}
 
+		// Starts / stops the tracing capture, the trace lands in
+		// tdata - see core/tracing.h.
+		DeclareCommand("ctrl+alt+shift+t", toggle_tracing);
+
 		// other commands here
 
 #undef DeclareCommand
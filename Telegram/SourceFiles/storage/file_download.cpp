@@ -17,9 +17,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 
 namespace Storage {
+namespace {
+
+constexpr auto kBandwidthRefillInterval = TimeMs(100);
+constexpr auto kClampedBackgroundRate = int64(32 * 1024); // bytes per second during a call
+constexpr auto kClampedPrefetchRate = int64(256 * 1024);
+
+} // namespace
 
 Downloader::Downloader()
-: _delayedLoadersDestroyer([this] { _delayedDestroyedLoaders.clear(); }) {
+: _delayedLoadersDestroyer([this] { _delayedDestroyedLoaders.clear(); })
+, _bandwidthTimer([this] { bandwidthRefilled(); }) {
 }
 
 void Downloader::delayedDestroyLoader(std::unique_ptr<FileLoader> loader) {
@@ -45,6 +53,53 @@ void Downloader::requestedAmountIncrement(MTP::DcId dcId, int index, int amount)
 	}
 }
 
+bool Downloader::consumeBandwidth(LoadPriority priority, int amount) {
+	auto &bucket = _bandwidthBuckets[static_cast<int>(priority)];
+	if (!bucket.rate) {
+		return true;
+	}
+	refillBandwidthBuckets();
+	if (bucket.tokens < amount) {
+		if (!_bandwidthTimer.isActive()) {
+			_bandwidthTimer.callOnce(kBandwidthRefillInterval);
+		}
+		return false;
+	}
+	bucket.tokens -= amount;
+	return true;
+}
+
+void Downloader::clampBackgroundBandwidth(bool clamp) {
+	if (_bandwidthClamped == clamp) {
+		return;
+	}
+	_bandwidthClamped = clamp;
+	const auto set = [&](LoadPriority priority, int64 rate) {
+		auto &bucket = _bandwidthBuckets[static_cast<int>(priority)];
+		bucket.rate = rate;
+		bucket.tokens = rate; // allow a full one second burst right away
+	};
+	set(LoadPriority::Background, clamp ? kClampedBackgroundRate : 0);
+	set(LoadPriority::Prefetch, clamp ? kClampedPrefetchRate : 0);
+	_bandwidthRefilledAt = getms(true);
+	if (!clamp) {
+		bandwidthRefilled();
+	}
+}
+
+void Downloader::refillBandwidthBuckets() {
+	const auto now = getms(true);
+	const auto elapsed = now - _bandwidthRefilledAt;
+	_bandwidthRefilledAt = now;
+	for (auto &bucket : _bandwidthBuckets) {
+		if (bucket.rate) {
+			bucket.tokens = std::min(
+				bucket.tokens + (bucket.rate * elapsed) / 1000,
+				bucket.rate); // keep at most one second of burst
+		}
+	}
+}
+
 int Downloader::chooseDcIndexForRequest(MTP::DcId dcId) const {
 	auto result = 0;
 	auto it = _requestedBytesAmount.find(dcId);
@@ -72,8 +127,12 @@ namespace {
 constexpr auto kDownloadPhotoPartSize = 64 * 1024; // 64kb for photo
 constexpr auto kDownloadDocumentPartSize = 128 * 1024; // 128kb for document
 constexpr auto kMaxFileQueries = 16; // max 16 file parts downloaded at the same time
+constexpr auto kMaxLargeFileQueries = 48; // sliding window for large file downloads
+constexpr auto kLargeFileFrom = 32 * 1024 * 1024; // use the large file window from 32 MB
 constexpr auto kMaxWebFileQueries = 8; // max 8 http[s] files downloaded at the same time
 constexpr auto kDownloadCdnPartSize = 128 * 1024; // 128kb for cdn requests
+constexpr auto kResumeSaveStep = 4 * 1024 * 1024; // save resume state every 4 MB
+constexpr auto kWriteBufferLimit = 4 * 1024 * 1024; // flush batched part writes at 4 MB
 
 } // namespace
 
@@ -91,8 +150,43 @@ namespace {
 using LoaderQueues = QMap<int32, FileLoaderQueue>;
 LoaderQueues queues;
 
+// Large files get their own queue with a wider window of part requests,
+// so one multi-gigabyte download can keep all download sessions of its
+// dc busy without blocking the small userpic and thumbnail loads.
+LoaderQueues largeFileQueues;
+
+FileLoaderQueue *QueueForDownload(int32 shiftedDcId, int32 size) {
+	const auto large = (size >= kLargeFileFrom);
+	auto &map = large ? largeFileQueues : queues;
+	auto i = map.find(shiftedDcId);
+	if (i == map.cend()) {
+		i = map.insert(shiftedDcId, FileLoaderQueue(large
+			? kMaxLargeFileQueries
+			: kMaxFileQueries));
+	}
+	return &i.value();
+}
+
 FileLoaderQueue _webQueue(kMaxWebFileQueries);
 
+} // namespace
+
+void Storage::Downloader::bandwidthRefilled() {
+	refillBandwidthBuckets();
+	for (auto &queue : queues) {
+		if (queue.start) {
+			queue.start->loadNext();
+		}
+	}
+	for (auto &queue : largeFileQueues) {
+		if (queue.start) {
+			queue.start->loadNext();
+		}
+	}
+}
+
+namespace {
+
 QThread *_webLoadThread = nullptr;
 WebLoadManager *_webLoadManager = nullptr;
 WebLoadManager *webLoadManager() {
@@ -100,10 +194,19 @@ WebLoadManager *webLoadManager() {
 }
 WebLoadMainManager *_webLoadMainManager = nullptr;
 
+// Loaders are deleted on the main thread all the time (cancelled or
+// completed downloads) while cdn parts are decrypted and hashed on
+// worker threads, so a worker never dereferences a loader pointer.
+// Instead the completion is posted to the application object and
+// resolved through this main thread only registry.
+std::map<quint64, mtpFileLoader*> CdnCheckingLoaders;
+quint64 CdnCheckingLoadersCounter = 0;
+
 } // namespace
 
 FileLoader::FileLoader(const QString &toFile, int32 size, LocationType locationType, LoadToCacheSetting toCache, LoadFromCloudSetting fromCloud, bool autoLoading)
 : _downloader(&Auth().downloader())
+, _loadPriority(autoLoading ? LoadPriority::Background : LoadPriority::Prefetch)
 , _autoLoading(autoLoading)
 , _filename(toFile)
 , _file(_filename)
@@ -259,13 +362,15 @@ void FileLoader::start(bool loadFirst, bool prior) {
 	}
 
 	if (!_filename.isEmpty() && _toCache == LoadToFileOnly && !_fileIsOpen) {
-		_fileIsOpen = _file.open(QIODevice::WriteOnly);
-		if (!_fileIsOpen) {
+		if (!openFileForWriting()) {
 			return cancel(true);
 		}
 	}
 
-	auto currentPriority = _downloader->currentPriority();
+	// The generation from clearPriorities() dominates, the load priority
+	// class orders loaders inside one generation.
+	auto currentPriority = (_downloader->currentPriority() << 2)
+		| static_cast<int>(_loadPriority);
 	FileLoader *before = 0, *after = 0;
 	if (prior) {
 		if (_inQueue && _priority == currentPriority) {
@@ -358,9 +463,15 @@ void FileLoader::cancel() {
 	cancel(false);
 }
 
+bool FileLoader::openFileForWriting() {
+	_fileIsOpen = _file.open(QIODevice::WriteOnly);
+	return _fileIsOpen;
+}
+
 void FileLoader::cancel(bool fail) {
 	bool started = currentOffset(true) > 0;
 	cancelRequests();
+	clearResumeState();
 	_cancelled = true;
 	_finished = true;
 	if (_fileIsOpen) {
@@ -384,7 +495,13 @@ void FileLoader::cancel(bool fail) {
 }
 
 void FileLoader::startLoading(bool loadFirst, bool prior) {
-	if ((_queue->queriesCount >= _queue->queriesLimit && (!loadFirst || !prior)) || _finished) {
+	if (_finished) {
+		return;
+	} else if (_queue->queriesCount >= _queue->queriesLimit
+		&& (!loadFirst || !prior)
+		&& _loadPriority != LoadPriority::Viewport) {
+		// Viewport loads don't wait for a window slot, the user
+		// is looking at the result right now.
 		return;
 	}
 	loadPart();
@@ -394,12 +511,7 @@ mtpFileLoader::mtpFileLoader(const StorageImageLocation *location, int32 size, L
 : FileLoader(QString(), size, UnknownFileLocation, LoadToCacheAsWell, fromCloud, autoLoading)
 , _dcId(location->dc())
 , _location(location) {
-	auto shiftedDcId = MTP::downloadDcId(_dcId, 0);
-	auto i = queues.find(shiftedDcId);
-	if (i == queues.cend()) {
-		i = queues.insert(shiftedDcId, FileLoaderQueue(kMaxFileQueries));
-	}
-	_queue = &i.value();
+	_queue = QueueForDownload(MTP::downloadDcId(_dcId, 0), size);
 }
 
 mtpFileLoader::mtpFileLoader(int32 dc, uint64 id, uint64 accessHash, int32 version, LocationType type, const QString &to, int32 size, LoadToCacheSetting toCache, LoadFromCloudSetting fromCloud, bool autoLoading)
@@ -408,28 +520,30 @@ mtpFileLoader::mtpFileLoader(int32 dc, uint64 id, uint64 accessHash, int32 versi
 , _id(id)
 , _accessHash(accessHash)
 , _version(version) {
-	auto shiftedDcId = MTP::downloadDcId(_dcId, 0);
-	auto i = queues.find(shiftedDcId);
-	if (i == queues.cend()) {
-		i = queues.insert(shiftedDcId, FileLoaderQueue(kMaxFileQueries));
-	}
-	_queue = &i.value();
+	_queue = QueueForDownload(MTP::downloadDcId(_dcId, 0), size);
 }
 
 mtpFileLoader::mtpFileLoader(const WebFileLocation *location, int32 size, LoadFromCloudSetting fromCloud, bool autoLoading)
 : FileLoader(QString(), size, UnknownFileLocation, LoadToCacheAsWell, fromCloud, autoLoading)
 , _dcId(location->dc())
 , _urlLocation(location) {
-	auto shiftedDcId = MTP::downloadDcId(_dcId, 0);
-	auto i = queues.find(shiftedDcId);
-	if (i == queues.cend()) {
-		i = queues.insert(shiftedDcId, FileLoaderQueue(kMaxFileQueries));
-	}
-	_queue = &i.value();
+	_queue = QueueForDownload(MTP::downloadDcId(_dcId, 0), size);
 }
 
 int32 mtpFileLoader::currentOffset(bool includeSkipped) const {
-	return (_fileIsOpen ? _file.size() : _data.size()) - (includeSkipped ? 0 : _skippedBytes);
+	return _fileIsOpen
+		? _fileReceivedBytes
+		: (_data.size() - (includeSkipped ? 0 : _skippedBytes));
+}
+
+int32 mtpFileLoader::contiguousSize() const {
+	return qMin(_receivedTill, int(_data.size()));
+}
+
+int32 mtpFileLoader::diskPrefixSize() const {
+	// _receivedTill counts only the parts flushed from the write buffer,
+	// so everything before it can really be read back from the file.
+	return resumeSupported() ? _receivedTill : 0;
 }
 
 bool mtpFileLoader::loadPart() {
@@ -437,6 +551,8 @@ bool mtpFileLoader::loadPart() {
 		return false;
 	} else if (_size && _nextRequestOffset >= _size) {
 		return false;
+	} else if (!_downloader->consumeBandwidth(_loadPriority, partSize())) {
+		return false;
 	}
 
 	makeRequest(_nextRequestOffset);
@@ -460,6 +576,120 @@ int mtpFileLoader::partSize() const {
 	//return kDownloadDocumentPartSize;
 }
 
+bool mtpFileLoader::resumeSupported() const {
+	return (_toCache == LoadToFileOnly)
+		&& !_filename.isEmpty()
+		&& !_urlLocation
+		&& !_location
+		&& (_locationType != UnknownFileLocation)
+		&& (_size > 0);
+}
+
+bool mtpFileLoader::openFileForWriting() {
+	if (resumeSupported()) {
+		const auto mkey = mediaKey(_locationType, _dcId, _id, _version);
+		const auto resume = Local::readDownloadResume(mkey);
+		if (resume.already > 0
+			&& resume.fname == _filename
+			&& resume.size == _size
+			&& !(resume.already % partSize())
+			&& QFile(_filename).size() >= resume.already) {
+			_fileIsOpen = _file.open(QIODevice::ReadWrite);
+			if (_fileIsOpen) {
+				// Drop the bytes written out of order after the last
+				// complete prefix, they were not counted in 'already'.
+				_file.resize(resume.already);
+				_receivedTill = _resumeSavedTill = resume.already;
+				_nextRequestOffset = resume.already;
+				_fileReceivedBytes = resume.already;
+				preallocate();
+				DEBUG_LOG(("Download Resume: resuming '%1' from offset %2."
+					).arg(_filename).arg(resume.already));
+				return true;
+			}
+		}
+	}
+	if (!FileLoader::openFileForWriting()) {
+		return false;
+	}
+	if (resumeSupported()) {
+		preallocate();
+	}
+	return true;
+}
+
+void mtpFileLoader::preallocate() {
+	// Reserve the full destination size once, so batched part writes
+	// append into already allocated space instead of growing the file.
+	if (_file.resize(_size)) {
+		_preallocated = true;
+	}
+}
+
+bool mtpFileLoader::writeToFile(int offset, base::const_byte_span bytes) {
+	_fileReceivedBytes += bytes.size();
+	if (_writeBuffer.isEmpty()) {
+		_writeBuffer.reserve(kWriteBufferLimit);
+		_writeBufferOffset = offset;
+	} else if (offset != _writeBufferOffset + _writeBuffer.size()) {
+		if (!flushWriteBuffer()) {
+			return false;
+		}
+		_writeBufferOffset = offset;
+	}
+	_writeBuffer.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	if (_writeBuffer.size() >= kWriteBufferLimit) {
+		return flushWriteBuffer();
+	}
+	return true;
+}
+
+bool mtpFileLoader::flushWriteBuffer() {
+	if (_writeBuffer.isEmpty()) {
+		return true;
+	}
+	_file.seek(_writeBufferOffset);
+	if (_file.write(_writeBuffer) != qint64(_writeBuffer.size())) {
+		return false;
+	}
+	if (resumeSupported()) {
+		markPartReceived(_writeBufferOffset, _writeBuffer.size());
+	}
+	_writeBufferOffset += _writeBuffer.size();
+	_writeBuffer.resize(0); // keep the allocation for the next batch
+	return true;
+}
+
+void mtpFileLoader::markPartReceived(int offset, int size) {
+	if (offset > _receivedTill) {
+		_receivedAfterGap.emplace(offset, size);
+		return;
+	}
+	accumulate_max(_receivedTill, offset + size);
+	for (auto i = _receivedAfterGap.begin(); i != _receivedAfterGap.end() && i->first <= _receivedTill;) {
+		accumulate_max(_receivedTill, i->first + i->second);
+		i = _receivedAfterGap.erase(i);
+	}
+	if (resumeSupported() && _receivedTill - _resumeSavedTill >= kResumeSaveStep) {
+		saveResumeState();
+	}
+}
+
+void mtpFileLoader::saveResumeState() {
+	_resumeSavedTill = _receivedTill;
+	auto resume = Local::DownloadResume();
+	resume.fname = _filename;
+	resume.already = _receivedTill;
+	resume.size = _size;
+	Local::writeDownloadResume(mediaKey(_locationType, _dcId, _id, _version), resume);
+}
+
+void mtpFileLoader::clearResumeState() {
+	if (_resumeSavedTill > 0 || resumeSupported()) {
+		Local::clearDownloadResume(mediaKey(_locationType, _dcId, _id, _version));
+	}
+}
+
 mtpFileLoader::RequestData mtpFileLoader::prepareRequest(int offset) const {
 	auto result = RequestData();
 	result.dcId = _cdnDcId ? _cdnDcId : _dcId;
@@ -562,40 +792,69 @@ void mtpFileLoader::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId
 		return;
 	}
 	Expects(result.type() == mtpc_upload_cdnFile);
+	Expects(_cdnEncryptionKey.size() == MTP::CTRState::KeySize);
+	Expects(_cdnEncryptionIV.size() == MTP::CTRState::IvecSize);
+
+	// Decrypt and hash the part on a worker thread, crypto for several
+	// parallel cdn parts should not be serialized on this one.
+	const auto hashIt = _cdnFileHashes.find(offset);
+	const auto hadHash = (hashIt != _cdnFileHashes.cend());
+	const auto expectedHash = hadHash ? hashIt->second.hash : QByteArray();
+	++_cdnCheckingParts;
+	if (!_cdnCheckingId) {
+		_cdnCheckingId = ++CdnCheckingLoadersCounter;
+		CdnCheckingLoaders.emplace(_cdnCheckingId, this);
+	}
+	const auto checkingId = _cdnCheckingId;
+	crl::async([=, decryptInPlace = result.c_upload_cdnFile().vbytes.v, encryptionKey = _cdnEncryptionKey, encryptionIV = _cdnEncryptionIV]() mutable {
+		auto key = gsl::as_bytes(gsl::make_span(encryptionKey));
+		auto iv = gsl::as_bytes(gsl::make_span(encryptionIV));
+
+		auto state = MTP::CTRState();
+		auto ivec = gsl::as_writeable_bytes(gsl::make_span(state.ivec));
+		std::copy(iv.begin(), iv.end(), ivec.begin());
+
+		auto counterOffset = static_cast<uint32>(offset) >> 4;
+		state.ivec[15] = static_cast<uchar>(counterOffset & 0xFF);
+		state.ivec[14] = static_cast<uchar>((counterOffset >> 8) & 0xFF);
+		state.ivec[13] = static_cast<uchar>((counterOffset >> 16) & 0xFF);
+		state.ivec[12] = static_cast<uchar>((counterOffset >> 24) & 0xFF);
+
+		MTP::aesCtrEncrypt(decryptInPlace.data(), decryptInPlace.size(), key.data(), &state);
+
+		auto good = true;
+		if (hadHash) {
+			const auto bytes = gsl::as_bytes(gsl::make_span(decryptInPlace));
+			const auto realHash = hashSha256(bytes.data(), bytes.size());
+			good = !base::compare_bytes(
+				gsl::as_bytes(gsl::make_span(realHash)),
+				gsl::as_bytes(gsl::make_span(expectedHash)));
+		}
+		InvokeQueued(QCoreApplication::instance(), [=, bytes = std::move(decryptInPlace)] {
+			const auto i = CdnCheckingLoaders.find(checkingId);
+			if (i != CdnCheckingLoaders.cend()) {
+				i->second->cdnPartChecked(offset, bytes, hadHash, good);
+			}
+		});
+	});
+}
 
-	auto key = gsl::as_bytes(gsl::make_span(_cdnEncryptionKey));
-	auto iv = gsl::as_bytes(gsl::make_span(_cdnEncryptionIV));
-	Expects(key.size() == MTP::CTRState::KeySize);
-	Expects(iv.size() == MTP::CTRState::IvecSize);
-
-	auto state = MTP::CTRState();
-	auto ivec = gsl::as_writeable_bytes(gsl::make_span(state.ivec));
-	std::copy(iv.begin(), iv.end(), ivec.begin());
-
-	auto counterOffset = static_cast<uint32>(offset) >> 4;
-	state.ivec[15] = static_cast<uchar>(counterOffset & 0xFF);
-	state.ivec[14] = static_cast<uchar>((counterOffset >> 8) & 0xFF);
-	state.ivec[13] = static_cast<uchar>((counterOffset >> 16) & 0xFF);
-	state.ivec[12] = static_cast<uchar>((counterOffset >> 24) & 0xFF);
-
-	auto decryptInPlace = result.c_upload_cdnFile().vbytes.v;
-	MTP::aesCtrEncrypt(decryptInPlace.data(), decryptInPlace.size(), key.data(), &state);
-	auto bytes = gsl::as_bytes(gsl::make_span(decryptInPlace));
-
-	switch (checkCdnFileHash(offset, bytes)) {
-	case CheckCdnHashResult::NoHash: {
-		_cdnUncheckedParts.emplace(offset, decryptInPlace);
+void mtpFileLoader::cdnPartChecked(int offset, const QByteArray &bytes, bool hadHash, bool good) {
+	--_cdnCheckingParts;
+	if (_finished) {
+		// The load was cancelled while the part was being checked.
+		return;
+	}
+	if (!hadHash) {
+		_cdnUncheckedParts.emplace(offset, bytes);
 		requestMoreCdnFileHashes();
-	} return;
-
-	case CheckCdnHashResult::Invalid: {
+		return;
+	} else if (!good) {
 		LOG(("API Error: Wrong cdnFileHash for offset %1.").arg(offset));
 		cancel(true);
-	} return;
-
-	case CheckCdnHashResult::Good: return partLoaded(offset, bytes);
+		return;
 	}
-	Unexpected("Result of checkCdnFileHash()");
+	partLoaded(offset, gsl::as_bytes(gsl::make_span(bytes)));
 }
 
 mtpFileLoader::CheckCdnHashResult mtpFileLoader::checkCdnFileHash(int offset, base::const_byte_span bytes) {
@@ -695,14 +954,7 @@ bool mtpFileLoader::feedPart(int offset, base::const_byte_span bytes) {
 
 	if (bytes.size()) {
 		if (_fileIsOpen) {
-			auto fsize = _file.size();
-			if (offset < fsize) {
-				_skippedBytes -= bytes.size();
-			} else if (offset > fsize) {
-				_skippedBytes += offset - fsize;
-			}
-			_file.seek(offset);
-			if (_file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()) != qint64(bytes.size())) {
+			if (!writeToFile(offset, bytes)) {
 				cancel(true);
 				return false;
 			}
@@ -733,6 +985,7 @@ bool mtpFileLoader::feedPart(int offset, base::const_byte_span bytes) {
 				auto dst = gsl::make_span(_data).subspan(offset, bytes.size());
 				base::copy_bytes(gsl::as_writeable_bytes(dst), src);
 			}
+			markPartReceived(offset, bytes.size());
 		}
 	}
 	if (!bytes.size() || (bytes.size() % 1024)) { // bad next offset
@@ -740,6 +993,7 @@ bool mtpFileLoader::feedPart(int offset, base::const_byte_span bytes) {
 	}
 	if (_sentRequests.empty()
 		&& _cdnUncheckedParts.empty()
+		&& !_cdnCheckingParts
 		&& (_lastComplete || (_size && _nextRequestOffset >= _size))) {
 		if (!_filename.isEmpty() && (_toCache == LoadToCacheAsWell)) {
 			if (!_fileIsOpen) {
@@ -750,12 +1004,21 @@ bool mtpFileLoader::feedPart(int offset, base::const_byte_span bytes) {
 				return false;
 			}
 		}
+		if (_fileIsOpen && !flushWriteBuffer()) {
+			cancel(true);
+			return false;
+		}
 		_finished = true;
 		if (_fileIsOpen) {
+			if (_preallocated && _receivedTill > 0 && _receivedTill < _size) {
+				// The server ended the file early, drop the unused tail.
+				_file.resize(_receivedTill);
+			}
 			_file.close();
 			_fileIsOpen = false;
 			Platform::File::PostprocessDownloaded(QFileInfo(_file).absoluteFilePath());
 		}
+		clearResumeState();
 		removeFromQueue();
 
 		if (_localStatus == LocalNotFound || _localStatus == LocalFailed) {
@@ -911,6 +1174,9 @@ bool mtpFileLoader::tryLoadLocal() {
 }
 
 mtpFileLoader::~mtpFileLoader() {
+	if (_cdnCheckingId) {
+		CdnCheckingLoaders.erase(_cdnCheckingId);
+	}
 	cancelRequests();
 }
 
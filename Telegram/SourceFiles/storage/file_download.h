@@ -8,8 +8,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/observer.h"
+#include "base/timer.h"
 #include "storage/localimageloader.h" // for TaskId
 
+enum class LoadPriority;
+
 namespace Storage {
 
 constexpr auto kMaxFileInMemory = 10 * 1024 * 1024; // 10 MB max file could be hold in memory
@@ -35,9 +38,26 @@ public:
 	void requestedAmountIncrement(MTP::DcId dcId, int index, int amount);
 	int chooseDcIndexForRequest(MTP::DcId dcId) const;
 
+	// Token-bucket bandwidth governor. Returns whether a part request of
+	// the given size may go out right now for the given scheduling class.
+	bool consumeBandwidth(LoadPriority priority, int amount);
+
+	// While a phone call is active the prefetch and background classes
+	// are clamped so they cannot degrade the voice stream, viewport
+	// loads stay unlimited.
+	void clampBackgroundBandwidth(bool clamp);
+
 	~Downloader();
 
 private:
+	struct BandwidthBucket {
+		int64 rate = 0; // bytes per second, 0 means unlimited
+		int64 tokens = 0;
+	};
+
+	void refillBandwidthBuckets();
+	void bandwidthRefilled();
+
 	base::Observable<void> _taskFinishedObservable;
 	int _priority = 1;
 
@@ -47,6 +67,11 @@ private:
 	using RequestedInDc = std::array<int64, MTP::kDownloadSessionsCount>;
 	std::map<MTP::DcId, RequestedInDc> _requestedBytesAmount;
 
+	std::array<BandwidthBucket, 3> _bandwidthBuckets;
+	TimeMs _bandwidthRefilledAt = 0;
+	bool _bandwidthClamped = false;
+	base::Timer _bandwidthTimer;
+
 };
 
 } // namespace Storage
@@ -71,6 +96,15 @@ enum LocalLoadStatus {
 class mtpFileLoader;
 class webFileLoader;
 
+// Explicit scheduling classes inside one priority generation: the queue
+// serves what the user is looking at before prefetch, and prefetch
+// before automatic background downloads.
+enum class LoadPriority {
+	Background = 0,
+	Prefetch = 1,
+	Viewport = 2,
+};
+
 struct FileLoaderQueue;
 class FileLoader : public QObject {
 	Q_OBJECT
@@ -96,10 +130,26 @@ public:
 	}
 	float64 currentProgress() const;
 	virtual int32 currentOffset(bool includeSkipped = false) const = 0;
+
+	// Count of bytes from the beginning that were already received
+	// without gaps, for incremental decode of partially loaded files.
+	virtual int32 contiguousSize() const {
+		return 0;
+	}
+
+	// Count of bytes from the beginning already written to the disk
+	// file without gaps, safe to read while the download continues.
+	virtual int32 diskPrefixSize() const {
+		return 0;
+	}
+
 	int32 fullSize() const;
 
 	bool setFileName(const QString &filename); // set filename for loaders to cache
 	void permitLoadFromCloud();
+	void setLoadPriority(LoadPriority priority) {
+		_loadPriority = priority;
+	}
 
 	void pause();
 	void start(bool loadFirst = false, bool prior = true);
@@ -132,12 +182,15 @@ signals:
 	void failed(FileLoader *loader, bool started);
 
 protected:
+	friend class Storage::Downloader;
+
 	void readImage(const QSize &shrinkBox) const;
 
 	not_null<Storage::Downloader*> _downloader;
 	FileLoader *_prev = nullptr;
 	FileLoader *_next = nullptr;
 	int _priority = 0;
+	LoadPriority _loadPriority = LoadPriority::Prefetch;
 	FileLoaderQueue *_queue = nullptr;
 
 	bool _paused = false;
@@ -149,6 +202,9 @@ protected:
 
 	virtual bool tryLoadLocal() = 0;
 	virtual void cancelRequests() = 0;
+	virtual bool openFileForWriting();
+	virtual void clearResumeState() {
+	}
 
 	void startLoading(bool loadFirst, bool prior);
 	void removeFromQueue();
@@ -186,6 +242,8 @@ public:
 	mtpFileLoader(const WebFileLocation *location, int32 size, LoadFromCloudSetting fromCloud, bool autoLoading);
 
 	int32 currentOffset(bool includeSkipped = false) const override;
+	int32 contiguousSize() const override;
+	int32 diskPrefixSize() const override;
 
 	uint64 objId() const override {
 		return _id;
@@ -217,11 +275,22 @@ private:
 	RequestData prepareRequest(int offset) const;
 	void makeRequest(int offset);
 
+	bool resumeSupported() const;
+	bool openFileForWriting() override;
+	void markPartReceived(int offset, int size);
+	void saveResumeState();
+	void clearResumeState() override;
+
+	void preallocate();
+	bool writeToFile(int offset, base::const_byte_span bytes);
+	bool flushWriteBuffer();
+
 	MTPInputFileLocation computeLocation() const;
 	bool loadPart() override;
 	void normalPartLoaded(const MTPupload_File &result, mtpRequestId requestId);
 	void webPartLoaded(const MTPupload_WebFile &result, mtpRequestId requestId);
 	void cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId requestId);
+	void cdnPartChecked(int offset, const QByteArray &bytes, bool hadHash, bool good);
 	void reuploadDone(const MTPVector<MTPFileHash> &result, mtpRequestId requestId);
 	void requestMoreCdnFileHashes();
 	void getCdnFileHashesDone(const MTPVector<MTPFileHash> &result, mtpRequestId requestId);
@@ -251,6 +320,15 @@ private:
 	int32 _skippedBytes = 0;
 	int32 _nextRequestOffset = 0;
 
+	int _receivedTill = 0; // every byte before this offset was received
+	int _resumeSavedTill = 0;
+	std::map<int, int> _receivedAfterGap; // offset -> size after a gap
+
+	QByteArray _writeBuffer; // contiguous parts are written in batches
+	int _writeBufferOffset = 0;
+	int32 _fileReceivedBytes = 0;
+	bool _preallocated = false;
+
 	MTP::DcId _dcId = 0; // for photo locations
 	const StorageImageLocation *_location = nullptr;
 
@@ -267,6 +345,8 @@ private:
 	std::map<int, CdnFileHash> _cdnFileHashes;
 	std::map<int, QByteArray> _cdnUncheckedParts;
 	mtpRequestId _cdnHashesRequestId = 0;
+	int _cdnCheckingParts = 0; // decrypted / hashed on worker threads
+	quint64 _cdnCheckingId = 0; // key in the main thread loaders registry
 
 };
 
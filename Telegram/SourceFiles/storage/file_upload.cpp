@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/file_upload.h"
 
 #include "storage/localimageloader.h"
+#include "storage/localstorage.h"
 #include "data/data_document.h"
 #include "data/data_photo.h"
 #include "data/data_session.h"
@@ -16,7 +17,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Storage {
 namespace {
 
-constexpr auto kMaxUploadFileParallelSize = MTP::kUploadSessionsCount * 512 * 1024; // max 512kb uploaded at the same time in each session
+constexpr auto kMinUploadFileParallelSize = uint32(MTP::kUploadSessionsCount * 512 * 1024); // start with 512kb in flight in each session
+constexpr auto kMaxUploadFileParallelSize = uint32(MTP::kUploadSessionsCount * 4 * 1024 * 1024); // up to 4mb in flight in each session
+constexpr auto kGrowWindowBelowRtt = TimeMs(1000); // parts acked that fast mean the pipe is not full
+constexpr auto kShrinkWindowAboveRtt = TimeMs(4000); // parts acked that slow mean we overfilled the pipe
 
 } // namespace
 
@@ -39,6 +43,13 @@ struct Uploader::File {
 
 	HashMd5 md5Hash;
 
+	// Filled when the content hash matches a recent upload, so the
+	// parts are still saved server-side and the transfer is skipped.
+	uint64 reuseId = 0;
+	int32 reusePartsCount = 0;
+	bool reuseBig = false;
+	QByteArray reuseMd5;
+
 	std::unique_ptr<QFile> docFile;
 	int32 docSentParts = 0;
 	int32 docSize = 0;
@@ -109,7 +120,8 @@ const QString &Uploader::File::filename() const {
 	return file ? file->filename : media.filename;
 }
 
-Uploader::Uploader() {
+Uploader::Uploader()
+: parallelLimit(kMinUploadFileParallelSize) {
 	nextTimer.setSingleShot(true);
 	connect(&nextTimer, SIGNAL(timeout()), this, SLOT(sendNext()));
 	killSessionsTimer.setSingleShot(true);
@@ -130,7 +142,10 @@ void Uploader::uploadMedia(const FullMsgId &msgId, const SendMediaReady &media)
 			document->setLocation(FileLocation(media.file));
 		}
 	}
-	queue.emplace(msgId, File(media));
+	const auto inserted = queue.emplace(msgId, File(media));
+	if (inserted.second) {
+		checkReuse(inserted.first->second);
+	}
 	sendNext();
 }
 
@@ -152,10 +167,39 @@ void Uploader::upload(
 			document->setLocation(FileLocation(file->filepath));
 		}
 	}
-	queue.emplace(msgId, File(file));
+	const auto inserted = queue.emplace(msgId, File(file));
+	if (inserted.second) {
+		checkReuse(inserted.first->second);
+	}
 	sendNext();
 }
 
+void Uploader::checkReuse(File &file) {
+	const auto type = file.type();
+	const auto md5 = file.file
+		? file.file->filemd5
+		: (type == SendMediaType::Photo
+			? file.media.jpeg_md5
+			: QByteArray());
+	if (md5.isEmpty()) {
+		return;
+	}
+	const auto known = Local::readUploadedFileInfo(md5);
+	if (!known.fileId) {
+		return;
+	}
+	file.reuseId = known.fileId;
+	file.reusePartsCount = known.partsCount;
+	file.reuseBig = known.big;
+	file.reuseMd5 = md5;
+	if (type != SendMediaType::Photo) {
+		file.docSentParts = file.docPartsCount;
+	}
+	// The photo parts are kept around instead of being cleared here:
+	// if the send fails with a FILE_PART_* error they are uploaded
+	// for real, see reuseFailed().
+}
+
 void Uploader::currentFailed() {
 	auto j = queue.find(uploadingId);
 	if (j != queue.end()) {
@@ -174,8 +218,10 @@ void Uploader::currentFailed() {
 	requestsSent.clear();
 	docRequestsSent.clear();
 	dcMap.clear();
+	sentTimes.clear();
 	uploadingId = FullMsgId();
 	sentSize = 0;
+	parallelLimit = kMinUploadFileParallelSize;
 	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
 		sentSizes[i] = 0;
 	}
@@ -190,7 +236,7 @@ void Uploader::killSessions() {
 }
 
 void Uploader::sendNext() {
-	if (sentSize >= kMaxUploadFileParallelSize || _pausedId.msg) return;
+	if (sentSize >= parallelLimit || _pausedId.msg) return;
 
 	bool killing = killSessionsTimer.isActive();
 	if (queue.empty()) {
@@ -229,7 +275,9 @@ void Uploader::sendNext() {
 			? uploadingData.file->id
 			: uploadingData.file->thumbId)
 		: uploadingData.media.thumbId;
-	if (parts.isEmpty()) {
+	const auto skipParts = (uploadingData.reuseId != 0)
+		&& (uploadingData.type() == SendMediaType::Photo);
+	if (skipParts || parts.isEmpty()) {
 		if (uploadingData.docSentParts >= uploadingData.docPartsCount) {
 			if (requestsSent.empty() && docRequestsSent.empty()) {
 				const auto silent = uploadingData.file
@@ -246,26 +294,63 @@ void Uploader::sendNext() {
 						? uploadingData.file->filemd5
 						: uploadingData.media.jpeg_md5;
 					const auto file = MTP_inputFile(
-						MTP_long(uploadingData.id()),
-						MTP_int(uploadingData.partsCount),
+						MTP_long(uploadingData.reuseId
+							? uploadingData.reuseId
+							: uploadingData.id()),
+						MTP_int(uploadingData.reuseId
+							? uploadingData.reusePartsCount
+							: uploadingData.partsCount),
 						MTP_string(photoFilename),
 						MTP_bytes(md5));
+					if (!uploadingData.reuseId) {
+						Local::UploadedFileInfo info;
+						info.fileId = uploadingData.id();
+						info.partsCount = uploadingData.partsCount;
+						info.big = false;
+						info.when = qint32(unixtime());
+						Local::writeUploadedFileInfo(md5, info);
+					}
 					emit photoReady(uploadingId, silent, file);
 				} else if (uploadingData.type() == SendMediaType::File
 					|| uploadingData.type() == SendMediaType::Audio) {
 					QByteArray docMd5(32, Qt::Uninitialized);
-					hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
+					if (uploadingData.reuseId) {
+						docMd5 = uploadingData.file->filemd5;
+					} else {
+						hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
+					}
 
-					const auto file = (uploadingData.docSize > UseBigFilesFrom)
+					const auto docId = uploadingData.reuseId
+						? uploadingData.reuseId
+						: uploadingData.id();
+					const auto docParts = uploadingData.reuseId
+						? uploadingData.reusePartsCount
+						: uploadingData.docPartsCount;
+					const auto docBig = uploadingData.reuseId
+						? uploadingData.reuseBig
+						: (uploadingData.docSize > UseBigFilesFrom);
+					const auto file = docBig
 						? MTP_inputFileBig(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
+							MTP_long(docId),
+							MTP_int(docParts),
 							MTP_string(uploadingData.filename()))
 						: MTP_inputFile(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
+							MTP_long(docId),
+							MTP_int(docParts),
 							MTP_string(uploadingData.filename()),
 							MTP_bytes(docMd5));
+					if (!uploadingData.reuseId
+						&& uploadingData.file
+						&& !uploadingData.file->filemd5.isEmpty()) {
+						Local::UploadedFileInfo info;
+						info.fileId = uploadingData.id();
+						info.partsCount = uploadingData.docPartsCount;
+						info.big = (uploadingData.docSize > UseBigFilesFrom);
+						info.when = qint32(unixtime());
+						Local::writeUploadedFileInfo(
+							uploadingData.file->filemd5,
+							info);
+					}
 					if (uploadingData.partsCount) {
 						const auto thumbFilename = uploadingData.file
 							? uploadingData.file->thumbname
@@ -287,6 +372,13 @@ void Uploader::sendNext() {
 						emit documentReady(uploadingId, silent, file);
 					}
 				}
+				if (uploadingData.reuseId) {
+					// Keep the payload until the send confirms the
+					// file reference, see reuseFailed().
+					uploaded.emplace(
+						uploadingId,
+						std::move(uploadingData));
+				}
 				queue.erase(uploadingId);
 				uploadingId = FullMsgId();
 				sendNext();
@@ -352,6 +444,7 @@ void Uploader::sendNext() {
 		}
 		docRequestsSent.emplace(requestId, uploadingData.docSentParts);
 		dcMap.emplace(requestId, todc);
+		sentTimes.emplace(requestId, getms(true));
 		sentSize += uploadingData.docPartSize;
 		sentSizes[todc] += uploadingData.docPartSize;
 
@@ -369,12 +462,18 @@ void Uploader::sendNext() {
 			MTP::uploadDcId(todc));
 		requestsSent.emplace(requestId, part.value());
 		dcMap.emplace(requestId, todc);
+		sentTimes.emplace(requestId, getms(true));
 		sentSize += part.value().size();
 		sentSizes[todc] += part.value().size();
 
 		parts.erase(part);
 	}
 	nextTimer.start(UploadRequestInterval);
+	if (sentSize < parallelLimit) {
+		// Keep the pipeline window full instead of waiting for the
+		// timer or for an ack to send the next part.
+		sendNext();
+	}
 }
 
 void Uploader::cancel(const FullMsgId &msgId) {
@@ -398,6 +497,35 @@ void Uploader::unpause() {
 void Uploader::confirm(const FullMsgId &msgId) {
 }
 
+void Uploader::reuseDone(const FullMsgId &msgId) {
+	uploaded.erase(msgId);
+}
+
+bool Uploader::reuseFailed(const FullMsgId &msgId, const QString &errorType) {
+	if (!errorType.startsWith(qstr("FILE_PART"))) {
+		return false;
+	}
+	const auto i = uploaded.find(msgId);
+	if (i == uploaded.end() || !i->second.reuseId) {
+		return false;
+	}
+
+	// The parts referenced by the index entry expired server-side,
+	// forget them and upload the file for real this time.
+	LOG(("Upload Info: %1 for a reused file, uploading for real.").arg(errorType));
+	auto file = std::move(i->second);
+	uploaded.erase(i);
+	Local::forgetUploadedFileInfo(file.reuseMd5);
+	file.reuseId = 0;
+	file.reusePartsCount = 0;
+	file.reuseBig = false;
+	file.reuseMd5 = QByteArray();
+	file.docSentParts = 0;
+	queue.emplace(msgId, std::move(file));
+	sendNext();
+	return true;
+}
+
 void Uploader::clear() {
 	uploaded.clear();
 	queue.clear();
@@ -410,7 +538,9 @@ void Uploader::clear() {
 	}
 	docRequestsSent.clear();
 	dcMap.clear();
+	sentTimes.clear();
 	sentSize = 0;
+	parallelLimit = kMinUploadFileParallelSize;
 	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
 		sentSizes[i] = 0;
@@ -450,6 +580,21 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 			}
 			sentSize -= sentPartSize;
 			sentSizes[dc] -= sentPartSize;
+
+			const auto sentTimeIt = sentTimes.find(requestId);
+			if (sentTimeIt != sentTimes.cend()) {
+				const auto rtt = getms(true) - sentTimeIt->second;
+				sentTimes.erase(sentTimeIt);
+				if (rtt < kGrowWindowBelowRtt) {
+					parallelLimit = std::min(
+						parallelLimit + uint32(sentPartSize),
+						kMaxUploadFileParallelSize);
+				} else if (rtt > kShrinkWindowAboveRtt) {
+					parallelLimit = std::max(
+						parallelLimit / 2,
+						kMinUploadFileParallelSize);
+				}
+			}
 			if (file.type() == SendMediaType::Photo) {
 				file.fileSentSize += sentPartSize;
 				const auto photo = Auth().data().photo(file.id());
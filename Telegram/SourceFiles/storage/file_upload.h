@@ -29,6 +29,12 @@ public:
 	void pause(const FullMsgId &msgId);
 	void confirm(const FullMsgId &msgId);
 
+	// Outcome of the send for a file that referenced a recent upload:
+	// a FILE_PART_* error means the server no longer keeps the parts,
+	// so the stale index entry is dropped and a real upload takes over.
+	void reuseDone(const FullMsgId &msgId);
+	bool reuseFailed(const FullMsgId &msgId, const QString &errorType);
+
 	void clear();
 
 	~Uploader();
@@ -52,6 +58,7 @@ signals:
 private:
 	struct File;
 
+	void checkReuse(File &file);
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	bool partFailed(const RPCError &err, mtpRequestId requestId);
 
@@ -60,9 +67,13 @@ private:
 	base::flat_map<mtpRequestId, QByteArray> requestsSent;
 	base::flat_map<mtpRequestId, int32> docRequestsSent;
 	base::flat_map<mtpRequestId, int32> dcMap;
+	base::flat_map<mtpRequestId, TimeMs> sentTimes;
 	uint32 sentSize = 0;
 	uint32 sentSizes[MTP::kUploadSessionsCount] = { 0 };
 
+	// In-flight window, adapted to the measured part round trip time.
+	uint32 parallelLimit = 0;
+
 	FullMsgId uploadingId;
 	FullMsgId _pausedId;
 	std::map<FullMsgId, File> queue;
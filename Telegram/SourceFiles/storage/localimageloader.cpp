@@ -21,7 +21,21 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 using Storage::ValidateThumbDimensions;
 
+namespace {
+
+// Don't re-read huge videos from disk just for upload deduplication.
+constexpr auto kMaxSizeForContentHash = 32 * 1024 * 1024;
+
+// All live task queues and the priority their worker threads should
+// run at, so that image scaling and media preparation can be dialed
+// down while a call is active. Main thread only.
+QList<TaskQueue*> AllQueues;
+QThread::Priority WorkersPriority = QThread::NormalPriority;
+
+} // namespace
+
 TaskQueue::TaskQueue(TimeMs stopTimeoutMs) {
+	AllQueues.push_back(this);
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -63,7 +77,7 @@ void TaskQueue::wakeThread() {
 		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
 		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		_thread->start();
+		_thread->start(WorkersPriority);
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
@@ -129,6 +143,16 @@ void TaskQueue::stop() {
 TaskQueue::~TaskQueue() {
 	stop();
 	delete _stopTimer;
+	AllQueues.removeOne(this);
+}
+
+void TaskQueue::SetAllWorkersPriority(QThread::Priority priority) {
+	WorkersPriority = priority;
+	for_const (auto queue, AllQueues) {
+		if (queue->_thread) {
+			queue->_thread->setPriority(priority);
+		}
+	}
 }
 
 void TaskQueueWorker::onTaskAdded() {
@@ -542,23 +566,42 @@ void FileLoadTask::process() {
 			if (isAnimation) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != SendMediaType::File) {
-				auto thumb = (w > 100 || h > 100) ? App::pixmapFromImageInPlace(fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
+				// Scaling the previews is the bulk of the preparation
+				// time for a large photo, so the small and medium sizes
+				// are scaled on the crl pool while this thread handles
+				// the heaviest full size scale and re-encode.
+				// QImage::scaled() is const and only reads the shared
+				// image data, so the copies can be scaled concurrently.
+				auto smallImage = QImage();
+				auto mediumImage = QImage();
+				QSemaphore semaphore;
+				crl::async([&semaphore, &smallImage, fullimage, w, h] {
+					const auto guard = gsl::finally([&] { semaphore.release(); });
+					smallImage = (w > 100 || h > 100) ? fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				});
+				crl::async([&semaphore, &mediumImage, fullimage, w, h] {
+					const auto guard = gsl::finally([&] { semaphore.release(); });
+					mediumImage = (w > 320 || h > 320) ? fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				});
+				auto fullPhotoImage = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				{
+					QBuffer buffer(&filedata);
+					fullPhotoImage.save(&buffer, "JPG", 87);
+				}
+				semaphore.acquire(2);
+
+				auto thumb = App::pixmapFromImageInPlace(std::move(smallImage));
 				photoThumbs.insert('s', thumb);
 				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
 
-				auto medium = (w > 320 || h > 320) ? App::pixmapFromImageInPlace(fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
+				auto medium = App::pixmapFromImageInPlace(std::move(mediumImage));
 				photoThumbs.insert('m', medium);
 				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
 
-				auto full = (w > 1280 || h > 1280) ? App::pixmapFromImageInPlace(fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
+				auto full = App::pixmapFromImageInPlace(std::move(fullPhotoImage));
 				photoThumbs.insert('y', full);
 				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
 
-				{
-					QBuffer buffer(&filedata);
-					full.save(&buffer, "JPG", 87);
-				}
-
 				photo = MTP_photo(MTP_flags(0), MTP_long(_id), MTP_long(0), MTP_int(unixtime()), MTP_vector<MTPPhotoSize>(photoSizes));
 
 				if (filesize < 0) {
@@ -615,6 +658,26 @@ void FileLoadTask::process() {
 	_result->filename = filename;
 	_result->filemime = filemime;
 	_result->setFileData(filedata);
+	if (_type != SendMediaType::Photo && _result->filemd5.isEmpty()) {
+		// Content hash used for upload deduplication. Photos get it in
+		// setFileData() above, documents are hashed here while we are
+		// still in the worker thread.
+		if (!_content.isEmpty()) {
+			_result->filemd5.resize(32);
+			hashMd5Hex(_content.constData(), _content.size(), _result->filemd5.data());
+		} else if (!_filepath.isEmpty() && filesize <= kMaxSizeForContentHash) {
+			QFile f(_filepath);
+			if (f.open(QIODevice::ReadOnly)) {
+				HashMd5 hash;
+				while (!f.atEnd()) {
+					const auto bytes = f.read(1024 * 1024);
+					hash.feed(bytes.constData(), bytes.size());
+				}
+				_result->filemd5.resize(32);
+				hashMd5Hex(hash.result(), _result->filemd5.data());
+			}
+		}
+	}
 
 	_result->thumbId = thumbId;
 	_result->thumbname = thumbname;
@@ -113,6 +113,11 @@ public:
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
 	void cancelTask(TaskId id); // this task finish() won't be called
 
+	// Adjusts the priority of all the live worker threads, so that
+	// image scaling and media preparation don't compete with the call
+	// audio threads for CPU while a call is active. Main thread only.
+	static void SetAllWorkersPriority(QThread::Priority priority);
+
 	~TaskQueue();
 
 signals:
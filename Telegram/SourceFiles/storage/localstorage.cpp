@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "lang/lang_keys.h"
 #include "media/media_audio.h"
+#include "media/media_clip_reader.h"
 #include "ui/widgets/input_fields.h"
 #include "mtproto/dc_options.h"
 #include "messenger.h"
@@ -28,15 +29,29 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "auth_session.h"
 #include "window/window_controller.h"
 #include "base/flags.h"
+#include "base/zlib_help.h"
 #include "data/data_session.h"
 #include "history/history.h"
 
 #include <openssl/evp.h>
 
+#ifdef Q_OS_WIN
+#include <io.h>
+#else // Q_OS_WIN
+#include <unistd.h>
+#endif // Q_OS_WIN
+
 namespace Local {
 namespace {
 
 constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
+constexpr auto kWindowSnapshotQuality = 87;
+
+// Large serialized blocks (sticker sets, saved gifs) are deflated
+// before encryption. A compressed block starts with this tag followed
+// by the deflated bytes, so readers detect it and inflate
+// transparently while old uncompressed files keep working.
+constexpr quint32 kCompressedBlockTag = 0x7A4C4254U; // 'TBLz'
 constexpr auto kFileLoaderQueueStopTimeout = TimeMs(5000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
@@ -201,8 +216,28 @@ struct EncryptedDescriptor {
 	}
 };
 
+void _fullSyncFile(QFile &file) {
+	file.flush();
+#ifdef Q_OS_WIN
+	_commit(file.handle());
+#else // Q_OS_WIN
+	::fsync(file.handle());
+#endif // Q_OS_WIN
+}
+
+// Grouped commit: blob writes land in the OS buffer immediately and a
+// single timer-driven sync covers the whole batch, so a burst of
+// incoming media does not issue one sync per file. Name-based writes
+// (map, settings, mtp data) keep syncing immediately.
+QMutex _pendingSyncMutex;
+QSet<QString> _pendingSyncPaths;
+
+void _registerGroupedSync(const QString &path);
+void _performGroupedSync();
+
 struct FileWriteDescriptor {
-	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe) {
+	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe)
+	: groupedSync(true) {
 		init(toFilePart(key), options);
 	}
 	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
@@ -282,6 +317,44 @@ struct FileWriteDescriptor {
 	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
 		return writeData(prepareEncrypted(data, key));
 	}
+	bool writeCompressedEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+		data.finish();
+		const auto plain = QByteArray::fromRawData(
+			data.data.constData() + sizeof(uint32),
+			data.data.size() - sizeof(uint32));
+
+		// Packed with a reused deflate context in the qCompress format
+		// (big-endian unpacked size, then a zlib stream), so readers
+		// keep using qUncompress. Writes happen on the main thread.
+		static zlib::StreamingDeflate Deflate(5);
+		auto packed = QByteArray();
+		const auto bound = Deflate.packBound(plain.size());
+		if (bound > 0) {
+			packed.resize(int(sizeof(quint32)) + bound);
+			const auto packedSize = Deflate.pack(
+				plain.constData(),
+				plain.size(),
+				packed.data() + sizeof(quint32),
+				packed.size() - sizeof(quint32));
+			if (packedSize > 0) {
+				packed.resize(int(sizeof(quint32)) + packedSize);
+				const auto size = quint32(plain.size());
+				packed[0] = char((size >> 24) & 0xFF);
+				packed[1] = char((size >> 16) & 0xFF);
+				packed[2] = char((size >> 8) & 0xFF);
+				packed[3] = char(size & 0xFF);
+			} else {
+				packed = QByteArray();
+			}
+		}
+		if (packed.isEmpty()) {
+			packed = qCompress(plain, 5);
+		}
+
+		EncryptedDescriptor compressed(sizeof(quint32) + sizeof(quint32) + packed.size());
+		compressed.stream << quint32(kCompressedBlockTag) << packed;
+		return writeEncrypted(compressed, key);
+	}
 	void finish() {
 		if (!file.isOpen()) return;
 
@@ -292,6 +365,11 @@ struct FileWriteDescriptor {
 		md5.feed(&version, sizeof(version));
 		md5.feed(tdfMagic, tdfMagicLen);
 		file.write((const char*)md5.result(), 0x10);
+		if (groupedSync) {
+			_registerGroupedSync(file.fileName());
+		} else {
+			_fullSyncFile(file);
+		}
 		file.close();
 
 		if (!toDelete.isEmpty()) {
@@ -302,6 +380,7 @@ struct FileWriteDescriptor {
 	QDataStream stream;
 
 	QString toDelete;
+	bool groupedSync = false;
 
 	HashMd5 md5;
 	int32 dataSize = 0;
@@ -408,17 +487,19 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 	return false;
 }
 
-bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKeyPtr &key = LocalKey) {
-	if (encrypted.size() <= 16 || (encrypted.size() & 0x0F)) {
-		LOG(("App Error: bad encrypted part size: %1").arg(encrypted.size()));
+bool decryptLocalRaw(EncryptedDescriptor &result, const char *encrypted, uint32 size, const MTP::AuthKeyPtr &key = LocalKey) {
+	if (size <= 16 || (size & 0x0F)) {
+		LOG(("App Error: bad encrypted part size: %1").arg(size));
 		return false;
 	}
-	uint32 fullLen = encrypted.size() - 16;
+	uint32 fullLen = size - 16;
 
 	QByteArray decrypted;
 	decrypted.resize(fullLen);
-	const char *encryptedKey = encrypted.constData(), *encryptedData = encrypted.constData() + 16;
+	const char *encryptedKey = encrypted, *encryptedData = encrypted + 16;
+	const auto decryptFrom = getms();
 	aesDecryptLocal(encryptedData, decrypted.data(), fullLen, key, encryptedKey);
+	_cacheDecryptMs += getms() - decryptFrom;
 	uchar sha1Buffer[20];
 	if (memcmp(hashSha1(decrypted.constData(), decrypted.size(), sha1Buffer), encryptedKey, 16)) {
 		LOG(("App Info: bad decrypt key, data not decrypted - incorrect password?"));
@@ -444,6 +525,45 @@ bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, cons
 	return true;
 }
 
+bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKeyPtr &key = LocalKey) {
+	return decryptLocalRaw(result, encrypted.constData(), encrypted.size(), key);
+}
+
+// Detects the compressed-block tag in a decrypted descriptor and
+// replaces the content with the inflated payload. Returns false only
+// when a tagged block fails to inflate.
+bool inflateCompressedBlock(FileReadDescriptor &result) {
+	if (result.stream.atEnd()) {
+		return true;
+	}
+	const auto position = result.buffer.pos();
+	quint32 tag = 0;
+	result.stream >> tag;
+	if (result.stream.status() != QDataStream::Ok || tag != kCompressedBlockTag) {
+		result.stream.resetStatus();
+		result.buffer.seek(position);
+		return true;
+	}
+	QByteArray packed;
+	result.stream >> packed;
+	auto plain = qUncompress(packed);
+	if (plain.isEmpty()) {
+		LOG(("App Error: could not inflate compressed block, packed size: %1").arg(packed.size()));
+		return false;
+	}
+
+	result.stream.setDevice(0);
+	if (result.buffer.isOpen()) result.buffer.close();
+	result.buffer.setBuffer(0);
+	result.data = plain;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+
+	return true;
+}
+
 bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
 	if (!readFile(result, name, options)) {
 		return false;
@@ -478,6 +598,124 @@ bool readEncryptedFile(FileReadDescriptor &result, const FileKey &fkey, FileOpti
 	return readEncryptedFile(result, toFilePart(fkey), options, key);
 }
 
+// Memory-mapped read path for large cached blobs: the encrypted file is
+// mapped instead of being read into an intermediate buffer, validated in
+// place and decrypted straight from the mapping into the result buffer.
+// The blob is copied once (at decryption) instead of three times. Falls
+// back to the buffered path when the mapping fails.
+bool readEncryptedFileMapped(FileReadDescriptor &result, const FileKey &fkey, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
+	if (options & FileOption::User) {
+		if (!_userWorking()) return false;
+	} else {
+		if (!_working()) return false;
+	}
+	const auto name = toFilePart(fkey);
+
+	// detect order of read attempts, exactly like readFile() does
+	QString toTry[2];
+	toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
+	if (options & FileOption::Safe) {
+		QFileInfo toTry0(toTry[0]);
+		if (toTry0.exists()) {
+			toTry[1] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '1';
+			QFileInfo toTry1(toTry[1]);
+			if (toTry1.exists()) {
+				QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
+				if (mod0 < mod1) {
+					qSwap(toTry[0], toTry[1]);
+				}
+			} else {
+				toTry[1] = QString();
+			}
+		} else {
+			toTry[0][toTry[0].size() - 1] = '1';
+		}
+	}
+	for (int32 i = 0; i < 2; ++i) {
+		QString fname(toTry[i]);
+		if (fname.isEmpty()) break;
+
+		QFile f(fname);
+		if (!f.open(QIODevice::ReadOnly)) {
+			DEBUG_LOG(("App Info: failed to open '%1' for reading").arg(name));
+			continue;
+		}
+		const auto fullSize = f.size();
+		if (fullSize <= qint64(tdfMagicLen + sizeof(qint32) + 16)) {
+			DEBUG_LOG(("App Info: bad file '%1', could not read sign part").arg(name));
+			continue;
+		}
+		const auto mapped = reinterpret_cast<const char*>(f.map(0, fullSize));
+		if (!mapped) {
+			return readEncryptedFile(result, fkey, options, key);
+		}
+
+		// check magic
+		if (memcmp(mapped, tdfMagic, tdfMagicLen)) {
+			DEBUG_LOG(("App Info: bad magic %1 in '%2'").arg(Logs::mb(mapped, tdfMagicLen).str()).arg(name));
+			continue;
+		}
+
+		// read app version
+		qint32 version;
+		memcpy(&version, mapped + tdfMagicLen, sizeof(version));
+		if (version > AppVersion) {
+			DEBUG_LOG(("App Info: version too big %1 for '%2', my version %3").arg(version).arg(name).arg(AppVersion));
+			continue;
+		}
+
+		const char *bytes = mapped + tdfMagicLen + sizeof(qint32);
+		int32 dataSize = fullSize - tdfMagicLen - sizeof(qint32) - 16;
+
+		// check signature
+		HashMd5 md5;
+		md5.feed(bytes, dataSize);
+		md5.feed(&dataSize, sizeof(dataSize));
+		md5.feed(&version, sizeof(version));
+		md5.feed(tdfMagic, tdfMagicLen);
+		if (memcmp(md5.result(), bytes + dataSize, 16)) {
+			DEBUG_LOG(("App Info: bad file '%1', signature did not match").arg(name));
+			continue;
+		}
+
+		// the data part holds a single serialized QByteArray with the
+		// encrypted blob: a big-endian length followed by the bytes
+		if (dataSize < int32(sizeof(quint32))) {
+			DEBUG_LOG(("App Info: bad file '%1', could not read encrypted length").arg(name));
+			continue;
+		}
+		quint32 encryptedLen;
+		memcpy(&encryptedLen, bytes, sizeof(encryptedLen));
+		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
+			encryptedLen = qbswap(encryptedLen);
+		}
+		if (encryptedLen == 0xffffffffU || encryptedLen + sizeof(quint32) > uint32(dataSize)) {
+			DEBUG_LOG(("App Info: bad file '%1', bad encrypted length %2").arg(name).arg(encryptedLen));
+			continue;
+		}
+
+		EncryptedDescriptor data;
+		if (!decryptLocalRaw(data, bytes + sizeof(quint32), encryptedLen, key)) {
+			continue;
+		}
+
+		if ((i == 0 && !toTry[1].isEmpty()) || i == 1) {
+			QFile::remove(toTry[1 - i]);
+		}
+
+		result.version = version;
+		result.data = data.data;
+		result.buffer.setBuffer(&result.data);
+		result.buffer.open(QIODevice::ReadOnly);
+		result.buffer.seek(data.buffer.pos());
+		result.stream.setDevice(&result.buffer);
+		result.stream.setVersion(QDataStream::Qt_5_1);
+
+		return true;
+	}
+	return false;
+}
+
 FileKey _dataNameKey = 0;
 
 enum { // Local Storage Keys
@@ -500,6 +738,9 @@ enum { // Local Storage Keys
 	lskStickersKeys = 0x10, // no data
 	lskTrustedBots = 0x11, // no data
 	lskFavedStickers = 0x12, // no data
+	lskVoiceWaveforms = 0x13, // no data
+	lskVideoThumbs = 0x14, // no data
+	lskStickerPreviews = 0x15, // no data
 };
 
 enum {
@@ -575,6 +816,7 @@ enum {
 	dbiConnectionType = 0x4f,
 	dbiStickersFavedLimit = 0x50,
 	dbiSuggestStickersByEmoji = 0x51,
+	dbiLocalStorageLimit = 0x52,
 
 	dbiEncryptedWithSalt = 333,
 	dbiEncrypted = 444,
@@ -597,6 +839,23 @@ DraftsMap _draftsMap, _draftCursorsMap;
 typedef QMap<PeerId, bool> DraftsNotReadMap;
 DraftsNotReadMap _draftsNotReadMap;
 
+// Draft writes are coalesced per peer within the write timeout and then
+// encrypted and flushed from the local tasks thread, so typing does not
+// pay for encryption and disk I/O on the main thread.
+struct PendingDraft {
+	MessageDraft localDraft;
+	MessageDraft editDraft;
+};
+typedef QMap<PeerId, PendingDraft> PendingDraftsMap;
+PendingDraftsMap _draftsPendingMap;
+
+struct PendingDraftCursors {
+	MessageCursor msgCursor;
+	MessageCursor editCursor;
+};
+typedef QMap<PeerId, PendingDraftCursors> PendingDraftCursorsMap;
+PendingDraftCursorsMap _draftCursorsPendingMap;
+
 typedef QPair<FileKey, qint32> FileDesc; // file, size
 
 typedef QMultiMap<MediaKey, FileLocation> FileLocations;
@@ -608,6 +867,14 @@ typedef QMap<MediaKey, MediaKey> FileLocationAliases;
 FileLocationAliases _fileLocationAliases;
 typedef QMap<QString, FileDesc> WebFilesMap;
 WebFilesMap _webFilesMap;
+typedef QMap<MediaKey, DownloadResume> DownloadResumeMap;
+DownloadResumeMap _downloadResumeMap;
+
+// The server keeps saved file parts alive for about a day, be conservative.
+constexpr auto kUploadedFileInfoLifetime = qint32(12 * 3600);
+
+typedef QMap<QByteArray, UploadedFileInfo> UploadedFilesMap;
+UploadedFilesMap _uploadedFilesMap;
 uint64 _storageWebFilesSize = 0;
 FileKey _locationsKey = 0, _reportSpamStatusesKey = 0, _trustedBotsKey = 0;
 
@@ -615,8 +882,57 @@ using TrustedBots = OrderedSet<uint64>;
 TrustedBots _trustedBots;
 bool _trustedBotsRead = false;
 
+// Locally counted voice message waveforms by media key, each one is
+// some 40 bytes of documentWaveformEncode5bit() data, so the cap is
+// a few dozen kilobytes of the most recently played voice chats.
+constexpr auto kMaxVoiceWaveformsCount = 1024;
+
+using VoiceWaveforms = QMap<MediaKey, QByteArray>;
+VoiceWaveforms _voiceWaveforms;
+bool _voiceWaveformsRead = false;
+FileKey _voiceWaveformsKey = 0;
+
+// Keyframe thumbnail strips for video scrubbing by media key, each
+// one is a JPEG of several dozen kilobytes, so the cap is kept low.
+constexpr auto kMaxVideoThumbsCount = 32;
+
+using VideoThumbs = QMap<MediaKey, QByteArray>;
+VideoThumbs _videoThumbs;
+bool _videoThumbsRead = false;
+FileKey _videoThumbsKey = 0;
+
+// Sticker panel previews pre-rendered at the panel cell size, so the
+// second-ever open of the panel paints without decoding the stickers.
+// All entries share one cell size - it changes only with the DPI or
+// the style, and then the whole cache is dropped at the first read.
+constexpr auto kMaxStickerPreviewsCount = 256;
+
+struct StickerPreview {
+	qint32 width = 0;
+	qint32 height = 0;
+	QByteArray bytes;
+};
+using StickerPreviews = QMap<MediaKey, StickerPreview>;
+StickerPreviews _stickerPreviews;
+bool _stickerPreviewsRead = false;
+FileKey _stickerPreviewsKey = 0;
+
 FileKey _recentStickersKeyOld = 0;
 FileKey _installedStickersKey = 0, _featuredStickersKey = 0, _recentStickersKey = 0, _favedStickersKey = 0, _archivedStickersKey = 0;
+
+// Which of the sticker set files wait for a write. Serializing a file
+// rewrites every set stored in it, so bursts of changes (installing a
+// list of packs, receiving the cloud order) are coalesced into a single
+// write per file, see writeInstalledStickers() and friends.
+enum StickersFileFlag {
+	StickersFileInstalled = (1 << 0),
+	StickersFileFeatured = (1 << 1),
+	StickersFileRecent = (1 << 2),
+	StickersFileFaved = (1 << 3),
+	StickersFileArchived = (1 << 4),
+};
+qint32 _stickersFilesToWrite = 0;
+
 FileKey _savedGifsKey = 0;
 
 FileKey _backgroundKey = 0;
@@ -633,6 +949,11 @@ FileKey _recentHashtagsAndBotsKey = 0;
 bool _recentHashtagsAndBotsWereRead = false;
 
 FileKey _savedPeersKey = 0;
+FileKey _peersSnapshotKey = 0;
+
+// Bumped whenever the peers snapshot layout changes, an old snapshot
+// is simply dropped and the peers arrive from the server sync.
+constexpr auto kPeersSnapshotVersion = quint32(1);
 FileKey _langPackKey = 0;
 
 typedef QMap<StorageKey, FileDesc> StorageMap;
@@ -642,6 +963,64 @@ qint64 _storageImagesSize = 0, _storageStickersSize = 0, _storageAudiosSize = 0;
 bool _mapChanged = false;
 int32 _oldMapVersion = 0, _oldSettingsVersion = 0;
 
+// Cache effectiveness counters, incremented from the main thread and
+// from the local tasks thread, read by Local::cacheStats().
+QAtomicInteger<qint64> _cacheHits = 0;
+QAtomicInteger<qint64> _cacheMisses = 0;
+QAtomicInteger<qint64> _cacheBytesRead = 0;
+QAtomicInteger<qint64> _cacheBytesWritten = 0;
+QAtomicInteger<qint64> _cacheDecryptMs = 0;
+
+// In-memory LRU index over the storage maps: every cached blob carries
+// a last-access tick, kept in a pair of maps so that enforcing a size
+// cap pops the least recently used entries in O(evicted * log n)
+// instead of scanning the whole cache.
+enum class StorageClass {
+	Images,
+	StickerImages,
+	Audios,
+};
+typedef QPair<int, StorageKey> StorageLruId;
+QMap<StorageLruId, quint64> _storageLruTicks;
+QMap<quint64, StorageLruId> _storageLruOrder;
+quint64 _storageLruCounter = 0;
+
+void _storageTouch(StorageClass storageClass, const StorageKey &key) {
+	const auto id = StorageLruId(int(storageClass), key);
+	const auto i = _storageLruTicks.find(id);
+	if (i != _storageLruTicks.end()) {
+		_storageLruOrder.remove(i.value());
+		i.value() = ++_storageLruCounter;
+	} else {
+		_storageLruTicks.insert(id, ++_storageLruCounter);
+	}
+	_storageLruOrder.insert(_storageLruCounter, id);
+}
+
+void _storageForget(StorageClass storageClass, const StorageKey &key) {
+	const auto id = StorageLruId(int(storageClass), key);
+	const auto i = _storageLruTicks.find(id);
+	if (i != _storageLruTicks.end()) {
+		_storageLruOrder.remove(i.value());
+		_storageLruTicks.erase(i);
+	}
+}
+
+// Evicts the oldest entries right after a cache write when the user
+// set a storage limit, so the cap costs O(evicted) per write instead
+// of a full scan.
+void _checkStorageLimit() {
+	if (const auto limit = Global::LocalStorageLimit()) {
+		enforceStorageLimit(limit);
+	}
+}
+
+void _storageLruClear() {
+	_storageLruTicks.clear();
+	_storageLruOrder.clear();
+	_storageLruCounter = 0;
+}
+
 enum class WriteMapWhen {
 	Now,
 	Fast,
@@ -658,6 +1037,255 @@ AuthSessionSettings &GetStoredAuthSessionCache() {
 
 void _writeMap(WriteMapWhen when = WriteMapWhen::Soon);
 
+// The storage maps (images, sticker images, audios) used to be written
+// as part of the full map file, so every cache mutation rewrote all of
+// the cached keys at once. Now they are split into kStorageShardsCount
+// shard files and a mutation only rewrites the one shard it touches.
+constexpr auto kStorageShardsCount = 16;
+static_assert(!(kStorageShardsCount & (kStorageShardsCount - 1)), "Shard lookup uses a bit mask.");
+
+uint32 _storageShardsChanged = 0;
+
+int _storageShardIndex(const StorageKey &location) {
+	return int((location.first ^ location.second) & (kStorageShardsCount - 1));
+}
+
+QString _storageShardName(int index) {
+	return qsl("map_shard%1").arg(index, 0, 16);
+}
+
+void _writeStorageShards(WriteMapWhen when = WriteMapWhen::Soon);
+
+void _flushDraftsQueue(WriteMapWhen when = WriteMapWhen::Soon, bool synchronous = false);
+
+// Append-only intent log for the common map mutations. Registering or
+// removing a draft key appends one small encrypted record instead of
+// scheduling a full map rewrite; the log is replayed after the map is
+// read and truncated on every full map write (the checkpoint). Anything
+// the journal does not cover still goes through _writeMap().
+enum MapJournalOp : quint32 {
+	jopDraftSet = 1,
+	jopDraftRemove = 2,
+	jopDraftCursorsSet = 3,
+	jopDraftCursorsRemove = 4,
+};
+
+constexpr auto kMapJournalCheckpointRecords = 128;
+
+int _mapJournalRecords = 0;
+
+QString _mapJournalPath() {
+	return _userBasePath + qsl("map_journal");
+}
+
+void _truncateMapJournal() {
+	if (!_userBasePath.isEmpty()) {
+		QFile::remove(_mapJournalPath());
+	}
+	_mapJournalRecords = 0;
+}
+
+void _journalMapMutation(MapJournalOp op, quint64 peer, FileKey key) {
+	if (_userBasePath.isEmpty() || !LocalKey) {
+		_mapChanged = true;
+		_writeMap();
+		return;
+	}
+	EncryptedDescriptor record(sizeof(quint32) + sizeof(quint64) * 2);
+	record.stream << quint32(op) << quint64(peer) << quint64(key);
+	const auto encrypted = FileWriteDescriptor::prepareEncrypted(record);
+
+	QFile journal(_mapJournalPath());
+	if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		LOG(("App Error: could not open map journal for appending"));
+		_mapChanged = true;
+		_writeMap();
+		return;
+	}
+	QDataStream stream(&journal);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << encrypted;
+	journal.close();
+
+	_mapChanged = true;
+	if (++_mapJournalRecords >= kMapJournalCheckpointRecords) {
+		_writeMap(WriteMapWhen::Fast);
+	}
+}
+
+void _replayMapJournal() {
+	QFile journal(_mapJournalPath());
+	if (!journal.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	QDataStream stream(&journal);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto replayed = 0;
+	while (!stream.atEnd()) {
+		QByteArray encrypted;
+		stream >> encrypted;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("App Info: map journal tail is corrupt, dropping it after %1 records").arg(replayed));
+			break;
+		}
+		EncryptedDescriptor record;
+		if (!decryptLocal(record, encrypted)) {
+			LOG(("App Info: could not decrypt map journal record %1, dropping the tail").arg(replayed));
+			break;
+		}
+		quint32 op = 0;
+		quint64 peer = 0, key = 0;
+		record.stream >> op >> peer >> key;
+		if (!_checkStreamStatus(record.stream)) {
+			break;
+		}
+		switch (op) {
+		case jopDraftSet: {
+			_draftsMap.insert(peer, key);
+			_draftsNotReadMap.insert(peer, true);
+		} break;
+		case jopDraftRemove: {
+			_draftsMap.remove(peer);
+			_draftsNotReadMap.remove(peer);
+		} break;
+		case jopDraftCursorsSet: {
+			_draftCursorsMap.insert(peer, key);
+		} break;
+		case jopDraftCursorsRemove: {
+			_draftCursorsMap.remove(peer);
+		} break;
+		default: {
+			LOG(("App Error: unknown op in map journal: %1").arg(op));
+		} break;
+		}
+		++replayed;
+	}
+	journal.close();
+	if (replayed) {
+		DEBUG_LOG(("App Info: replayed %1 map journal records").arg(replayed));
+		_mapChanged = true;
+	}
+}
+
+// Startup preload: the big independent blobs (sticker sets, saved gifs,
+// recent hashtags and bots) are read and decrypted on the local tasks
+// thread right after the map is read, so the main thread only applies
+// the already-decrypted data when it first needs it. If a blob is
+// requested before its preload finished the caller just reads it
+// synchronously, exactly as before.
+struct PreloadedBlob {
+	qint32 version = 0;
+	qint64 pos = 0;
+	QByteArray data;
+};
+
+QMutex _preloadedBlobsMutex;
+QMap<FileKey, PreloadedBlob> _preloadedBlobs;
+
+class PreloadBlobsTask : public Task {
+public:
+	explicit PreloadBlobsTask(QVector<FileKey> &&keys) : _keys(std::move(keys)) {
+	}
+	void process() override {
+		for (const auto key : _keys) {
+			FileReadDescriptor blob;
+			if (!readEncryptedFile(blob, key)) {
+				continue;
+			}
+			PreloadedBlob preloaded;
+			preloaded.version = blob.version;
+			preloaded.pos = blob.buffer.pos();
+			preloaded.data = blob.data;
+			QMutexLocker lock(&_preloadedBlobsMutex);
+			_preloadedBlobs.insert(key, preloaded);
+		}
+	}
+	void finish() override {
+	}
+
+private:
+	QVector<FileKey> _keys;
+
+};
+
+bool readEncryptedFilePreloaded(FileReadDescriptor &result, const FileKey &fkey, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
+	{
+		QMutexLocker lock(&_preloadedBlobsMutex);
+		const auto i = _preloadedBlobs.find(fkey);
+		if (i != _preloadedBlobs.end()) {
+			result.version = i->version;
+			result.data = i->data;
+			result.buffer.setBuffer(&result.data);
+			result.buffer.open(QIODevice::ReadOnly);
+			result.buffer.seek(i->pos);
+			result.stream.setDevice(&result.buffer);
+			result.stream.setVersion(QDataStream::Qt_5_1);
+			_preloadedBlobs.erase(i);
+			return true;
+		}
+	}
+	return readEncryptedFile(result, fkey, options, key);
+}
+
+void _preloadStartupBlobs() {
+	if (!_localLoader) {
+		return;
+	}
+	auto keys = QVector<FileKey>();
+	for (const auto key : {
+		_installedStickersKey,
+		_featuredStickersKey,
+		_recentStickersKey,
+		_favedStickersKey,
+		_archivedStickersKey,
+		_savedGifsKey,
+		_recentHashtagsAndBotsKey,
+	}) {
+		if (key) {
+			keys.push_back(key);
+		}
+	}
+	if (!keys.isEmpty()) {
+		_localLoader->addTask(std::make_unique<PreloadBlobsTask>(std::move(keys)));
+	}
+}
+
+
+void _markStorageShardChanged(const StorageKey &location, WriteMapWhen when = WriteMapWhen::Soon) {
+	_storageShardsChanged |= (1U << _storageShardIndex(location));
+	_writeStorageShards(when);
+}
+
+void _markAllStorageShardsChanged() {
+	_storageShardsChanged = (1U << kStorageShardsCount) - 1;
+}
+
+void _registerGroupedSync(const QString &path) {
+	{
+		QMutexLocker lock(&_pendingSyncMutex);
+		_pendingSyncPaths.insert(path);
+	}
+	if (_manager) {
+		// May be called from the local tasks thread, the timer has to
+		// be started on the thread the manager lives on.
+		QMetaObject::invokeMethod(_manager, "scheduleSync", Qt::QueuedConnection);
+	}
+}
+
+void _performGroupedSync() {
+	auto paths = QSet<QString>();
+	{
+		QMutexLocker lock(&_pendingSyncMutex);
+		paths = base::take(_pendingSyncPaths);
+	}
+	for (const auto &path : paths) {
+		QFile file(path);
+		if (file.open(QIODevice::ReadWrite)) {
+			_fullSyncFile(file);
+		}
+	}
+}
+
 void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 	if (when != WriteMapWhen::Now) {
 		_manager->writeLocations(when == WriteMapWhen::Fast);
@@ -666,7 +1294,10 @@ void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 	if (!_working()) return;
 
 	_manager->writingLocations();
-	if (_fileLocations.isEmpty() && _webFilesMap.isEmpty()) {
+	if (_fileLocations.isEmpty()
+		&& _webFilesMap.isEmpty()
+		&& _downloadResumeMap.isEmpty()
+		&& _uploadedFilesMap.isEmpty()) {
 		if (_locationsKey) {
 			clearKey(_locationsKey);
 			_locationsKey = 0;
@@ -710,6 +1341,18 @@ void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 			size += Serialize::stringSize(i.key()) + sizeof(quint64) + sizeof(qint32);
 		}
 
+		size += sizeof(quint32); // download resume count
+		for (DownloadResumeMap::const_iterator i = _downloadResumeMap.cbegin(), e = _downloadResumeMap.cend(); i != e; ++i) {
+			// location + name + already + size
+			size += sizeof(quint64) * 2 + Serialize::stringSize(i.value().fname) + sizeof(qint32) * 2;
+		}
+
+		size += sizeof(quint32); // uploaded files count
+		for (UploadedFilesMap::const_iterator i = _uploadedFilesMap.cbegin(), e = _uploadedFilesMap.cend(); i != e; ++i) {
+			// md5 + file id + parts count + big + when
+			size += Serialize::bytearraySize(i.key()) + sizeof(quint64) + sizeof(qint32) * 3;
+		}
+
 		EncryptedDescriptor data(size);
 		auto legacyTypeField = 0;
 		for (FileLocations::const_iterator i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
@@ -736,6 +1379,16 @@ void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 			data.stream << i.key() << quint64(i.value().first) << qint32(i.value().second);
 		}
 
+		data.stream << quint32(_downloadResumeMap.size());
+		for (DownloadResumeMap::const_iterator i = _downloadResumeMap.cbegin(), e = _downloadResumeMap.cend(); i != e; ++i) {
+			data.stream << quint64(i.key().first) << quint64(i.key().second) << i.value().fname << qint32(i.value().already) << qint32(i.value().size);
+		}
+
+		data.stream << quint32(_uploadedFilesMap.size());
+		for (UploadedFilesMap::const_iterator i = _uploadedFilesMap.cbegin(), e = _uploadedFilesMap.cend(); i != e; ++i) {
+			data.stream << i.key() << quint64(i.value().fileId) << qint32(i.value().partsCount) << qint32(i.value().big ? 1 : 0) << qint32(i.value().when);
+		}
+
 		FileWriteDescriptor file(_locationsKey);
 		file.writeEncrypted(data);
 	}
@@ -797,13 +1450,59 @@ void _readLocations() {
 				_webFilesMap.insert(url, FileDesc(key, size));
 				_storageWebFilesSize += size;
 			}
+
+			if (!locations.stream.atEnd()) {
+				_downloadResumeMap.clear();
+
+				quint32 downloadResumeCount;
+				locations.stream >> downloadResumeCount;
+				for (quint32 i = 0; i < downloadResumeCount; ++i) {
+					quint64 first, second;
+					DownloadResume resume;
+					locations.stream >> first >> second >> resume.fname >> resume.already >> resume.size;
+					if (QFile(resume.fname).exists()) {
+						_downloadResumeMap.insert(MediaKey(first, second), resume);
+					}
+				}
+
+				if (!locations.stream.atEnd()) {
+					_uploadedFilesMap.clear();
+
+					auto now = qint32(unixtime());
+					quint32 uploadedFilesCount;
+					locations.stream >> uploadedFilesCount;
+					for (quint32 i = 0; i < uploadedFilesCount; ++i) {
+						QByteArray md5;
+						quint64 fileId;
+						qint32 partsCount, big, when;
+						locations.stream >> md5 >> fileId >> partsCount >> big >> when;
+						if (when + kUploadedFileInfoLifetime > now) {
+							UploadedFileInfo info;
+							info.fileId = fileId;
+							info.partsCount = partsCount;
+							info.big = (big == 1);
+							info.when = when;
+							_uploadedFilesMap.insert(md5, info);
+						}
+					}
+				}
+			}
 		}
 	}
 }
 
-void _writeReportSpamStatuses() {
+void _writeReportSpamStatuses(WriteMapWhen when = WriteMapWhen::Soon) {
+	// A single peer status change used to rewrite the whole statuses
+	// map right away, so accounts that open many new chats rewrote the
+	// file constantly. Debounce through the manager like the locations
+	// map - the statuses stay valid in memory meanwhile.
+	if (when != WriteMapWhen::Now) {
+		_manager->writeReportSpamStatuses(when == WriteMapWhen::Fast);
+		return;
+	}
 	if (!_working()) return;
 
+	_manager->writingReportSpamStatuses();
 	if (cReportSpamStatuses().isEmpty()) {
 		if (_reportSpamStatusesKey) {
 			clearKey(_reportSpamStatusesKey);
@@ -1027,6 +1726,14 @@ bool _readSetting(quint32 blockId, QDataStream &stream, int version, ReadSetting
 		Global::SetSuggestStickersByEmoji(v == 1);
 	} break;
 
+	case dbiLocalStorageLimit: {
+		qint64 v;
+		stream >> v;
+		if (!_checkStreamStatus(stream)) return false;
+
+		Global::SetLocalStorageLimit((v > 0) ? v : 0);
+	} break;
+
 	case dbiAutoDownload: {
 		qint32 photo, audio, gif;
 		stream >> photo >> audio >> gif;
@@ -1860,6 +2567,7 @@ void _writeUserSettings() {
 		size += Serialize::stringSize(item.first) + sizeof(item.second);
 	}
 
+	size += sizeof(quint32) + sizeof(qint64);
 	size += sizeof(quint32) + sizeof(qint32) + cEmojiVariants().size() * (sizeof(uint32) + sizeof(uint64));
 	size += sizeof(quint32) + sizeof(qint32) + (Stickers::GetRecentPack().isEmpty() ? Stickers::GetRecentPack().size() : cRecentStickersPreload().size()) * (sizeof(uint64) + sizeof(ushort));
 	size += sizeof(quint32) + Serialize::stringSize(cDialogLastPath());
@@ -1896,6 +2604,7 @@ void _writeUserSettings() {
 	data.stream << quint32(dbiAutoPlay) << qint32(cAutoPlayGif() ? 1 : 0);
 	data.stream << quint32(dbiUseExternalVideoPlayer) << qint32(cUseExternalVideoPlayer());
 	data.stream << quint32(dbiSuggestStickersByEmoji) << qint32(Global::SuggestStickersByEmoji() ? 1 : 0);
+	data.stream << quint32(dbiLocalStorageLimit) << qint64(Global::LocalStorageLimit());
 	if (!userData.isEmpty()) {
 		data.stream << quint32(dbiAuthSessionSettings) << userData;
 	}
@@ -1992,11 +2701,116 @@ void _readMtpData() {
 			return _writeMtpData();
 		}
 
-		if (!_readSetting(blockId, mtp.stream, mtp.version, context)) {
-			return _writeMtpData();
+		if (!_readSetting(blockId, mtp.stream, mtp.version, context)) {
+			return _writeMtpData();
+		}
+	}
+	applyReadContext(std::move(context));
+}
+
+void _mergeStorageShardEntry(StorageMap &to, qint64 &totalSize, const StorageKey &location, const FileDesc &value) {
+	const auto i = to.constFind(location);
+	if (i != to.cend()) {
+		totalSize -= i.value().second;
+	}
+	to.insert(location, value);
+	totalSize += value.second;
+}
+
+void _readStorageShards() {
+	for (auto index = 0; index != kStorageShardsCount; ++index) {
+		FileReadDescriptor shard;
+		if (!readEncryptedFile(shard, _storageShardName(index))) {
+			continue;
+		}
+		while (!shard.stream.atEnd()) {
+			quint32 keyType = 0, count = 0;
+			shard.stream >> keyType >> count;
+			if (!_checkStreamStatus(shard.stream)) {
+				break;
+			}
+			for (quint32 i = 0; i != count; ++i) {
+				FileKey key;
+				quint64 first, second;
+				qint32 size;
+				shard.stream >> key >> first >> second >> size;
+				if (!_checkStreamStatus(shard.stream)) {
+					break;
+				}
+				const auto location = StorageKey(first, second);
+				const auto value = FileDesc(key, size);
+				switch (keyType) {
+				case lskImages: _mergeStorageShardEntry(_imagesMap, _storageImagesSize, location, value); break;
+				case lskStickerImages: _mergeStorageShardEntry(_stickerImagesMap, _storageStickersSize, location, value); break;
+				case lskAudios: _mergeStorageShardEntry(_audiosMap, _storageAudiosSize, location, value); break;
+				default: {
+					LOG(("App Error: unknown key type in storage shard: %1").arg(keyType));
+				} break;
+				}
+			}
+		}
+	}
+}
+
+void _writeStorageShard(int index) {
+	if (_userBasePath.isEmpty()) {
+		LOG(("App Error: _userBasePath is empty in writeStorageShard()"));
+		return;
+	}
+	if (!QDir().exists(_userBasePath)) QDir().mkpath(_userBasePath);
+
+	const auto countShardEntries = [index](const StorageMap &map) {
+		auto result = 0;
+		for (auto i = map.cbegin(), e = map.cend(); i != e; ++i) {
+			if (_storageShardIndex(i.key()) == index) {
+				++result;
+			}
+		}
+		return result;
+	};
+	const auto imagesCount = countShardEntries(_imagesMap);
+	const auto stickersCount = countShardEntries(_stickerImagesMap);
+	const auto audiosCount = countShardEntries(_audiosMap);
+
+	uint32 shardSize = 0;
+	if (imagesCount) shardSize += sizeof(quint32) * 2 + imagesCount * (sizeof(quint64) * 3 + sizeof(qint32));
+	if (stickersCount) shardSize += sizeof(quint32) * 2 + stickersCount * (sizeof(quint64) * 3 + sizeof(qint32));
+	if (audiosCount) shardSize += sizeof(quint32) * 2 + audiosCount * (sizeof(quint64) * 3 + sizeof(qint32));
+
+	EncryptedDescriptor shardData(shardSize);
+	const auto writeShardEntries = [index, &shardData](quint32 keyType, const StorageMap &map, int count) {
+		if (!count) {
+			return;
+		}
+		shardData.stream << keyType << quint32(count);
+		for (auto i = map.cbegin(), e = map.cend(); i != e; ++i) {
+			if (_storageShardIndex(i.key()) == index) {
+				shardData.stream << quint64(i.value().first) << quint64(i.key().first) << quint64(i.key().second) << qint32(i.value().second);
+			}
+		}
+	};
+	writeShardEntries(lskImages, _imagesMap, imagesCount);
+	writeShardEntries(lskStickerImages, _stickerImagesMap, stickersCount);
+	writeShardEntries(lskAudios, _audiosMap, audiosCount);
+
+	FileWriteDescriptor shard(_storageShardName(index));
+	shard.writeEncrypted(shardData);
+}
+
+void _writeStorageShards(WriteMapWhen when) {
+	if (when != WriteMapWhen::Now) {
+		_manager->writeShards(when == WriteMapWhen::Fast);
+		return;
+	}
+	_manager->writingShards();
+	if (!_storageShardsChanged) return;
+
+	for (auto index = 0; index != kStorageShardsCount; ++index) {
+		if (_storageShardsChanged & (1U << index)) {
+			_writeStorageShard(index);
 		}
 	}
-	applyReadContext(std::move(context));
+	_storageShardsChanged = 0;
 }
 
 ReadMapState _readMap(const QByteArray &pass) {
@@ -2051,10 +2865,14 @@ ReadMapState _readMap(const QByteArray &pass) {
 	StorageMap imagesMap, stickerImagesMap, audiosMap;
 	qint64 storageImagesSize = 0, storageStickersSize = 0, storageAudiosSize = 0;
 	quint64 locationsKey = 0, reportSpamStatusesKey = 0, trustedBotsKey = 0;
+	quint64 voiceWaveformsKey = 0;
+	quint64 videoThumbsKey = 0;
+	quint64 stickerPreviewsKey = 0;
 	quint64 recentStickersKeyOld = 0;
 	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
 	quint64 savedGifsKey = 0;
 	quint64 backgroundKey = 0, userSettingsKey = 0, recentHashtagsAndBotsKey = 0, savedPeersKey = 0;
+	quint64 peersSnapshotKey = 0;
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -2125,6 +2943,15 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskTrustedBots: {
 			map.stream >> trustedBotsKey;
 		} break;
+		case lskVoiceWaveforms: {
+			map.stream >> voiceWaveformsKey;
+		} break;
+		case lskVideoThumbs: {
+			map.stream >> videoThumbsKey;
+		} break;
+		case lskStickerPreviews: {
+			map.stream >> stickerPreviewsKey;
+		} break;
 		case lskRecentStickersOld: {
 			map.stream >> recentStickersKeyOld;
 		} break;
@@ -2156,6 +2983,9 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskSavedPeers: {
 			map.stream >> savedPeersKey;
 		} break;
+		case lskPeersSnapshot: {
+			map.stream >> peersSnapshotKey;
+		} break;
 		default:
 		LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 		return ReadMapFailed;
@@ -2176,9 +3006,30 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_audiosMap = audiosMap;
 	_storageAudiosSize = storageAudiosSize;
 
+	_readStorageShards();
+	_storageLruClear();
+	for (auto i = _imagesMap.cbegin(), e = _imagesMap.cend(); i != e; ++i) {
+		_storageTouch(StorageClass::Images, i.key());
+	}
+	for (auto i = _stickerImagesMap.cbegin(), e = _stickerImagesMap.cend(); i != e; ++i) {
+		_storageTouch(StorageClass::StickerImages, i.key());
+	}
+	for (auto i = _audiosMap.cbegin(), e = _audiosMap.cend(); i != e; ++i) {
+		_storageTouch(StorageClass::Audios, i.key());
+	}
+	if (!imagesMap.isEmpty() || !stickerImagesMap.isEmpty() || !audiosMap.isEmpty()) {
+		// Legacy map still carried storage entries, move them to shards.
+		_markAllStorageShardsChanged();
+		_writeStorageShards();
+		_mapChanged = true;
+	}
+
 	_locationsKey = locationsKey;
 	_reportSpamStatusesKey = reportSpamStatusesKey;
 	_trustedBotsKey = trustedBotsKey;
+	_voiceWaveformsKey = voiceWaveformsKey;
+	_videoThumbsKey = videoThumbsKey;
+	_stickerPreviewsKey = stickerPreviewsKey;
 	_recentStickersKeyOld = recentStickersKeyOld;
 	_installedStickersKey = installedStickersKey;
 	_featuredStickersKey = featuredStickersKey;
@@ -2187,15 +3038,20 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_archivedStickersKey = archivedStickersKey;
 	_savedGifsKey = savedGifsKey;
 	_savedPeersKey = savedPeersKey;
+	_peersSnapshotKey = peersSnapshotKey;
 	_backgroundKey = backgroundKey;
 	_userSettingsKey = userSettingsKey;
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
+	_replayMapJournal();
+
 	_oldMapVersion = mapData.version;
 	if (_oldMapVersion < AppVersion) {
 		_mapChanged = true;
 		_writeMap();
-	} else {
+	} else if (!_mapChanged) {
 		_mapChanged = false;
+	} else {
+		_writeMap();
 	}
 
 	if (_locationsKey) {
@@ -2208,6 +3064,8 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_readUserSettings();
 	_readMtpData();
 
+	_preloadStartupBlobs();
+
 	Messenger::Instance().setAuthSessionFromStorage(std::move(StoredAuthSessionCache));
 
 	LOG(("Map read time: %1").arg(getms() - ms));
@@ -2252,12 +3110,12 @@ void _writeMap(WriteMapWhen when) {
 	uint32 mapSize = 0;
 	if (!_draftsMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _draftsMap.size() * sizeof(quint64) * 2;
 	if (!_draftCursorsMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _draftCursorsMap.size() * sizeof(quint64) * 2;
-	if (!_imagesMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _imagesMap.size() * (sizeof(quint64) * 3 + sizeof(qint32));
-	if (!_stickerImagesMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _stickerImagesMap.size() * (sizeof(quint64) * 3 + sizeof(qint32));
-	if (!_audiosMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _audiosMap.size() * (sizeof(quint64) * 3 + sizeof(qint32));
 	if (_locationsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_reportSpamStatusesKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_trustedBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_voiceWaveformsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_videoThumbsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_stickerPreviewsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentStickersKeyOld) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_installedStickersKey || _featuredStickersKey || _recentStickersKey || _archivedStickersKey) {
 		mapSize += sizeof(quint32) + 4 * sizeof(quint64);
@@ -2265,6 +3123,7 @@ void _writeMap(WriteMapWhen when) {
 	if (_favedStickersKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_savedGifsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_savedPeersKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_peersSnapshotKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_backgroundKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_userSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
@@ -2293,24 +3152,6 @@ void _writeMap(WriteMapWhen when) {
 			mapData.stream << quint64(i.value()) << quint64(i.key());
 		}
 	}
-	if (!_imagesMap.isEmpty()) {
-		mapData.stream << quint32(lskImages) << quint32(_imagesMap.size());
-		for (StorageMap::const_iterator i = _imagesMap.cbegin(), e = _imagesMap.cend(); i != e; ++i) {
-			mapData.stream << quint64(i.value().first) << quint64(i.key().first) << quint64(i.key().second) << qint32(i.value().second);
-		}
-	}
-	if (!_stickerImagesMap.isEmpty()) {
-		mapData.stream << quint32(lskStickerImages) << quint32(_stickerImagesMap.size());
-		for (StorageMap::const_iterator i = _stickerImagesMap.cbegin(), e = _stickerImagesMap.cend(); i != e; ++i) {
-			mapData.stream << quint64(i.value().first) << quint64(i.key().first) << quint64(i.key().second) << qint32(i.value().second);
-		}
-	}
-	if (!_audiosMap.isEmpty()) {
-		mapData.stream << quint32(lskAudios) << quint32(_audiosMap.size());
-		for (StorageMap::const_iterator i = _audiosMap.cbegin(), e = _audiosMap.cend(); i != e; ++i) {
-			mapData.stream << quint64(i.value().first) << quint64(i.key().first) << quint64(i.key().second) << qint32(i.value().second);
-		}
-	}
 	if (_locationsKey) {
 		mapData.stream << quint32(lskLocations) << quint64(_locationsKey);
 	}
@@ -2320,6 +3161,15 @@ void _writeMap(WriteMapWhen when) {
 	if (_trustedBotsKey) {
 		mapData.stream << quint32(lskTrustedBots) << quint64(_trustedBotsKey);
 	}
+	if (_voiceWaveformsKey) {
+		mapData.stream << quint32(lskVoiceWaveforms) << quint64(_voiceWaveformsKey);
+	}
+	if (_videoThumbsKey) {
+		mapData.stream << quint32(lskVideoThumbs) << quint64(_videoThumbsKey);
+	}
+	if (_stickerPreviewsKey) {
+		mapData.stream << quint32(lskStickerPreviews) << quint64(_stickerPreviewsKey);
+	}
 	if (_recentStickersKeyOld) {
 		mapData.stream << quint32(lskRecentStickersOld) << quint64(_recentStickersKeyOld);
 	}
@@ -2336,6 +3186,9 @@ void _writeMap(WriteMapWhen when) {
 	if (_savedPeersKey) {
 		mapData.stream << quint32(lskSavedPeers) << quint64(_savedPeersKey);
 	}
+	if (_peersSnapshotKey) {
+		mapData.stream << quint32(lskPeersSnapshot) << quint64(_peersSnapshotKey);
+	}
 	if (_backgroundKey) {
 		mapData.stream << quint32(lskBackground) << quint64(_backgroundKey);
 	}
@@ -2347,6 +3200,7 @@ void _writeMap(WriteMapWhen when) {
 	}
 	map.writeEncrypted(mapData);
 
+	_truncateMapJournal();
 	_mapChanged = false;
 
 	if (mapSize > 30 * 1024 * 1024) {
@@ -2358,6 +3212,7 @@ void _writeMap(WriteMapWhen when) {
 
 void finish() {
 	if (_manager) {
+		_flushDraftsQueue(WriteMapWhen::Now, true);
 		_writeMap(WriteMapWhen::Now);
 		_manager->finish();
 		_manager->deleteLater();
@@ -2409,6 +3264,12 @@ void start() {
 	}
 
 	LOG(("App Info: reading encrypted settings..."));
+	// Note on a possible "fixed-layout fast path": it would not help
+	// here. The records are inherently variable-length (strings, the
+	// proxies list, the serialized dcOptions blob), they carry secrets
+	// so they cannot move out of the encrypted container, and the time
+	// in this loop is dominated by the file read and AES decryption
+	// above, not by the dispatcher switch.
 	while (!settings.stream.atEnd()) {
 		quint32 blockId;
 		settings.stream >> blockId;
@@ -2588,6 +3449,12 @@ void reset() {
 	_passKeySalt.clear(); // reset passcode, local key
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
+	_draftsPendingMap.clear();
+	_draftCursorsPendingMap.clear();
+	{
+		QMutexLocker lock(&_preloadedBlobsMutex);
+		_preloadedBlobs.clear();
+	}
 	_fileLocations.clear();
 	_fileLocationPairs.clear();
 	_fileLocationAliases.clear();
@@ -2596,17 +3463,31 @@ void reset() {
 	_stickerImagesMap.clear();
 	_audiosMap.clear();
 	_storageImagesSize = _storageStickersSize = _storageAudiosSize = 0;
+	_storageLruClear();
+	_markAllStorageShardsChanged();
 	_webFilesMap.clear();
 	_storageWebFilesSize = 0;
 	_locationsKey = _reportSpamStatusesKey = _trustedBotsKey = 0;
+	_voiceWaveforms.clear();
+	_voiceWaveformsRead = false;
+	_voiceWaveformsKey = 0;
+	_videoThumbs.clear();
+	_videoThumbsRead = false;
+	_videoThumbsKey = 0;
+	_stickerPreviews.clear();
+	_stickerPreviewsRead = false;
+	_stickerPreviewsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = _featuredStickersKey = _recentStickersKey = _favedStickersKey = _archivedStickersKey = 0;
+	_stickersFilesToWrite = 0;
 	_savedGifsKey = 0;
 	_backgroundKey = _userSettingsKey = _recentHashtagsAndBotsKey = _savedPeersKey = 0;
+	_peersSnapshotKey = 0;
 	_oldMapVersion = _oldSettingsVersion = 0;
 	StoredAuthSessionCache.reset();
 	_mapChanged = true;
 	_writeMap(WriteMapWhen::Now);
+	_writeStorageShards(WriteMapWhen::Now);
 
 	_writeMtpData();
 }
@@ -2648,55 +3529,134 @@ int32 oldSettingsVersion() {
 	return _oldSettingsVersion;
 }
 
+struct DraftWriteRequest {
+	FileKey key;
+	PeerId peer;
+	PendingDraft draft;
+};
+
+struct DraftCursorsWriteRequest {
+	FileKey key;
+	PeerId peer;
+	PendingDraftCursors cursors;
+};
+
+class DraftsWriteTask : public Task {
+public:
+	DraftsWriteTask(QVector<DraftWriteRequest> &&drafts, QVector<DraftCursorsWriteRequest> &&cursors)
+	: _drafts(std::move(drafts))
+	, _cursors(std::move(cursors)) {
+	}
+	void process() override {
+		for (const auto &request : _drafts) {
+			const auto &localDraft = request.draft.localDraft;
+			const auto &editDraft = request.draft.editDraft;
+			auto msgTags = Ui::FlatTextarea::serializeTagsList(localDraft.textWithTags.tags);
+			auto editTags = Ui::FlatTextarea::serializeTagsList(editDraft.textWithTags.tags);
+
+			int size = sizeof(quint64);
+			size += Serialize::stringSize(localDraft.textWithTags.text) + Serialize::bytearraySize(msgTags) + 2 * sizeof(qint32);
+			size += Serialize::stringSize(editDraft.textWithTags.text) + Serialize::bytearraySize(editTags) + 2 * sizeof(qint32);
+
+			EncryptedDescriptor data(size);
+			data.stream << quint64(request.peer);
+			data.stream << localDraft.textWithTags.text << msgTags;
+			data.stream << qint32(localDraft.msgId) << qint32(localDraft.previewCancelled ? 1 : 0);
+			data.stream << editDraft.textWithTags.text << editTags;
+			data.stream << qint32(editDraft.msgId) << qint32(editDraft.previewCancelled ? 1 : 0);
+
+			FileWriteDescriptor file(request.key);
+			file.writeEncrypted(data);
+		}
+		for (const auto &request : _cursors) {
+			const auto &msgCursor = request.cursors.msgCursor;
+			const auto &editCursor = request.cursors.editCursor;
+
+			EncryptedDescriptor data(sizeof(quint64) + sizeof(qint32) * 3);
+			data.stream << quint64(request.peer) << qint32(msgCursor.position) << qint32(msgCursor.anchor) << qint32(msgCursor.scroll);
+			data.stream << qint32(editCursor.position) << qint32(editCursor.anchor) << qint32(editCursor.scroll);
+
+			FileWriteDescriptor file(request.key);
+			file.writeEncrypted(data);
+		}
+	}
+	void finish() override {
+	}
+
+private:
+	QVector<DraftWriteRequest> _drafts;
+	QVector<DraftCursorsWriteRequest> _cursors;
+
+};
+
+void _flushDraftsQueue(WriteMapWhen when, bool synchronous) {
+	if (when != WriteMapWhen::Now) {
+		_manager->writeDrafts(when == WriteMapWhen::Fast);
+		return;
+	}
+	_manager->writingDrafts();
+	if (_draftsPendingMap.isEmpty() && _draftCursorsPendingMap.isEmpty()) {
+		return;
+	}
+
+	auto drafts = QVector<DraftWriteRequest>();
+	drafts.reserve(_draftsPendingMap.size());
+	for (auto i = _draftsPendingMap.cbegin(), e = _draftsPendingMap.cend(); i != e; ++i) {
+		auto j = _draftsMap.constFind(i.key());
+		if (j == _draftsMap.cend()) {
+			j = _draftsMap.insert(i.key(), genKey());
+			_journalMapMutation(jopDraftSet, i.key(), j.value());
+		}
+		drafts.push_back({ j.value(), i.key(), i.value() });
+	}
+	auto cursors = QVector<DraftCursorsWriteRequest>();
+	cursors.reserve(_draftCursorsPendingMap.size());
+	for (auto i = _draftCursorsPendingMap.cbegin(), e = _draftCursorsPendingMap.cend(); i != e; ++i) {
+		auto j = _draftCursorsMap.constFind(i.key());
+		if (j == _draftCursorsMap.cend()) {
+			j = _draftCursorsMap.insert(i.key(), genKey());
+			_journalMapMutation(jopDraftCursorsSet, i.key(), j.value());
+		}
+		cursors.push_back({ j.value(), i.key(), i.value() });
+	}
+	_draftsPendingMap.clear();
+	_draftCursorsPendingMap.clear();
+
+	auto task = std::make_unique<DraftsWriteTask>(std::move(drafts), std::move(cursors));
+	if (synchronous || !_localLoader) {
+		task->process();
+	} else {
+		_localLoader->addTask(std::move(task));
+	}
+}
+
 void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const MessageDraft &editDraft) {
 	if (!_working()) return;
 
 	if (localDraft.msgId <= 0 && localDraft.textWithTags.text.isEmpty() && editDraft.msgId <= 0) {
+		_draftsPendingMap.remove(peer);
 		auto i = _draftsMap.find(peer);
 		if (i != _draftsMap.cend()) {
 			clearKey(i.value());
 			_draftsMap.erase(i);
-			_mapChanged = true;
-			_writeMap();
+			_journalMapMutation(jopDraftRemove, peer, 0);
 		}
 
 		_draftsNotReadMap.remove(peer);
 	} else {
-		auto i = _draftsMap.constFind(peer);
-		if (i == _draftsMap.cend()) {
-			i = _draftsMap.insert(peer, genKey());
-			_mapChanged = true;
-			_writeMap(WriteMapWhen::Fast);
-		}
-
-		auto msgTags = Ui::FlatTextarea::serializeTagsList(localDraft.textWithTags.tags);
-		auto editTags = Ui::FlatTextarea::serializeTagsList(editDraft.textWithTags.tags);
-
-		int size = sizeof(quint64);
-		size += Serialize::stringSize(localDraft.textWithTags.text) + Serialize::bytearraySize(msgTags) + 2 * sizeof(qint32);
-		size += Serialize::stringSize(editDraft.textWithTags.text) + Serialize::bytearraySize(editTags) + 2 * sizeof(qint32);
-
-		EncryptedDescriptor data(size);
-		data.stream << quint64(peer);
-		data.stream << localDraft.textWithTags.text << msgTags;
-		data.stream << qint32(localDraft.msgId) << qint32(localDraft.previewCancelled ? 1 : 0);
-		data.stream << editDraft.textWithTags.text << editTags;
-		data.stream << qint32(editDraft.msgId) << qint32(editDraft.previewCancelled ? 1 : 0);
-
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
-
+		_draftsPendingMap.insert(peer, { localDraft, editDraft });
 		_draftsNotReadMap.remove(peer);
+		_flushDraftsQueue();
 	}
 }
 
 void clearDraftCursors(const PeerId &peer) {
+	_draftCursorsPendingMap.remove(peer);
 	DraftsMap::iterator i = _draftCursorsMap.find(peer);
 	if (i != _draftCursorsMap.cend()) {
 		clearKey(i.value());
 		_draftCursorsMap.erase(i);
-		_mapChanged = true;
-		_writeMap();
+		_journalMapMutation(jopDraftCursorsRemove, peer, 0);
 	}
 }
 
@@ -2730,6 +3690,33 @@ void _readDraftCursors(const PeerId &peer, MessageCursor &localCursor, MessageCu
 
 void readDraftsWithCursors(History *h) {
 	PeerId peer = h->peer->id;
+	const auto pending = _draftsPendingMap.constFind(peer);
+	if (pending != _draftsPendingMap.cend()) {
+		// Not yet flushed to disk, apply the in-memory copy.
+		MessageCursor msgCursor, editCursor;
+		const auto cursors = _draftCursorsPendingMap.constFind(peer);
+		if (cursors != _draftCursorsPendingMap.cend()) {
+			msgCursor = cursors->msgCursor;
+			editCursor = cursors->editCursor;
+		} else {
+			_readDraftCursors(peer, msgCursor, editCursor);
+		}
+		const auto &localDraft = pending->localDraft;
+		const auto &editDraft = pending->editDraft;
+		if (!h->localDraft()) {
+			if (localDraft.textWithTags.text.isEmpty() && !localDraft.msgId) {
+				h->clearLocalDraft();
+			} else {
+				h->setLocalDraft(std::make_unique<Data::Draft>(localDraft.textWithTags, localDraft.msgId, msgCursor, localDraft.previewCancelled));
+			}
+		}
+		if (!editDraft.msgId) {
+			h->clearEditDraft();
+		} else {
+			h->setEditDraft(std::make_unique<Data::Draft>(editDraft.textWithTags, editDraft.msgId, editCursor, editDraft.previewCancelled));
+		}
+		return;
+	}
 	if (!_draftsNotReadMap.remove(peer)) {
 		clearDraftCursors(peer);
 		return;
@@ -2800,30 +3787,21 @@ void writeDraftCursors(const PeerId &peer, const MessageCursor &msgCursor, const
 	if (!_working()) return;
 
 	if (msgCursor == MessageCursor() && editCursor == MessageCursor()) {
+		_draftCursorsPendingMap.remove(peer);
 		clearDraftCursors(peer);
 	} else {
-		DraftsMap::const_iterator i = _draftCursorsMap.constFind(peer);
-		if (i == _draftCursorsMap.cend()) {
-			i = _draftCursorsMap.insert(peer, genKey());
-			_mapChanged = true;
-			_writeMap(WriteMapWhen::Fast);
-		}
-
-		EncryptedDescriptor data(sizeof(quint64) + sizeof(qint32) * 3);
-		data.stream << quint64(peer) << qint32(msgCursor.position) << qint32(msgCursor.anchor) << qint32(msgCursor.scroll);
-		data.stream << qint32(editCursor.position) << qint32(editCursor.anchor) << qint32(editCursor.scroll);
-
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		_draftCursorsPendingMap.insert(peer, { msgCursor, editCursor });
+		_flushDraftsQueue();
 	}
 }
 
 bool hasDraftCursors(const PeerId &peer) {
-	return _draftCursorsMap.contains(peer);
+	return _draftCursorsPendingMap.contains(peer)
+		|| _draftCursorsMap.contains(peer);
 }
 
 bool hasDraft(const PeerId &peer) {
-	return _draftsMap.contains(peer);
+	return _draftsPendingMap.contains(peer) || _draftsMap.contains(peer);
 }
 
 void writeFileLocation(MediaKey location, const FileLocation &local) {
@@ -2879,6 +3857,55 @@ FileLocation readFileLocation(MediaKey location, bool check) {
 	return FileLocation();
 }
 
+void writeDownloadResume(MediaKey location, const DownloadResume &resume) {
+	if (resume.fname.isEmpty() || resume.already <= 0) return;
+
+	auto i = _downloadResumeMap.constFind(location);
+	if (i != _downloadResumeMap.cend()
+		&& i.value().fname == resume.fname
+		&& i.value().already == resume.already
+		&& i.value().size == resume.size) {
+		return;
+	}
+	_downloadResumeMap.insert(location, resume);
+	_writeLocations();
+}
+
+DownloadResume readDownloadResume(MediaKey location) {
+	return _downloadResumeMap.value(location);
+}
+
+void clearDownloadResume(MediaKey location) {
+	if (_downloadResumeMap.remove(location)) {
+		_writeLocations();
+	}
+}
+
+void writeUploadedFileInfo(const QByteArray &filemd5, const UploadedFileInfo &info) {
+	if (filemd5.isEmpty() || !info.fileId) return;
+
+	_uploadedFilesMap.insert(filemd5, info);
+	_writeLocations();
+}
+
+void forgetUploadedFileInfo(const QByteArray &filemd5) {
+	if (_uploadedFilesMap.remove(filemd5)) {
+		_writeLocations();
+	}
+}
+
+UploadedFileInfo readUploadedFileInfo(const QByteArray &filemd5) {
+	auto i = _uploadedFilesMap.find(filemd5);
+	if (i == _uploadedFilesMap.end()) {
+		return UploadedFileInfo();
+	} else if (i.value().when + kUploadedFileInfoLifetime <= qint32(unixtime())) {
+		_uploadedFilesMap.erase(i);
+		_writeLocations();
+		return UploadedFileInfo();
+	}
+	return i.value();
+}
+
 qint32 _storageImageSize(qint32 rawlen) {
 	// fulllen + storagekey + type + len + data
 	qint32 result = sizeof(uint32) + sizeof(quint64) * 2 + sizeof(quint32) + sizeof(quint32) + rawlen;
@@ -2919,11 +3946,11 @@ void writeImage(const StorageKey &location, const StorageImageSaved &image, bool
 	if (i == _imagesMap.cend()) {
 		i = _imagesMap.insert(location, FileDesc(genKey(FileOption::User), size));
 		_storageImagesSize += size;
-		_mapChanged = true;
-		_writeMap();
+		_markStorageShardChanged(location);
 	} else if (!overwrite) {
 		return;
 	}
+	_storageTouch(StorageClass::Images, location);
 
 	auto legacyTypeField = 0;
 
@@ -2932,11 +3959,14 @@ void writeImage(const StorageKey &location, const StorageImageSaved &image, bool
 
 	FileWriteDescriptor file(i.value().first, FileOption::User);
 	file.writeEncrypted(data);
+	_cacheBytesWritten += image.data.size();
 	if (i.value().second != size) {
 		_storageImagesSize += size;
 		_storageImagesSize -= i.value().second;
 		_imagesMap[location].second = size;
+		_markStorageShardChanged(location);
 	}
+	_checkStorageLimit();
 }
 
 class AbstractCachedLoadTask : public Task {
@@ -2947,9 +3977,12 @@ public:
 	}
 	void process() {
 		FileReadDescriptor image;
-		if (!readEncryptedFile(image, _key, FileOption::User)) {
+		if (!readEncryptedFileMapped(image, _key, FileOption::User)) {
+			++_cacheMisses;
 			return;
 		}
+		++_cacheHits;
+		_cacheBytesRead += image.data.size();
 
 		QByteArray imageData;
 		quint64 locFirst, locSecond;
@@ -3016,6 +4049,8 @@ public:
 			clearKey(_key, FileOption::User);
 			_storageImagesSize -= j->second;
 			_imagesMap.erase(j);
+			_storageForget(StorageClass::Images, _location);
+			_markStorageShardChanged(_location);
 		}
 	}
 };
@@ -3023,8 +4058,10 @@ public:
 TaskId startImageLoad(const StorageKey &location, mtpFileLoader *loader) {
 	StorageMap::const_iterator j = _imagesMap.constFind(location);
 	if (j == _imagesMap.cend() || !_localLoader) {
+		++_cacheMisses;
 		return 0;
 	}
+	_storageTouch(StorageClass::Images, location);
 	return _localLoader->addTask(
 		std::make_unique<ImageLoadTask>(j->first, location, loader));
 }
@@ -3049,20 +4086,23 @@ void writeStickerImage(const StorageKey &location, const QByteArray &sticker, bo
 	if (i == _stickerImagesMap.cend()) {
 		i = _stickerImagesMap.insert(location, FileDesc(genKey(FileOption::User), size));
 		_storageStickersSize += size;
-		_mapChanged = true;
-		_writeMap();
+		_markStorageShardChanged(location);
 	} else if (!overwrite) {
 		return;
 	}
+	_storageTouch(StorageClass::StickerImages, location);
 	EncryptedDescriptor data(sizeof(quint64) * 2 + sizeof(quint32) + sizeof(quint32) + sticker.size());
 	data.stream << quint64(location.first) << quint64(location.second) << sticker;
 	FileWriteDescriptor file(i.value().first, FileOption::User);
 	file.writeEncrypted(data);
+	_cacheBytesWritten += sticker.size();
 	if (i.value().second != size) {
 		_storageStickersSize += size;
 		_storageStickersSize -= i.value().second;
 		_stickerImagesMap[location].second = size;
+		_markStorageShardChanged(location);
 	}
+	_checkStorageLimit();
 }
 
 class StickerImageLoadTask : public AbstractCachedLoadTask {
@@ -3079,6 +4119,8 @@ public:
 			clearKey(j.value().first, FileOption::User);
 			_storageStickersSize -= j.value().second;
 			_stickerImagesMap.erase(j);
+			_storageForget(StorageClass::StickerImages, _location);
+			_markStorageShardChanged(_location);
 		}
 	}
 };
@@ -3086,8 +4128,10 @@ public:
 TaskId startStickerImageLoad(const StorageKey &location, mtpFileLoader *loader) {
 	auto j = _stickerImagesMap.constFind(location);
 	if (j == _stickerImagesMap.cend() || !_localLoader) {
+		++_cacheMisses;
 		return 0;
 	}
+	_storageTouch(StorageClass::StickerImages, location);
 	return _localLoader->addTask(
 		std::make_unique<StickerImageLoadTask>(j->first, location, loader));
 }
@@ -3102,8 +4146,8 @@ bool copyStickerImage(const StorageKey &oldLocation, const StorageKey &newLocati
 		return false;
 	}
 	_stickerImagesMap.insert(newLocation, i.value());
-	_mapChanged = true;
-	_writeMap();
+	_storageTouch(StorageClass::StickerImages, newLocation);
+	_markStorageShardChanged(newLocation);
 	return true;
 }
 
@@ -3123,20 +4167,23 @@ void writeAudio(const StorageKey &location, const QByteArray &audio, bool overwr
 	if (i == _audiosMap.cend()) {
 		i = _audiosMap.insert(location, FileDesc(genKey(FileOption::User), size));
 		_storageAudiosSize += size;
-		_mapChanged = true;
-		_writeMap();
+		_markStorageShardChanged(location);
 	} else if (!overwrite) {
 		return;
 	}
+	_storageTouch(StorageClass::Audios, location);
 	EncryptedDescriptor data(sizeof(quint64) * 2 + sizeof(quint32) + sizeof(quint32) + audio.size());
 	data.stream << quint64(location.first) << quint64(location.second) << audio;
 	FileWriteDescriptor file(i.value().first, FileOption::User);
 	file.writeEncrypted(data);
+	_cacheBytesWritten += audio.size();
 	if (i.value().second != size) {
 		_storageAudiosSize += size;
 		_storageAudiosSize -= i.value().second;
 		_audiosMap[location].second = size;
+		_markStorageShardChanged(location);
 	}
+	_checkStorageLimit();
 }
 
 class AudioLoadTask : public AbstractCachedLoadTask {
@@ -3153,6 +4200,8 @@ public:
 			clearKey(j.value().first, FileOption::User);
 			_storageAudiosSize -= j.value().second;
 			_audiosMap.erase(j);
+			_storageForget(StorageClass::Audios, _location);
+			_markStorageShardChanged(_location);
 		}
 	}
 };
@@ -3160,8 +4209,10 @@ public:
 TaskId startAudioLoad(const StorageKey &location, mtpFileLoader *loader) {
 	auto j = _audiosMap.constFind(location);
 	if (j == _audiosMap.cend() || !_localLoader) {
+		++_cacheMisses;
 		return 0;
 	}
+	_storageTouch(StorageClass::Audios, location);
 	return _localLoader->addTask(
 		std::make_unique<AudioLoadTask>(j->first, location, loader));
 }
@@ -3172,8 +4223,8 @@ bool copyAudio(const StorageKey &oldLocation, const StorageKey &newLocation) {
 		return false;
 	}
 	_audiosMap.insert(newLocation, i.value());
-	_mapChanged = true;
-	_writeMap();
+	_storageTouch(StorageClass::Audios, newLocation);
+	_markStorageShardChanged(newLocation);
 	return true;
 }
 
@@ -3189,6 +4240,55 @@ qint64 storageAudiosSize() {
 	return _storageAudiosSize;
 }
 
+CacheStats cacheStats() {
+	CacheStats result;
+	result.hits = _cacheHits.load();
+	result.misses = _cacheMisses.load();
+	result.bytesRead = _cacheBytesRead.load();
+	result.bytesWritten = _cacheBytesWritten.load();
+	result.decryptMs = _cacheDecryptMs.load();
+	return result;
+}
+
+void enforceStorageLimit(qint64 limit) {
+	if (limit <= 0) {
+		return;
+	}
+	auto total = _storageImagesSize + _storageStickersSize + _storageAudiosSize;
+	if (total <= limit) {
+		return;
+	}
+	auto evicted = 0;
+	while (total > limit && !_storageLruOrder.isEmpty()) {
+		const auto order = _storageLruOrder.begin();
+		const auto id = order.value();
+		const auto storageClass = StorageClass(id.first);
+		const auto &location = id.second;
+		const auto evictFrom = [&](StorageMap &map, qint64 &size) {
+			const auto i = map.find(location);
+			if (i == map.end()) {
+				return;
+			}
+			clearKey(i.value().first, FileOption::User);
+			size -= i.value().second;
+			total -= i.value().second;
+			map.erase(i);
+			_markStorageShardChanged(location);
+			++evicted;
+		};
+		switch (storageClass) {
+		case StorageClass::Images: evictFrom(_imagesMap, _storageImagesSize); break;
+		case StorageClass::StickerImages: evictFrom(_stickerImagesMap, _storageStickersSize); break;
+		case StorageClass::Audios: evictFrom(_audiosMap, _storageAudiosSize); break;
+		}
+		_storageLruOrder.erase(order);
+		_storageLruTicks.remove(id);
+	}
+	if (evicted) {
+		DEBUG_LOG(("App Info: storage limit %1 enforced, evicted %2 cached files").arg(limit).arg(evicted));
+	}
+}
+
 qint32 _storageWebFileSize(const QString &url, qint32 rawlen) {
 	// fulllen + url + len + data
 	qint32 result = sizeof(uint32) + Serialize::stringSize(url) + sizeof(quint32) + rawlen;
@@ -3326,6 +4426,7 @@ public:
 			if (!_waveform.isEmpty()) {
 				voice->waveform = _waveform;
 				voice->wavemax = _wavemax;
+				writeVoiceWaveform(_doc);
 			}
 			if (voice->waveform.isEmpty()) {
 				voice->waveform.resize(1);
@@ -3355,6 +4456,11 @@ protected:
 
 void countVoiceWaveform(DocumentData *document) {
 	if (const auto voice = document->voice()) {
+		if (readVoiceWaveform(document)) {
+			// Found a waveform counted in an earlier session.
+			Auth().data().requestDocumentViewRepaint(document);
+			return;
+		}
 		if (_localLoader) {
 			voice->waveform.resize(1 + sizeof(TaskId));
 			voice->waveform[0] = -1; // counting
@@ -3365,6 +4471,73 @@ void countVoiceWaveform(DocumentData *document) {
 	}
 }
 
+constexpr auto kVideoThumbHeight = 80; // the strip is scaled by the view
+
+class CountVideoThumbsTask : public Task {
+public:
+	CountVideoThumbsTask(DocumentData *doc)
+		: _doc(doc)
+		, _loc(doc->location(true))
+		, _data(doc->data()) {
+		if (_data.isEmpty() && !_loc.accessEnable()) {
+			_doc = 0;
+		}
+	}
+	void process() {
+		if (!_doc) return;
+
+		_strip = Media::Clip::CountThumbsStrip(
+			_loc,
+			_data,
+			kVideoThumbsInStrip,
+			kVideoThumbHeight);
+	}
+	void finish() {
+		if (const auto video = _doc ? _doc->video() : nullptr) {
+			video->thumbsStripTask = QByteArray();
+			if (_strip.isNull()) {
+				video->thumbsStripFailed = true;
+			} else {
+				video->thumbsStrip = _strip;
+				writeVideoThumbsStrip(_doc);
+			}
+		}
+	}
+	virtual ~CountVideoThumbsTask() {
+		if (_data.isEmpty() && _doc) {
+			_loc.accessDisable();
+		}
+	}
+
+protected:
+	DocumentData *_doc;
+	FileLocation _loc;
+	QByteArray _data;
+	QImage _strip;
+
+};
+
+void countVideoThumbsStrip(DocumentData *document) {
+	const auto video = document->video();
+	if (!video
+		|| !video->thumbsStrip.isNull()
+		|| video->thumbsStripFailed
+		|| !video->thumbsStripTask.isEmpty()) {
+		return;
+	}
+	if (readVideoThumbsStrip(document)) {
+		// Found a strip counted in an earlier session.
+		return;
+	}
+	if (_localLoader) {
+		TaskId taskId = _localLoader->addTask(
+			std::make_unique<CountVideoThumbsTask>(document));
+		video->thumbsStripTask = QByteArray(
+			reinterpret_cast<const char*>(&taskId),
+			sizeof(taskId));
+	}
+}
+
 void cancelTask(TaskId id) {
 	if (_localLoader) {
 		_localLoader->cancelTask(id);
@@ -3401,9 +4574,7 @@ void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
 	if (AppVersion > 1002008) {
 		stream << qint32(set.installDate);
 	}
-	for (auto j = set.stickers.cbegin(), e = set.stickers.cend(); j != e; ++j) {
-		Serialize::Document::writeToStream(stream, *j);
-	}
+	Serialize::Document::writePackToStream(stream, set.stickers);
 	if (AppVersion > 1002008) {
 		stream << qint32(set.dates.size());
 		if (!set.dates.empty()) {
@@ -3507,12 +4678,13 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 	data.stream << order;
 
 	FileWriteDescriptor file(stickersKey);
-	file.writeEncrypted(data);
+	file.writeCompressedEncrypted(data);
 }
 
 void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr, MTPDstickerSet::Flags readingFlags = 0) {
 	FileReadDescriptor stickers;
-	if (!readEncryptedFile(stickers, stickersKey)) {
+	if (!readEncryptedFilePreloaded(stickers, stickersKey)
+		|| !inflateCompressedBlock(stickers)) {
 		clearKey(stickersKey);
 		stickersKey = 0;
 		_writeMap();
@@ -3616,8 +4788,10 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 
 		Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
 		OrderedSet<DocumentId> read;
-		for (int32 j = 0; j < scnt; ++j) {
-			auto document = Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
+		auto pack = QVector<DocumentData*>();
+		const auto wasPacked = Serialize::Document::readPackFromStream(stickers.stream, &info, pack);
+		for (int32 j = 0, l = wasPacked ? pack.size() : scnt; j < l; ++j) {
+			auto document = wasPacked ? pack[j] : Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
 			if (!document || !document->sticker()) continue;
 
 			if (read.contains(document->id)) continue;
@@ -3699,9 +4873,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 	}
 }
 
-void writeInstalledStickers() {
-	if (!Global::started()) return;
-
+void _writeInstalledStickers() {
 	_writeStickerSets(_installedStickersKey, [](const Stickers::Set &set) {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
@@ -3720,9 +4892,7 @@ void writeInstalledStickers() {
 	}, Auth().data().stickerSetsOrder());
 }
 
-void writeFeaturedStickers() {
-	if (!Global::started()) return;
-
+void _writeFeaturedStickers() {
 	_writeStickerSets(_featuredStickersKey, [](const Stickers::Set &set) {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
@@ -3739,9 +4909,7 @@ void writeFeaturedStickers() {
 	}, Auth().data().featuredStickerSetsOrder());
 }
 
-void writeRecentStickers() {
-	if (!Global::started()) return;
-
+void _writeRecentStickers() {
 	_writeStickerSets(_recentStickersKey, [](const Stickers::Set &set) {
 		if (set.id != Stickers::CloudRecentSetId || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
@@ -3750,9 +4918,7 @@ void writeRecentStickers() {
 	}, Stickers::Order());
 }
 
-void writeFavedStickers() {
-	if (!Global::started()) return;
-
+void _writeFavedStickers() {
 	_writeStickerSets(_favedStickersKey, [](const Stickers::Set &set) {
 		if (set.id != Stickers::FavedSetId || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
@@ -3761,9 +4927,7 @@ void writeFavedStickers() {
 	}, Stickers::Order());
 }
 
-void writeArchivedStickers() {
-	if (!Global::started()) return;
-
+void _writeArchivedStickers() {
 	_writeStickerSets(_archivedStickersKey, [](const Stickers::Set &set) {
 		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
@@ -3772,6 +4936,62 @@ void writeArchivedStickers() {
 	}, Auth().data().archivedStickerSetsOrder());
 }
 
+void _flushStickersWrites() {
+	if (!AuthSession::Exists()) {
+		// The sets to serialize live in the session, without it there
+		// is nothing to write.
+		_stickersFilesToWrite = 0;
+		return;
+	}
+	const auto files = base::take(_stickersFilesToWrite);
+	if (files & StickersFileInstalled) {
+		_writeInstalledStickers();
+	}
+	if (files & StickersFileFeatured) {
+		_writeFeaturedStickers();
+	}
+	if (files & StickersFileRecent) {
+		_writeRecentStickers();
+	}
+	if (files & StickersFileFaved) {
+		_writeFavedStickers();
+	}
+	if (files & StickersFileArchived) {
+		_writeArchivedStickers();
+	}
+}
+
+void _scheduleWriteStickers(StickersFileFlag file) {
+	if (!Global::started() || !_working()) return;
+
+	_stickersFilesToWrite |= file;
+	_manager->writeStickers(false);
+}
+
+void writeInstalledStickers() {
+	_scheduleWriteStickers(StickersFileInstalled);
+}
+
+void writeFeaturedStickers() {
+	_scheduleWriteStickers(StickersFileFeatured);
+}
+
+void writeRecentStickers() {
+	_scheduleWriteStickers(StickersFileRecent);
+}
+
+void writeFavedStickers() {
+	_scheduleWriteStickers(StickersFileFaved);
+}
+
+void writeArchivedStickers() {
+	_scheduleWriteStickers(StickersFileArchived);
+}
+
+void flushStickersWrites() {
+	_flushStickersWrites();
+}
+
 void importOldRecentStickers() {
 	if (!_recentStickersKeyOld) return;
 
@@ -4012,11 +5232,9 @@ void writeSavedGifs() {
 		}
 		EncryptedDescriptor data(size);
 		data.stream << quint32(saved.size());
-		for_const (auto gif, saved) {
-			Serialize::Document::writeToStream(data.stream, gif);
-		}
+		Serialize::Document::writePackToStream(data.stream, saved);
 		FileWriteDescriptor file(_savedGifsKey);
-		file.writeEncrypted(data);
+		file.writeCompressedEncrypted(data);
 	}
 }
 
@@ -4024,7 +5242,8 @@ void readSavedGifs() {
 	if (!_savedGifsKey) return;
 
 	FileReadDescriptor gifs;
-	if (!readEncryptedFile(gifs, _savedGifsKey)) {
+	if (!readEncryptedFilePreloaded(gifs, _savedGifsKey)
+		|| !inflateCompressedBlock(gifs)) {
 		clearKey(_savedGifsKey);
 		_savedGifsKey = 0;
 		_writeMap();
@@ -4038,8 +5257,10 @@ void readSavedGifs() {
 	gifs.stream >> cnt;
 	saved.reserve(cnt);
 	OrderedSet<DocumentId> read;
-	for (uint32 i = 0; i < cnt; ++i) {
-		auto document = Serialize::Document::readFromStream(gifs.version, gifs.stream);
+	auto pack = QVector<DocumentData*>();
+	const auto wasPacked = Serialize::Document::readPackFromStream(gifs.stream, nullptr, pack);
+	for (uint32 i = 0, l = wasPacked ? uint32(pack.size()) : cnt; i < l; ++i) {
+		auto document = wasPacked ? pack[i] : Serialize::Document::readFromStream(gifs.version, gifs.stream);
 		if (!document || !document->isGifv()) continue;
 
 		if (read.contains(document->id)) continue;
@@ -4112,19 +5333,67 @@ bool readBackground() {
 		return true;
 	}
 
-	QImage image;
-	QBuffer buf(&pngData);
-	QImageReader reader(&buf);
-#ifndef OS_MAC_OLD
-	reader.setAutoTransform(true);
-#endif // OS_MAC_OLD
-	if (reader.read(&image)) {
-		_backgroundCanWrite = false;
-		Window::Theme::Background()->setImage(id, std::move(image));
-		_backgroundCanWrite = true;
-		return true;
+	QImage image;
+	QBuffer buf(&pngData);
+	QImageReader reader(&buf);
+#ifndef OS_MAC_OLD
+	reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+	if (reader.read(&image)) {
+		_backgroundCanWrite = false;
+		Window::Theme::Background()->setImage(id, std::move(image));
+		_backgroundCanWrite = true;
+		return true;
+	}
+	return false;
+}
+
+// The window snapshot is shown before the map file (and so the pass
+// protected local key) is read, so it is encrypted with the settings
+// key, the same way as the theme cache and the lang pack.
+void writeWindowSnapshot(const QImage &image) {
+	if (!_working()) return;
+
+	if (!SettingsKey) {
+		LOG(("App Error: settings key not created in writeWindowSnapshot()"));
+		return;
+	}
+	QByteArray jpeg;
+	{
+		QBuffer buffer(&jpeg);
+		if (image.isNull() || !image.save(&buffer, "JPG", kWindowSnapshotQuality)) {
+			clearWindowSnapshot();
+			return;
+		}
+	}
+	EncryptedDescriptor data(sizeof(quint32) + jpeg.size());
+	data.stream << jpeg;
+
+	FileWriteDescriptor file(qsl("snapshot"), FileOption::Safe);
+	file.writeEncrypted(data, SettingsKey);
+}
+
+QImage readWindowSnapshot() {
+	FileReadDescriptor snapshot;
+	if (!readEncryptedFile(snapshot, qsl("snapshot"), FileOption::Safe, SettingsKey)) {
+		return QImage();
+	}
+
+	QByteArray jpeg;
+	snapshot.stream >> jpeg;
+	if (snapshot.stream.status() != QDataStream::Ok) {
+		return QImage();
 	}
-	return false;
+	auto image = QImage();
+	image.loadFromData(jpeg, "JPG");
+	return image;
+}
+
+void clearWindowSnapshot() {
+	if (_basePath.isEmpty()) return;
+
+	QFile::remove(_basePath + qsl("snapshot0"));
+	QFile::remove(_basePath + qsl("snapshot1"));
 }
 
 bool readThemeUsingKey(FileKey key) {
@@ -4530,7 +5799,7 @@ void readRecentHashtagsAndBots() {
 	if (!_recentHashtagsAndBotsKey) return;
 
 	FileReadDescriptor hashtags;
-	if (!readEncryptedFile(hashtags, _recentHashtagsAndBotsKey)) {
+	if (!readEncryptedFilePreloaded(hashtags, _recentHashtagsAndBotsKey)) {
 		clearKey(_recentHashtagsAndBotsKey);
 		_recentHashtagsAndBotsKey = 0;
 		_writeMap();
@@ -4649,6 +5918,71 @@ void readSavedPeers() {
 	Auth().api().requestPeers(peers);
 }
 
+void writePeersSnapshot() {
+	if (!_working() || !AuthSession::Exists()) return;
+
+	auto peers = QVector<PeerData*>();
+	App::enumeratePeers([&peers](PeerData *peer) {
+		// Only fully loaded peers can be restored as fully loaded.
+		if (peer->loadedStatus == PeerData::FullLoaded) {
+			peers.push_back(peer);
+		}
+	});
+	if (peers.isEmpty()) {
+		if (_peersSnapshotKey) {
+			clearKey(_peersSnapshotKey);
+			_peersSnapshotKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+		return;
+	}
+	if (!_peersSnapshotKey) {
+		_peersSnapshotKey = genKey();
+		_mapChanged = true;
+		_writeMap(WriteMapWhen::Fast);
+	}
+	quint32 size = sizeof(quint32) + sizeof(quint32);
+	for_const (const auto peer, peers) {
+		size += _peerSize(peer);
+	}
+	EncryptedDescriptor data(size);
+	data.stream << quint32(kPeersSnapshotVersion) << quint32(peers.size());
+	for_const (const auto peer, peers) {
+		_writePeer(data.stream, peer);
+	}
+	FileWriteDescriptor file(_peersSnapshotKey);
+	file.writeEncrypted(data);
+}
+
+void readPeersSnapshot() {
+	if (!_peersSnapshotKey) return;
+
+	FileReadDescriptor snapshot;
+	if (!readEncryptedFile(snapshot, _peersSnapshotKey)) {
+		clearKey(_peersSnapshotKey);
+		_peersSnapshotKey = 0;
+		_writeMap();
+		return;
+	}
+	quint32 version = 0, count = 0;
+	snapshot.stream >> version >> count;
+	if (version != kPeersSnapshotVersion
+		|| !_checkStreamStatus(snapshot.stream)) {
+		clearKey(_peersSnapshotKey);
+		_peersSnapshotKey = 0;
+		_writeMap();
+		return;
+	}
+	App::reservePeers(count);
+	for (auto i = quint32(0); i != count; ++i) {
+		if (!_readPeer(snapshot)) {
+			break;
+		}
+	}
+	DEBUG_LOG(("Peers snapshot read: %1 peers.").arg(count));
+}
+
 void addSavedPeer(PeerData *peer, const QDateTime &position) {
 	auto &savedPeers = cRefSavedPeers();
 	auto i = savedPeers.find(peer);
@@ -4742,6 +6076,318 @@ bool isBotTrusted(UserData *bot) {
 	return _trustedBots.contains(bot->id);
 }
 
+void _readVoiceWaveforms() {
+	if (_voiceWaveformsRead) return;
+	_voiceWaveformsRead = true;
+	if (!_voiceWaveformsKey) return;
+
+	FileReadDescriptor waveforms;
+	if (!readEncryptedFile(waveforms, _voiceWaveformsKey)) {
+		clearKey(_voiceWaveformsKey);
+		_voiceWaveformsKey = 0;
+		_writeMap();
+		return;
+	}
+
+	qint32 size = 0;
+	waveforms.stream >> size;
+	for (auto i = 0; i != size; ++i) {
+		quint64 first = 0, second = 0;
+		QByteArray encoded;
+		waveforms.stream >> first >> second >> encoded;
+		if (!_checkStreamStatus(waveforms.stream)) {
+			return;
+		}
+		_voiceWaveforms.insert(MediaKey(first, second), encoded);
+	}
+}
+
+void _writeVoiceWaveforms() {
+	if (_voiceWaveforms.isEmpty()) {
+		if (_voiceWaveformsKey) {
+			clearKey(_voiceWaveformsKey);
+			_voiceWaveformsKey = 0;
+			_mapChanged = true;
+			_writeMap();
+		}
+	} else {
+		if (!_voiceWaveformsKey) {
+			_voiceWaveformsKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		quint32 size = sizeof(qint32);
+		for (auto i = _voiceWaveforms.cbegin(), e = _voiceWaveforms.cend(); i != e; ++i) {
+			size += 2 * sizeof(quint64) + Serialize::bytearraySize(i.value());
+		}
+		EncryptedDescriptor data(size);
+		data.stream << qint32(_voiceWaveforms.size());
+		for (auto i = _voiceWaveforms.cbegin(), e = _voiceWaveforms.cend(); i != e; ++i) {
+			data.stream << quint64(i.key().first) << quint64(i.key().second) << i.value();
+		}
+
+		FileWriteDescriptor file(_voiceWaveformsKey);
+		file.writeEncrypted(data);
+	}
+}
+
+void writeVoiceWaveform(DocumentData *document) {
+	if (!_working()) return;
+
+	const auto voice = document->voice();
+	if (!voice || voice->waveform.isEmpty() || voice->waveform[0] < 0) {
+		return;
+	}
+	_readVoiceWaveforms();
+
+	const auto key = document->mediaKey();
+	const auto encoded = documentWaveformEncode5bit(voice->waveform);
+	const auto i = _voiceWaveforms.constFind(key);
+	if (i != _voiceWaveforms.cend() && i.value() == encoded) {
+		return;
+	}
+	if (i == _voiceWaveforms.cend()
+		&& _voiceWaveforms.size() >= kMaxVoiceWaveformsCount) {
+		// The cache is full, drop it, the hot chats fill it up again.
+		_voiceWaveforms.clear();
+	}
+	_voiceWaveforms.insert(key, encoded);
+	_writeVoiceWaveforms();
+}
+
+bool readVoiceWaveform(DocumentData *document) {
+	const auto voice = document->voice();
+	if (!voice) {
+		return false;
+	}
+	_readVoiceWaveforms();
+
+	const auto i = _voiceWaveforms.constFind(document->mediaKey());
+	if (i == _voiceWaveforms.cend()) {
+		return false;
+	}
+	auto waveform = documentWaveformDecode(i.value());
+	if (waveform.isEmpty()) {
+		return false;
+	}
+	uchar wavemax = 0;
+	for (int32 j = 0, l = waveform.size(); j < l; ++j) {
+		uchar waveat = waveform.at(j);
+		if (wavemax < waveat) wavemax = waveat;
+	}
+	voice->waveform = waveform;
+	voice->wavemax = wavemax;
+	return true;
+}
+
+void _readVideoThumbs() {
+	if (_videoThumbsRead) return;
+	_videoThumbsRead = true;
+	if (!_videoThumbsKey) return;
+
+	FileReadDescriptor thumbs;
+	if (!readEncryptedFile(thumbs, _videoThumbsKey)) {
+		clearKey(_videoThumbsKey);
+		_videoThumbsKey = 0;
+		_writeMap();
+		return;
+	}
+
+	qint32 size = 0;
+	thumbs.stream >> size;
+	for (auto i = 0; i != size; ++i) {
+		quint64 first = 0, second = 0;
+		QByteArray jpeg;
+		thumbs.stream >> first >> second >> jpeg;
+		if (!_checkStreamStatus(thumbs.stream)) {
+			return;
+		}
+		_videoThumbs.insert(MediaKey(first, second), jpeg);
+	}
+}
+
+void _writeVideoThumbs() {
+	if (_videoThumbs.isEmpty()) {
+		if (_videoThumbsKey) {
+			clearKey(_videoThumbsKey);
+			_videoThumbsKey = 0;
+			_mapChanged = true;
+			_writeMap();
+		}
+	} else {
+		if (!_videoThumbsKey) {
+			_videoThumbsKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		quint32 size = sizeof(qint32);
+		for (auto i = _videoThumbs.cbegin(), e = _videoThumbs.cend(); i != e; ++i) {
+			size += 2 * sizeof(quint64) + Serialize::bytearraySize(i.value());
+		}
+		EncryptedDescriptor data(size);
+		data.stream << qint32(_videoThumbs.size());
+		for (auto i = _videoThumbs.cbegin(), e = _videoThumbs.cend(); i != e; ++i) {
+			data.stream << quint64(i.key().first) << quint64(i.key().second) << i.value();
+		}
+
+		FileWriteDescriptor file(_videoThumbsKey);
+		file.writeEncrypted(data);
+	}
+}
+
+void writeVideoThumbsStrip(DocumentData *document) {
+	if (!_working()) return;
+
+	const auto video = document->video();
+	if (!video || video->thumbsStrip.isNull()) {
+		return;
+	}
+	_readVideoThumbs();
+
+	const auto key = document->mediaKey();
+	if (_videoThumbs.constFind(key) != _videoThumbs.cend()) {
+		return;
+	}
+	QByteArray jpeg;
+	{
+		QBuffer buffer(&jpeg);
+		video->thumbsStrip.save(&buffer, "JPG", 87);
+	}
+	if (jpeg.isEmpty()) {
+		return;
+	}
+	if (_videoThumbs.size() >= kMaxVideoThumbsCount) {
+		// The cache is full, drop it, recently watched videos fill
+		// it up again.
+		_videoThumbs.clear();
+	}
+	_videoThumbs.insert(key, jpeg);
+	_writeVideoThumbs();
+}
+
+bool readVideoThumbsStrip(DocumentData *document) {
+	const auto video = document->video();
+	if (!video) {
+		return false;
+	}
+	_readVideoThumbs();
+
+	const auto i = _videoThumbs.constFind(document->mediaKey());
+	if (i == _videoThumbs.cend()) {
+		return false;
+	}
+	auto strip = QImage::fromData(i.value());
+	if (strip.isNull()) {
+		return false;
+	}
+	video->thumbsStrip = strip;
+	return true;
+}
+
+void _readStickerPreviews() {
+	if (_stickerPreviewsRead) return;
+	_stickerPreviewsRead = true;
+	if (!_stickerPreviewsKey) return;
+
+	FileReadDescriptor previews;
+	if (!readEncryptedFile(previews, _stickerPreviewsKey)) {
+		clearKey(_stickerPreviewsKey);
+		_stickerPreviewsKey = 0;
+		_writeMap();
+		return;
+	}
+
+	qint32 size = 0;
+	previews.stream >> size;
+	for (auto i = 0; i != size; ++i) {
+		quint64 first = 0, second = 0;
+		StickerPreview preview;
+		previews.stream >> first >> second >> preview.width >> preview.height >> preview.bytes;
+		if (!_checkStreamStatus(previews.stream)) {
+			return;
+		}
+		_stickerPreviews.insert(MediaKey(first, second), preview);
+	}
+}
+
+void _writeStickerPreviews() {
+	if (_stickerPreviews.isEmpty()) {
+		if (_stickerPreviewsKey) {
+			clearKey(_stickerPreviewsKey);
+			_stickerPreviewsKey = 0;
+			_mapChanged = true;
+			_writeMap();
+		}
+	} else {
+		if (!_stickerPreviewsKey) {
+			_stickerPreviewsKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		quint32 size = sizeof(qint32);
+		for (auto i = _stickerPreviews.cbegin(), e = _stickerPreviews.cend(); i != e; ++i) {
+			size += 2 * sizeof(quint64) + 2 * sizeof(qint32) + Serialize::bytearraySize(i.value().bytes);
+		}
+		EncryptedDescriptor data(size);
+		data.stream << qint32(_stickerPreviews.size());
+		for (auto i = _stickerPreviews.cbegin(), e = _stickerPreviews.cend(); i != e; ++i) {
+			data.stream << quint64(i.key().first) << quint64(i.key().second) << i.value().width << i.value().height << i.value().bytes;
+		}
+
+		FileWriteDescriptor file(_stickerPreviewsKey);
+		file.writeEncrypted(data);
+	}
+}
+
+void writeStickerPreview(DocumentData *document, const QImage &preview) {
+	if (!_working() || !document->sticker() || preview.isNull()) {
+		return;
+	}
+	_readStickerPreviews();
+
+	const auto key = document->mediaKey();
+	if (_stickerPreviews.constFind(key) != _stickerPreviews.cend()) {
+		return;
+	}
+	StickerPreview entry;
+	entry.width = preview.width();
+	entry.height = preview.height();
+	{
+		QBuffer buffer(&entry.bytes);
+		preview.save(&buffer, "PNG");
+	}
+	if (entry.bytes.isEmpty()) {
+		return;
+	}
+	if (_stickerPreviews.size() >= kMaxStickerPreviewsCount) {
+		// The cache is full, drop it, the visible sets fill it
+		// up again.
+		_stickerPreviews.clear();
+	}
+	_stickerPreviews.insert(key, entry);
+	_writeStickerPreviews();
+}
+
+QImage readStickerPreview(DocumentData *document, const QSize &size) {
+	if (!document->sticker()) {
+		return QImage();
+	}
+	_readStickerPreviews();
+
+	const auto i = _stickerPreviews.constFind(document->mediaKey());
+	if (i == _stickerPreviews.cend()) {
+		return QImage();
+	}
+	if (i.value().width != size.width() || i.value().height != size.height()) {
+		// The cell size changed (DPI or style update), every entry
+		// was rendered for the old size, drop them all at once.
+		_stickerPreviews.clear();
+		_writeStickerPreviews();
+		return QImage();
+	}
+	return QImage::fromData(i.value().bytes);
+}
+
 bool encrypt(const void *src, void *dst, uint32 len, const void *key128) {
 	if (!LocalKey) {
 		return false;
@@ -4762,11 +6408,86 @@ struct ClearManagerData {
 	QThread *thread;
 	StorageMap images, stickers, audios;
 	WebFilesMap webFiles;
+	QSet<FileKey> compactKeep;
 	QMutex mutex;
 	QList<int> tasks;
 	bool working;
 };
 
+namespace {
+
+// Snapshot of every file key the maps still reference, for the
+// compaction pass: any other blob file in the user directory is dead
+// weight left behind by cleared cache entries.
+QSet<FileKey> _collectReferencedKeys() {
+	auto result = QSet<FileKey>();
+	const auto addMap = [&result](const StorageMap &map) {
+		for (auto i = map.cbegin(), e = map.cend(); i != e; ++i) {
+			result.insert(i.value().first);
+		}
+	};
+	addMap(_imagesMap);
+	addMap(_stickerImagesMap);
+	addMap(_audiosMap);
+	for (auto i = _webFilesMap.cbegin(), e = _webFilesMap.cend(); i != e; ++i) {
+		result.insert(i.value().first);
+	}
+	for (auto i = _draftsMap.cbegin(), e = _draftsMap.cend(); i != e; ++i) {
+		result.insert(i.value());
+	}
+	for (auto i = _draftCursorsMap.cbegin(), e = _draftCursorsMap.cend(); i != e; ++i) {
+		result.insert(i.value());
+	}
+	for (const auto key : {
+		_locationsKey,
+		_reportSpamStatusesKey,
+		_trustedBotsKey,
+		_recentStickersKeyOld,
+		_installedStickersKey,
+		_featuredStickersKey,
+		_recentStickersKey,
+		_favedStickersKey,
+		_archivedStickersKey,
+		_savedGifsKey,
+		_voiceWaveformsKey,
+		_videoThumbsKey,
+		_stickerPreviewsKey,
+		_backgroundKey,
+		_themeKey,
+		_userSettingsKey,
+		_recentHashtagsAndBotsKey,
+		_savedPeersKey,
+		_peersSnapshotKey,
+		_langPackKey,
+	}) {
+		if (key) {
+			result.insert(key);
+		}
+	}
+	return result;
+}
+
+// A blob file name is the 16 hex chars of its key plus the '0'/'1'
+// safe-write suffix; everything else (map, map_shard*, ...) is skipped.
+bool _parseBlobFileName(const QString &name, FileKey *outKey) {
+	if (name.size() != 17) {
+		return false;
+	}
+	const auto suffix = name.at(16);
+	if (suffix != QChar('0') && suffix != QChar('1')) {
+		return false;
+	}
+	auto ok = false;
+	const auto key = name.midRef(0, 16).toULongLong(&ok, 16);
+	if (!ok) {
+		return false;
+	}
+	*outKey = key;
+	return true;
+}
+
+} // namespace
+
 ClearManager::ClearManager() : data(new ClearManagerData()) {
 	data->thread = new QThread();
 	data->working = true;
@@ -4830,6 +6551,13 @@ bool ClearManager::addTask(int task) {
 			_savedPeersKey = 0;
 			_mapChanged = true;
 		}
+		if (_peersSnapshotKey) {
+			_peersSnapshotKey = 0;
+			_mapChanged = true;
+		}
+		_storageLruClear();
+		_markAllStorageShardsChanged();
+		_writeStorageShards();
 		_writeMap();
 	} else {
 		if (task & ClearManagerStorage) {
@@ -4897,8 +6625,14 @@ bool ClearManager::addTask(int task) {
 				_storageAudiosSize = 0;
 				_mapChanged = true;
 			}
+			_storageLruClear();
+			_markAllStorageShardsChanged();
+			_writeStorageShards();
 			_writeMap();
 		}
+		if (task & ClearManagerCompact) {
+			data->compactKeep = _collectReferencedKeys();
+		}
 		for (int32 i = 0, l = data->tasks.size(); i < l; ++i) {
 			if (data->tasks.at(i) == task) return true;
 		}
@@ -4945,6 +6679,7 @@ void ClearManager::onStart() {
 		bool result = false;
 		StorageMap images, stickers, audios;
 		WebFilesMap webFiles;
+		QSet<FileKey> compactKeep;
 		{
 			QMutexLocker lock(&data->mutex);
 			if (data->tasks.isEmpty()) {
@@ -4956,6 +6691,7 @@ void ClearManager::onStart() {
 			stickers = data->stickers;
 			audios = data->audios;
 			webFiles = data->webFiles;
+			compactKeep = data->compactKeep;
 		}
 		switch (task) {
 		case ClearManagerAll: {
@@ -4992,6 +6728,30 @@ void ClearManager::onStart() {
 			}
 			result = true;
 		break;
+		case ClearManagerCompact: {
+			// Rate-limited sweep of the user directory: unlink every
+			// blob file whose key is no longer referenced by the maps.
+			constexpr auto kUnlinksPerSlice = 64;
+			constexpr auto kSliceSleepMs = 20;
+			auto unlinked = 0;
+			QDirIterator di(_userBasePath, QDir::Files | QDir::Hidden | QDir::System);
+			while (di.hasNext()) {
+				di.next();
+				FileKey key = 0;
+				if (!_parseBlobFileName(di.fileName(), &key)) {
+					continue;
+				}
+				if (compactKeep.contains(key)) {
+					continue;
+				}
+				QFile::remove(di.filePath());
+				if (++unlinked % kUnlinksPerSlice == 0) {
+					QThread::msleep(kSliceSleepMs);
+				}
+			}
+			DEBUG_LOG(("App Info: cache compaction removed %1 dead blob files").arg(unlinked));
+			result = true;
+		} break;
 		}
 		{
 			QMutexLocker lock(&data->mutex);
@@ -5018,6 +6778,16 @@ Manager::Manager() {
 	connect(&_mapWriteTimer, SIGNAL(timeout()), this, SLOT(mapWriteTimeout()));
 	_locationsWriteTimer.setSingleShot(true);
 	connect(&_locationsWriteTimer, SIGNAL(timeout()), this, SLOT(locationsWriteTimeout()));
+	_reportSpamStatusesWriteTimer.setSingleShot(true);
+	connect(&_reportSpamStatusesWriteTimer, SIGNAL(timeout()), this, SLOT(reportSpamStatusesWriteTimeout()));
+	_shardsWriteTimer.setSingleShot(true);
+	connect(&_shardsWriteTimer, SIGNAL(timeout()), this, SLOT(shardsWriteTimeout()));
+	_draftsWriteTimer.setSingleShot(true);
+	connect(&_draftsWriteTimer, SIGNAL(timeout()), this, SLOT(draftsWriteTimeout()));
+	_stickersWriteTimer.setSingleShot(true);
+	connect(&_stickersWriteTimer, SIGNAL(timeout()), this, SLOT(stickersWriteTimeout()));
+	_syncTimer.setSingleShot(true);
+	connect(&_syncTimer, SIGNAL(timeout()), this, SLOT(syncTimeout()));
 }
 
 void Manager::writeMap(bool fast) {
@@ -5044,6 +6814,50 @@ void Manager::writingLocations() {
 	_locationsWriteTimer.stop();
 }
 
+void Manager::writeReportSpamStatuses(bool fast) {
+	if (!_reportSpamStatusesWriteTimer.isActive() || fast) {
+		_reportSpamStatusesWriteTimer.start(fast ? 1 : WriteMapTimeout);
+	} else if (_reportSpamStatusesWriteTimer.remainingTime() <= 0) {
+		reportSpamStatusesWriteTimeout();
+	}
+}
+
+void Manager::writingReportSpamStatuses() {
+	_reportSpamStatusesWriteTimer.stop();
+}
+
+void Manager::writeShards(bool fast) {
+	if (!_shardsWriteTimer.isActive() || fast) {
+		_shardsWriteTimer.start(fast ? 1 : WriteMapTimeout);
+	} else if (_shardsWriteTimer.remainingTime() <= 0) {
+		shardsWriteTimeout();
+	}
+}
+
+void Manager::writingShards() {
+	_shardsWriteTimer.stop();
+}
+
+void Manager::writeDrafts(bool fast) {
+	if (!_draftsWriteTimer.isActive() || fast) {
+		_draftsWriteTimer.start(fast ? 1 : WriteMapTimeout);
+	} else if (_draftsWriteTimer.remainingTime() <= 0) {
+		draftsWriteTimeout();
+	}
+}
+
+void Manager::writingDrafts() {
+	_draftsWriteTimer.stop();
+}
+
+void Manager::writeStickers(bool fast) {
+	if (!_stickersWriteTimer.isActive() || fast) {
+		_stickersWriteTimer.start(fast ? 1 : WriteMapTimeout);
+	} else if (_stickersWriteTimer.remainingTime() <= 0) {
+		stickersWriteTimeout();
+	}
+}
+
 void Manager::mapWriteTimeout() {
 	_writeMap(WriteMapWhen::Now);
 }
@@ -5052,6 +6866,32 @@ void Manager::locationsWriteTimeout() {
 	_writeLocations(WriteMapWhen::Now);
 }
 
+void Manager::reportSpamStatusesWriteTimeout() {
+	_writeReportSpamStatuses(WriteMapWhen::Now);
+}
+
+void Manager::shardsWriteTimeout() {
+	_writeStorageShards(WriteMapWhen::Now);
+}
+
+void Manager::draftsWriteTimeout() {
+	_flushDraftsQueue(WriteMapWhen::Now);
+}
+
+void Manager::stickersWriteTimeout() {
+	_flushStickersWrites();
+}
+
+void Manager::scheduleSync() {
+	if (!_syncTimer.isActive()) {
+		_syncTimer.start(WriteMapTimeout);
+	}
+}
+
+void Manager::syncTimeout() {
+	_performGroupedSync();
+}
+
 void Manager::finish() {
 	if (_mapWriteTimer.isActive()) {
 		mapWriteTimeout();
@@ -5059,6 +6899,22 @@ void Manager::finish() {
 	if (_locationsWriteTimer.isActive()) {
 		locationsWriteTimeout();
 	}
+	if (_reportSpamStatusesWriteTimer.isActive()) {
+		reportSpamStatusesWriteTimeout();
+	}
+	if (_shardsWriteTimer.isActive()) {
+		shardsWriteTimeout();
+	}
+	if (_draftsWriteTimer.isActive()) {
+		_draftsWriteTimer.stop();
+		_flushDraftsQueue(WriteMapWhen::Now, true);
+	}
+	if (_stickersWriteTimer.isActive()) {
+		_stickersWriteTimer.stop();
+		_flushStickersWrites();
+	}
+	_syncTimer.stop();
+	_performGroupedSync();
 }
 
 } // namespace internal
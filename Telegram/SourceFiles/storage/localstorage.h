@@ -41,6 +41,7 @@ enum ClearManagerTask {
 	ClearManagerAll = 0xFFFF,
 	ClearManagerDownloads = 0x01,
 	ClearManagerStorage = 0x02,
+	ClearManagerCompact = 0x04,
 };
 
 struct ClearManagerData;
@@ -97,6 +98,25 @@ bool hasDraft(const PeerId &peer);
 void writeFileLocation(MediaKey location, const FileLocation &local);
 FileLocation readFileLocation(MediaKey location, bool check = true);
 
+struct DownloadResume {
+	QString fname;
+	qint32 already = 0; // every byte before this offset is on disk
+	qint32 size = 0;
+};
+void writeDownloadResume(MediaKey location, const DownloadResume &resume);
+DownloadResume readDownloadResume(MediaKey location);
+void clearDownloadResume(MediaKey location);
+
+struct UploadedFileInfo {
+	quint64 fileId = 0;
+	qint32 partsCount = 0;
+	bool big = false;
+	qint32 when = 0; // unixtime of the upload
+};
+void writeUploadedFileInfo(const QByteArray &filemd5, const UploadedFileInfo &info);
+void forgetUploadedFileInfo(const QByteArray &filemd5);
+UploadedFileInfo readUploadedFileInfo(const QByteArray &filemd5);
+
 void writeImage(const StorageKey &location, const ImagePtr &img);
 void writeImage(const StorageKey &location, const StorageImageSaved &jpeg, bool overwrite = true);
 TaskId startImageLoad(const StorageKey &location, mtpFileLoader *loader);
@@ -118,6 +138,20 @@ bool copyAudio(const StorageKey &oldLocation, const StorageKey &newLocation);
 int32 hasAudios();
 qint64 storageAudiosSize();
 
+// Snapshot of the local cache effectiveness counters.
+struct CacheStats {
+	qint64 hits = 0;
+	qint64 misses = 0;
+	qint64 bytesRead = 0;
+	qint64 bytesWritten = 0;
+	qint64 decryptMs = 0;
+};
+CacheStats cacheStats();
+
+// Evicts least-recently-used cached images / stickers / audios until
+// their total size fits the limit, O(evicted * log n).
+void enforceStorageLimit(qint64 limit);
+
 void writeWebFile(const QString &url, const QByteArray &data, bool overwrite = true);
 TaskId startWebFileLoad(const QString &url, webFileLoader *loader);
 bool willWebFileLoad(const QString &url);
@@ -126,13 +160,38 @@ qint64 storageWebFilesSize();
 
 void countVoiceWaveform(DocumentData *document);
 
+// Locally counted waveforms, cached between the sessions so that a
+// voice-heavy chat doesn't decode the audio files at paint time.
+void writeVoiceWaveform(DocumentData *document);
+bool readVoiceWaveform(DocumentData *document);
+
+// Keyframe thumbnail strips for instant previews while scrubbing
+// a video, counted in the background and cached between sessions.
+constexpr auto kVideoThumbsInStrip = 20;
+void countVideoThumbsStrip(DocumentData *document);
+void writeVideoThumbsStrip(DocumentData *document);
+bool readVideoThumbsStrip(DocumentData *document);
+
+// Sticker panel previews pre-rendered at the panel cell size, cached
+// between sessions. The stored size must match the requested one -
+// a DPI or style change invalidates the whole cache.
+void writeStickerPreview(DocumentData *document, const QImage &preview);
+QImage readStickerPreview(DocumentData *document, const QSize &size);
+
 void cancelTask(TaskId id);
 
+// Schedule a write of the corresponding sticker sets file. The writes
+// are coalesced, so a burst of changes serializes each file only once.
 void writeInstalledStickers();
 void writeFeaturedStickers();
 void writeRecentStickers();
 void writeFavedStickers();
 void writeArchivedStickers();
+
+// Perform the scheduled sticker sets writes right now, the sets to
+// serialize are read from the auth session, so this should be called
+// before the session is destroyed.
+void flushStickersWrites();
 void readInstalledStickers();
 void readFeaturedStickers();
 void readRecentStickers();
@@ -150,6 +209,10 @@ int32 countSavedGifsHash();
 void writeBackground(int32 id, const QImage &img);
 bool readBackground();
 
+void writeWindowSnapshot(const QImage &image);
+QImage readWindowSnapshot();
+void clearWindowSnapshot();
+
 void writeTheme(const QString &pathRelative, const QString &pathAbsolute, const QByteArray &content, const Window::Theme::Cached &cache);
 void clearTheme();
 bool hasTheme();
@@ -166,6 +229,12 @@ void addSavedPeer(PeerData *peer, const QDateTime &position);
 void removeSavedPeer(PeerData *peer);
 void readSavedPeers();
 
+// The whole loaded peer table, written sequentially once at quit and
+// restored in one pass at the next launch, so the peers don't have to
+// be rebuilt from piecemeal reads and the server sync.
+void writePeersSnapshot();
+void readPeersSnapshot();
+
 void writeReportSpamStatuses();
 
 void makeBotTrusted(UserData *bot);
@@ -186,15 +255,33 @@ public:
 	void writingMap();
 	void writeLocations(bool fast);
 	void writingLocations();
+	void writeReportSpamStatuses(bool fast);
+	void writingReportSpamStatuses();
+	void writeShards(bool fast);
+	void writingShards();
+	void writeDrafts(bool fast);
+	void writingDrafts();
+	void writeStickers(bool fast);
 	void finish();
 
 public slots:
 	void mapWriteTimeout();
 	void locationsWriteTimeout();
+	void reportSpamStatusesWriteTimeout();
+	void shardsWriteTimeout();
+	void draftsWriteTimeout();
+	void stickersWriteTimeout();
+	void scheduleSync();
+	void syncTimeout();
 
 private:
 	QTimer _mapWriteTimer;
 	QTimer _locationsWriteTimer;
+	QTimer _reportSpamStatusesWriteTimer;
+	QTimer _shardsWriteTimer;
+	QTimer _draftsWriteTimer;
+	QTimer _stickersWriteTimer;
+	QTimer _syncTimer;
 
 };
 
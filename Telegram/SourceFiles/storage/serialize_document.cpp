@@ -20,6 +20,53 @@ enum StickerSetType {
 	StickerSetTypeShortName = 2,
 };
 
+// A packed columnar documents block starts with this tag instead of
+// the first document id. Ids are serialized as big-endian quint64, so
+// a collision needs a document id starting with these four bytes -
+// and a collision only costs us a cache file rebuild.
+constexpr auto kDocumentsPackTag = quint32(0xFFFFFFFEU);
+constexpr auto kDocumentsPackMaxCount = 0x100000;
+
+// The column order inside a packed block, shared by the writer and
+// the reader. The columns are stored in the native byte order - these
+// are local cache files, not shared between machines.
+enum PackLongColumn {
+	IdsColumn,
+	AccessesColumn,
+	ThumbVolumesColumn,
+	ThumbSecretsColumn,
+	PackLongColumnsCount,
+};
+enum PackIntColumn {
+	DatesColumn,
+	VersionsColumn,
+	DcsColumn,
+	SizesColumn,
+	WidthsColumn,
+	HeightsColumn,
+	TypesColumn,
+	DurationsColumn,
+	SetTypesColumn,
+	ThumbWidthsColumn,
+	ThumbHeightsColumn,
+	ThumbDcsColumn,
+	ThumbLocalsColumn,
+	NameOffsetsColumn,
+	NameLengthsColumn,
+	MimeOffsetsColumn,
+	MimeLengthsColumn,
+	AltOffsetsColumn,
+	AltLengthsColumn,
+	PackIntColumnsCount,
+};
+
+int PackBlobSize(int count, int heapLength) {
+	return 2 * sizeof(qint32)
+		+ count * (PackLongColumnsCount * sizeof(quint64)
+			+ PackIntColumnsCount * sizeof(qint32))
+		+ heapLength * sizeof(ushort);
+}
+
 } // namespace
 
 namespace Serialize {
@@ -65,20 +112,27 @@ DocumentData *Document::readFromStreamHelper(int streamAppVersion, QDataStream &
 	stream >> width >> height;
 	stream >> type;
 
-	QVector<MTPDocumentAttribute> attributes;
-	if (!name.isEmpty()) {
-		attributes.push_back(MTP_documentAttributeFilename(MTP_string(name)));
-	}
-
+	QString alt;
 	qint32 duration = -1;
+	qint32 typeOfSet = StickerSetTypeEmpty;
 	StorageImageLocation thumb;
 	if (type == StickerDocument) {
-		QString alt;
-		qint32 typeOfSet;
 		stream >> alt >> typeOfSet;
-
 		thumb = readStorageImageLocation(stream);
+	} else {
+		stream >> duration;
+		thumb = readStorageImageLocation(stream);
+	}
+	return createDocument(id, access, version, date, dc, size, width, height, type, duration, name, mime, alt, typeOfSet, thumb, info);
+}
 
+DocumentData *Document::createDocument(quint64 id, quint64 access, qint32 version, qint32 date, qint32 dc, qint32 size, qint32 width, qint32 height, qint32 type, qint32 duration, const QString &name, const QString &mime, const QString &alt, qint32 typeOfSet, const StorageImageLocation &thumb, const StickerSetInfo *info) {
+	QVector<MTPDocumentAttribute> attributes;
+	if (!name.isEmpty()) {
+		attributes.push_back(MTP_documentAttributeFilename(MTP_string(name)));
+	}
+
+	if (type == StickerDocument) {
 		if (typeOfSet == StickerSetTypeEmpty) {
 			attributes.push_back(MTP_documentAttributeSticker(MTP_flags(0), MTP_string(alt), MTP_inputStickerSetEmpty(), MTPMaskCoords()));
 		} else if (info) {
@@ -102,12 +156,8 @@ DocumentData *Document::readFromStreamHelper(int streamAppVersion, QDataStream &
 			} break;
 			}
 		}
-	} else {
-		stream >> duration;
-		if (type == AnimatedDocument) {
-			attributes.push_back(MTP_documentAttributeAnimated());
-		}
-		thumb = readStorageImageLocation(stream);
+	} else if (type == AnimatedDocument) {
+		attributes.push_back(MTP_documentAttributeAnimated());
 	}
 	if (width > 0 && height > 0) {
 		if (duration >= 0) {
@@ -145,6 +195,186 @@ DocumentData *Document::readFromStream(int streamAppVersion, QDataStream &stream
 	return readFromStreamHelper(streamAppVersion, stream, nullptr);
 }
 
+void Document::writePackToStream(QDataStream &stream, const QVector<DocumentData*> &pack) {
+	const auto count = pack.size();
+
+	auto heap = QString();
+	auto heapOffsets = QMap<QString, qint32>();
+	const auto refOf = [&](const QString &text) {
+		if (text.isEmpty()) {
+			return QPair<qint32, qint32>(0, 0);
+		}
+		auto i = heapOffsets.constFind(text);
+		if (i == heapOffsets.cend()) {
+			i = heapOffsets.insert(text, heap.size());
+			heap.append(text);
+		}
+		return QPair<qint32, qint32>(i.value(), text.size());
+	};
+	struct StringRefs {
+		QPair<qint32, qint32> name, mime, alt;
+	};
+	auto strings = std::vector<StringRefs>();
+	strings.reserve(count);
+	for (const auto document : pack) {
+		auto entry = StringRefs();
+		entry.name = refOf(document->filename());
+		entry.mime = refOf(document->mimeString());
+		if (const auto sticker = document->sticker()) {
+			entry.alt = refOf(sticker->alt);
+		}
+		strings.push_back(entry);
+	}
+	const auto thumbOf = [](DocumentData *document) {
+		if (const auto sticker = document->sticker()) {
+			return sticker->loc;
+		}
+		return document->thumb->location();
+	};
+
+	auto blob = QByteArray(PackBlobSize(count, heap.size()), Qt::Uninitialized);
+	auto to = blob.data();
+	const auto putInt = [&](qint32 value) {
+		memcpy(to, &value, sizeof(value));
+		to += sizeof(value);
+	};
+	const auto putLong = [&](quint64 value) {
+		memcpy(to, &value, sizeof(value));
+		to += sizeof(value);
+	};
+	putInt(count);
+	putInt(heap.size());
+	for (const auto document : pack) putLong(quint64(document->id));
+	for (const auto document : pack) putLong(quint64(document->_access));
+	for (const auto document : pack) putLong(quint64(thumbOf(document).volume()));
+	for (const auto document : pack) putLong(quint64(thumbOf(document).secret()));
+	for (const auto document : pack) putInt(qint32(document->date));
+	for (const auto document : pack) putInt(document->_version);
+	for (const auto document : pack) putInt(document->_dc);
+	for (const auto document : pack) putInt(document->size);
+	for (const auto document : pack) putInt(document->dimensions.width());
+	for (const auto document : pack) putInt(document->dimensions.height());
+	for (const auto document : pack) putInt(qint32(document->type));
+	for (const auto document : pack) putInt(document->sticker() ? -1 : qint32(document->duration()));
+	for (const auto document : pack) {
+		auto typeOfSet = qint32(StickerSetTypeEmpty);
+		if (const auto sticker = document->sticker()) {
+			switch (sticker->set.type()) {
+			case mtpc_inputStickerSetID: typeOfSet = StickerSetTypeID; break;
+			case mtpc_inputStickerSetShortName: typeOfSet = StickerSetTypeShortName; break;
+			}
+		}
+		putInt(typeOfSet);
+	}
+	for (const auto document : pack) putInt(thumbOf(document).width());
+	for (const auto document : pack) putInt(thumbOf(document).height());
+	for (const auto document : pack) putInt(thumbOf(document).dc());
+	for (const auto document : pack) putInt(thumbOf(document).local());
+	for (const auto &entry : strings) putInt(entry.name.first);
+	for (const auto &entry : strings) putInt(entry.name.second);
+	for (const auto &entry : strings) putInt(entry.mime.first);
+	for (const auto &entry : strings) putInt(entry.mime.second);
+	for (const auto &entry : strings) putInt(entry.alt.first);
+	for (const auto &entry : strings) putInt(entry.alt.second);
+	memcpy(to, heap.constData(), heap.size() * sizeof(ushort));
+
+	stream << kDocumentsPackTag << blob;
+}
+
+bool Document::readPackFromStream(QDataStream &stream, const StickerSetInfo *info, QVector<DocumentData*> &result) {
+	const auto device = stream.device();
+	if (!device) {
+		return false;
+	}
+	const auto position = device->pos();
+	auto tag = quint32(0);
+	stream >> tag;
+	if (stream.status() != QDataStream::Ok || tag != kDocumentsPackTag) {
+		stream.resetStatus();
+		device->seek(position);
+		return false;
+	}
+	auto blob = QByteArray();
+	stream >> blob;
+	if (stream.status() != QDataStream::Ok
+		|| blob.size() < 2 * int(sizeof(qint32))) {
+		return false;
+	}
+	const auto from = blob.constData();
+	auto count = qint32(0), heapLength = qint32(0);
+	memcpy(&count, from, sizeof(count));
+	memcpy(&heapLength, from + sizeof(count), sizeof(heapLength));
+	if (count < 0
+		|| count > kDocumentsPackMaxCount
+		|| heapLength < 0
+		|| blob.size() != PackBlobSize(count, heapLength)) {
+		return false;
+	}
+
+	const auto longColumn = [&](int column, int index) {
+		auto value = quint64();
+		memcpy(&value, from + 2 * sizeof(qint32) + (column * count + index) * sizeof(quint64), sizeof(value));
+		return value;
+	};
+	const auto intsBase = 2 * sizeof(qint32) + PackLongColumnsCount * count * sizeof(quint64);
+	const auto intColumn = [&](int column, int index) {
+		auto value = qint32();
+		memcpy(&value, from + intsBase + (column * count + index) * sizeof(qint32), sizeof(value));
+		return value;
+	};
+	const auto heapBase = intsBase + PackIntColumnsCount * count * sizeof(qint32);
+	const auto heapString = [&](qint32 offset, qint32 length, QString &text) {
+		// Compared as (length > heapLength - offset), the addition of
+		// two corrupted positive values could overflow and pass.
+		if (offset < 0
+			|| length < 0
+			|| offset > heapLength
+			|| length > heapLength - offset) {
+			return false;
+		}
+		text = QString(reinterpret_cast<const QChar*>(from + heapBase) + offset, length);
+		return true;
+	};
+
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		QString name, mime, alt;
+		if (!heapString(intColumn(NameOffsetsColumn, i), intColumn(NameLengthsColumn, i), name)
+			|| !heapString(intColumn(MimeOffsetsColumn, i), intColumn(MimeLengthsColumn, i), mime)
+			|| !heapString(intColumn(AltOffsetsColumn, i), intColumn(AltLengthsColumn, i), alt)) {
+			return false;
+		}
+		const auto thumb = StorageImageLocation(
+			intColumn(ThumbWidthsColumn, i),
+			intColumn(ThumbHeightsColumn, i),
+			intColumn(ThumbDcsColumn, i),
+			longColumn(ThumbVolumesColumn, i),
+			intColumn(ThumbLocalsColumn, i),
+			longColumn(ThumbSecretsColumn, i));
+		const auto document = createDocument(
+			longColumn(IdsColumn, i),
+			longColumn(AccessesColumn, i),
+			intColumn(VersionsColumn, i),
+			intColumn(DatesColumn, i),
+			intColumn(DcsColumn, i),
+			intColumn(SizesColumn, i),
+			intColumn(WidthsColumn, i),
+			intColumn(HeightsColumn, i),
+			intColumn(TypesColumn, i),
+			intColumn(DurationsColumn, i),
+			name,
+			mime,
+			alt,
+			intColumn(SetTypesColumn, i),
+			thumb,
+			info);
+		if (document) {
+			result.push_back(document);
+		}
+	}
+	return true;
+}
+
 int Document::sizeInStream(DocumentData *document) {
 	int result = 0;
 
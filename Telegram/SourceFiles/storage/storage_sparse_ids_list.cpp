@@ -8,6 +8,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_sparse_ids_list.h"
 
 namespace Storage {
+namespace {
+
+constexpr auto kQueryCacheLimit = 4;
+
+} // namespace
 
 SparseIdsList::Slice::Slice(
 	base::flat_set<MsgId> &&messages,
@@ -97,6 +102,7 @@ void SparseIdsList::addRange(
 		bool incrementCount) {
 	Expects(!count || !incrementCount);
 
+	_queryCache.clear();
 	auto wasCount = _count;
 	auto update = SparseIdsSliceUpdate();
 	auto result = addRangeItemsAndCountNew(
@@ -137,6 +143,7 @@ void SparseIdsList::addSlice(
 }
 
 void SparseIdsList::removeOne(MsgId messageId) {
+	_queryCache.clear();
 	auto slice = ranges::lower_bound(
 		_slices,
 		messageId,
@@ -153,12 +160,14 @@ void SparseIdsList::removeOne(MsgId messageId) {
 }
 
 void SparseIdsList::removeAll() {
+	_queryCache.clear();
 	_slices.clear();
 	_slices.emplace(base::flat_set<MsgId>{}, MsgRange { 0, ServerMaxMsgId });
 	_count = 0;
 }
 
 void SparseIdsList::invalidateBottom() {
+	_queryCache.clear();
 	if (!_slices.empty()) {
 		const auto &last = _slices.back();
 		if (last.range.till == ServerMaxMsgId) {
@@ -175,6 +184,11 @@ void SparseIdsList::invalidateBottom() {
 rpl::producer<SparseIdsListResult> SparseIdsList::query(
 		SparseIdsListQuery &&query) const {
 	return [this, query = std::move(query)](auto consumer) {
+		if (auto cached = queryFromCache(query)) {
+			consumer.put_next(std::move(*cached));
+			consumer.put_done();
+			return rpl::lifetime();
+		}
 		auto slice = query.aroundId
 			? ranges::lower_bound(
 				_slices,
@@ -184,7 +198,9 @@ rpl::producer<SparseIdsListResult> SparseIdsList::query(
 			: _slices.end();
 		if (slice != _slices.end()
 			&& slice->range.from <= query.aroundId) {
-			consumer.put_next(queryFromSlice(query, *slice));
+			auto result = queryFromSlice(query, *slice);
+			pushToCache(query, result);
+			consumer.put_next(std::move(result));
 		} else if (_count) {
 			auto result = SparseIdsListResult {};
 			result.count = _count;
@@ -195,6 +211,27 @@ rpl::producer<SparseIdsListResult> SparseIdsList::query(
 	};
 }
 
+base::optional<SparseIdsListResult> SparseIdsList::queryFromCache(
+		const SparseIdsListQuery &query) const {
+	for (auto i = _queryCache.begin(); i != _queryCache.end(); ++i) {
+		if (i->query == query) {
+			auto result = i->result;
+			std::rotate(_queryCache.begin(), i, i + 1);
+			return result;
+		}
+	}
+	return base::none;
+}
+
+void SparseIdsList::pushToCache(
+		const SparseIdsListQuery &query,
+		const SparseIdsListResult &result) const {
+	while (_queryCache.size() >= kQueryCacheLimit) {
+		_queryCache.pop_back();
+	}
+	_queryCache.insert(_queryCache.begin(), CachedQuery { query, result });
+}
+
 rpl::producer<SparseIdsSliceUpdate> SparseIdsList::sliceUpdated() const {
 	return _sliceUpdated.events();
 }
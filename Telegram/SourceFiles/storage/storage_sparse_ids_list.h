@@ -19,6 +19,12 @@ struct SparseIdsListQuery {
 	, limitAfter(limitAfter) {
 	}
 
+	inline bool operator==(const SparseIdsListQuery &other) const {
+		return (aroundId == other.aroundId)
+			&& (limitBefore == other.limitBefore)
+			&& (limitAfter == other.limitAfter);
+	}
+
 	MsgId aroundId = 0;
 	int limitBefore = 0;
 	int limitAfter = 0;
@@ -90,6 +96,21 @@ private:
 	SparseIdsListResult queryFromSlice(
 		const SparseIdsListQuery &query,
 		const Slice &slice) const;
+	base::optional<SparseIdsListResult> queryFromCache(
+		const SparseIdsListQuery &query) const;
+	void pushToCache(
+		const SparseIdsListQuery &query,
+		const SparseIdsListResult &result) const;
+
+	// Materialized results of the last few queries, most recently used
+	// first. The media viewer asks around its current position on each
+	// navigation step, so stepping back and forth reuses these instead
+	// of rebuilding the slice. Dropped on any change of the list.
+	struct CachedQuery {
+		SparseIdsListQuery query;
+		SparseIdsListResult result;
+	};
+	mutable std::vector<CachedQuery> _queryCache;
 
 	base::optional<int> _count;
 	base::flat_set<Slice> _slices;
@@ -9,6 +9,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/media_clip_reader.h"
 
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
+
 namespace Media {
 namespace Clip {
 
@@ -29,6 +32,18 @@ namespace {
 AnimationManager *_manager = nullptr;
 bool AnimationsDisabled = false;
 
+// One tick per display frame, so all active animations step together
+// and the paint pass that follows coalesces their update regions into
+// one repaint. A fixed delta ticked faster than 60 Hz screens paint
+// and slower than 144 Hz screens do.
+int CountFrameInterval() {
+	const auto screen = QGuiApplication::primaryScreen();
+	const auto rate = screen ? screen->refreshRate() : 0.;
+	return (rate >= 30. && rate <= 1000.)
+		? qMax(qRound(1000. / rate), 1)
+		: int(AnimationTimerDelta);
+}
+
 } // namespace
 
 namespace anim {
@@ -127,6 +142,7 @@ void BasicAnimation::stop() {
 
 AnimationManager::AnimationManager() : _timer(this), _iterating(false) {
 	_timer.setSingleShot(false);
+	_timer.setTimerType(Qt::PreciseTimer);
 	connect(&_timer, SIGNAL(timeout()), this, SLOT(timeout()));
 }
 
@@ -138,7 +154,10 @@ void AnimationManager::start(BasicAnimation *obj) {
 		}
 	} else {
 		if (_objects.isEmpty()) {
-			_timer.start(AnimationTimerDelta);
+			// Counted on each start, so moving the window to a display
+			// with another refresh rate is picked up as soon as the
+			// animations go idle once.
+			_timer.start(CountFrameInterval());
 		}
 		_objects.insert(obj);
 	}
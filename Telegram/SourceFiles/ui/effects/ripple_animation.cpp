@@ -8,6 +8,48 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/effects/ripple_animation.h"
 
 namespace Ui {
+namespace {
+
+constexpr auto kMaskCacheLimit = 64;
+
+// Hovering through the dialogs list or a menu creates a ripple mask of
+// the same shape and size for every row, so the standard rect / round
+// rect / ellipse masks are rasterized once and shared between all the
+// ripple instances. Size, radius and shape are packed into one key.
+enum class MaskShape {
+	Rect = 0,
+	RoundRect = 1,
+	Ellipse = 2,
+};
+
+QImage CachedMask(
+		MaskShape shape,
+		QSize size,
+		int radius,
+		base::lambda<QImage()> generator) {
+	static auto Cache = base::flat_map<uint64, QImage>();
+	if (size.width() >= (1 << 22)
+		|| size.height() >= (1 << 22)
+		|| radius >= (1 << 10)) {
+		return generator();
+	}
+	const auto key = (uint64(uint32(size.width())) << 34)
+		| (uint64(uint32(size.height())) << 12)
+		| (uint64(uint32(radius)) << 2)
+		| uint64(int(shape));
+	const auto i = Cache.find(key);
+	if (i != Cache.end()) {
+		return i->second;
+	}
+	if (Cache.size() >= kMaskCacheLimit) {
+		Cache.clear();
+	}
+	auto result = generator();
+	Cache.emplace(key, result);
+	return result;
+}
+
+} // namespace
 
 class RippleAnimation::Ripple {
 public:
@@ -197,18 +239,24 @@ QImage RippleAnimation::maskByDrawer(QSize size, bool filled, base::lambda<void(
 }
 
 QImage RippleAnimation::rectMask(QSize size) {
-	return maskByDrawer(size, true, base::lambda<void(QPainter&)>());
+	return CachedMask(MaskShape::Rect, size, 0, [size] {
+		return maskByDrawer(size, true, base::lambda<void(QPainter&)>());
+	});
 }
 
 QImage RippleAnimation::roundRectMask(QSize size, int radius) {
-	return maskByDrawer(size, false, [size, radius](QPainter &p) {
-		p.drawRoundedRect(0, 0, size.width(), size.height(), radius, radius);
+	return CachedMask(MaskShape::RoundRect, size, radius, [size, radius] {
+		return maskByDrawer(size, false, [size, radius](QPainter &p) {
+			p.drawRoundedRect(0, 0, size.width(), size.height(), radius, radius);
+		});
 	});
 }
 
 QImage RippleAnimation::ellipseMask(QSize size) {
-	return maskByDrawer(size, false, [size](QPainter &p) {
-		p.drawEllipse(0, 0, size.width(), size.height());
+	return CachedMask(MaskShape::Ellipse, size, 0, [size] {
+		return maskByDrawer(size, false, [size](QPainter &p) {
+			p.drawEllipse(0, 0, size.width(), size.height());
+		});
 	});
 }
 
@@ -95,6 +95,11 @@ inline EmojiPtr FromUrl(const QString &url) {
 }
 
 inline EmojiPtr Find(const QChar *start, const QChar *end, int *outLength = nullptr) {
+	// Text construction probes every character position, so reject the
+	// common case with a single bitmap lookup before the full search.
+	if (start == end || !internal::MayBeEmojiFirstChar(start->unicode())) {
+		return nullptr;
+	}
 	return internal::Find(start, end, outLength);
 }
 
@@ -11,6 +11,53 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 
 namespace Ui {
+namespace {
+
+enum class BackgroundShape {
+	Circle,
+	Rounded,
+};
+
+// The dialogs list paints thousands of these placeholders, and the
+// antialiased circle rasterization is the expensive part, so finished
+// backgrounds are shared between all EmptyUserpic instances by
+// (color, shape, size). A palette switch changes the color values and
+// simply starts filling new entries.
+using BackgroundsMap = QMap<uint64, QPixmap>;
+BackgroundsMap Backgrounds;
+
+const QPixmap &backgroundPixmap(const style::color &color, BackgroundShape shape, int size) {
+	const auto realSize = size * cIntRetinaFactor();
+	const auto key = (uint64(anim::getPremultiplied(color->c)) << 32)
+		| (uint64(uint32(realSize)) << 2)
+		| uint64(static_cast<int>(shape));
+	auto i = Backgrounds.constFind(key);
+	if (i == Backgrounds.cend()) {
+		auto image = QImage(
+			QSize(realSize, realSize),
+			QImage::Format_ARGB32_Premultiplied);
+		image.setDevicePixelRatio(cRetinaFactor());
+		image.fill(Qt::transparent);
+		{
+			Painter p(&image);
+			PainterHighQualityEnabler hq(p);
+			p.setBrush(color);
+			p.setPen(Qt::NoPen);
+			switch (shape) {
+			case BackgroundShape::Circle:
+				p.drawEllipse(0, 0, size, size);
+				break;
+			case BackgroundShape::Rounded:
+				p.drawRoundedRect(0, 0, size, size, st::buttonRadius, st::buttonRadius);
+				break;
+			}
+		}
+		i = Backgrounds.insert(key, App::pixmapFromImageInPlace(std::move(image)));
+	}
+	return i.value();
+}
+
+} // namespace
 
 EmptyUserpic::EmptyUserpic(const style::color &color, const QString &name)
 : _color(color) {
@@ -28,15 +75,15 @@ void EmptyUserpic::paint(
 	x = rtl() ? (outerWidth - x - size) : x;
 
 	const auto fontsize = (size * 13) / 33;
-	auto font = st::historyPeerUserpicFont->f;
-	font.setPixelSize(fontsize);
+	if (_fontSize != fontsize) {
+		_fontSize = fontsize;
+		_font = st::historyPeerUserpicFont->f;
+		_font.setPixelSize(fontsize);
+	}
 
-	PainterHighQualityEnabler hq(p);
-	p.setBrush(_color);
-	p.setPen(Qt::NoPen);
-	paintBackground();
+	paintBackground(x, y);
 
-	p.setFont(font);
+	p.setFont(_font);
 	p.setBrush(Qt::NoBrush);
 	p.setPen(st::historyPeerUserpicFg);
 	p.drawText(QRect(x, y, size, size), _string, QTextOption(style::al_center));
@@ -48,20 +95,20 @@ void EmptyUserpic::paint(
 		int y,
 		int outerWidth,
 		int size) const {
-	paint(p, x, y, outerWidth, size, [&p, x, y, size] {
-		p.drawEllipse(x, y, size, size);
+	paint(p, x, y, outerWidth, size, [&](int x, int y) {
+		p.drawPixmap(x, y, backgroundPixmap(_color, BackgroundShape::Circle, size));
 	});
 }
 
 void EmptyUserpic::paintRounded(Painter &p, int x, int y, int outerWidth, int size) const {
-	paint(p, x, y, outerWidth, size, [&p, x, y, size] {
-		p.drawRoundedRect(x, y, size, size, st::buttonRadius, st::buttonRadius);
+	paint(p, x, y, outerWidth, size, [&](int x, int y) {
+		p.drawPixmap(x, y, backgroundPixmap(_color, BackgroundShape::Rounded, size));
 	});
 }
 
 void EmptyUserpic::paintSquare(Painter &p, int x, int y, int outerWidth, int size) const {
-	paint(p, x, y, outerWidth, size, [&p, x, y, size] {
-		p.fillRect(x, y, size, size, p.brush());
+	paint(p, x, y, outerWidth, size, [&](int x, int y) {
+		p.fillRect(x, y, size, size, _color);
 	});
 }
 
@@ -65,6 +65,8 @@ private:
 
 	style::color _color;
 	QString _string;
+	mutable QFont _font;
+	mutable int _fontSize = 0;
 
 };
 
@@ -9,11 +9,21 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "mainwidget.h"
 #include "storage/localstorage.h"
+#include "storage/localimageloader.h"
 #include "platform/platform_specific.h"
 #include "auth_session.h"
 #include "history/history_item.h"
 #include "history/history.h"
 
+#ifdef ARCH_CPU_X86_FAMILY
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#else // COMPILER_MSVC
+#include <cpuid.h>
+#endif // COMPILER_MSVC
+#include <immintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
 namespace Images {
 namespace {
 
@@ -21,6 +31,197 @@ FORCE_INLINE uint64 blurGetColors(const uchar *p) {
 	return (uint64)p[0] + ((uint64)p[1] << 16) + ((uint64)p[2] << 32) + ((uint64)p[3] << 48);
 }
 
+#ifdef ARCH_CPU_X86_FAMILY
+
+#ifdef COMPILER_MSVC
+#define SSE2_TARGET
+#define AVX2_TARGET
+#else // COMPILER_MSVC
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif // COMPILER_MSVC
+
+bool Sse2Available() {
+	static const auto available = [] {
+#ifdef COMPILER_MSVC
+		int data[4] = { 0 };
+		__cpuid(data, 1);
+		return (data[3] & (1 << 26)) != 0;
+#else // COMPILER_MSVC
+		unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+			return false;
+		}
+		return (edx & (1U << 26)) != 0;
+#endif // COMPILER_MSVC
+	}();
+	return available;
+}
+
+bool Avx2Available() {
+	static const auto available = [] {
+		// Needs the CPU feature and OS support for the ymm state.
+#ifdef COMPILER_MSVC
+		int data[4] = { 0 };
+		__cpuid(data, 1);
+		if (!(data[2] & (1 << 27))) { // OSXSAVE
+			return false;
+		}
+		__cpuidex(data, 7, 0);
+		if (!(data[1] & (1 << 5))) {
+			return false;
+		}
+		return (_xgetbv(0) & 0x6) == 0x6;
+#else // COMPILER_MSVC
+		unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+			|| !(ecx & (1U << 27))) { // OSXSAVE
+			return false;
+		}
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		if (!(ebx & (1U << 5))) {
+			return false;
+		}
+		unsigned int xeax = 0, xedx = 0;
+		__asm__ ("xgetbv" : "=a" (xeax), "=d" (xedx) : "c" (0));
+		return (xeax & 0x6) == 0x6;
+#endif // COMPILER_MSVC
+	}();
+	return available;
+}
+
+// The blur state is packed 16 bit color lanes inside uint64 values, and
+// all the passes only add and subtract whole uint64 values, so the exact
+// same arithmetic runs on several columns at once with per-qword vector
+// additions. Multiplications by the small window coefficients become
+// repeated additions, executed once per column group.
+
+SSE2_TARGET inline __m128i BlurMultiplySmall(__m128i value, int by) {
+	auto result = _mm_setzero_si128();
+	while (by-- > 0) {
+		result = _mm_add_epi64(result, value);
+	}
+	return result;
+}
+
+SSE2_TARGET void BlurColumnsSse2(uchar *pix, const uint64 *rgb, int w, int h, int he, int stride, int &xFrom) {
+	const int radius = 3;
+	const int r1 = radius + 1;
+	const auto mask = _mm_set1_epi16(0x00FF);
+	int x = xFrom;
+	for (; x + 2 <= w; x += 2) {
+		auto cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + x));
+		auto rgballsum = _mm_sub_epi64(_mm_setzero_si128(), BlurMultiplySmall(cur, radius));
+		auto rgbsum = BlurMultiplySmall(cur, (r1 * (r1 + 1)) >> 1);
+		for (int i = 1; i <= radius; ++i) {
+			cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * w + x));
+			rgbsum = _mm_add_epi64(rgbsum, BlurMultiplySmall(cur, r1 - i));
+			rgballsum = _mm_add_epi64(rgballsum, cur);
+		}
+
+		int y = 0;
+		int yi = x * 4;
+
+#define load_rgb(row) _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (row) * w + x))
+#define update(start, middle, end) \
+auto res = _mm_and_si128(_mm_srli_epi64(rgbsum, 4), mask); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(pix + yi), _mm_packus_epi16(res, res)); \
+rgballsum = _mm_add_epi64(rgballsum, _mm_sub_epi64(_mm_add_epi64(load_rgb(start), load_rgb(end)), _mm_add_epi64(load_rgb(middle), load_rgb(middle)))); \
+rgbsum = _mm_add_epi64(rgbsum, rgballsum); \
+y++; \
+yi += stride;
+
+		while (y < r1) {
+			update(0, y, y + r1);
+		}
+		while (y < he) {
+			update(y - r1, y, y + r1);
+		}
+		while (y < h) {
+			update(y - r1, y, h - 1);
+		}
+
+#undef update
+#undef load_rgb
+	}
+	xFrom = x;
+}
+
+AVX2_TARGET inline __m256i BlurMultiplySmall(__m256i value, int by) {
+	auto result = _mm256_setzero_si256();
+	while (by-- > 0) {
+		result = _mm256_add_epi64(result, value);
+	}
+	return result;
+}
+
+AVX2_TARGET void BlurColumnsAvx2(uchar *pix, const uint64 *rgb, int w, int h, int he, int stride, int &xFrom) {
+	const int radius = 3;
+	const int r1 = radius + 1;
+	const auto mask = _mm256_set1_epi16(0x00FF);
+	int x = xFrom;
+	for (; x + 4 <= w; x += 4) {
+		auto cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + x));
+		auto rgballsum = _mm256_sub_epi64(_mm256_setzero_si256(), BlurMultiplySmall(cur, radius));
+		auto rgbsum = BlurMultiplySmall(cur, (r1 * (r1 + 1)) >> 1);
+		for (int i = 1; i <= radius; ++i) {
+			cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + i * w + x));
+			rgbsum = _mm256_add_epi64(rgbsum, BlurMultiplySmall(cur, r1 - i));
+			rgballsum = _mm256_add_epi64(rgballsum, cur);
+		}
+
+		int y = 0;
+		int yi = x * 4;
+
+#define load_rgb(row) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + (row) * w + x))
+#define update(start, middle, end) \
+auto res = _mm256_and_si256(_mm256_srli_epi64(rgbsum, 4), mask); \
+auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(res, res), 0x08); \
+_mm_storeu_si128(reinterpret_cast<__m128i*>(pix + yi), _mm256_castsi256_si128(packed)); \
+rgballsum = _mm256_add_epi64(rgballsum, _mm256_sub_epi64(_mm256_add_epi64(load_rgb(start), load_rgb(end)), _mm256_add_epi64(load_rgb(middle), load_rgb(middle)))); \
+rgbsum = _mm256_add_epi64(rgbsum, rgballsum); \
+y++; \
+yi += stride;
+
+		while (y < r1) {
+			update(0, y, y + r1);
+		}
+		while (y < he) {
+			update(y - r1, y, y + r1);
+		}
+		while (y < h) {
+			update(y - r1, y, h - 1);
+		}
+
+#undef update
+#undef load_rgb
+	}
+	xFrom = x;
+}
+
+// Rounding multiplies every pixel channel by the corner mask opacity,
+// (c * (a + 1)) >> 8 in 16 bit lanes, which maps directly onto
+// _mm_mullo_epi16, four pixels per step.
+SSE2_TARGET void RoundCornerRowSse2(uint32 *imageInts, const uchar *maskBytes, int maskBytesPerPixel, int width, int &xFrom) {
+	const auto zero = _mm_setzero_si128();
+	auto x = 0;
+	for (; x + 4 <= width; x += 4) {
+		const auto a0 = short(maskBytes[(x + 0) * maskBytesPerPixel] + 1);
+		const auto a1 = short(maskBytes[(x + 1) * maskBytesPerPixel] + 1);
+		const auto a2 = short(maskBytes[(x + 2) * maskBytesPerPixel] + 1);
+		const auto a3 = short(maskBytes[(x + 3) * maskBytesPerPixel] + 1);
+		const auto mullo = _mm_set_epi16(a1, a1, a1, a1, a0, a0, a0, a0);
+		const auto mulhi = _mm_set_epi16(a3, a3, a3, a3, a2, a2, a2, a2);
+		const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(imageInts + x));
+		const auto lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), mullo), 8);
+		const auto hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), mulhi), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(imageInts + x), _mm_packus_epi16(lo, hi));
+	}
+	xFrom = x;
+}
+
+#endif // ARCH_CPU_X86_FAMILY
+
 const QPixmap &circleMask(int width, int height) {
 	Assert(Global::started());
 
@@ -133,7 +334,15 @@ x++;
 			}
 
 			const int he = h - r1;
-			for (x = 0; x < w; x++) {
+			x = 0;
+#ifdef ARCH_CPU_X86_FAMILY
+			if (Avx2Available()) {
+				BlurColumnsAvx2(pix, rgb, w, h, he, stride, x);
+			} else if (Sse2Available()) {
+				BlurColumnsSse2(pix, rgb, w, h, he, stride, x);
+			}
+#endif // ARCH_CPU_X86_FAMILY
+			for (; x < w; x++) {
 				uint64 rgballsum = -radius * rgb[x];
 				uint64 rgbsum = rgb[x] * ((r1 * (r1 + 1)) >> 1);
 				for (i = 1; i <= radius; i++) {
@@ -214,26 +423,31 @@ void prepareRound(
 	auto intsTopRight = ints + target.x() + target.width() - cornerWidth + target.y() * imageWidth;
 	auto intsBottomLeft = ints + target.x() + (target.y() + target.height() - cornerHeight) * imageWidth;
 	auto intsBottomRight = ints + target.x() + target.width() - cornerWidth + (target.y() + target.height() - cornerHeight) * imageWidth;
+#ifdef ARCH_CPU_X86_FAMILY
+	const auto sse2 = Sse2Available();
+#endif // ARCH_CPU_X86_FAMILY
 	auto maskCorner = [&](uint32 *imageInts, const QImage &mask) {
 		auto maskWidth = mask.width();
 		auto maskHeight = mask.height();
 		auto maskBytesPerPixel = (mask.depth() >> 3);
 		auto maskBytesPerLine = mask.bytesPerLine();
-		auto maskBytesAdded = maskBytesPerLine - maskWidth * maskBytesPerPixel;
 		auto maskBytes = mask.constBits();
-		Assert(maskBytesAdded >= 0);
+		Assert(maskBytesPerLine - maskWidth * maskBytesPerPixel >= 0);
 		Assert(mask.depth() == (maskBytesPerPixel << 3));
-		auto imageIntsAdded = imageIntsPerLine - maskWidth * imageIntsPerPixel;
-		Assert(imageIntsAdded >= 0);
+		Assert(imageIntsPerLine - maskWidth * imageIntsPerPixel >= 0);
 		for (auto y = 0; y != maskHeight; ++y) {
-			for (auto x = 0; x != maskWidth; ++x) {
-				auto opacity = static_cast<anim::ShiftedMultiplier>(*maskBytes) + 1;
-				*imageInts = anim::unshifted(anim::shifted(*imageInts) * opacity);
-				maskBytes += maskBytesPerPixel;
-				imageInts += imageIntsPerPixel;
+			auto x = 0;
+#ifdef ARCH_CPU_X86_FAMILY
+			if (sse2) {
+				RoundCornerRowSse2(imageInts, maskBytes, maskBytesPerPixel, maskWidth, x);
 			}
-			maskBytes += maskBytesAdded;
-			imageInts += imageIntsAdded;
+#endif // ARCH_CPU_X86_FAMILY
+			for (; x != maskWidth; ++x) {
+				auto opacity = static_cast<anim::ShiftedMultiplier>(maskBytes[x * maskBytesPerPixel]) + 1;
+				imageInts[x] = anim::unshifted(anim::shifted(imageInts[x]) * opacity);
+			}
+			maskBytes += maskBytesPerLine;
+			imageInts += imageIntsPerLine;
 		}
 	};
 	if (corners & RectPart::TopLeft) maskCorner(intsTopLeft, cornerMasks[0]);
@@ -362,6 +576,84 @@ QImage prepare(QImage img, int w, int h, Images::Options options, int outerw, in
 	return img;
 }
 
+namespace {
+
+constexpr auto kAsyncDecodeStopTimeout = TimeMs(3000);
+
+// Decodes the compressed bytes of an image on the worker thread of a
+// TaskQueue and hands the result back on the main one.
+class DecodeTask : public Task {
+public:
+	DecodeTask(
+		const QByteArray &bytes,
+		const QByteArray &format,
+		base::lambda<void(QImage&&)> done)
+	: _bytes(bytes)
+	, _format(format)
+	, _done(std::move(done)) {
+	}
+
+	void process() override {
+		QBuffer buffer(&_bytes);
+		QImageReader reader(&buffer, _format);
+#ifndef OS_MAC_OLD
+		reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+		_image = reader.read();
+	}
+	void finish() override {
+		_done(std::move(_image));
+	}
+
+private:
+	QByteArray _bytes, _format;
+	QImage _image;
+	base::lambda<void(QImage&&)> _done;
+
+};
+
+} // namespace
+
+AsyncDecoder::AsyncDecoder() = default;
+
+AsyncDecoder::~AsyncDecoder() = default;
+
+bool AsyncDecoder::ready(const ImagePtr &image, base::lambda<void()> callback) {
+	if (image->decodedBytes() > 0) {
+		return true;
+	}
+	const auto bytes = image->savedData();
+	if (bytes.isEmpty()) {
+		// There are no compressed bytes to decode on a worker, let
+		// the paint do whatever it normally does.
+		return true;
+	}
+	const auto raw = image.v();
+	if (!_scheduled.contains(raw)) {
+		_scheduled.insert(raw);
+		if (!_queue) {
+			_queue = std::make_unique<TaskQueue>(kAsyncDecodeStopTimeout);
+		}
+		// Images are never deleted while the app is running, so the
+		// raw pointer is safe to hold in the callback.
+		_queue->addTask(std::make_unique<DecodeTask>(
+			bytes,
+			image->savedFormat(),
+			[=, callback = std::move(callback)](QImage &&result) {
+				if (result.isNull()) {
+					// Couldn't decode the bytes, keep the image in
+					// the scheduled set so that it isn't re-queued
+					// on every paint.
+					return;
+				}
+				_scheduled.remove(raw);
+				raw->setDecodedImage(std::move(result));
+				callback();
+			}));
+	}
+	return false;
+}
+
 } // namespace Images
 
 namespace {
@@ -392,12 +684,30 @@ WebFileImages webFileImages;
 
 int64 globalAcquiredSize = 0;
 
+// Hard cap for decoded image memory. Most recently used images first.
+constexpr auto kMemoryForImageCache = int64(256) * 1024 * 1024;
+Image *LruFront = nullptr;
+Image *LruBack = nullptr;
+
+// Bumped when the image caches are cleared, so that asynchronous decode
+// results landing after that don't touch destroyed images.
+auto ImagesGeneration = 0;
+
+// Images smaller than this are decoded synchronously: the decode is fast
+// and going through a worker would delay thumbnails by a frame.
+constexpr auto kDecodeOffThreadFrom = 512 * 1024;
+
 uint64 PixKey(int width, int height, Images::Options options) {
 	return static_cast<uint64>(width) | (static_cast<uint64>(height) << 24) | (static_cast<uint64>(options) << 48);
 }
 
-uint64 SinglePixKey(Images::Options options) {
-	return PixKey(0, 0, options);
+// Renders that fit the image into an outer frame are cached per size as
+// well, so one userpic shown in the dialogs list, the top bar and the
+// members list at different sizes keeps all three pixmaps instead of
+// re-rendering on every draw. The high bit keeps these keys apart from
+// the plain PixKey renders of the same dimensions.
+uint64 SinglePixKey(int outerw, int outerh, Images::Options options) {
+	return PixKey(outerw, outerh, options) | (uint64(1) << 63);
 }
 
 } // namespace
@@ -421,6 +731,7 @@ Image::Image(const QString &file, QByteArray fmt) : _forgot(false) {
 	_format = fmt;
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
 	}
 }
 
@@ -430,12 +741,14 @@ Image::Image(const QByteArray &filecontent, QByteArray fmt) : _forgot(false) {
 	_saved = filecontent;
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
 	}
 }
 
 Image::Image(const QPixmap &pixmap, QByteArray format) : _format(format), _forgot(false), _data(pixmap) {
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
 	}
 }
 
@@ -445,11 +758,13 @@ Image::Image(const QByteArray &filecontent, QByteArray fmt, const QPixmap &pixma
 	_saved = filecontent;
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
 	}
 }
 
 const QPixmap &Image::pix(int32 w, int32 h) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
         w = width();
@@ -473,6 +788,7 @@ const QPixmap &Image::pix(int32 w, int32 h) const {
 
 const QPixmap &Image::pixRounded(int32 w, int32 h, ImageRoundRadius radius, RectParts corners) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width();
@@ -509,6 +825,7 @@ const QPixmap &Image::pixRounded(int32 w, int32 h, ImageRoundRadius radius, Rect
 
 const QPixmap &Image::pixCircled(int32 w, int32 h) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width();
@@ -532,6 +849,7 @@ const QPixmap &Image::pixCircled(int32 w, int32 h) const {
 
 const QPixmap &Image::pixBlurredCircled(int32 w, int32 h) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width();
@@ -555,6 +873,7 @@ const QPixmap &Image::pixBlurredCircled(int32 w, int32 h) const {
 
 const QPixmap &Image::pixBlurred(int32 w, int32 h) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width() * cIntRetinaFactor();
@@ -578,6 +897,7 @@ const QPixmap &Image::pixBlurred(int32 w, int32 h) const {
 
 const QPixmap &Image::pixColored(style::color add, int32 w, int32 h) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width() * cIntRetinaFactor();
@@ -601,6 +921,7 @@ const QPixmap &Image::pixColored(style::color add, int32 w, int32 h) const {
 
 const QPixmap &Image::pixBlurredColored(style::color add, int32 w, int32 h) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width() * cIntRetinaFactor();
@@ -624,6 +945,7 @@ const QPixmap &Image::pixBlurredColored(style::color add, int32 w, int32 h) cons
 
 const QPixmap &Image::pixSingle(int32 w, int32 h, int32 outerw, int32 outerh, ImageRoundRadius radius, RectParts corners, const style::color *colored) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width() * cIntRetinaFactor();
@@ -650,7 +972,7 @@ const QPixmap &Image::pixSingle(int32 w, int32 h, int32 outerw, int32 outerh, Im
 		options |= Images::Option::Colored;
 	}
 
-	auto k = SinglePixKey(options);
+	auto k = SinglePixKey(outerw * cIntRetinaFactor(), outerh * cIntRetinaFactor(), options);
 	auto i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
 		if (i != _sizesCache.cend()) {
@@ -668,6 +990,7 @@ const QPixmap &Image::pixSingle(int32 w, int32 h, int32 outerw, int32 outerh, Im
 
 const QPixmap &Image::pixBlurredSingle(int w, int h, int32 outerw, int32 outerh, ImageRoundRadius radius, RectParts corners) const {
 	checkload();
+	touchInLru();
 
 	if (w <= 0 || !width() || !height()) {
 		w = width() * cIntRetinaFactor();
@@ -691,7 +1014,7 @@ const QPixmap &Image::pixBlurredSingle(int w, int h, int32 outerw, int32 outerh,
 		options |= Images::Option::Circled | cornerOptions(corners);
 	}
 
-	auto k = SinglePixKey(options);
+	auto k = SinglePixKey(outerw * cIntRetinaFactor(), outerh * cIntRetinaFactor(), options);
 	auto i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
 		if (i != _sizesCache.cend()) {
@@ -796,6 +1119,7 @@ void Image::forget() const {
 
 	if (_data.isNull()) return;
 
+	removeFromLru();
 	invalidateSizeCache();
 	/*if (hasLocalCopy()) {
 		_saved.clear();
@@ -826,10 +1150,94 @@ void Image::restore() const {
 
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
+	}
+	_forgot = false;
+}
+
+void Image::setDecodedImage(QImage &&image) const {
+	if (!_data.isNull() || image.isNull()) {
+		// Someone has decoded it synchronously meanwhile (or the
+		// worker failed), keep what is here already.
+		return;
+	}
+	_data = App::pixmapFromImageInPlace(std::move(image));
+	if (!_data.isNull()) {
+		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
 	}
 	_forgot = false;
 }
 
+void Image::touchInLru() const {
+	const auto that = const_cast<Image*>(this);
+	if (LruFront != that) {
+		removeFromLru();
+		_lruNext = LruFront;
+		if (LruFront) {
+			LruFront->_lruPrev = that;
+		}
+		LruFront = that;
+		if (!LruBack) {
+			LruBack = that;
+		}
+		_inLru = true;
+	}
+	if (globalAcquiredSize <= kMemoryForImageCache) {
+		return;
+	}
+	auto image = LruBack;
+	while (image && globalAcquiredSize > kMemoryForImageCache) {
+		const auto prev = image->_lruPrev;
+		if (image != that) {
+			if (!image->_saved.isEmpty()) {
+				image->forget();
+			} else {
+				// Forgetting would have to re-encode the pixmap, skip
+				// it and stop tracking until it is used again.
+				image->removeFromLru();
+			}
+		}
+		image = prev;
+	}
+}
+
+void Image::removeFromLru() const {
+	if (!_inLru) return;
+
+	const auto that = const_cast<Image*>(this);
+	if (_lruPrev) {
+		_lruPrev->_lruNext = _lruNext;
+	}
+	if (_lruNext) {
+		_lruNext->_lruPrev = _lruPrev;
+	}
+	if (LruFront == that) {
+		LruFront = _lruNext;
+	}
+	if (LruBack == that) {
+		LruBack = _lruPrev;
+	}
+	_lruPrev = _lruNext = nullptr;
+	_inLru = false;
+}
+
+int64 Image::decodedBytes() const {
+	return _data.isNull() ? 0 : int64(_data.width()) * _data.height() * 4;
+}
+
+int64 Image::compressedBytes() const {
+	return int64(_saved.size());
+}
+
+int64 Image::scaledCacheBytes() const {
+	auto result = int64(0);
+	for (const auto &pix : _sizesCache) {
+		result += int64(pix.width()) * pix.height() * 4;
+	}
+	return result;
+}
+
 void Image::invalidateSizeCache() const {
 	for (auto &pix : _sizesCache) {
 		if (!pix.isNull()) {
@@ -840,6 +1248,7 @@ void Image::invalidateSizeCache() const {
 }
 
 Image::~Image() {
+	removeFromLru();
 	invalidateSizeCache();
 	if (!_data.isNull()) {
 		globalAcquiredSize -= int64(_data.width()) * _data.height() * 4;
@@ -847,6 +1256,7 @@ Image::~Image() {
 }
 
 void clearStorageImages() {
+	++ImagesGeneration;
 	for (auto image : base::take(storageImages)) {
 		delete image;
 	}
@@ -869,11 +1279,104 @@ int64 imageCacheSize() {
 	return globalAcquiredSize;
 }
 
+QString imageCacheReport() {
+	auto lines = QStringList();
+	const auto row = [&lines](const QString &name, const auto &map) {
+		auto count = 0;
+		auto decoded = int64(0);
+		auto compressed = int64(0);
+		auto scaled = int64(0);
+		for (const auto image : map) {
+			++count;
+			decoded += image->decodedBytes();
+			compressed += image->compressedBytes();
+			scaled += image->scaledCacheBytes();
+		}
+		lines.push_back(QString("%1: %2 images, decoded %3 KB, compressed %4 KB, scaled renders %5 KB"
+			).arg(name
+			).arg(count
+			).arg(decoded / 1024
+			).arg(compressed / 1024
+			).arg(scaled / 1024));
+	};
+	row(qsl("storage (userpics, thumbs, stickers)"), storageImages);
+	row(qsl("web previews"), webImages);
+	row(qsl("web files"), webFileImages);
+	row(qsl("local files"), localImages);
+	lines.push_back(QString("acquired total: %1 KB of %2 KB budget"
+		).arg(globalAcquiredSize / 1024
+		).arg(kMemoryForImageCache / 1024));
+	return lines.join('\n');
+}
+
 void RemoteImage::doCheckload() const {
-	if (!amLoading() || !_loader->finished()) return;
+	if (_decoding || !amLoading() || !_loader->finished()) return;
+
+	if (_loader->bytes().size() < kDecodeOffThreadFrom) {
+		QPixmap data = _loader->imagePixmap(shrinkBox());
+		if (data.isNull()) {
+			destroyLoaderDelayed(CancelledFileLoader);
+			return;
+		}
+
+		if (!_data.isNull()) {
+			globalAcquiredSize -= int64(_data.width()) * _data.height() * 4;
+		}
+
+		_format = _loader->imageFormat(shrinkBox());
+		_data = data;
+		_saved = _loader->bytes();
+		const_cast<RemoteImage*>(this)->setInformation(_saved.size(), _data.width(), _data.height());
+		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+		touchInLru();
 
-	QPixmap data = _loader->imagePixmap(shrinkBox());
-	if (data.isNull()) {
+		invalidateSizeCache();
+
+		destroyLoaderDelayed();
+
+		_forgot = false;
+		return;
+	}
+
+	// A multi-megapixel photo takes hundreds of milliseconds to
+	// decompress and would freeze the interface if decoded here in
+	// the paint cycle, so hand it to a worker.
+	_decoding = true;
+	auto bytes = _loader->bytes();
+	const auto box = shrinkBox();
+	const auto generation = ImagesGeneration;
+	crl::async([this, bytes, box, generation] {
+		auto format = QByteArray();
+		auto image = App::readImage(bytes, &format, false);
+		if (!image.isNull()
+			&& !box.isEmpty()
+			&& (image.width() > box.width()
+				|| image.height() > box.height())) {
+			image = image.scaled(
+				box,
+				Qt::KeepAspectRatio,
+				Qt::SmoothTransformation);
+		}
+		InvokeQueued(QCoreApplication::instance(), [
+			this,
+			image = std::move(image),
+			format,
+			generation
+		]() mutable {
+			if (generation == ImagesGeneration) {
+				decodeDone(std::move(image), format);
+			}
+		});
+	});
+}
+
+void RemoteImage::decodeDone(QImage &&image, const QByteArray &format) const {
+	_decoding = false;
+	if (!amLoading() || !_loader->finished()) {
+		// Cancelled or restarted while the decode was in flight.
+		return;
+	}
+	if (image.isNull()) {
 		destroyLoaderDelayed(CancelledFileLoader);
 		return;
 	}
@@ -882,17 +1385,23 @@ void RemoteImage::doCheckload() const {
 		globalAcquiredSize -= int64(_data.width()) * _data.height() * 4;
 	}
 
-	_format = _loader->imageFormat(shrinkBox());
-	_data = data;
+	_format = format;
+	_data = App::pixmapFromImageInPlace(std::move(image));
 	_saved = _loader->bytes();
 	const_cast<RemoteImage*>(this)->setInformation(_saved.size(), _data.width(), _data.height());
 	globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
+	touchInLru();
 
 	invalidateSizeCache();
 
 	destroyLoaderDelayed();
 
 	_forgot = false;
+
+	// Whoever was waiting on loaded() needs a repaint now.
+	if (AuthSession::Exists()) {
+		Auth().downloader().taskFinished().notify();
+	}
 }
 
 void RemoteImage::destroyLoaderDelayed(FileLoader *newValue) const {
@@ -919,6 +1428,7 @@ void RemoteImage::setData(QByteArray &bytes, const QByteArray &bytesFormat) {
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
 		setInformation(bytes.size(), _data.width(), _data.height());
+		touchInLru();
 	}
 
 	invalidateSizeCache();
@@ -966,10 +1476,32 @@ void RemoteImage::load(bool loadFirst, bool prior) {
 		_loader = createLoader(LoadFromCloudOrLocal, false);
 	}
 	if (amLoading()) {
+		// Explicit loads come from the visible viewport.
+		_loader->setLoadPriority(LoadPriority::Viewport);
 		_loader->start(loadFirst, prior);
 	}
 }
 
+void RemoteImage::prefetch() {
+	if (loaded()) return;
+
+	if (!_loader) {
+		_loader = createLoader(LoadFromCloudOrLocal, false);
+	}
+	if (amLoading()) {
+		_loader->setLoadPriority(LoadPriority::Prefetch);
+		_loader->start();
+	}
+}
+
+QByteArray RemoteImage::partialBytes() const {
+	if (!amLoading() || _loader->finished()) {
+		return QByteArray();
+	}
+	const auto till = _loader->contiguousSize();
+	return (till > 0) ? _loader->bytes().left(till) : QByteArray();
+}
+
 void RemoteImage::loadEvenCancelled(bool loadFirst, bool prior) {
 	if (_loader == CancelledFileLoader) _loader = 0;
 	return load(loadFirst, prior);
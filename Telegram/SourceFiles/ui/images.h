@@ -281,6 +281,16 @@ public:
 	virtual void loadEvenCancelled(bool loadFirst = false, bool prior = true) {
 	}
 
+	// Start loading at prefetch priority, without jumping the queue.
+	virtual void prefetch() {
+	}
+
+	// The gap-free head of the file while it is still being loaded,
+	// for incremental decode previews. Empty when not loading.
+	virtual QByteArray partialBytes() const {
+		return QByteArray();
+	}
+
 	virtual const StorageImageLocation &location() const {
 		return StorageImageLocation::Null;
 	}
@@ -289,6 +299,11 @@ public:
 
 	void forget() const;
 
+	// Memory held by this image right now, without restoring anything.
+	int64 decodedBytes() const;
+	int64 compressedBytes() const;
+	int64 scaledCacheBytes() const;
+
 	QByteArray savedFormat() const {
 		return _format;
 	}
@@ -296,6 +311,10 @@ public:
 		return _saved;
 	}
 
+	// Accept an image decoded from savedData() on a worker thread, so
+	// that the first paint doesn't have to decode on the UI thread.
+	void setDecodedImage(QImage &&image) const;
+
 	virtual DelayedStorageImage *toDelayedStorageImage() {
 		return 0;
 	}
@@ -314,6 +333,13 @@ protected:
 	}
 	void invalidateSizeCache() const;
 
+	// Memory budget for decoded images: every image holding a pixmap
+	// sits in a global least-recently-used list and the oldest ones
+	// get forgotten (dropping pixmaps, keeping the compressed bytes)
+	// when the budget is exceeded.
+	void touchInLru() const;
+	void removeFromLru() const;
+
 	virtual int32 countWidth() const {
 		restore();
 		return _data.width();
@@ -336,6 +362,10 @@ private:
 	using Sizes = QMap<uint64, QPixmap>;
 	mutable Sizes _sizesCache;
 
+	mutable Image *_lruPrev = nullptr;
+	mutable Image *_lruNext = nullptr;
+	mutable bool _inLru = false;
+
 };
 
 typedef QPair<uint64, uint64> StorageKey;
@@ -378,6 +408,8 @@ public:
 
 	void load(bool loadFirst = false, bool prior = true);
 	void loadEvenCancelled(bool loadFirst = false, bool prior = true);
+	void prefetch() override;
+	QByteArray partialBytes() const override;
 
 	~RemoteImage();
 
@@ -397,8 +429,10 @@ protected:
 
 private:
 	mutable FileLoader *_loader = nullptr;
+	mutable bool _decoding = false;
 	bool amLoading() const;
 	void doCheckload() const;
+	void decodeDone(QImage &&image, const QByteArray &format) const;
 
 	void destroyLoaderDelayed(FileLoader *newValue = nullptr) const;
 
@@ -598,6 +632,36 @@ void clearStorageImages();
 void clearAllImages();
 int64 imageCacheSize();
 
+// Multi-line description of what the image cache is holding, for the
+// "imagestats" debug code in Settings.
+QString imageCacheReport();
+
+class TaskQueue;
+
+namespace Images {
+
+// Decodes the compressed bytes of images on a TaskQueue worker, so
+// that the first paint of a grid of previews doesn't stall the UI
+// thread decoding them one by one.
+class AsyncDecoder {
+public:
+	AsyncDecoder();
+	~AsyncDecoder();
+
+	// Returns true if painting the image won't require a decode. If
+	// only the compressed bytes are in memory it schedules a worker
+	// decode, returns false and invokes the callback on the main
+	// thread once the image is ready to paint.
+	bool ready(const ImagePtr &image, base::lambda<void()> callback);
+
+private:
+	std::unique_ptr<TaskQueue> _queue;
+	QSet<const Image*> _scheduled;
+
+};
+
+} // namespace Images
+
 class PsFileBookmark;
 class ReadAccessEnabler {
 public:
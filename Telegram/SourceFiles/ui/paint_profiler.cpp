@@ -0,0 +1,186 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/paint_profiler.h"
+
+#include "base/timer.h"
+#include "platform/platform_specific.h"
+
+namespace Ui {
+namespace PaintProfiler {
+namespace {
+
+constexpr auto kOverlayRefreshInterval = TimeMs(1000);
+constexpr auto kOverlayRowLimit = 10;
+constexpr auto kOverlayWidth = 420;
+constexpr auto kOverlayPadding = 6;
+
+// Histogram bucket upper bounds, in milliseconds. The last bucket is
+// everything above, those are the paints that blow the frame budget.
+constexpr qint64 kBucketBounds[] = { 1, 4, 16 };
+constexpr auto kBucketCount = int(base::array_size(kBucketBounds)) + 1;
+
+struct Entry {
+	int count = 0;
+	qint64 totalNs = 0;
+	qint64 maxNs = 0;
+	int buckets[kBucketCount] = { 0 };
+};
+using Stats = QMap<QByteArray, Entry>;
+
+bool ProfilerEnabled = false;
+
+// Cleared on every overlay refresh, feeds the "last second" rows.
+NeverFreedPointer<Stats> IntervalStats;
+
+// Accumulated while the profiler is enabled, dumped to the log on disable.
+NeverFreedPointer<Stats> TotalStats;
+
+class Overlay : public TWidget {
+public:
+	Overlay();
+
+protected:
+	void paintEvent(QPaintEvent *e) override;
+
+private:
+	void refresh();
+
+	QStringList _rows;
+	base::Timer _refreshTimer;
+
+};
+
+QPointer<Overlay> OverlayInstance;
+
+Overlay::Overlay() : TWidget(nullptr) {
+	setWindowFlags(Qt::WindowFlags(Qt::FramelessWindowHint) | Qt::WindowStaysOnTopHint | Qt::BypassWindowManagerHint | Qt::NoDropShadowWindowHint | Qt::Tool);
+	setAttribute(Qt::WA_MacAlwaysShowToolWindow);
+	setAttribute(Qt::WA_ShowWithoutActivating);
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	setAttribute(Qt::WA_TranslucentBackground);
+
+	_refreshTimer.setCallback([this] { refresh(); });
+	_refreshTimer.callEach(kOverlayRefreshInterval);
+	refresh();
+}
+
+void Overlay::refresh() {
+	_rows.clear();
+	if (IntervalStats) {
+		auto ordered = std::vector<std::pair<QByteArray, Entry>>();
+		ordered.reserve(IntervalStats->size());
+		for (auto i = IntervalStats->cbegin(); i != IntervalStats->cend(); ++i) {
+			ordered.push_back({ i.key(), i.value() });
+		}
+		std::sort(ordered.begin(), ordered.end(), [](auto &a, auto &b) {
+			return a.second.totalNs > b.second.totalNs;
+		});
+		if (ordered.size() > kOverlayRowLimit) {
+			ordered.resize(kOverlayRowLimit);
+		}
+		for_const (auto &row, ordered) {
+			_rows.push_back(qsl("%1 x%2 %3ms (max %4ms)"
+			).arg(QString::fromLatin1(row.first)
+			).arg(row.second.count
+			).arg(row.second.totalNs / 1000000., 0, 'f', 1
+			).arg(row.second.maxNs / 1000000., 0, 'f', 1));
+		}
+		IntervalStats->clear();
+	}
+
+	auto desktop = psDesktopRect();
+	auto height = 2 * kOverlayPadding + qMax(_rows.size(), 1) * st::normalFont->height;
+	setGeometry(desktop.x(), desktop.y(), kOverlayWidth, height);
+	update();
+}
+
+void Overlay::paintEvent(QPaintEvent *e) {
+	Painter p(this);
+	p.fillRect(rect(), QColor(0, 0, 0, 176));
+	p.setFont(st::normalFont);
+	p.setPen(QColor(255, 255, 255));
+	auto top = kOverlayPadding;
+	if (_rows.isEmpty()) {
+		p.drawText(kOverlayPadding, top + st::normalFont->ascent, qsl("paint profiler: no paints"));
+	} else {
+		for_const (auto &row, _rows) {
+			p.drawText(kOverlayPadding, top + st::normalFont->ascent, row);
+			top += st::normalFont->height;
+		}
+	}
+}
+
+void feedEntry(Entry &entry, qint64 elapsedNs) {
+	++entry.count;
+	entry.totalNs += elapsedNs;
+	accumulate_max(entry.maxNs, elapsedNs);
+	auto bucket = 0;
+	while (bucket != kBucketCount - 1
+		&& elapsedNs >= kBucketBounds[bucket] * 1000000) {
+		++bucket;
+	}
+	++entry.buckets[bucket];
+}
+
+void dumpTotals() {
+	if (!TotalStats) {
+		return;
+	}
+	for (auto i = TotalStats->cbegin(); i != TotalStats->cend(); ++i) {
+		auto &entry = i.value();
+		LOG(("Paint Profiler: %1: %2 paints, %3ms total, %4ms max, buckets (<1ms / <4ms / <16ms / slower): %5 / %6 / %7 / %8"
+			).arg(QString::fromLatin1(i.key())
+			).arg(entry.count
+			).arg(entry.totalNs / 1000000., 0, 'f', 1
+			).arg(entry.maxNs / 1000000., 0, 'f', 1
+			).arg(entry.buckets[0]
+			).arg(entry.buckets[1]
+			).arg(entry.buckets[2]
+			).arg(entry.buckets[3]));
+	}
+}
+
+} // namespace
+
+bool Enabled() {
+	return ProfilerEnabled;
+}
+
+void Toggle() {
+	ProfilerEnabled = !ProfilerEnabled;
+	if (ProfilerEnabled) {
+		IntervalStats.createIfNull();
+		TotalStats.createIfNull();
+		IntervalStats->clear();
+		TotalStats->clear();
+		Assert(OverlayInstance == nullptr);
+		OverlayInstance = new Overlay();
+		OverlayInstance->show();
+	} else {
+		dumpTotals();
+		IntervalStats.clear();
+		TotalStats.clear();
+		delete OverlayInstance.data();
+	}
+}
+
+void RegisterPaint(
+		const QObject *receiver,
+		const QByteArray &className,
+		qint64 elapsedNs) {
+	if (!ProfilerEnabled
+		|| !IntervalStats
+		|| receiver == OverlayInstance.data()) {
+		return;
+	}
+	feedEntry((*IntervalStats)[className], elapsedNs);
+	feedEntry((*TotalStats)[className], elapsedNs);
+}
+
+} // namespace PaintProfiler
+} // namespace Ui
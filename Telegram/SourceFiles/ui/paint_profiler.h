@@ -0,0 +1,29 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Ui {
+namespace PaintProfiler {
+
+// Runtime paint timing instrumentation, toggled by the "paintprofile"
+// settings code. While enabled every widget paint event is timed in
+// Application::notify() and aggregated by widget class, with a small
+// always-on-top overlay showing the worst offenders of the last second.
+// On disable the collected per-class histograms are dumped to the log.
+bool Enabled();
+void Toggle();
+
+// Feeds one timed paint. The receiver pointer is only compared, never
+// dereferenced - the widget could have been destroyed while painting.
+void RegisterPaint(
+	const QObject *receiver,
+	const QByteArray &className,
+	qint64 elapsedNs);
+
+} // namespace PaintProfiler
+} // namespace Ui
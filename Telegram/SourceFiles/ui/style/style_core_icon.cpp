@@ -15,6 +15,8 @@ uint32 colorKey(QColor c) {
 	return (((((uint32(c.red()) << 8) | uint32(c.green())) << 8) | uint32(c.blue())) << 8) | uint32(c.alpha());
 }
 
+constexpr auto kMaxCachedIconPixmaps = 4096;
+
 using IconMasks = QMap<const IconMask*, QImage>;
 using IconPixmaps = QMap<QPair<const IconMask*, uint32>, QPixmap>;
 using IconDatas = OrderedSet<IconData*>;
@@ -341,7 +343,14 @@ int IconData::height() const {
 }
 
 void resetIcons() {
-	iconPixmaps.clear();
+	// Keep the (mask, color) -> pixmap cache across a palette change:
+	// icons whose colors were not touched by the new palette rebind to
+	// their existing pixmaps by key instead of being colorized again,
+	// and toggling between two themes reuses both generations. Only
+	// prune the cache if many different palettes were applied in a row.
+	if (iconPixmaps && iconPixmaps->size() > kMaxCachedIconPixmaps) {
+		iconPixmaps.clear();
+	}
 	if (iconData) {
 		for (auto data : *iconData) {
 			data->reset();
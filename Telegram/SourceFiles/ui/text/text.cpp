@@ -19,6 +19,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
+// Per-paragraph states of the bidi itemization cache, stored in
+// Text::_bidiCacheState at the paragraph start position.
+constexpr auto kBidiUnknown = uchar(0);
+constexpr auto kBidiTrivial = uchar(1); // Plain LTR, analysis is all zeros.
+constexpr auto kBidiCached = uchar(0x80); // Analysis stored in _bidiCache.
+constexpr auto kBidiCachedHasBidi = uchar(0x01);
+constexpr auto kBidiCachedRtlBase = uchar(0x02);
+
 inline int32 countBlockHeight(const ITextBlock *b, const style::TextStyle *st) {
 	return (b->type() == TextBlockTSkip) ? static_cast<const SkipBlock*>(b)->height() : (st->lineHeight > st->font->height) ? st->lineHeight : st->font->height;
 }
@@ -1123,10 +1131,32 @@ private:
 	void initParagraphBidi() {
 		if (!_parLength || !_parAnalysis.isEmpty()) return;
 
+		bool rtl = (_parDirection == Qt::RightToLeft);
+		auto &cacheState = _t->_bidiCacheState;
+		if (cacheState.size() != _t->_text.size()) {
+			cacheState.fill(kBidiUnknown, _t->_text.size());
+			_t->_bidiCache.clear();
+		}
+		const auto state = uchar(cacheState.at(_parStart));
+		if (state == kBidiTrivial && !rtl) {
+			_parAnalysis.resize(_parLength);
+			memset(_parAnalysis.data(), 0, _parLength * sizeof(QScriptAnalysis));
+			_parHasBidi = false;
+			return;
+		} else if ((state & kBidiCached)
+			&& (((state & kBidiCachedRtlBase) != 0) == rtl)) {
+			_parAnalysis.resize(_parLength);
+			memcpy(
+				_parAnalysis.data(),
+				_t->_bidiCache.constData() + _parStart * sizeof(QScriptAnalysis),
+				_parLength * sizeof(QScriptAnalysis));
+			_parHasBidi = ((state & kBidiCachedHasBidi) != 0);
+			return;
+		}
+
 		Text::TextBlocks::const_iterator i = _parStartBlock, e = _t->_blocks.cend(), n = i + 1;
 
 		bool ignore = false;
-		bool rtl = (_parDirection == Qt::RightToLeft);
 		if (!ignore && !rtl) {
 			ignore = true;
 			const ushort *start = reinterpret_cast<const ushort*>(_str) + _parStart;
@@ -1158,8 +1188,22 @@ private:
 					analysis[i].bidiLevel = 1;
 				_parHasBidi = true;
 			}
+			cacheState[_parStart] = char(kBidiTrivial);
 		} else {
 			_parHasBidi = eBidiItemize(analysis, control);
+
+			auto &cache = _t->_bidiCache;
+			const auto cacheSize = int(_t->_text.size() * sizeof(QScriptAnalysis));
+			if (cache.size() != cacheSize) {
+				cache.fill(0, cacheSize);
+			}
+			memcpy(
+				cache.data() + _parStart * sizeof(QScriptAnalysis),
+				analysis,
+				_parLength * sizeof(QScriptAnalysis));
+			cacheState[_parStart] = char(kBidiCached
+				| (rtl ? kBidiCachedRtlBase : 0)
+				| (_parHasBidi ? kBidiCachedHasBidi : 0));
 		}
 	}
 
@@ -2503,6 +2547,11 @@ Text &Text::operator=(const Text &other) {
 	_blocks = TextBlocks(other._blocks.size());
 	_links = other._links;
 	_startDir = other._startDir;
+	for (auto i = 0; i != kHeightCacheSize; ++i) {
+		_heightCacheWidths[i] = -1;
+	}
+	_bidiCacheState.clear();
+	_bidiCache.clear();
 	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
 		_blocks[i] = other._blocks.at(i)->clone();
 	}
@@ -2518,6 +2567,11 @@ Text &Text::operator=(Text &&other) {
 	_blocks = std::move(other._blocks);
 	_links = other._links;
 	_startDir = other._startDir;
+	for (auto i = 0; i != kHeightCacheSize; ++i) {
+		_heightCacheWidths[i] = -1;
+	}
+	_bidiCacheState.clear();
+	_bidiCache.clear();
 	other.clearFields();
 	return *this;
 }
@@ -2532,6 +2586,9 @@ void Text::setText(const style::TextStyle &st, const QString &text, const TextPa
 }
 
 void Text::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
+	for (auto i = 0; i != kHeightCacheSize; ++i) {
+		_heightCacheWidths[i] = -1;
+	}
 	NewlineBlock *lastNewline = 0;
 
 	_maxWidth = _minHeight = 0;
@@ -2779,10 +2836,18 @@ int Text::countHeight(int width) const {
 	if (QFixed(width) >= _maxWidth) {
 		return _minHeight;
 	}
+	for (auto i = 0; i != kHeightCacheSize; ++i) {
+		if (_heightCacheWidths[i] == width) {
+			return _heightCacheHeights[i];
+		}
+	}
 	int result = 0;
 	enumerateLines(width, [&result](QFixed lineWidth, int lineHeight) {
 		result += lineHeight;
 	});
+	_heightCachePosition = (_heightCachePosition + 1) % kHeightCacheSize;
+	_heightCacheWidths[_heightCachePosition] = width;
+	_heightCacheHeights[_heightCachePosition] = result;
 	return result;
 }
 
@@ -3114,6 +3179,11 @@ void Text::clearFields() {
 	_blocks.clear();
 	_links.clear();
 	_maxWidth = _minHeight = 0;
+	for (auto i = 0; i != kHeightCacheSize; ++i) {
+		_heightCacheWidths[i] = -1;
+	}
+	_bidiCacheState.clear();
+	_bidiCache.clear();
 	_startDir = Qt::LayoutDirectionAuto;
 }
 
@@ -3123,3 +3193,68 @@ void emojiDraw(QPainter &p, EmojiPtr e, int x, int y) {
 	auto size = Ui::Emoji::Size();
 	p.drawPixmap(QPoint(x, y), App::emoji(), QRect(e->x() * size, e->y() * size, size, size));
 }
+
+QString textPerformanceReport() {
+	constexpr auto kIterations = 200;
+
+	const auto entityRich = QString(
+		"Check https://telegram.org and @username with #hashtag, "
+		"/command and mail@example.com somewhere in the text. "
+	).repeated(20);
+	const auto plain = QString(
+		"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+		"eiusmod tempor incididunt ut labore et dolore magna aliqua. "
+	).repeated(20);
+	const auto emojiDense = QString::fromUtf8(
+		"\xF0\x9F\x98\x80\xF0\x9F\x98\x81\xF0\x9F\x98\x82"
+		"\xF0\x9F\x98\x83\xF0\x9F\x98\x84\xF0\x9F\x91\x8D"
+	).repeated(100);
+
+	auto options = TextParseOptions {
+		TextParseLinks | TextParseMentions | TextParseHashtags | TextParseBotCommands | TextParseMultiline,
+		0,
+		0,
+		Qt::LayoutDirectionAuto
+	};
+
+	auto result = QString();
+	const auto row = [&result](const QString &name, TimeMs elapsed, int count) {
+		result += QString("%1: %2 iterations, %3 ms, %4 us each\n"
+		).arg(name
+		).arg(count
+		).arg(elapsed
+		).arg(double(elapsed) * 1000. / count, 0, 'f', 1);
+	};
+
+	auto from = getms();
+	for (auto i = 0; i != kIterations; ++i) {
+		TextUtilities::ParseEntities(entityRich, options.flags);
+	}
+	row(qsl("ParseEntities"), getms() - from, kIterations);
+
+	auto text = Text(int32(100));
+	from = getms();
+	for (auto i = 0; i != kIterations; ++i) {
+		text.setMarkedText(
+			st::defaultTextStyle,
+			TextUtilities::ParseEntities(entityRich, options.flags),
+			options);
+	}
+	row(qsl("setMarkedText"), getms() - from, kIterations);
+
+	text.setText(st::defaultTextStyle, plain, options);
+	from = getms();
+	for (auto i = 0; i != kIterations; ++i) {
+		// Vary the width, otherwise the height cache swallows the work.
+		text.countHeight(240 + (i % 97));
+	}
+	row(qsl("countHeight"), getms() - from, kIterations);
+
+	from = getms();
+	for (auto i = 0; i != kIterations; ++i) {
+		text.setText(st::defaultTextStyle, emojiDense, options);
+	}
+	row(qsl("emoji-dense setText"), getms() - from, kIterations);
+
+	return result;
+}
@@ -217,6 +217,23 @@ private:
 	QFixed _maxWidth = 0;
 	int32 _minHeight = 0;
 
+	// Window resizes run countHeight() for every visible message
+	// again, and toggling a side column resizes back and forth, so
+	// the results for the last few widths are memoized.
+	static constexpr auto kHeightCacheSize = 3;
+	mutable int _heightCacheWidths[kHeightCacheSize] = { -1, -1, -1 };
+	mutable int _heightCacheHeights[kHeightCacheSize] = { 0, 0, 0 };
+	mutable int _heightCachePosition = 0;
+
+	// Bidi itemization of a paragraph depends only on its content, while
+	// painting re-runs it for every visible line, which is costly for
+	// RTL-heavy texts. Results are cached per paragraph at first paint:
+	// a state byte at each paragraph start in _bidiCacheState and the
+	// QScriptAnalysis data in _bidiCache for non-trivial paragraphs, see
+	// TextPainter::initParagraphBidi().
+	mutable QByteArray _bidiCacheState;
+	mutable QByteArray _bidiCache;
+
 	QString _text;
 	const style::TextStyle *_st = nullptr;
 
@@ -374,3 +391,7 @@ inline bool chIsParagraphSeparator(QChar ch) {
 }
 
 void emojiDraw(QPainter &p, EmojiPtr e, int x, int y);
+
+// Runs entity parsing / layout microbenchmarks and returns a report
+// with per-iteration timings, shown by the "textperf" settings code.
+QString textPerformanceReport();
@@ -292,6 +292,61 @@ private:
 
 };
 
+namespace {
+
+// A single slot fits any of the block types, so freed slots can be
+// reused for blocks of another type without per-type bookkeeping.
+constexpr auto kBlockSlotSize = size_t(64);
+constexpr auto kBlockSlabSlots = 1024;
+
+static_assert(sizeof(NewlineBlock) <= kBlockSlotSize, "Bad block slot size.");
+static_assert(sizeof(TextBlock) <= kBlockSlotSize, "Bad block slot size.");
+static_assert(sizeof(EmojiBlock) <= kBlockSlotSize, "Bad block slot size.");
+static_assert(sizeof(SkipBlock) <= kBlockSlotSize, "Bad block slot size.");
+
+struct BlockFreeSlot {
+	BlockFreeSlot *next;
+};
+
+// Slabs are never returned to the system, freed blocks go to the free
+// list and get reused. Texts are created and destroyed from several
+// threads (local storage reads parse messages on its own thread).
+QMutex BlockPoolMutex;
+BlockFreeSlot *BlockFreeList = nullptr;
+char *BlockSlabPointer = nullptr;
+int BlockSlabSlotsLeft = 0;
+
+} // namespace
+
+void *ITextBlock::operator new(size_t size) {
+	Expects(size <= kBlockSlotSize);
+
+	QMutexLocker lock(&BlockPoolMutex);
+	if (const auto slot = BlockFreeList) {
+		BlockFreeList = slot->next;
+		return slot;
+	}
+	if (!BlockSlabSlotsLeft) {
+		BlockSlabPointer = static_cast<char*>(
+			::operator new(kBlockSlotSize * kBlockSlabSlots));
+		BlockSlabSlotsLeft = kBlockSlabSlots;
+	}
+	const auto result = BlockSlabPointer;
+	BlockSlabPointer += kBlockSlotSize;
+	--BlockSlabSlotsLeft;
+	return result;
+}
+
+void ITextBlock::operator delete(void *pointer) {
+	if (!pointer) {
+		return;
+	}
+	QMutexLocker lock(&BlockPoolMutex);
+	const auto slot = static_cast<BlockFreeSlot*>(pointer);
+	slot->next = BlockFreeList;
+	BlockFreeList = slot;
+}
+
 QFixed ITextBlock::f_rbearing() const {
 	return (type() == TextBlockTText) ? static_cast<const TextBlock*>(this)->real_f_rbearing() : 0;
 }
@@ -327,13 +382,17 @@ TextBlock::TextBlock(const style::font &font, const QString &str, QFixed minResi
 
 		const auto part = str.mid(_from, length);
 
-		// Attempt to catch a crash in text processing
-		CrashReports::SetAnnotationRef("CrashString", &part);
+		// Attempt to catch a crash in text processing. This runs for
+		// every block, so use the lock-free annotation slot.
+		CrashReports::SetAnnotationSlot(
+			CrashReports::AnnotationSlot::CrashString,
+			&part);
 
 		QStackTextEngine engine(part, blockFont->f);
 		BlockParser parser(&engine, this, minResizeWidth, _from, part);
 
-		CrashReports::ClearAnnotationRef("CrashString");
+		CrashReports::ClearAnnotationSlot(
+			CrashReports::AnnotationSlot::CrashString);
 	}
 }
 
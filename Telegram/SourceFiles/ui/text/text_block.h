@@ -68,6 +68,12 @@ public:
 	virtual ~ITextBlock() {
 	}
 
+	// Blocks are small and a history slice creates tens of thousands of
+	// them at once, so they are carved from shared fixed-size slabs
+	// instead of going through the general allocator, see text_block.cpp.
+	void *operator new(size_t size);
+	void operator delete(void *pointer);
+
 protected:
 	uint16 _from = 0;
 
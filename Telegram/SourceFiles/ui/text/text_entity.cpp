@@ -10,9 +10,72 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "auth_session.h"
 #include "lang/lang_tag.h"
 
+#ifdef ARCH_CPU_X86_FAMILY
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#else // COMPILER_MSVC
+#include <cpuid.h>
+#endif // COMPILER_MSVC
+#include <immintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
 namespace TextUtilities {
 namespace {
 
+#ifdef ARCH_CPU_X86_FAMILY
+
+#ifdef COMPILER_MSVC
+#define SCAN_SSE2_TARGET
+#else // COMPILER_MSVC
+#define SCAN_SSE2_TARGET __attribute__((target("sse2")))
+#endif // COMPILER_MSVC
+
+bool ScanSse2Available() {
+	static const auto available = [] {
+#ifdef COMPILER_MSVC
+		int data[4] = { 0 };
+		__cpuid(data, 1);
+		return (data[3] & (1 << 26)) != 0;
+#else // COMPILER_MSVC
+		unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+			return false;
+		}
+		return (edx & (1U << 26)) != 0;
+#endif // COMPILER_MSVC
+	}();
+	return available;
+}
+
+SCAN_SSE2_TARGET bool MayHaveEntitiesSse2(const ushort *data, int size) {
+	const auto dot = _mm_set1_epi16('.');
+	const auto at = _mm_set1_epi16('@');
+	const auto hash = _mm_set1_epi16('#');
+	const auto slash = _mm_set1_epi16('/');
+	const auto colon = _mm_set1_epi16(':');
+	auto index = 0;
+	for (; index + 8 <= size; index += 8) {
+		const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+		auto found = _mm_cmpeq_epi16(chars, dot);
+		found = _mm_or_si128(found, _mm_cmpeq_epi16(chars, at));
+		found = _mm_or_si128(found, _mm_cmpeq_epi16(chars, hash));
+		found = _mm_or_si128(found, _mm_cmpeq_epi16(chars, slash));
+		found = _mm_or_si128(found, _mm_cmpeq_epi16(chars, colon));
+		if (_mm_movemask_epi8(found)) {
+			return true;
+		}
+	}
+	for (; index != size; ++index) {
+		const auto ch = data[index];
+		if (ch == '.' || ch == '@' || ch == '#' || ch == '/' || ch == ':') {
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif // ARCH_CPU_X86_FAMILY
+
 QString ExpressionDomain() {
 	// Matches any domain name, containing at least one '.', including "file.txt".
 	return QString::fromUtf8("(?<![\\w\\$\\-\\_%=\\.])(?:([a-zA-Z]+)://)?((?:[A-Za-z" "\xD0\x90-\xD0\xAF\xD0\x81" "\xD0\xB0-\xD1\x8F\xD1\x91" "0-9\\-\\_]+\\.){1,10}([A-Za-z" "\xD1\x80\xD1\x84" "\\-\\d]{2,22})(\\:\\d+)?)");
@@ -1792,6 +1855,27 @@ void ParseMarkdown(
 	}
 }
 
+bool MayHaveEntities(const QString &text) {
+	// Every parsed entity needs one of these trigger characters:
+	// '.' for domains, ':' for explicit protocols, '@' for mentions,
+	// '#' for hashtags and '/' for bot commands. Texts without any of
+	// them can skip the regular expressions entirely.
+	const auto data = reinterpret_cast<const ushort*>(text.unicode());
+	const auto size = text.size();
+#ifdef ARCH_CPU_X86_FAMILY
+	if (ScanSse2Available()) {
+		return MayHaveEntitiesSse2(data, size);
+	}
+#endif // ARCH_CPU_X86_FAMILY
+	for (auto index = 0; index != size; ++index) {
+		const auto ch = data[index];
+		if (ch == '.' || ch == '@' || ch == '#' || ch == '/' || ch == ':') {
+			return true;
+		}
+	}
+	return false;
+}
+
 TextWithEntities ParseEntities(const QString &text, int32 flags) {
 	const auto rich = ((flags & TextParseRichText) != 0);
 	auto result = TextWithEntities{ text, EntitiesInText() };
@@ -1820,7 +1904,8 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 	int32 len = result.text.size(), commandOffset = rich ? 0 : len;
 	bool inLink = false, commandIsLink = false;
 	const QChar *start = result.text.constData(), *end = start + result.text.size();
-	for (int32 offset = 0, matchOffset = offset, mentionSkip = 0; offset < len;) {
+	const auto mayHaveEntities = MayHaveEntities(result.text);
+	for (int32 offset = 0, matchOffset = offset, mentionSkip = 0; mayHaveEntities && offset < len;) {
 		if (commandOffset <= offset) {
 			for (commandOffset = offset; commandOffset < len; ++commandOffset) {
 				if (*(start + commandOffset) == TextCommand) {
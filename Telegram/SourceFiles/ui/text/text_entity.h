@@ -156,6 +156,11 @@ namespace TextUtilities {
 bool IsValidProtocol(const QString &protocol);
 bool IsValidTopDomain(const QString &domain);
 
+// Fast check that the text contains at least one character that could
+// start or be part of a parsed entity, so large plain texts skip the
+// regular expression machinery in ParseEntities().
+bool MayHaveEntities(const QString &text);
+
 const QRegularExpression &RegExpDomain();
 const QRegularExpression &RegExpDomainExplicit();
 const QRegularExpression &RegExpMailNameAtEnd();
@@ -815,25 +815,16 @@ bool FlatTextarea::isRedoAvailable() const {
 	return _redoAvailable;
 }
 
-void FlatTextarea::parseLinks() { // some code is duplicated in text.cpp!
+FlatTextarea::LinkRanges FlatTextarea::scanForLinks(const QString &text, int from, int till) const { // some code is duplicated in text.cpp!
 	LinkRanges newLinks;
 
-	QString text(toPlainText());
-	if (text.isEmpty()) {
-		if (!_links.isEmpty()) {
-			_links.clear();
-			emit linksChanged();
-		}
-		return;
-	}
-
-	auto len = text.size();
 	const QChar *start = text.unicode(), *end = start + text.size();
-	for (auto offset = 0, matchOffset = offset; offset < len;) {
+	for (auto offset = from, matchOffset = offset; offset < till;) {
 		auto m = TextUtilities::RegExpDomain().match(text, matchOffset);
 		if (!m.hasMatch()) break;
 
 		auto domainOffset = m.capturedStart();
+		if (domainOffset >= till) break;
 
 		auto protocol = m.captured(1).toLower();
 		auto topDomain = m.captured(3).toLower();
@@ -890,6 +881,63 @@ void FlatTextarea::parseLinks() { // some code is duplicated in text.cpp!
 		offset = matchOffset = p - start;
 	}
 
+	return newLinks;
+}
+
+void FlatTextarea::parseLinks() {
+	QString text(toPlainText());
+	if (text.isEmpty() || !TextUtilities::MayHaveEntities(text)) {
+		if (!_links.isEmpty()) {
+			_links.clear();
+			emit linksChanged();
+		}
+		return;
+	}
+
+	auto newLinks = scanForLinks(text, 0, text.size());
+	if (newLinks != _links) {
+		_links = newLinks;
+		emit linksChanged();
+	}
+}
+
+void FlatTextarea::parseLinksInRange(int changedFrom, int changedTill, int delta) {
+	QString text(toPlainText());
+	if (text.isEmpty() || !TextUtilities::MayHaveEntities(text)) {
+		if (!_links.isEmpty()) {
+			_links.clear();
+			emit linksChanged();
+		}
+		return;
+	}
+
+	// Expand the changed range to whitespace borders, links cannot cross
+	// them. Link ranges keep one character of padding on each side, so
+	// pad the window by one character as well.
+	auto from = snap(changedFrom, 0, text.size());
+	auto till = snap(changedTill, from, text.size());
+	while (from > 0 && !chIsSpace(text.at(from - 1))) {
+		--from;
+	}
+	while (till < text.size() && !chIsSpace(text.at(till))) {
+		++till;
+	}
+	from = qMax(from - 1, 0);
+	till = qMin(till + 1, text.size());
+
+	auto newLinks = LinkRanges();
+	for (auto &link : _links) {
+		if (link.start + link.length <= from) {
+			newLinks.push_back(link);
+		}
+	}
+	newLinks += scanForLinks(text, from, till);
+	for (auto &link : _links) {
+		if (link.start >= till - delta) {
+			newLinks.push_back({ link.start + delta, link.length });
+		}
+	}
+
 	if (newLinks != _links) {
 		_links = newLinks;
 		emit linksChanged();
@@ -1252,7 +1300,10 @@ void FlatTextarea::onDocumentContentsChange(int position, int charsRemoved, int
 			if (changed) emit linksChanged();
 		}
 	} else {
-		parseLinks();
+		parseLinksInRange(
+			qMin(insertPosition, removePosition),
+			qMax(insertPosition + insertLength, removePosition),
+			insertLength - removeLength);
 	}
 
 	if (document()->availableRedoSteps() > 0) {
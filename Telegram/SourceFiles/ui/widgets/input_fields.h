@@ -214,6 +214,16 @@ private:
 	friend bool operator==(const LinkRange &a, const LinkRange &b);
 	friend bool operator!=(const LinkRange &a, const LinkRange &b);
 	using LinkRanges = QVector<LinkRange>;
+
+	// Scans [from, till) of text for links, see parseLinks().
+	LinkRanges scanForLinks(const QString &text, int from, int till) const;
+
+	// Re-parses links only in the edited part of the text: the changed
+	// range is expanded to whitespace borders (links cannot cross them)
+	// and links outside of it are kept, shifted by delta if they were
+	// after the edit.
+	void parseLinksInRange(int changedFrom, int changedTill, int delta);
+
 	LinkRanges _links;
 };
 
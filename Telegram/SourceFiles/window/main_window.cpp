@@ -18,9 +18,53 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 
 namespace Window {
+namespace {
+
+constexpr auto kWarmSnapshotFadeDuration = TimeMs(200);
+
+} // namespace
 
 constexpr auto kInactivePressTimeout = 200;
 
+// Covers the body with the screenshot from the last quit until the
+// real widgets are ready, then cross-fades away and deletes itself.
+class WarmSnapshot : public TWidget {
+public:
+	WarmSnapshot(QWidget *parent, QPixmap &&image)
+	: TWidget(parent)
+	, _image(std::move(image)) {
+	}
+
+	void fadeOut() {
+		if (_hiding) {
+			return;
+		}
+		_hiding = true;
+		_a_opacity.start([this] { animationCallback(); }, 1., 0., kWarmSnapshotFadeDuration);
+	}
+
+protected:
+	void paintEvent(QPaintEvent *e) override {
+		Painter p(this);
+		p.setOpacity(_a_opacity.current(getms(), _hiding ? 0. : 1.));
+		p.drawPixmap(rect(), _image);
+	}
+
+private:
+	void animationCallback() {
+		update();
+		if (_hiding && !_a_opacity.animating()) {
+			hide();
+			deleteLater();
+		}
+	}
+
+	QPixmap _image;
+	Animation _a_opacity;
+	bool _hiding = false;
+
+};
+
 QImage LoadLogo() {
 	return QImage(qsl(":/gui/art/logo_256.png"));
 }
@@ -269,6 +313,55 @@ void MainWindow::updateControlsGeometry() {
 		_rightColumn->setGeometry(bodyWidth, bodyTop, width() - bodyWidth, height() - bodyTop);
 	}
 	_body->setGeometry(0, bodyTop, bodyWidth, height() - bodyTop);
+	if (_warmSnapshot) {
+		_warmSnapshot->setGeometry(_body->geometry());
+	}
+}
+
+void MainWindow::showWarmSnapshot() {
+	auto image = Local::readWindowSnapshot();
+	if (image.isNull()) {
+		return;
+	}
+
+	// A stale snapshot shouldn't survive this launch - it gets written
+	// back at the next normal quit.
+	Local::clearWindowSnapshot();
+
+	const auto startHidden = cStartInTray()
+		|| (cLaunchMode() == LaunchModeAutoStart && cStartMinimized());
+	if (startHidden || cWindowPos().maximized) {
+		return;
+	}
+	_warmSnapshot = object_ptr<WarmSnapshot>(
+		this,
+		App::pixmapFromImageInPlace(std::move(image)));
+	_warmSnapshot->setGeometry(_body->geometry());
+	_warmSnapshot->show();
+	_warmSnapshot->raise();
+	show();
+}
+
+void MainWindow::saveWarmSnapshot() {
+	if (Global::LocalPasscode()
+		|| !positionInited()
+		|| !AuthSession::Exists()) {
+		Local::clearWindowSnapshot();
+		return;
+	}
+	Local::writeWindowSnapshot(Ui::GrabWidget(_body.data()).toImage());
+}
+
+void MainWindow::destroyWarmSnapshot(anim::type animated) {
+	if (!_warmSnapshot) {
+		return;
+	} else if (animated == anim::type::instant) {
+		_warmSnapshot.destroy();
+	} else {
+		// Deletes itself when the fade ends.
+		_warmSnapshot->fadeOut();
+		_warmSnapshot = nullptr;
+	}
 }
 
 void MainWindow::updateUnreadCounter() {
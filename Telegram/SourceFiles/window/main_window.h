@@ -17,6 +17,7 @@ namespace Window {
 
 class Controller;
 class TitleWidget;
+class WarmSnapshot;
 
 QImage LoadLogo();
 QImage LoadLogoNoMargin();
@@ -79,6 +80,16 @@ public:
 		return _body.data();
 	}
 
+	// Shows the window right away with the screenshot saved at the
+	// last quit covering the body, so launch feels instant while the
+	// local cache is being read and the real widgets are created.
+	void showWarmSnapshot();
+
+	// Captures the screenshot for the next launch. Skipped (and the
+	// old file removed) when a local passcode is set, so no message
+	// text lies around readable while the storage is locked.
+	void saveWarmSnapshot();
+
 	void launchDrag(std::unique_ptr<QMimeData> data);
 	base::Observable<void> &dragFinished() {
 		return _dragFinished;
@@ -147,6 +158,9 @@ protected:
 
 	void setPositionInited();
 
+	// Cross-fades the warm snapshot away over the real widgets.
+	void destroyWarmSnapshot(anim::type animated);
+
 private slots:
 	void savePositionByTimer() {
 		savePosition();
@@ -168,6 +182,7 @@ private:
 	object_ptr<TitleWidget> _title = { nullptr };
 	object_ptr<TWidget> _body;
 	object_ptr<TWidget> _rightColumn = { nullptr };
+	object_ptr<WarmSnapshot> _warmSnapshot = { nullptr };
 
 	QIcon _icon;
 	QString _titleText;
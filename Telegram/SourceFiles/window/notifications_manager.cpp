@@ -28,6 +28,13 @@ namespace {
 // not more than one sound in 500ms from one peer - grouping
 constexpr auto kMinimalAlertDelay = TimeMs(500);
 
+// not more than this count of native toasts from one peer in one window,
+// the rest is collapsed to a single "N new messages" summary - so during
+// a storm the shell is not asked to animate dozens of toasts at once
+constexpr auto kNativeBatchWindow = TimeMs(6000);
+constexpr auto kNativeBatchThreshold = 3;
+constexpr auto kNativeBatchFlushDelay = TimeMs(2000);
+
 } // namespace
 
 System::System(AuthSession *session) : _authSession(session) {
@@ -454,10 +461,35 @@ void Manager::notificationReplied(
 	}
 }
 
+NativeManager::NativeManager(System *system) : Manager(system) {
+	_batchTimer.setTimeoutHandler([this] {
+		flushBatches();
+	});
+}
+
 void NativeManager::doShowNotification(HistoryItem *item, int forwardedCount) {
 	const auto options = getNotificationOptions(item);
 
 	const auto title = options.hideNameAndPhoto ? qsl("Telegram Desktop") : item->history()->peer->name;
+
+	const auto peer = item->history()->peer;
+	const auto ms = getms(true);
+	auto &batch = _batches[peer];
+	if (!batch.windowStart || ms > batch.windowStart + kNativeBatchWindow) {
+		batch.windowStart = ms;
+		batch.shownInWindow = 0;
+	}
+	if (++batch.shownInWindow > kNativeBatchThreshold || batch.pending > 0) {
+		++batch.pending;
+		batch.lastMsgId = item->id;
+		batch.title = title;
+		batch.hideNameAndPhoto = options.hideNameAndPhoto;
+		if (!_batchTimer.isActive()) {
+			_batchTimer.start(kNativeBatchFlushDelay);
+		}
+		return;
+	}
+
 	const auto subtitle = options.hideNameAndPhoto ? QString() : item->notificationHeader();
 	const auto text = options.hideMessageText
 		? lang(lng_notification_preview)
@@ -475,6 +507,23 @@ void NativeManager::doShowNotification(HistoryItem *item, int forwardedCount) {
 		options.hideReplyButton);
 }
 
+void NativeManager::flushBatches() {
+	for (auto i = _batches.begin(); i != _batches.end(); ++i) {
+		auto &batch = i.value();
+		if (!batch.pending) continue;
+
+		doShowNativeNotification(
+			i.key(),
+			batch.lastMsgId,
+			batch.title,
+			QString(),
+			lng_notification_batch(lt_count, batch.pending),
+			batch.hideNameAndPhoto,
+			true);
+		batch.pending = 0;
+	}
+}
+
 System::~System() = default;
 
 } // namespace Notifications
@@ -170,12 +170,14 @@ private:
 
 class NativeManager : public Manager {
 protected:
-	using Manager::Manager;
+	NativeManager(System *system);
 
 	void doUpdateAll() override {
+		_batches.clear();
 		doClearAllFast();
 	}
 	void doClearAll() override {
+		_batches.clear();
 		doClearAllFast();
 	}
 	void doClearFromItem(HistoryItem *item) override {
@@ -184,6 +186,23 @@ protected:
 
 	virtual void doShowNativeNotification(PeerData *peer, MsgId msgId, const QString &title, const QString &subtitle, const QString &msg, bool hideNameAndPhoto, bool hideReplyButton) = 0;
 
+private:
+	// During a notification storm the per-chat toasts over a threshold
+	// collapse into one grouped "N new messages" summary, so the shell
+	// gets at most the threshold of toasts per chat per window.
+	struct ChatBatch {
+		TimeMs windowStart = 0;
+		int shownInWindow = 0;
+		int pending = 0;
+		MsgId lastMsgId = 0;
+		QString title;
+		bool hideNameAndPhoto = false;
+	};
+	void flushBatches();
+
+	QMap<PeerData*, ChatBatch> _batches;
+	SingleTimer _batchTimer;
+
 };
 
 } // namespace Notifications
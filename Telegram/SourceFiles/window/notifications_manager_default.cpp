@@ -53,7 +53,8 @@ std::unique_ptr<Manager> Create(System *system) {
 	return std::make_unique<Manager>(system);
 }
 
-Manager::Manager(System *system) : Notifications::Manager(system) {
+Manager::Manager(System *system) : Notifications::Manager(system)
+, _queuedShowNext([this] { showNextFromQueue(); }) {
 	subscribe(system->authSession()->downloader().taskFinished(), [this] {
 		for_const (auto &notification, _notifications) {
 			notification->updatePeerPhoto();
@@ -112,9 +113,8 @@ void Manager::settingsChanged(ChangeType change) {
 			}
 		}
 		if (allow > 0) {
-			for (int i = 0; i != allow; ++i) {
-				showNextFromQueue();
-			}
+			// One pass fills all the free slots.
+			_queuedShowNext.call();
 		}
 	} else if (change == ChangeType::DemoIsShown) {
 		auto demoIsShown = Global::NotificationsDemoIsShown();
@@ -270,7 +270,7 @@ void Manager::unlinkFromShown(Notification *remove) {
 			_positionsOutdated = true;
 		}
 	}
-	showNextFromQueue();
+	_queuedShowNext.call();
 }
 
 void Manager::removeWidget(internal::Widget *remove) {
@@ -285,12 +285,12 @@ void Manager::removeWidget(internal::Widget *remove) {
 			_positionsOutdated = true;
 		}
 	}
-	showNextFromQueue();
+	_queuedShowNext.call();
 }
 
 void Manager::doShowNotification(HistoryItem *item, int forwardedCount) {
 	_queuedNotifications.push_back(QueuedNotification(item, forwardedCount));
-	showNextFromQueue();
+	_queuedShowNext.call();
 }
 
 void Manager::doClearAll() {
@@ -298,7 +298,7 @@ void Manager::doClearAll() {
 	for_const (auto &notification, _notifications) {
 		notification->unlinkHistory();
 	}
-	showNextFromQueue();
+	_queuedShowNext.call();
 }
 
 void Manager::doClearAllFast() {
@@ -320,7 +320,7 @@ void Manager::doClearFromHistory(History *history) {
 			_positionsOutdated = true;
 		}
 	}
-	showNextFromQueue();
+	_queuedShowNext.call();
 }
 
 void Manager::doClearFromItem(HistoryItem *item) {
@@ -335,8 +335,7 @@ void Manager::doClearFromItem(HistoryItem *item) {
 		}
 	}
 	if (showNext) {
-		// This call invalidates _notifications iterators.
-		showNextFromQueue();
+		_queuedShowNext.call();
 	}
 }
 
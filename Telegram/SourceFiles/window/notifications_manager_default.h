@@ -81,6 +81,11 @@ private:
 	bool _positionsOutdated = false;
 	SingleTimer _inputCheckTimer;
 
+	// Showing a notification builds a widget and renders its content,
+	// so the queue is processed once at the end of the event loop tick:
+	// a burst of messages arriving in one tick is shown as one batch.
+	SingleQueuedInvokation _queuedShowNext;
+
 	struct QueuedNotification {
 		QueuedNotification(not_null<HistoryItem*> item, int forwardedCount);
 
@@ -331,7 +331,7 @@ void adjustColor(style::color color, float64 hue, float64 saturation) {
 	color.set(original.red(), original.green(), original.blue(), original.alpha());
 }
 
-void adjustColorsUsingBackground(const QImage &img) {
+QColor countAverageColor(const QImage &img) {
 	Assert(img.format() == QImage::Format_ARGB32_Premultiplied);
 
 	uint64 components[3] = { 0 };
@@ -353,7 +353,10 @@ void adjustColorsUsingBackground(const QImage &img) {
 		}
 	}
 
-	auto bgColor = QColor(components[0], components[1], components[2]);
+	return QColor(components[0], components[1], components[2]);
+}
+
+void adjustColorsUsingBackground(QColor bgColor) {
 	auto hue = bgColor.hslHueF();
 	auto saturation = bgColor.hslSaturationF();
 	adjustColor(st::msgServiceBg, hue, saturation);
@@ -380,6 +383,9 @@ void ChatBackground::start() {
 }
 
 void ChatBackground::setImage(int32 id, QImage &&image) {
+	if (!_keepImageAverageColor) {
+		_imageAverageColorValid = false;
+	}
 	auto resetPalette = (id == kDefaultBackground && _id != kDefaultBackground && !Local::hasTheme());
 	if (id == kThemeBackground && _themeImage.isNull()) {
 		id = kDefaultBackground;
@@ -456,7 +462,14 @@ void ChatBackground::setPreparedImage(QImage &&image) {
 	};
 
 	if (adjustColors()) {
-		adjustColorsUsingBackground(image);
+		// Counting the average color scans every pixel, so it is cached
+		// while the image content stays the same - reapplying the same
+		// background with a new palette (the night mode toggle) skips it.
+		if (!_imageAverageColorValid) {
+			_imageAverageColor = countAverageColor(image);
+			_imageAverageColorValid = true;
+		}
+		adjustColorsUsingBackground(_imageAverageColor);
 	}
 
 	auto width = image.width();
@@ -565,8 +578,7 @@ void ChatBackground::setTestingTheme(Instance &&theme, ChangeMode mode) {
 		setImage(internal::kTestingThemeBackground, std::move(theme.background));
 		setTile(theme.tiled);
 	} else {
-		// Apply current background image so that service bg colors are recounted.
-		setImage(_id, std::move(_pixmap).toImage());
+		reapplyWithNewPalette();
 	}
 	notify(BackgroundUpdate(BackgroundUpdate::Type::TestingTheme, _tile), true);
 }
@@ -578,8 +590,7 @@ void ChatBackground::setTestingDefaultTheme() {
 		setImage(internal::kTestingDefaultBackground);
 		setTile(false);
 	} else {
-		// Apply current background image so that service bg colors are recounted.
-		setImage(_id, std::move(_pixmap).toImage());
+		reapplyWithNewPalette();
 	}
 	notify(BackgroundUpdate(BackgroundUpdate::Type::TestingTheme, _tile), true);
 }
@@ -604,6 +615,15 @@ void ChatBackground::keepApplied() {
 	notify(BackgroundUpdate(BackgroundUpdate::Type::ApplyingTheme, _tile), true);
 }
 
+void ChatBackground::reapplyWithNewPalette() {
+	// Apply current background image so that service bg colors are recounted.
+	// The image pixels are unchanged, only the palette is, so the cached
+	// average color used for the adjustment stays valid.
+	auto guard = gsl::finally([this] { _keepImageAverageColor = false; });
+	_keepImageAverageColor = true;
+	setImage(_id, std::move(_pixmap).toImage());
+}
+
 void ChatBackground::writeNewBackgroundSettings() {
 	if (_tile != _tileForRevert) {
 		Local::writeUserSettings();
@@ -618,8 +638,7 @@ void ChatBackground::revert() {
 		setTile(_tileForRevert);
 		setImage(_idForRevert, std::move(_imageForRevert));
 	} else {
-		// Apply current background image so that service bg colors are recounted.
-		setImage(_id, std::move(_pixmap).toImage());
+		reapplyWithNewPalette();
 	}
 	notify(BackgroundUpdate(BackgroundUpdate::Type::RevertingTheme, _tile), true);
 }
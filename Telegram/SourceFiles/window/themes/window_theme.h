@@ -113,6 +113,7 @@ private:
 	void ensureStarted();
 	void saveForRevert();
 	void setPreparedImage(QImage &&image);
+	void reapplyWithNewPalette();
 	void writeNewBackgroundSettings();
 
 	int32 _id = internal::kUninitializedBackground;
@@ -120,6 +121,13 @@ private:
 	QPixmap _pixmapForTiled;
 	bool _tile = false;
 
+	// Average background color, used to adjust the service message colors.
+	// Stays valid while the image content does not change, so a palette-only
+	// reapply does not rescan all the background pixels.
+	QColor _imageAverageColor;
+	bool _imageAverageColorValid = false;
+	bool _keepImageAverageColor = false;
+
 	QImage _themeImage;
 	bool _themeTile = false;
 
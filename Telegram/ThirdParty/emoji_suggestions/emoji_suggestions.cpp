@@ -109,8 +109,23 @@ class Completer {
 public:
 	Completer(utf16string query);
 
+	// Matching is monotone: a query extended by one more character
+	// can only lose matches, never gain them. So when the current
+	// query just extends the previous one we refilter the previous
+	// matches instead of the whole first-character list.
+	void restrictToPrevious(
+		const std::vector<utf16char> &query,
+		const std::vector<const Replacement*> &matches);
+
 	std::vector<Suggestion> resolve();
 
+	const std::vector<utf16char> &normalizedQuery() const {
+		return _query;
+	}
+	std::vector<const Replacement*> takeMatches() {
+		return std::move(_matches);
+	}
+
 private:
 	struct Result {
 		const Replacement *replacement;
@@ -140,6 +155,8 @@ private:
 	int _querySize = 0;
 
 	const std::vector<const Replacement*> *_initialList = nullptr;
+	const std::vector<const Replacement*> *_restrictList = nullptr;
+	std::vector<const Replacement*> _matches;
 
 	string_span _currentItemWords;
 	int _currentItemWordsUsedCount = 0;
@@ -188,6 +205,17 @@ Completer::UsedWordGuard::~UsedWordGuard() {
 Completer::Completer(utf16string query) : _initialQuery(query), _query(NormalizeQuery(query)) {
 }
 
+void Completer::restrictToPrevious(
+		const std::vector<utf16char> &query,
+		const std::vector<const Replacement*> &matches) {
+	if (query.empty()
+		|| _query.size() < query.size()
+		|| !std::equal(query.begin(), query.end(), _query.begin())) {
+		return;
+	}
+	_restrictList = &matches;
+}
+
 // Remove all non-letters-or-numbers.
 // Leave '-' and '+' only if they're followed by a number or
 // at the end of the query (so it is possibly followed by a number).
@@ -226,10 +254,13 @@ std::vector<Suggestion> Completer::resolve() {
 	if (!_querySize) {
 		return std::vector<Suggestion>();
 	}
-	_initialList = Ui::Emoji::internal::GetReplacements(*_queryBegin);
+	_initialList = _restrictList
+		? _restrictList
+		: Ui::Emoji::internal::GetReplacements(*_queryBegin);
 	if (!_initialList) {
 		return std::vector<Suggestion>();
 	}
+	_matches.reserve(_initialList->size());
 	_result.reserve(_initialList->size());
 	processInitialList();
 	return prepareResult();
@@ -272,6 +303,7 @@ void Completer::processInitialList() {
 		_currentItemWordsUsedCount = 1;
 		for (auto item : *_initialList) {
 			addResult(item);
+			_matches.push_back(item);
 		}
 	}
 }
@@ -294,6 +326,10 @@ void Completer::filterInitialList() {
 		_currentItemWordsUsedCount = 1;
 		if (matchQueryForCurrentItem()) {
 			addResult(item);
+			// Keep every matched item, not only the deduplicated
+			// results - a dropped duplicate may still match a longer
+			// query when the kept one no longer does.
+			_matches.push_back(item);
 		}
 		_currentItemWordsUsedCount = 0;
 	}
@@ -423,7 +459,18 @@ string_span Completer::findWordsStartingWith(utf16char ch) {
 } // namespace
 
 std::vector<Suggestion> GetSuggestions(utf16string query) {
-	return Completer(query).resolve();
+	// Suggestions are requested from the UI thread only, so the last
+	// query and its matches are kept in plain statics and reused
+	// while the user keeps extending the query.
+	static std::vector<utf16char> LastQuery;
+	static std::vector<const Replacement*> LastMatches;
+
+	auto completer = Completer(query);
+	completer.restrictToPrevious(LastQuery, LastMatches);
+	auto result = completer.resolve();
+	LastQuery = completer.normalizedQuery();
+	LastMatches = completer.takeMatches();
+	return result;
 }
 
 int GetSuggestionMaxLength() {
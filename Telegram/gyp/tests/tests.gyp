@@ -78,6 +78,53 @@
       '<(src_loc)/base/flat_set.h',
       '<(src_loc)/base/flat_set_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_hash_map',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/hash_map.h',
+      '<(src_loc)/base/hash_map_tests.cpp',
+    ],
+  }, {
+    # Built with the tests but never run automatically: execute the
+    # binary by hand to get tab-separated timing lines for tracking.
+    'target_name': 'benchmarks',
+    'includes': [
+      'common_benchmark.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/flat_map_benchmark.cpp',
+      '<(src_loc)/mtproto/wire_benchmark.cpp',
+      '<(src_loc)/rpl/producer_benchmark.cpp',
+    ],
+    'conditions': [
+      [ 'build_win', {
+        'include_dirs': [
+          '<(libs_loc)/openssl/Release/include',
+        ],
+      }],
+      [ 'build_mac', {
+        'include_dirs': [
+          '<(libs_loc)/openssl/include',
+        ],
+      }],
+      [ 'build_linux', {
+        'include_dirs': [
+          '/usr/local/ssl/include',
+        ],
+      }],
+    ],
+  }, {
+    'target_name': 'tests_snapshot',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/snapshot.h',
+      '<(src_loc)/base/snapshot_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_rpl',
     'includes': [